@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "stats_log_util.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+// Adds a simple predicate that starts on an atom that is never logged, and returns it.
+static Predicate AddUnusedPredicate(const string& name, int atomId, StatsdConfig* config) {
+    *config->add_atom_matcher() = CreateSimpleAtomMatcher(name, atomId);
+    auto predicate = config->add_predicate();
+    predicate->set_id(StringToId(name + "Predicate"));
+    predicate->mutable_simple_predicate()->set_start(StringToId(name));
+    return *predicate;
+}
+
+// A config with a count metric conditioned on a chain of `depth` OR combinations, with the screen
+// state at the bottom of the chain:
+//   Chain0 = ScreenIsOff || Unused0, Chain1 = Chain0 || Unused1, ...
+// plus `numUnrelated` simple predicates on atoms that are never logged. Every screen event changes
+// the whole chain, while the unrelated predicates should not add to the cost of an event.
+static StatsdConfig CreateConfigWithConditionChain(int depth, int numUnrelated) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    *config.add_atom_matcher() = CreateScreenTurnedOffAtomMatcher();
+    Predicate child = CreateScreenIsOffPredicate();
+    *config.add_predicate() = child;
+
+    for (int i = 0; i < depth; i++) {
+        Predicate unused = AddUnusedPredicate("Unused" + std::to_string(i), 100000 + i, &config);
+        auto combination = config.add_predicate();
+        combination->set_id(StringToId("Chain" + std::to_string(i)));
+        combination->mutable_combination()->set_operation(LogicalOperation::OR);
+        addPredicateToPredicateCombination(child, combination);
+        addPredicateToPredicateCombination(unused, combination);
+        child = *combination;
+    }
+
+    for (int i = 0; i < numUnrelated; i++) {
+        AddUnusedPredicate("Unrelated" + std::to_string(i), 200000 + i, &config);
+    }
+
+    auto metric = config.add_count_metric();
+    metric->set_id(StringToId("ScreenTurnedOnCount"));
+    metric->set_what(StringToId("ScreenTurnedOn"));
+    metric->set_condition(child.id());
+    metric->set_bucket(FIVE_MINUTES);
+    return config;
+}
+
+static void BM_ConditionChainEvaluation(benchmark::State& state) {
+    ConfigKey cfgKey;
+    auto config = CreateConfigWithConditionChain(state.range(0), state.range(1));
+    int64_t bucketStartTimeNs = 10000000000;
+    auto processor = CreateStatsLogProcessor(bucketStartTimeNs / NS_PER_SEC, config, cfgKey);
+
+    std::vector<std::unique_ptr<LogEvent>> events;
+    for (int i = 0; i < 100; i++) {
+        events.push_back(CreateScreenStateChangedEvent(
+                i % 2 == 0 ? android::view::DISPLAY_STATE_ON : android::view::DISPLAY_STATE_OFF,
+                bucketStartTimeNs + i));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+// The config must stay under StatsdStats::kMaxConditionCountPerConfig predicates.
+BENCHMARK(BM_ConditionChainEvaluation)
+        ->Args({1, 0})
+        ->Args({1, 200})
+        ->Args({10, 0})
+        ->Args({10, 200})
+        ->Args({50, 0})
+        ->Args({50, 150});
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
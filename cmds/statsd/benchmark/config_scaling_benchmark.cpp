@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "stats_log_util.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+// A config that does some work on every screen event: count metrics on both screen states, half
+// of them while the screen is off.
+static StatsdConfig CreateScreenConfig() {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    *config.add_atom_matcher() = CreateScreenTurnedOffAtomMatcher();
+    Predicate screenIsOff = CreateScreenIsOffPredicate();
+    *config.add_predicate() = screenIsOff;
+
+    for (int i = 0; i < 20; i++) {
+        auto metric = config.add_count_metric();
+        metric->set_id(StringToId("ScreenCount" + std::to_string(i)));
+        metric->set_what(StringToId(i % 2 == 0 ? "ScreenTurnedOn" : "ScreenTurnedOff"));
+        if (i % 4 < 2) {
+            metric->set_condition(screenIsOff.id());
+        }
+        metric->set_bucket(FIVE_MINUTES);
+    }
+    return config;
+}
+
+// Processes screen events with state.range(0) configs, spread over state.range(1) extra threads.
+static void BM_ConfigScaling(benchmark::State& state) {
+    const int configCount = state.range(0);
+    int64_t bucketStartTimeNs = 10000000000;
+    auto config = CreateScreenConfig();
+    auto processor = CreateStatsLogProcessor(bucketStartTimeNs / NS_PER_SEC, config, ConfigKey());
+    for (int i = 1; i < configCount; i++) {
+        processor->OnConfigUpdated(bucketStartTimeNs, ConfigKey(1000 + i, i), config);
+    }
+    processor->setWorkerThreadCount(state.range(1));
+
+    std::vector<std::unique_ptr<LogEvent>> events;
+    for (int i = 0; i < 100; i++) {
+        events.push_back(CreateScreenStateChangedEvent(
+                i % 2 == 0 ? android::view::DISPLAY_STATE_ON : android::view::DISPLAY_STATE_OFF,
+                bucketStartTimeNs + i));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+static void ConfigScalingArgs(benchmark::internal::Benchmark* b) {
+    for (int configCount : {1, 2, 4, 8, 16}) {
+        for (int threadCount : {0, 1, 3}) {
+            b->Args({configCount, threadCount});
+        }
+    }
+}
+
+BENCHMARK(BM_ConfigScaling)->Apply(ConfigScalingArgs)->UseRealTime();
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -69,6 +69,17 @@ static void BM_LogEventCreation(benchmark::State& state) {
 }
 BENCHMARK(BM_LogEventCreation);
 
+static void BM_LogEventRecycled(benchmark::State& state) {
+    log_msg msg;
+    getSimpleLogMsgData(&msg);
+    LogEvent event(msg);
+    while (state.KeepRunning()) {
+        event.readFrom(msg);
+        benchmark::DoNotOptimize(event);
+    }
+}
+BENCHMARK(BM_LogEventRecycled);
+
 }  //  namespace statsd
 }  //  namespace os
 }  //  namespace android
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "matchers/CompiledSimpleAtomMatcher.h"
+#include "matchers/matcher_util.h"
+#include "packages/UidMap.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+// A wakelock-like event, matched by the package of any of its attribution uids and by its state.
+// The UidMap holds [appCount] apps, as on a device with that many packages installed.
+static void createUidMapEventAndMatcher(int appCount, UidMap* uidMap, LogEvent* event,
+                                        SimpleAtomMatcher* matcher) {
+    vector<int32_t> uids;
+    vector<int64_t> versions;
+    vector<String16> apps;
+    for (int i = 0; i < appCount; i++) {
+        uids.push_back(10000 + i);
+        versions.push_back(1);
+        apps.push_back(String16(("com.example.app" + std::to_string(i)).c_str()));
+    }
+    uidMap->updateMap(1, uids, versions, apps);
+
+    AttributionNodeInternal node1;
+    node1.set_uid(1000);
+    node1.set_tag("system");
+    AttributionNodeInternal node2;
+    node2.set_uid(10000 + appCount / 2);
+    node2.set_tag("location");
+    std::vector<AttributionNodeInternal> nodes = {node1, node2};
+    event->write(nodes);
+    event->write(1);
+    event->write("wakelock");
+    event->init();
+
+    matcher->set_atom_id(event->GetTagId());
+    auto attributionMatcher = matcher->add_field_value_matcher();
+    attributionMatcher->set_field(1);
+    attributionMatcher->set_position(Position::ANY);
+    auto uidMatcher = attributionMatcher->mutable_matches_tuple()->add_field_value_matcher();
+    uidMatcher->set_field(1);
+    uidMatcher->set_eq_string("com.example.app" + std::to_string(appCount / 2));
+    auto stateMatcher = matcher->add_field_value_matcher();
+    stateMatcher->set_field(2);
+    stateMatcher->set_eq_int(1);
+}
+
+static void BM_MatchesSimple(benchmark::State& state) {
+    UidMap uidMap;
+    LogEvent event(10, 100000);
+    SimpleAtomMatcher matcher;
+    createUidMapEventAndMatcher(state.range(0), &uidMap, &event, &matcher);
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(matchesSimple(uidMap, matcher, event));
+    }
+}
+
+BENCHMARK(BM_MatchesSimple)->Arg(10)->Arg(300);
+
+static void BM_CompiledSimpleAtomMatcher(benchmark::State& state) {
+    UidMap uidMap;
+    LogEvent event(10, 100000);
+    SimpleAtomMatcher matcher;
+    createUidMapEventAndMatcher(state.range(0), &uidMap, &event, &matcher);
+    CompiledSimpleAtomMatcher compiled(matcher);
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(compiled.matches(uidMap, event));
+    }
+}
+
+BENCHMARK(BM_CompiledSimpleAtomMatcher)->Arg(10)->Arg(300);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vector>
+#include "benchmark/benchmark.h"
+#include "logd/LogEvent.h"
+#include "stats_log_util.h"
+#include "metric_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+// A config with one count metric on screen state changes, plus `numMatchers` count metrics on
+// atoms that are never logged. Only the first metric is interested in the events below, so the
+// cost of an event should not grow with the number of matchers. `numMatchers` must stay under
+// StatsdStats::kMaxMatcherCountPerConfig or the config is rejected.
+static StatsdConfig CreateConfigWithMatchers(int numMatchers) {
+    StatsdConfig config;
+    config.add_allowed_log_source("AID_ROOT");  // LogEvent defaults to UID of root.
+
+    *config.add_atom_matcher() = CreateScreenTurnedOnAtomMatcher();
+    auto metric = config.add_count_metric();
+    metric->set_id(StringToId("ScreenTurnedOnCount"));
+    metric->set_what(StringToId("ScreenTurnedOn"));
+    metric->set_bucket(FIVE_MINUTES);
+
+    for (int i = 0; i < numMatchers; i++) {
+        const string name = "UnusedAtom" + std::to_string(i);
+        // Atom ids well past the ones that are defined, so that no event ever matches.
+        *config.add_atom_matcher() = CreateSimpleAtomMatcher(name, 100000 + i);
+        metric = config.add_count_metric();
+        metric->set_id(StringToId(name + "Count"));
+        metric->set_what(StringToId(name));
+        metric->set_bucket(FIVE_MINUTES);
+    }
+    return config;
+}
+
+static void BM_MatcherDispatch(benchmark::State& state) {
+    ConfigKey cfgKey;
+    auto config = CreateConfigWithMatchers(state.range(0));
+    int64_t bucketStartTimeNs = 10000000000;
+    auto processor = CreateStatsLogProcessor(bucketStartTimeNs / NS_PER_SEC, config, cfgKey);
+
+    std::vector<std::unique_ptr<LogEvent>> events;
+    for (int i = 0; i < 100; i++) {
+        events.push_back(CreateScreenStateChangedEvent(
+                i % 2 == 0 ? android::view::DISPLAY_STATE_ON : android::view::DISPLAY_STATE_OFF,
+                bucketStartTimeNs + i));
+    }
+
+    while (state.KeepRunning()) {
+        for (const auto& event : events) {
+            processor->OnLogEvent(event.get());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * events.size());
+}
+
+BENCHMARK(BM_MatcherDispatch)->Arg(1)->Arg(10)->Arg(100)->Arg(500);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
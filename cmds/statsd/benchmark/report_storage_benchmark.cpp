@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <android-base/test_utils.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include "benchmark/benchmark.h"
+#include "stats_log_util.h"
+#include "storage/ReportLogStore.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using android::util::FIELD_COUNT_REPEATED;
+using android::util::FIELD_TYPE_STRING;
+using android::util::ProtoOutputStream;
+
+// for ConfigMetricsReport
+const int FIELD_ID_STRINGS = 9;
+
+// About the size of the report of a config with a few metrics.
+const size_t kReportBytes = 4 * 1024;
+
+static void appendReport(ReportLogStore* store, const ConfigKey& key) {
+    ProtoOutputStream report;
+    report.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS,
+                 std::string(kReportBytes, 'x'));
+    store->append(key, getWallClockSec(), &report);
+}
+
+// Writing a report to disk while [state.range(0)] reports of other configs are on disk.
+static void BM_AppendReport(benchmark::State& state) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const ConfigKey storedKey(1000, 1);
+    const ConfigKey key(1000, 2);
+    for (int i = 0; i < state.range(0); i++) {
+        appendReport(&store, storedKey);
+    }
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    int appended = 0;
+    while (state.KeepRunning()) {
+        appendReport(&store, key);
+        if (++appended % 100 == 0) {
+            state.PauseTiming();
+            store.takeReports(key, devNull);
+            state.ResumeTiming();
+        }
+    }
+    close(devNull);
+}
+
+BENCHMARK(BM_AppendReport)->Arg(10)->Arg(100)->Arg(1000);
+
+// Collecting the [state.range(0)] reports of a config from disk.
+static void BM_TakeReports(benchmark::State& state) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const ConfigKey key(1000, 1);
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (int i = 0; i < state.range(0); i++) {
+            appendReport(&store, key);
+        }
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(store.takeReports(key, devNull));
+    }
+    close(devNull);
+}
+
+BENCHMARK(BM_TakeReports)->Arg(10)->Arg(100)->Arg(1000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <private/android_logger.h>
+
+#include "benchmark/benchmark.h"
+#include "socket/StatsSocketListener.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+/* Special markers for android_log_list_element type */
+static const char EVENT_TYPE_LIST_STOP = '\n'; /* declare end of list  */
+
+static const char EVENT_TYPE_INT = 0;
+static const char EVENT_TYPE_LONG = 1;
+static const char EVENT_TYPE_LIST = 3;
+
+static void write4Bytes(int val, vector<char>* buffer) {
+    buffer->push_back(static_cast<char>(val));
+    buffer->push_back(static_cast<char>((val >> 8) & 0xFF));
+    buffer->push_back(static_cast<char>((val >> 16) & 0xFF));
+    buffer->push_back(static_cast<char>((val >> 24) & 0xFF));
+}
+
+static void write8Bytes(int64_t val, vector<char>* buffer) {
+    write4Bytes(static_cast<int>(val), buffer);
+    write4Bytes(static_cast<int>(val >> 32), buffer);
+}
+
+// A datagram as written to the statsd socket by a client: a log header followed by the event.
+static vector<char> getSimpleSocketData() {
+    vector<char> buffer(sizeof(android_log_header_t), 0);
+    buffer[0] = LOG_ID_STATS;
+    // stats_log tag id
+    write4Bytes(1937006964, &buffer);
+    buffer.push_back(EVENT_TYPE_LIST);
+    buffer.push_back(3);  // field counts;
+    buffer.push_back(EVENT_TYPE_LONG);
+    write8Bytes(1000 /* elapsed timestamp */, &buffer);
+    buffer.push_back(EVENT_TYPE_INT);
+    write4Bytes(10 /* atom id */, &buffer);
+    buffer.push_back(EVENT_TYPE_INT);
+    write4Bytes(99 /* a value to log*/, &buffer);
+    buffer.push_back(EVENT_TYPE_LIST_STOP);
+    return buffer;
+}
+
+class CountingLogListener : public LogListener {
+public:
+    void OnLogEvent(LogEvent* /*msg*/, bool /*reconnectionStarts*/) override {
+        mCount++;
+    }
+
+    std::atomic<int64_t> mCount{0};
+};
+
+// Floods the socket with [state.range(0)] events at a time, without blocking the writer, the way
+// the clients write to statsd. Events that did not fit in the socket, or were not processed in
+// time, are reported as "dropped".
+static void BM_SocketListenerFlood(benchmark::State& state) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) != 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    sp<CountingLogListener> counter = new CountingLogListener();
+    sp<StatsSocketListener> listener = new StatsSocketListener(counter, sockets[0]);
+    if (listener->startListener(600)) {
+        state.SkipWithError("startListener failed");
+        return;
+    }
+
+    const vector<char> data = getSimpleSocketData();
+    const int64_t burst = state.range(0);
+    int64_t dropped = 0;
+    while (state.KeepRunning()) {
+        const int64_t processedBefore = counter->mCount;
+        int64_t sent = 0;
+        for (int64_t i = 0; i < burst; i++) {
+            if (send(sockets[1], data.data(), data.size(), MSG_DONTWAIT) > 0) {
+                sent++;
+            }
+        }
+        // Wait for the burst to be processed. Whatever is still missing after a while is counted
+        // as dropped.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        while (counter->mCount - processedBefore < sent &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        dropped += burst - std::min(burst, counter->mCount - processedBefore);
+    }
+    state.SetItemsProcessed(counter->mCount);
+    state.counters["dropped"] = dropped;
+
+    listener->stopListener();
+    close(sockets[1]);
+}
+
+BENCHMARK(BM_SocketListenerFlood)->Arg(100)->Arg(1000)->Arg(10000);
+
+}  //  namespace statsd
+}  //  namespace os
+}  //  namespace android
@@ -298,6 +298,11 @@ struct Value {
         type = LONG;
     }
 
+    void setString(const char* v, size_t len) {
+        str_value.assign(v, len);
+        type = STRING;
+    }
+
     union {
         int32_t int_value;
         int64_t long_value;
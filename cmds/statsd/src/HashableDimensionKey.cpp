@@ -124,10 +124,19 @@ bool LessThan(const vector<FieldValue>& s1, const vector<FieldValue>& s2) {
     return false;
 }
 
+android::hash_t HashableDimensionKey::computeHash() const {
+    return hashDimension(*this);
+}
+
 bool HashableDimensionKey::operator==(const HashableDimensionKey& that) const {
     if (mValues.size() != that.getValues().size()) {
         return false;
     }
+    // Keys that were already hashed, like the ones stored in maps, rarely need their values
+    // compared.
+    if (mHashValid && that.mHashValid && mHash != that.mHash) {
+        return false;
+    }
     size_t count = mValues.size();
     for (size_t i = 0; i < count; i++) {
         if (mValues[i] != (that.getValues())[i]) {
@@ -40,12 +40,32 @@ public:
         mValues = values;
     }
 
-    HashableDimensionKey() {};
+    HashableDimensionKey() : mHash(kEmptyHash), mHashValid(true) {};
 
-    HashableDimensionKey(const HashableDimensionKey& that) : mValues(that.getValues()){};
+    HashableDimensionKey(const HashableDimensionKey& that)
+        : mValues(that.getValues()), mHash(that.mHash), mHashValid(that.mHashValid){};
+
+    // A moved-from key is left empty, with a hash that matches.
+    HashableDimensionKey(HashableDimensionKey&& that)
+        : mValues(std::move(that.mValues)), mHash(that.mHash), mHashValid(that.mHashValid) {
+        that.reset();
+    }
+
+    HashableDimensionKey& operator=(const HashableDimensionKey& from) = default;
+
+    HashableDimensionKey& operator=(HashableDimensionKey&& from) {
+        if (this != &from) {
+            mValues = std::move(from.mValues);
+            mHash = from.mHash;
+            mHashValid = from.mHashValid;
+            from.reset();
+        }
+        return *this;
+    }
 
     inline void addValue(const FieldValue& value) {
         mValues.push_back(value);
+        mHashValid = false;
     }
 
     inline const std::vector<FieldValue>& getValues() const {
@@ -53,16 +73,28 @@ public:
     }
 
     inline std::vector<FieldValue>* mutableValues() {
+        mHashValid = false;
         return &mValues;
     }
 
     inline FieldValue* mutableValue(size_t i) {
         if (i >= 0 && i < mValues.size()) {
+            mHashValid = false;
             return &(mValues[i]);
         }
         return nullptr;
     }
 
+    // Returns hashDimension() of this key. The hash is computed once and kept until the values
+    // are modified, so a key can be looked up in several maps for the cost of one hash.
+    inline android::hash_t getHash() const {
+        if (!mHashValid) {
+            mHash = computeHash();
+            mHashValid = true;
+        }
+        return mHash;
+    }
+
     std::string toString() const;
 
     bool operator==(const HashableDimensionKey& that) const;
@@ -72,7 +104,21 @@ public:
     bool contains(const HashableDimensionKey& that) const;
 
 private:
+    // hashDimension() of a key without values, which is JenkinsHashWhiten(0).
+    static const android::hash_t kEmptyHash = 0;
+
+    android::hash_t computeHash() const;
+
+    inline void reset() {
+        mValues.clear();
+        mHash = kEmptyHash;
+        mHashValid = true;
+    }
+
     std::vector<FieldValue> mValues;
+
+    mutable android::hash_t mHash = 0;
+    mutable bool mHashValid = false;
 };
 
 class MetricDimensionKey {
@@ -82,14 +128,23 @@ class MetricDimensionKey {
         : mDimensionKeyInWhat(dimensionKeyInWhat),
           mDimensionKeyInCondition(dimensionKeyInCondition) {};
 
+    explicit MetricDimensionKey(HashableDimensionKey&& dimensionKeyInWhat,
+                                const HashableDimensionKey& dimensionKeyInCondition)
+        : mDimensionKeyInWhat(std::move(dimensionKeyInWhat)),
+          mDimensionKeyInCondition(dimensionKeyInCondition) {};
+
     MetricDimensionKey(){};
 
     MetricDimensionKey(const MetricDimensionKey& that)
         : mDimensionKeyInWhat(that.getDimensionKeyInWhat()),
           mDimensionKeyInCondition(that.getDimensionKeyInCondition()) {};
 
+    MetricDimensionKey(MetricDimensionKey&& that) = default;
+
     MetricDimensionKey& operator=(const MetricDimensionKey& from) = default;
 
+    MetricDimensionKey& operator=(MetricDimensionKey&& from) = default;
+
     std::string toString() const;
 
     inline const HashableDimensionKey& getDimensionKeyInWhat() const {
@@ -157,15 +212,15 @@ using android::os::statsd::MetricDimensionKey;
 template <>
 struct hash<HashableDimensionKey> {
     std::size_t operator()(const HashableDimensionKey& key) const {
-        return hashDimension(key);
+        return key.getHash();
     }
 };
 
 template <>
 struct hash<MetricDimensionKey> {
     std::size_t operator()(const MetricDimensionKey& key) const {
-        android::hash_t hash = hashDimension(key.getDimensionKeyInWhat());
-        hash = android::JenkinsHashMix(hash, hashDimension(key.getDimensionKeyInCondition()));
+        android::hash_t hash = key.getDimensionKeyInWhat().getHash();
+        hash = android::JenkinsHashMix(hash, key.getDimensionKeyInCondition().getHash());
         return android::JenkinsHashWhiten(hash);
     }
 };
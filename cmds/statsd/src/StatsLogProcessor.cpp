@@ -69,8 +69,6 @@ const int FIELD_ID_STRINGS = 9;
 
 #define NS_PER_HOUR 3600 * NS_PER_SEC
 
-#define STATS_DATA_DIR "/data/misc/stats-data"
-
 StatsLogProcessor::StatsLogProcessor(const sp<UidMap>& uidMap,
                                      const sp<AlarmMonitor>& anomalyAlarmMonitor,
                                      const sp<AlarmMonitor>& periodicAlarmMonitor,
@@ -177,8 +175,14 @@ void StatsLogProcessor::resetConfigsLocked(const int64_t timestampNs) {
 }
 
 void StatsLogProcessor::OnLogEvent(LogEvent* event, bool reconnected) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    {
+        std::lock_guard<std::mutex> lock(mMetricsMutex);
+        OnLogEventLocked(event, reconnected);
+    }
+    syncReportsIfNeeded();
+}
 
+void StatsLogProcessor::OnLogEventLocked(LogEvent* event, bool reconnected) {
 #ifdef VERY_VERBOSE_PRINTING
     if (mPrintAllLogs) {
         ALOGI("%s", event->ToString().c_str());
@@ -249,17 +253,40 @@ void StatsLogProcessor::OnLogEvent(LogEvent* event, bool reconnected) {
     }
 
     // pass the event to metrics managers.
+    if (mWorkerPool != nullptr && mMetricsManagers.size() > 1) {
+        for (auto& pair : mMetricsManagers) {
+            mEventReceivers.push_back(pair.second);
+        }
+        mWorkerPool->onLogEvent(mEventReceivers, *event);
+        mEventReceivers.clear();
+        for (auto& pair : mMetricsManagers) {
+            flushIfNecessaryLocked(event->GetElapsedTimestampNs(), pair.first, *(pair.second));
+        }
+        return;
+    }
     for (auto& pair : mMetricsManagers) {
         pair.second->onLogEvent(*event);
         flushIfNecessaryLocked(event->GetElapsedTimestampNs(), pair.first, *(pair.second));
     }
 }
 
+void StatsLogProcessor::setWorkerThreadCount(const size_t threadCount) {
+    std::lock_guard<std::mutex> lock(mMetricsMutex);
+    if (threadCount == 0) {
+        mWorkerPool = nullptr;
+    } else if (mWorkerPool == nullptr || mWorkerPool->getThreadCount() != threadCount) {
+        mWorkerPool = make_unique<MetricsManagerWorkerPool>(threadCount);
+    }
+}
+
 void StatsLogProcessor::OnConfigUpdated(const int64_t timestampNs, const ConfigKey& key,
                                         const StatsdConfig& config) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
-    WriteDataToDiskLocked(key, timestampNs, CONFIG_UPDATED);
-    OnConfigUpdatedLocked(timestampNs, key, config);
+    {
+        std::lock_guard<std::mutex> lock(mMetricsMutex);
+        WriteDataToDiskLocked(key, timestampNs, CONFIG_UPDATED);
+        OnConfigUpdatedLocked(timestampNs, key, config);
+    }
+    syncReportsIfNeeded();
 }
 
 void StatsLogProcessor::OnConfigUpdatedLocked(
@@ -302,6 +329,14 @@ void StatsLogProcessor::dumpStates(FILE* out, bool verbose) {
     }
 }
 
+// Writes the ConfigKey field of a ConfigMetricsReportList.
+static void writeConfigKey(const ConfigKey& key, ProtoOutputStream* proto) {
+    uint64_t configKeyToken = proto->start(FIELD_TYPE_MESSAGE | FIELD_ID_CONFIG_KEY);
+    proto->write(FIELD_TYPE_INT32 | FIELD_ID_UID, key.GetUid());
+    proto->write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)key.GetId());
+    proto->end(configKeyToken);
+}
+
 /*
  * onDumpReport dumps serialized ConfigMetricsReportList into outData.
  */
@@ -309,37 +344,19 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
                                      const bool include_current_partial_bucket,
                                      const DumpReportReason dumpReportReason,
                                      vector<uint8_t>* outData) {
+    std::lock_guard<std::mutex> dumpLock(mDumpReportMutex);
     std::lock_guard<std::mutex> lock(mMetricsMutex);
 
     ProtoOutputStream proto;
 
-    // Start of ConfigKey.
-    uint64_t configKeyToken = proto.start(FIELD_TYPE_MESSAGE | FIELD_ID_CONFIG_KEY);
-    proto.write(FIELD_TYPE_INT32 | FIELD_ID_UID, key.GetUid());
-    proto.write(FIELD_TYPE_INT64 | FIELD_ID_ID, (long long)key.GetId());
-    proto.end(configKeyToken);
-    // End of ConfigKey.
+    writeConfigKey(key, &proto);
 
-    // Then, check stats-data directory to see there's any file containing
-    // ConfigMetricsReport from previous shutdowns to concatenate to reports.
+    // Then, take the ConfigMetricsReports written to disk, by previous shutdowns or config
+    // updates, so they come before the report of the data in memory.
     StorageManager::appendConfigMetricsReport(key, &proto);
 
-    auto it = mMetricsManagers.find(key);
-    if (it != mMetricsManagers.end()) {
-        // This allows another broadcast to be sent within the rate-limit period if we get close to
-        // filling the buffer again soon.
-        mLastBroadcastTimes.erase(key);
-
-        // Start of ConfigMetricsReport (reports).
-        uint64_t reportsToken =
-                proto.start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS);
-        onConfigMetricsReportLocked(key, dumpTimeStampNs, include_current_partial_bucket,
-                                    dumpReportReason, &proto);
-        proto.end(reportsToken);
-        // End of ConfigMetricsReport (reports).
-    } else {
-        ALOGW("Config source %s does not exist", key.ToString().c_str());
-    }
+    onDumpReportLocked(key, dumpTimeStampNs, include_current_partial_bucket, dumpReportReason,
+                       &proto);
 
     if (outData != nullptr) {
         outData->clear();
@@ -357,6 +374,77 @@ void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTim
     StatsdStats::getInstance().noteMetricsReportSent(key, proto.size());
 }
 
+/*
+ * onDumpReport writes serialized ConfigMetricsReportList to outFd, one report at a time.
+ */
+void StatsLogProcessor::onDumpReport(const ConfigKey& key, const int64_t dumpTimeStampNs,
+                                     const bool include_current_partial_bucket,
+                                     const DumpReportReason dumpReportReason, const int outFd) {
+    std::lock_guard<std::mutex> dumpLock(mDumpReportMutex);
+
+    ProtoOutputStream configKeyProto;
+    writeConfigKey(key, &configKeyProto);
+    size_t bytesWritten = configKeyProto.size();
+    if (!configKeyProto.flush(outFd)) {
+        ALOGE("Failed to write the report of %s", key.ToString().c_str());
+        return;
+    }
+
+    ProtoOutputStream proto;
+    {
+        // The reports on disk are taken under the same lock as the data in memory, so that a
+        // report written to disk in between, by a config update or a flush, can't be left for the
+        // next dump to send after newer data.
+        std::lock_guard<std::mutex> lock(mMetricsMutex);
+
+        // The reports on disk can add up to StatsdStats::kMaxFileSize, so they are copied to outFd
+        // without being read into memory.
+        ssize_t reportsOnDiskBytes = StorageManager::appendConfigMetricsReport(key, outFd);
+        if (reportsOnDiskBytes < 0) {
+            return;
+        }
+        bytesWritten += reportsOnDiskBytes;
+
+        // The data in memory is kept under StatsdStats::kMaxMetricsBytesPerConfig. It is written
+        // out after releasing the lock.
+        onDumpReportLocked(key, dumpTimeStampNs, include_current_partial_bucket, dumpReportReason,
+                           &proto);
+    }
+    bytesWritten += proto.size();
+    if (!proto.flush(outFd)) {
+        ALOGE("Failed to write the report of %s", key.ToString().c_str());
+        return;
+    }
+
+    StatsdStats::getInstance().noteMetricsReportSent(key, bytesWritten);
+}
+
+/*
+ * onDumpReportLocked dumps the ConfigMetricsReport of the data in memory, as reports of a
+ * ConfigMetricsReportList.
+ */
+void StatsLogProcessor::onDumpReportLocked(const ConfigKey& key, const int64_t dumpTimeStampNs,
+                                           const bool include_current_partial_bucket,
+                                           const DumpReportReason dumpReportReason,
+                                           ProtoOutputStream* proto) {
+    auto it = mMetricsManagers.find(key);
+    if (it != mMetricsManagers.end()) {
+        // This allows another broadcast to be sent within the rate-limit period if we get close to
+        // filling the buffer again soon.
+        mLastBroadcastTimes.erase(key);
+
+        // Start of ConfigMetricsReport (reports).
+        uint64_t reportsToken =
+                proto->start(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS);
+        onConfigMetricsReportLocked(key, dumpTimeStampNs, include_current_partial_bucket,
+                                    dumpReportReason, proto);
+        proto->end(reportsToken);
+        // End of ConfigMetricsReport (reports).
+    } else {
+        ALOGW("Config source %s does not exist", key.ToString().c_str());
+    }
+}
+
 /*
  * onConfigMetricsReportLocked dumps serialized ConfigMetricsReport into outData.
  */
@@ -441,20 +529,23 @@ void StatsLogProcessor::resetIfConfigTtlExpiredLocked(const int64_t timestampNs)
 }
 
 void StatsLogProcessor::OnConfigRemoved(const ConfigKey& key) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
-    auto it = mMetricsManagers.find(key);
-    if (it != mMetricsManagers.end()) {
-        WriteDataToDiskLocked(key, getElapsedRealtimeNs(), CONFIG_REMOVED);
-        mMetricsManagers.erase(it);
-        mUidMap->OnConfigRemoved(key);
-    }
-    StatsdStats::getInstance().noteConfigRemoved(key);
+    {
+        std::lock_guard<std::mutex> lock(mMetricsMutex);
+        auto it = mMetricsManagers.find(key);
+        if (it != mMetricsManagers.end()) {
+            WriteDataToDiskLocked(key, getElapsedRealtimeNs(), CONFIG_REMOVED);
+            mMetricsManagers.erase(it);
+            mUidMap->OnConfigRemoved(key);
+        }
+        StatsdStats::getInstance().noteConfigRemoved(key);
 
-    mLastBroadcastTimes.erase(key);
+        mLastBroadcastTimes.erase(key);
 
-    if (mMetricsManagers.empty()) {
-        mStatsPullerManager.ForceClearPullerCache();
+        if (mMetricsManagers.empty()) {
+            mStatsPullerManager.ForceClearPullerCache();
+        }
     }
+    syncReportsIfNeeded();
 }
 
 void StatsLogProcessor::flushIfNecessaryLocked(
@@ -511,17 +602,12 @@ void StatsLogProcessor::WriteDataToDiskLocked(const ConfigKey& key,
     ProtoOutputStream proto;
     onConfigMetricsReportLocked(key, timestampNs, true /* include_current_partial_bucket*/,
                                 dumpReportReason, &proto);
-    string file_name = StringPrintf("%s/%ld_%d_%lld", STATS_DATA_DIR,
-         (long)getWallClockSec(), key.GetUid(), (long long)key.GetId());
-    android::base::unique_fd fd(open(file_name.c_str(),
-                                O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR));
-    if (fd == -1) {
-        ALOGE("Attempt to write %s but failed", file_name.c_str());
+    if (!StorageManager::writeConfigMetricsReport(key, getWallClockSec(), &proto)) {
         return;
     }
-    proto.flush(fd.get());
     // We were able to write the ConfigMetricsReport to disk, so we should trigger collection ASAP.
     mOnDiskDataConfigs.insert(key);
+    mReportsToSync = true;
 }
 
 void StatsLogProcessor::WriteDataToDiskLocked(const DumpReportReason dumpReportReason) {
@@ -532,8 +618,17 @@ void StatsLogProcessor::WriteDataToDiskLocked(const DumpReportReason dumpReportR
 }
 
 void StatsLogProcessor::WriteDataToDisk(const DumpReportReason dumpReportReason) {
-    std::lock_guard<std::mutex> lock(mMetricsMutex);
-    WriteDataToDiskLocked(dumpReportReason);
+    {
+        std::lock_guard<std::mutex> lock(mMetricsMutex);
+        WriteDataToDiskLocked(dumpReportReason);
+    }
+    syncReportsIfNeeded();
+}
+
+void StatsLogProcessor::syncReportsIfNeeded() {
+    if (mReportsToSync && mReportsToSync.exchange(false)) {
+        StorageManager::syncConfigMetricsReports();
+    }
 }
 
 void StatsLogProcessor::informPullAlarmFired(const int64_t timestampNs) {
@@ -20,12 +20,14 @@
 #include "config/ConfigListener.h"
 #include "logd/LogReader.h"
 #include "metrics/MetricsManager.h"
+#include "metrics/MetricsManagerWorkerPool.h"
 #include "packages/UidMap.h"
 #include "external/StatsPullerManager.h"
 
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
 
 #include <stdio.h>
+#include <atomic>
 #include <unordered_map>
 
 namespace android {
@@ -66,6 +68,11 @@ public:
                       const bool include_current_partial_bucket,
                       const DumpReportReason dumpReportReason, vector<uint8_t>* outData);
 
+    // Same as above, but streams the report to outFd instead of building it in memory.
+    void onDumpReport(const ConfigKey& key, const int64_t dumpTimeNs,
+                      const bool include_current_partial_bucket,
+                      const DumpReportReason dumpReportReason, const int outFd);
+
     /* Tells MetricsManager that the alarms in alarmSet have fired. Modifies anomaly alarmSet. */
     void onAnomalyAlarmFired(
             const int64_t& timestampNs,
@@ -102,6 +109,10 @@ public:
     // Add a specific config key to the possible configs to dump ASAP.
     void noteOnDiskData(const ConfigKey& key);
 
+    // Spreads the configs over [threadCount] extra threads when processing an event. 0 processes
+    // every config on the thread calling OnLogEvent.
+    void setWorkerThreadCount(const size_t threadCount);
+
 private:
     // For testing only.
     inline sp<AlarmMonitor> getAnomalyAlarmMonitor() const {
@@ -114,8 +125,20 @@ private:
 
     mutable mutex mMetricsMutex;
 
+    // Held for the whole of a dump, so that the reports a dump takes from disk and the report of
+    // the data in memory are written out together, ahead of those of a concurrent dump. Acquired
+    // before mMetricsMutex.
+    mutex mDumpReportMutex;
+
     std::unordered_map<ConfigKey, sp<MetricsManager>> mMetricsManagers;
 
+    // Set when the configs are processed in parallel.
+    std::unique_ptr<MetricsManagerWorkerPool> mWorkerPool;
+
+    // The MetricsManagers handed to mWorkerPool for the current event. Kept across events so
+    // that it doesn't allocate.
+    std::vector<sp<MetricsManager>> mEventReceivers;
+
     std::unordered_map<ConfigKey, long> mLastBroadcastTimes;
 
     // Tracks when we last checked the bytes consumed for each config key.
@@ -124,6 +147,9 @@ private:
     // Tracks which config keys has metric reports on disk
     std::set<ConfigKey> mOnDiskDataConfigs;
 
+    // Set when reports were written to disk under mMetricsMutex, until they are synced.
+    std::atomic<bool> mReportsToSync{false};
+
     sp<UidMap> mUidMap;  // Reference to the UidMap to lookup app name and version for each uid.
 
     StatsPullerManager mStatsPullerManager;
@@ -134,6 +160,8 @@ private:
 
     void resetIfConfigTtlExpiredLocked(const int64_t timestampNs);
 
+    void OnLogEventLocked(LogEvent* event, bool reconnected);
+
     void OnConfigUpdatedLocked(
         const int64_t currentTimestampNs, const ConfigKey& key, const StatsdConfig& config);
 
@@ -141,6 +169,15 @@ private:
     void WriteDataToDiskLocked(const ConfigKey& key, const int64_t timestampNs,
                                const DumpReportReason dumpReportReason);
 
+    // Syncs the reports written to disk, and compacts their logs, if any report was written since
+    // the last call. Called after releasing mMetricsMutex, so that events don't wait for the disk.
+    void syncReportsIfNeeded();
+
+    void onDumpReportLocked(const ConfigKey& key, const int64_t dumpTimeStampNs,
+                            const bool include_current_partial_bucket,
+                            const DumpReportReason dumpReportReason,
+                            util::ProtoOutputStream* proto);
+
     void onConfigMetricsReportLocked(const ConfigKey& key, const int64_t dumpTimeStampNs,
                                      const bool include_current_partial_bucket,
                                      const DumpReportReason dumpReportReason,
@@ -42,6 +42,9 @@
 #include <sys/system_properties.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <thread>
+
 using namespace android;
 
 using android::base::StringPrintf;
@@ -55,6 +58,10 @@ constexpr const char* kPermissionUsage = "android.permission.PACKAGE_USAGE_STATS
 
 constexpr const char* kOpUsage = "android:get_usage_stats";
 
+// Extra threads used to process the configs in parallel. Devices rarely have more than a handful
+// of configs, so a couple of threads is plenty. Devices with fewer than 4 cores get none.
+constexpr unsigned int kMaxMetricsWorkerThreads = 2;
+
 #define STATS_SERVICE_DIR "/data/misc/stats-service"
 
 static binder::Status ok() {
@@ -170,6 +177,9 @@ StatsService::StatsService(const sp<Looper>& handlerLooper)
     }
     );
 
+    mProcessor->setWorkerThreadCount(
+            std::min(kMaxMetricsWorkerThreads, std::thread::hardware_concurrency() / 4));
+
     mConfigManager->AddListener(mProcessor);
 
     init_system_properties();
@@ -600,15 +610,17 @@ status_t StatsService::cmd_dump_report(FILE* out, FILE* err, const Vector<String
             }
         }
         if (good) {
-            vector<uint8_t> data;
-            mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
-                                     false /* include_current_bucket*/, ADB_DUMP, &data);
-            // TODO: print the returned StatsLogReport to file instead of printing to logcat.
             if (proto) {
-                for (size_t i = 0; i < data.size(); i ++) {
-                    fprintf(out, "%c", data[i]);
-                }
+                // Streamed, since the reports kept on disk can be large.
+                fflush(out);
+                mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
+                                         false /* include_current_bucket*/, ADB_DUMP,
+                                         fileno(out));
             } else {
+                // TODO: print the returned StatsLogReport to file instead of printing to logcat.
+                vector<uint8_t> data;
+                mProcessor->onDumpReport(ConfigKey(uid, StrToInt64(name)), getElapsedRealtimeNs(),
+                                         false /* include_current_bucket*/, ADB_DUMP, &data);
                 fprintf(out, "Dump report for Config [%d,%s]\n", uid, name.c_str());
                 fprintf(out, "See the StatsLogReport in logcat...\n");
             }
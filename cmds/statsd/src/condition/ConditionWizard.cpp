@@ -29,12 +29,13 @@ ConditionState ConditionWizard::query(const int index, const ConditionKey& param
                                       const bool isSubOutputDimensionFields,
                                       const bool isPartialLink,
                                       std::unordered_set<HashableDimensionKey>* dimensionKeySet) {
-    vector<ConditionState> cache(mAllConditions.size(), ConditionState::kNotEvaluated);
+    // Reuses the buffer of the previous query.
+    mQueryCache.assign(mAllConditions.size(), ConditionState::kNotEvaluated);
 
     mAllConditions[index]->isConditionMet(
         parameters, mAllConditions, dimensionFields, isSubOutputDimensionFields, isPartialLink,
-        cache, *dimensionKeySet);
-    return cache[index];
+        mQueryCache, *dimensionKeySet);
+    return mQueryCache[index];
 }
 
 ConditionState ConditionWizard::getMetConditionDimension(
@@ -68,6 +68,10 @@ public:
 
 private:
     std::vector<sp<ConditionTracker>> mAllConditions;
+
+    // Condition states of the current query. Each wizard is only queried by the thread processing
+    // its config, so the cache needs no lock.
+    std::vector<ConditionState> mQueryCache;
 };
 
 }  // namespace statsd
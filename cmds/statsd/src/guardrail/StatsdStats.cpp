@@ -52,6 +52,7 @@ const int FIELD_ID_LOGGER_ERROR_STATS = 11;
 const int FIELD_ID_PERIODIC_ALARM_STATS = 12;
 const int FIELD_ID_LOG_LOSS_STATS = 14;
 const int FIELD_ID_SYSTEM_SERVER_RESTART = 15;
+const int FIELD_ID_EVENT_QUEUE_STATS = 16;
 
 const int FIELD_ID_ATOM_STATS_TAG = 1;
 const int FIELD_ID_ATOM_STATS_COUNT = 2;
@@ -59,6 +60,9 @@ const int FIELD_ID_ATOM_STATS_COUNT = 2;
 const int FIELD_ID_ANOMALY_ALARMS_REGISTERED = 1;
 const int FIELD_ID_PERIODIC_ALARMS_REGISTERED = 1;
 
+const int FIELD_ID_EVENT_QUEUE_MAX_SIZE = 1;
+const int FIELD_ID_EVENT_QUEUE_FULL_COUNT = 2;
+
 const int FIELD_ID_LOGGER_STATS_TIME = 1;
 const int FIELD_ID_LOGGER_STATS_ERROR_CODE = 2;
 
@@ -188,6 +192,16 @@ void StatsdStats::noteLogLost(int64_t timestampNs) {
     mLogLossTimestampNs.push_back(timestampNs);
 }
 
+void StatsdStats::noteEventQueueSize(int size) {
+    lock_guard<std::mutex> lock(mLock);
+    mMaxEventQueueSize = std::max(mMaxEventQueueSize, size);
+}
+
+void StatsdStats::noteEventQueueFull() {
+    lock_guard<std::mutex> lock(mLock);
+    mEventQueueFullCount++;
+}
+
 void StatsdStats::noteBroadcastSent(const ConfigKey& key) {
     noteBroadcastSent(key, getWallClockSec());
 }
@@ -386,6 +400,8 @@ void StatsdStats::resetInternalLocked() {
     std::fill(mPushedAtomStats.begin(), mPushedAtomStats.end(), 0);
     mAnomalyAlarmRegisteredStats = 0;
     mPeriodicAlarmRegisteredStats = 0;
+    mMaxEventQueueSize = 0;
+    mEventQueueFullCount = 0;
     mLoggerErrors.clear();
     mSystemServerRestartSec.clear();
     mLogLossTimestampNs.clear();
@@ -511,6 +527,9 @@ void StatsdStats::dumpStats(FILE* out) const {
         fprintf(out, "Subscriber alarm registrations: %d\n", mPeriodicAlarmRegisteredStats);
     }
 
+    fprintf(out, "Event queue: max size=%d, full=%lld\n", mMaxEventQueueSize,
+            (long long)mEventQueueFullCount);
+
     fprintf(out, "UID map stats: bytes=%d, changes=%d, deleted=%d, changes lost=%d\n",
             mUidMapStats.bytes_used, mUidMapStats.changes, mUidMapStats.deleted_apps,
             mUidMapStats.dropped_changes);
@@ -670,6 +689,14 @@ void StatsdStats::dumpStats(std::vector<uint8_t>* output, bool reset) {
         proto.end(token);
     }
 
+    if (mMaxEventQueueSize > 0 || mEventQueueFullCount > 0) {
+        uint64_t token = proto.start(FIELD_TYPE_MESSAGE | FIELD_ID_EVENT_QUEUE_STATS);
+        proto.write(FIELD_TYPE_INT32 | FIELD_ID_EVENT_QUEUE_MAX_SIZE, mMaxEventQueueSize);
+        proto.write(FIELD_TYPE_INT64 | FIELD_ID_EVENT_QUEUE_FULL_COUNT,
+                    (long long)mEventQueueFullCount);
+        proto.end(token);
+    }
+
     uint64_t uidMapToken = proto.start(FIELD_TYPE_MESSAGE | FIELD_ID_UIDMAP_STATS);
     proto.write(FIELD_TYPE_INT32 | FIELD_ID_UID_MAP_CHANGES, mUidMapStats.changes);
     proto.write(FIELD_TYPE_INT32 | FIELD_ID_UID_MAP_BYTES_USED, mUidMapStats.bytes_used);
@@ -287,6 +287,16 @@ public:
      */
     void noteLogLost(int64_t timestamp);
 
+    /**
+     * Records the number of socket events waiting to be processed after a batch was read.
+     */
+    void noteEventQueueSize(int size);
+
+    /**
+     * Records that the socket listener had to wait for the event queue to have room.
+     */
+    void noteEventQueueFull();
+
     /**
      * Reset the historical stats. Including all stats in icebox, and the tracked stats about
      * metrics, matchers, and atoms. The active configs will be kept and StatsdStats will continue
@@ -354,6 +364,12 @@ private:
     // Stores the number of times statsd registers the periodic alarm changes
     int mPeriodicAlarmRegisteredStats = 0;
 
+    // The largest number of socket events that were waiting to be processed at once.
+    int mMaxEventQueueSize = 0;
+
+    // The number of times the socket listener found the event queue full.
+    int64_t mEventQueueFullCount = 0;
+
     void noteConfigResetInternalLocked(const ConfigKey& key);
 
     void noteConfigRemovedInternalLocked(const ConfigKey& key);
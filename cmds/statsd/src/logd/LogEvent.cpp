@@ -19,6 +19,10 @@
 
 #include "stats_log_util.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 namespace android {
 namespace os {
 namespace statsd {
@@ -28,15 +32,180 @@ using android::util::ProtoOutputStream;
 using std::string;
 using std::vector;
 
+namespace {
+
+// The largest event payload that liblog parses, not counting the event tag.
+const size_t kMaxEventPayload = LOGGER_ENTRY_MAX_PAYLOAD - sizeof(int32_t);
+
+/**
+ * Reads the elements of an event payload one by one, with the same results as
+ * android_log_read_next(). Unlike a parser from create_android_log_parser(), it reads the payload
+ * where it is instead of copying it into a heap allocated context. Strings point into the payload,
+ * so it must outlive the elements.
+ */
+class PayloadReader {
+public:
+    PayloadReader(const char* payload, size_t len)
+        : mPayload(reinterpret_cast<const uint8_t*>(payload)),
+          mLen(std::min(len, kMaxEventPayload)) {
+    }
+
+    android_log_list_element next();
+
+private:
+    int32_t read4Bytes(size_t pos) const {
+        int32_t value;
+        memcpy(&value, mPayload + pos, sizeof(value));
+        return value;
+    }
+
+    const uint8_t* mPayload;
+    const size_t mLen;
+    size_t mPos = 0;
+
+    // Nesting depth of the current list, and the number of elements left in each open list.
+    unsigned mDepth = 0;
+    uint16_t mCount[ANDROID_MAX_LIST_NEST_DEPTH + 1] = {};
+
+    // Whether the current list has no elements left, so that the next element is its end.
+    bool mListStop = false;
+};
+
+android_log_list_element PayloadReader::next() {
+    android_log_list_element elem;
+    memset(&elem, 0, sizeof(elem));
+
+    if (mDepth > ANDROID_MAX_LIST_NEST_DEPTH ||
+        mCount[mDepth] >= kMaxEventPayload / (sizeof(uint8_t) + sizeof(uint8_t))) {
+        elem.type = EVENT_TYPE_UNKNOWN;
+        if (mListStop || (mDepth <= ANDROID_MAX_LIST_NEST_DEPTH && !mCount[mDepth])) {
+            elem.type = EVENT_TYPE_LIST_STOP;
+        }
+        elem.complete = true;
+        return elem;
+    }
+
+    size_t pos = mPos;
+    if (mListStop) {
+        elem.type = EVENT_TYPE_LIST_STOP;
+        elem.complete = !mCount[0] && (!mDepth || (mDepth == 1 && !mCount[1]));
+        // Skip an explicit end of list marker, if the writer put one.
+        if (pos < mLen && mPayload[pos] == EVENT_TYPE_LIST_STOP) {
+            mPos = pos + 1;
+        }
+        if (mDepth) {
+            --mDepth;
+            if (mCount[mDepth]) {
+                mListStop = false;
+            }
+        } else {
+            mListStop = false;
+        }
+        return elem;
+    }
+
+    if (pos + 1 > mLen) {
+        elem.type = EVENT_TYPE_UNKNOWN;
+        elem.complete = true;
+        return elem;
+    }
+
+    elem.type = static_cast<AndroidEventLogType>(mPayload[pos++]);
+    switch ((int)elem.type) {
+        case EVENT_TYPE_FLOAT:
+        // The float and int have the same size.
+        case EVENT_TYPE_INT:
+            elem.len = sizeof(int32_t);
+            if (pos + elem.len > mLen) {
+                elem.type = EVENT_TYPE_UNKNOWN;
+                return elem;
+            }
+            elem.data.int32 = read4Bytes(pos);
+            break;
+        case EVENT_TYPE_LONG:
+            elem.len = sizeof(int64_t);
+            if (pos + elem.len > mLen) {
+                elem.type = EVENT_TYPE_UNKNOWN;
+                return elem;
+            }
+            memcpy(&elem.data.int64, mPayload + pos, sizeof(int64_t));
+            break;
+        case EVENT_TYPE_STRING:
+            if (pos + sizeof(int32_t) > mLen) {
+                elem.type = EVENT_TYPE_UNKNOWN;
+                elem.complete = true;
+                return elem;
+            }
+            elem.len = read4Bytes(pos);
+            pos += sizeof(int32_t);
+            if (pos + elem.len > mLen) {
+                // Truncated string.
+                elem.len = mLen - pos;
+                if (!elem.len) {
+                    elem.type = EVENT_TYPE_UNKNOWN;
+                    elem.complete = true;
+                    return elem;
+                }
+            }
+            elem.data.string = (char*)(mPayload + pos);
+            break;
+        case EVENT_TYPE_LIST:
+            if (pos + sizeof(uint8_t) > mLen) {
+                elem.type = EVENT_TYPE_UNKNOWN;
+                elem.complete = true;
+                return elem;
+            }
+            elem.complete = mDepth >= ANDROID_MAX_LIST_NEST_DEPTH;
+            if (mCount[mDepth]) {
+                mCount[mDepth]--;
+            }
+            mListStop = !mPayload[pos];
+            mDepth++;
+            if (mDepth <= ANDROID_MAX_LIST_NEST_DEPTH) {
+                mCount[mDepth] = mPayload[pos];
+            }
+            mPos = pos + sizeof(uint8_t);
+            return elem;
+        case EVENT_TYPE_LIST_STOP:
+            // A newline ends the current list early.
+            mPos = pos;
+            elem.type = EVENT_TYPE_UNKNOWN;
+            elem.complete = !mDepth;
+            if (mDepth > 0) {
+                elem.type = EVENT_TYPE_LIST_STOP;
+                mDepth--;
+            }
+            return elem;
+        default:
+            elem.type = EVENT_TYPE_UNKNOWN;
+            return elem;
+    }
+
+    // An int, long, float or string was read.
+    pos += elem.len;
+    elem.complete = !mDepth && !mCount[0];
+    if (!mCount[mDepth] || !--mCount[mDepth]) {
+        mListStop = true;
+    }
+    mPos = pos;
+    return elem;
+}
+
+}  // namespace
+
 LogEvent::LogEvent(log_msg& msg) {
-    mContext =
-            create_android_log_parser(msg.msg() + sizeof(uint32_t), msg.len() - sizeof(uint32_t));
+    readFrom(msg);
+}
+
+void LogEvent::readFrom(log_msg& msg) {
+    // clear() keeps the capacity, so a recycled event doesn't allocate for its values again.
+    mValues.clear();
+    mTagId = 0;
+    mElapsedTimestampNs = 0;
     mLogdTimestampNs = msg.entry_v1.sec * NS_PER_SEC + msg.entry_v1.nsec;
     mLogUid = msg.entry_v4.uid;
-    init(mContext);
-    if (mContext) {
-        // android_log_destroy will set mContext to NULL
-        android_log_destroy(&mContext);
+    if (msg.len() > sizeof(uint32_t)) {
+        init(msg.msg() + sizeof(uint32_t), msg.len() - sizeof(uint32_t));
     }
 }
 
@@ -66,14 +235,9 @@ void LogEvent::init() {
     if (mContext) {
         const char* buffer;
         size_t len = android_log_write_list_buffer(mContext, &buffer);
-        // turns to reader mode
-        android_log_context contextForRead = create_android_log_parser(buffer, len);
-        if (contextForRead) {
-            init(contextForRead);
-            // destroy the context to save memory.
-            // android_log_destroy will set mContext to NULL
-            android_log_destroy(&contextForRead);
-        }
+        init(buffer, len);
+        // destroy the context to save memory.
+        // android_log_destroy will set mContext to NULL
         android_log_destroy(&mContext);
     }
 }
@@ -173,13 +337,14 @@ bool LogEvent::write(const AttributionNodeInternal& node) {
  * The idea here is to read through the log items once, we get as much information we need for
  * matching as possible. Because this log will be matched against lots of matchers.
  */
-void LogEvent::init(android_log_context context) {
+void LogEvent::init(const char* payload, size_t len) {
+    PayloadReader reader(payload, len);
     android_log_list_element elem;
     int i = 0;
     int depth = -1;
     int pos[] = {1, 1, 1};
     do {
-        elem = android_log_read_next(context);
+        elem = reader.next();
         switch ((int)elem.type) {
             case EVENT_TYPE_INT:
                 // elem at [0] is EVENT_TYPE_LIST, [1] is the timestamp, [2] is tag id.
@@ -213,8 +378,9 @@ void LogEvent::init(android_log_context context) {
                     return;
                 }
 
-                mValues.push_back(FieldValue(Field(mTagId, pos, depth),
-                                             Value(string(elem.data.string, elem.len))));
+                // Copy the string once, straight into the value.
+                mValues.push_back(FieldValue(Field(mTagId, pos, depth), Value()));
+                mValues.back().mValue.setString(elem.data.string, elem.len);
 
                 pos[depth]++;
 
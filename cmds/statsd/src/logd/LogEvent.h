@@ -61,6 +61,12 @@ public:
      */
     explicit LogEvent(log_msg& msg);
 
+    /**
+     * Replaces the contents of this LogEvent with the event in a log_msg. This reuses the memory
+     * of the previous values, so a reader can recycle one LogEvent for all the events it reads.
+     */
+    void readFrom(log_msg& msg);
+
     /**
      * Constructs a LogEvent with synthetic data for testing. Must call init() before reading.
      */
@@ -161,9 +167,9 @@ private:
     explicit LogEvent(const LogEvent&);
 
     /**
-     * Parses a log_msg into a LogEvent object.
+     * Parses the payload of a log_msg, without its event tag, into a LogEvent object.
      */
-    void init(android_log_context context);
+    void init(const char* payload, size_t len);
 
     // The items are naturally sorted in DFS order as we read them. this allows us to do fast
     // matching.
@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "CompiledSimpleAtomMatcher.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using google::protobuf::RepeatedPtrField;
+using std::string;
+using std::vector;
+
+namespace {
+
+// int and long fields are both compared with the int operands.
+bool getIntValue(const Value& value, int64_t* output) {
+    if (value.getType() == INT) {
+        *output = value.int_value;
+        return true;
+    }
+    if (value.getType() == LONG) {
+        *output = value.long_value;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+CompiledSimpleAtomMatcher::CompiledSimpleAtomMatcher(const SimpleAtomMatcher& matcher)
+    : mAtomId(matcher.atom_id()), mTopLevelCount(matcher.field_value_matcher_size()) {
+    mNodes.resize(mTopLevelCount);
+    compile(matcher.field_value_matcher(), 0);
+}
+
+void CompiledSimpleAtomMatcher::compile(const RepeatedPtrField<FieldValueMatcher>& matchers,
+                                        size_t first) {
+    for (int i = 0; i < matchers.size(); i++) {
+        const FieldValueMatcher& matcher = matchers.Get(i);
+        Node node = {};
+        node.mField = matcher.field();
+        node.mHasPosition = matcher.has_position();
+        node.mPosition = matcher.position();
+        node.mValueMatcherCase = matcher.value_matcher_case();
+
+        vector<const string*> strings;
+        switch (matcher.value_matcher_case()) {
+            case FieldValueMatcher::ValueMatcherCase::kEqBool:
+                node.mBool = matcher.eq_bool();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kEqString:
+                strings.push_back(&matcher.eq_string());
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kEqAnyString:
+                for (const auto& str : matcher.eq_any_string().str_value()) {
+                    strings.push_back(&str);
+                }
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kNeqAnyString:
+                for (const auto& str : matcher.neq_any_string().str_value()) {
+                    strings.push_back(&str);
+                }
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kEqInt:
+                node.mInt = matcher.eq_int();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kLtInt:
+                node.mInt = matcher.lt_int();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kGtInt:
+                node.mInt = matcher.gt_int();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kLteInt:
+                node.mInt = matcher.lte_int();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kGteInt:
+                node.mInt = matcher.gte_int();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kLtFloat:
+                node.mFloat = matcher.lt_float();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kGtFloat:
+                node.mFloat = matcher.gt_float();
+                break;
+            case FieldValueMatcher::ValueMatcherCase::kMatchesTuple: {
+                const auto& tuple = matcher.matches_tuple().field_value_matcher();
+                node.mBegin = mNodes.size();
+                node.mEnd = node.mBegin + tuple.size();
+                mNodes[first + i] = node;
+                mNodes.resize(node.mEnd);
+                compile(tuple, node.mBegin);
+                continue;
+            }
+            default:
+                break;
+        }
+
+        node.mBegin = mStrings.size();
+        for (const string* str : strings) {
+            CompiledString compiled;
+            compiled.mValue = *str;
+            auto aidIt = UidMap::sAidToUidMapping.find(*str);
+            compiled.mIsAid = aidIt != UidMap::sAidToUidMapping.end();
+            compiled.mAidUid = compiled.mIsAid ? (int)aidIt->second : -1;
+            // Not fetched yet.
+            compiled.mUidsGeneration = -1;
+            mStrings.push_back(std::move(compiled));
+        }
+        node.mEnd = mStrings.size();
+        mNodes[first + i] = node;
+    }
+}
+
+bool CompiledSimpleAtomMatcher::matches(const UidMap& uidMap, const LogEvent& event) {
+    if (mTopLevelCount == 0) {
+        return event.GetTagId() == mAtomId;
+    }
+    const vector<FieldValue>& values = event.getValues();
+    for (size_t i = 0; i < mTopLevelCount; i++) {
+        if (!matchesNode(uidMap, mNodes[i], values, 0, values.size(), 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompiledSimpleAtomMatcher::matchesTuple(const UidMap& uidMap, const Node& node,
+                                             const vector<FieldValue>& values, int start, int end,
+                                             int depth) {
+    for (uint32_t i = node.mBegin; i < node.mEnd; i++) {
+        if (!matchesNode(uidMap, mNodes[i], values, start, end, depth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompiledSimpleAtomMatcher::matchesString(const UidMap& uidMap, CompiledString& str,
+                                              const FieldValue& value) {
+    if (isAttributionUidField(value.mField, value.mValue)) {
+        const int uid = value.mValue.int_value;
+        if (str.mIsAid) {
+            return str.mAidUid == uid;
+        }
+        if (str.mUidsGeneration != uidMap.getMapGeneration()) {
+            str.mUidsGeneration = uidMap.getUidsFromNormalizedAppName(str.mValue, &str.mUids);
+        }
+        return str.mUids.find(uid) != str.mUids.end();
+    } else if (value.mValue.getType() == STRING) {
+        return value.mValue.str_value == str.mValue;
+    }
+    return false;
+}
+
+// Follows matchesSimple() in matcher_util.cpp step by step.
+bool CompiledSimpleAtomMatcher::matchesNode(const UidMap& uidMap, const Node& node,
+                                            const vector<FieldValue>& values, int start, int end,
+                                            int depth) {
+    if (depth > 2) {
+        ALOGE("Depth > 3 not supported");
+        return false;
+    }
+
+    if (start >= end) {
+        return false;
+    }
+
+    // Zoom in to the range of the field. The fields are sorted in DFS order.
+    int newStart = -1;
+    int newEnd = end;
+    for (int i = start; i < end; i++) {
+        int pos = values[i].mField.getPosAtDepth(depth);
+        if (pos == node.mField) {
+            if (newStart == -1) {
+                newStart = i;
+            }
+            newEnd = i + 1;
+        } else if (pos > node.mField) {
+            break;
+        }
+    }
+    if (newStart == -1) {
+        // No such field found.
+        return false;
+    }
+    start = newStart;
+    end = newEnd;
+
+    // Whether the tuple is matched against each sub tree at positionDepth, or against none.
+    bool anyPosition = false;
+    bool noSubTree = false;
+    int positionDepth = depth;
+    if (node.mHasPosition) {
+        positionDepth = ++depth;
+        if (depth > 2) {
+            return false;
+        }
+        switch (node.mPosition) {
+            case Position::FIRST:
+                for (int i = start; i < end; i++) {
+                    if (values[i].mField.getPosAtDepth(depth) != 1) {
+                        end = i;
+                        break;
+                    }
+                }
+                break;
+            case Position::LAST:
+                for (int i = start; i < end; i++) {
+                    if (values[i].mField.isLastPos(depth)) {
+                        start = i;
+                        break;
+                    }
+                }
+                break;
+            case Position::ANY:
+                anyPosition = true;
+                break;
+            case Position::ALL:
+                ALOGE("Not supported: field matcher with ALL position.");
+                noSubTree = true;
+                break;
+            case Position::POSITION_UNKNOWN:
+                noSubTree = true;
+                break;
+        }
+    }
+
+    switch (node.mValueMatcherCase) {
+        case FieldValueMatcher::ValueMatcherCase::kMatchesTuple: {
+            ++depth;
+            if (noSubTree) {
+                return false;
+            }
+            if (!anyPosition) {
+                return matchesTuple(uidMap, node, values, start, end, depth);
+            }
+            // ANY: it's a match if all the tuple matches within one of the sub trees.
+            int subTreeStart = start;
+            int currentPos = values[start].mField.getPosAtDepth(positionDepth);
+            for (int i = start; i < end; i++) {
+                int newPos = values[i].mField.getPosAtDepth(positionDepth);
+                if (newPos != currentPos) {
+                    if (matchesTuple(uidMap, node, values, subTreeStart, i, depth)) {
+                        return true;
+                    }
+                    subTreeStart = i;
+                    currentPos = newPos;
+                }
+            }
+            return matchesTuple(uidMap, node, values, subTreeStart, end, depth);
+        }
+        // The value cases match if ANY of the values in [start, end) matches.
+        case FieldValueMatcher::ValueMatcherCase::kEqBool: {
+            for (int i = start; i < end; i++) {
+                int64_t value;
+                if (getIntValue(values[i].mValue, &value) && (value != 0) == node.mBool) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kEqString:
+        case FieldValueMatcher::ValueMatcherCase::kEqAnyString: {
+            for (int i = start; i < end; i++) {
+                for (uint32_t j = node.mBegin; j < node.mEnd; j++) {
+                    if (matchesString(uidMap, mStrings[j], values[i])) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kNeqAnyString: {
+            for (int i = start; i < end; i++) {
+                bool notEqAll = true;
+                for (uint32_t j = node.mBegin; j < node.mEnd; j++) {
+                    if (matchesString(uidMap, mStrings[j], values[i])) {
+                        notEqAll = false;
+                        break;
+                    }
+                }
+                if (notEqAll) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kEqInt:
+        case FieldValueMatcher::ValueMatcherCase::kLtInt:
+        case FieldValueMatcher::ValueMatcherCase::kGtInt:
+        case FieldValueMatcher::ValueMatcherCase::kLteInt:
+        case FieldValueMatcher::ValueMatcherCase::kGteInt: {
+            for (int i = start; i < end; i++) {
+                int64_t value;
+                if (!getIntValue(values[i].mValue, &value)) {
+                    continue;
+                }
+                bool matched;
+                switch (node.mValueMatcherCase) {
+                    case FieldValueMatcher::ValueMatcherCase::kEqInt:
+                        matched = value == node.mInt;
+                        break;
+                    case FieldValueMatcher::ValueMatcherCase::kLtInt:
+                        matched = value < node.mInt;
+                        break;
+                    case FieldValueMatcher::ValueMatcherCase::kGtInt:
+                        matched = value > node.mInt;
+                        break;
+                    case FieldValueMatcher::ValueMatcherCase::kLteInt:
+                        matched = value <= node.mInt;
+                        break;
+                    default:
+                        matched = value >= node.mInt;
+                        break;
+                }
+                if (matched) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kLtFloat: {
+            for (int i = start; i < end; i++) {
+                if (values[i].mValue.getType() == FLOAT &&
+                    values[i].mValue.float_value < node.mFloat) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case FieldValueMatcher::ValueMatcherCase::kGtFloat: {
+            for (int i = start; i < end; i++) {
+                if (values[i].mValue.getType() == FLOAT &&
+                    values[i].mValue.float_value > node.mFloat) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
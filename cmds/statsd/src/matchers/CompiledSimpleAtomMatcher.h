@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
+#include "logd/LogEvent.h"
+#include "packages/UidMap.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * A SimpleAtomMatcher translated, once, into a flat list of nodes that can be run on every event
+ * without going through the protobuf accessors or allocating.
+ *
+ * Matches exactly the events that matchesSimple() in matcher_util.h matches. The string
+ * comparisons against attribution uids are resolved ahead of time: AID names to their uid, and
+ * package names to the set of uids with that package, refreshed when the UidMap changes.
+ *
+ * Not thread safe: matches() updates the cached uid sets.
+ */
+class CompiledSimpleAtomMatcher {
+public:
+    explicit CompiledSimpleAtomMatcher(const SimpleAtomMatcher& matcher);
+
+    bool matches(const UidMap& uidMap, const LogEvent& event);
+
+private:
+    // A FieldValueMatcher. The tuple of a kMatchesTuple node is stored in mNodes, and the strings
+    // of the string cases in mStrings, both in [mBegin, mEnd).
+    struct Node {
+        int32_t mField;
+        bool mHasPosition;
+        Position mPosition;
+        FieldValueMatcher::ValueMatcherCase mValueMatcherCase;
+        // The operand of the int, bool and float cases.
+        int64_t mInt;
+        float mFloat;
+        bool mBool;
+        uint32_t mBegin;
+        uint32_t mEnd;
+    };
+
+    // A string to compare with string fields and attribution uids.
+    struct CompiledString {
+        std::string mValue;
+        // Whether mValue is the name of an AID, like "AID_ROOT", and its uid.
+        bool mIsAid;
+        int32_t mAidUid;
+        // Uids with an app named mValue, as of the mUidsGeneration of the UidMap.
+        std::unordered_set<int32_t> mUids;
+        int64_t mUidsGeneration;
+    };
+
+    // Appends the nodes of [matchers] at [first] and after, and their tuples at the end.
+    void compile(const google::protobuf::RepeatedPtrField<FieldValueMatcher>& matchers,
+                 size_t first);
+
+    bool matchesNode(const UidMap& uidMap, const Node& node, const std::vector<FieldValue>& values,
+                     int start, int end, int depth);
+
+    // Whether every node of the tuple [node] matches the values in [start, end).
+    bool matchesTuple(const UidMap& uidMap, const Node& node,
+                      const std::vector<FieldValue>& values, int start, int end, int depth);
+
+    bool matchesString(const UidMap& uidMap, CompiledString& str, const FieldValue& value);
+
+    const int32_t mAtomId;
+
+    // Number of top level nodes, stored first in mNodes.
+    size_t mTopLevelCount;
+
+    std::vector<Node> mNodes;
+
+    std::vector<CompiledString> mStrings;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
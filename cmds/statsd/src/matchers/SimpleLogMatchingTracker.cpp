@@ -65,7 +65,7 @@ void SimpleLogMatchingTracker::onLogEvent(const LogEvent& event,
         return;
     }
 
-    bool matched = matchesSimple(mUidMap, mMatcher, event);
+    bool matched = mMatcher.matches(mUidMap, event);
     matcherResults[mIndex] = matched ? MatchingState::kMatched : MatchingState::kNotMatched;
     VLOG("Stats SimpleLogMatcher %lld matched? %d", (long long)mId, matched);
 }
@@ -22,6 +22,7 @@
 #include <set>
 #include <unordered_map>
 #include <vector>
+#include "CompiledSimpleAtomMatcher.h"
 #include "LogMatchingTracker.h"
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
 #include "packages/UidMap.h"
@@ -48,7 +49,7 @@ public:
                     std::vector<MatchingState>& matcherResults) override;
 
 private:
-    const SimpleAtomMatcher mMatcher;
+    CompiledSimpleAtomMatcher mMatcher;
     const UidMap& mUidMap;
 };
 
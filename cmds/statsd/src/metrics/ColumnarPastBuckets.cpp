@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "ColumnarPastBuckets.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+void writeVarint(uint64_t value, vector<uint8_t>* data) {
+    while (value >= 0x80) {
+        data->push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data->push_back(static_cast<uint8_t>(value));
+}
+
+// Returns false if the data ends in the middle of a varint.
+bool readVarint(const uint8_t** pos, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; *pos < end && shift < 64; shift += 7) {
+        const uint8_t byte = *(*pos)++;
+        result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Maps small negative differences to small unsigned values, like protobuf sint64.
+uint64_t zigZagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigZagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}  // namespace
+
+ColumnarPastBuckets::Reader::Reader(const Boundary* boundaries, const Column& column)
+    : mBoundaries(boundaries),
+      mPos(column.mData.data()),
+      mEnd(column.mData.data() + column.mData.size()),
+      mBucketIndex(0),
+      mNextBucketIndex(0),
+      mValue(0) {
+}
+
+bool ColumnarPastBuckets::Reader::next() {
+    uint64_t bucketGap;
+    uint64_t valueDelta;
+    if (!readVarint(&mPos, mEnd, &bucketGap) || !readVarint(&mPos, mEnd, &valueDelta)) {
+        return false;
+    }
+    mBucketIndex = mNextBucketIndex + bucketGap;
+    mNextBucketIndex = mBucketIndex + 1;
+    // Wraps around like the encoding did.
+    mValue = static_cast<int64_t>(static_cast<uint64_t>(mValue) +
+                                  static_cast<uint64_t>(zigZagDecode(valueDelta)));
+    return true;
+}
+
+void ColumnarPastBuckets::addBucket(const int64_t bucketStartNs, const int64_t bucketEndNs) {
+    mBoundaries.push_back({bucketStartNs, bucketEndNs});
+}
+
+void ColumnarPastBuckets::addValue(const MetricDimensionKey& key, const int64_t value) {
+    if (mBoundaries.empty()) {
+        ALOGE("No bucket to add the value to");
+        return;
+    }
+    const size_t bucketIndex = mBoundaries.size() - 1;
+    Column& column = mColumns[key];
+    if (bucketIndex < column.mNextBucketIndex) {
+        ALOGE("Value already added to the bucket %zu", bucketIndex);
+        return;
+    }
+    writeVarint(bucketIndex - column.mNextBucketIndex, &column.mData);
+    // The difference may overflow; the reader wraps around the same way.
+    writeVarint(zigZagEncode(static_cast<int64_t>(static_cast<uint64_t>(value) -
+                                                  static_cast<uint64_t>(column.mLastValue))),
+                &column.mData);
+    column.mBucketCount++;
+    column.mNextBucketIndex = bucketIndex + 1;
+    column.mLastValue = value;
+}
+
+vector<PastBucket> ColumnarPastBuckets::getBuckets(const MetricDimensionKey& key) const {
+    vector<PastBucket> buckets;
+    const auto it = mColumns.find(key);
+    if (it == mColumns.end()) {
+        return buckets;
+    }
+    buckets.reserve(it->second.mBucketCount);
+    Reader reader = read(it->second);
+    while (reader.next()) {
+        buckets.push_back({reader.getBucketStartNs(), reader.getBucketEndNs(), reader.getValue()});
+    }
+    return buckets;
+}
+
+void ColumnarPastBuckets::clear() {
+    mBoundaries.clear();
+    mColumns.clear();
+}
+
+size_t ColumnarPastBuckets::byteSize() const {
+    size_t totalSize = mBoundaries.size() * sizeof(Boundary);
+    for (const auto& pair : mColumns) {
+        totalSize += pair.second.mData.size();
+    }
+    return totalSize;
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "HashableDimensionKey.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+// A past bucket of one dimension, as decoded from ColumnarPastBuckets.
+struct PastBucket {
+    int64_t mBucketStartNs;
+    int64_t mBucketEndNs;
+    int64_t mValue;
+};
+
+/**
+ * Past buckets of a metric with one int64 value per dimension and bucket, stored by column.
+ *
+ * The bucket boundaries are stored once for all the dimensions. Each dimension only stores, for
+ * each bucket it has a value in, the distance to its previous bucket and the difference to its
+ * previous value, both varint encoded. Consecutive buckets with close values take 2 or 3 bytes,
+ * instead of the 24 bytes of a {start, end, value} struct.
+ *
+ * Buckets are appended with addBucket() followed by addValue() for each dimension in the bucket,
+ * and read back in order with a Reader.
+ */
+class ColumnarPastBuckets {
+public:
+    // The time span of a bucket, shared by all the dimensions.
+    struct Boundary {
+        int64_t mStartNs;
+        int64_t mEndNs;
+    };
+
+    // The encoded buckets of one dimension.
+    struct Column {
+        std::vector<uint8_t> mData;
+        // Number of buckets in mData.
+        size_t mBucketCount = 0;
+        // Index of the bucket after the last one in mData.
+        size_t mNextBucketIndex = 0;
+        int64_t mLastValue = 0;
+    };
+
+    typedef std::unordered_map<MetricDimensionKey, Column>::const_iterator const_iterator;
+
+    /**
+     * Decodes the buckets of one dimension, oldest first:
+     *     ColumnarPastBuckets::Reader reader = pastBuckets.read(it->second);
+     *     while (reader.next()) { ... reader.getValue() ... }
+     */
+    class Reader {
+    public:
+        // Moves to the next bucket. Returns false once all the buckets have been read.
+        bool next();
+
+        int64_t getBucketStartNs() const {
+            return mBoundaries[mBucketIndex].mStartNs;
+        }
+
+        int64_t getBucketEndNs() const {
+            return mBoundaries[mBucketIndex].mEndNs;
+        }
+
+        int64_t getValue() const {
+            return mValue;
+        }
+
+    private:
+        friend class ColumnarPastBuckets;
+
+        Reader(const Boundary* boundaries, const Column& column);
+
+        const Boundary* mBoundaries;
+        const uint8_t* mPos;
+        const uint8_t* mEnd;
+        size_t mBucketIndex;
+        size_t mNextBucketIndex;
+        int64_t mValue;
+    };
+
+    // Starts a new bucket. It must not start before the previous one.
+    void addBucket(const int64_t bucketStartNs, const int64_t bucketEndNs);
+
+    // Sets the value of [key] in the last bucket added. Called at most once per key and bucket.
+    void addValue(const MetricDimensionKey& key, const int64_t value);
+
+    bool empty() const {
+        return mColumns.empty();
+    }
+
+    // Number of dimensions.
+    size_t size() const {
+        return mColumns.size();
+    }
+
+    const_iterator begin() const {
+        return mColumns.begin();
+    }
+
+    const_iterator end() const {
+        return mColumns.end();
+    }
+
+    const_iterator find(const MetricDimensionKey& key) const {
+        return mColumns.find(key);
+    }
+
+    Reader read(const Column& column) const {
+        return Reader(mBoundaries.data(), column);
+    }
+
+    // Decodes all the buckets of [key]. Returns an empty list if the key has no bucket.
+    std::vector<PastBucket> getBuckets(const MetricDimensionKey& key) const;
+
+    void clear();
+
+    // Bytes used by the bucket boundaries and the encoded values. The dimension keys are not
+    // counted.
+    size_t byteSize() const;
+
+private:
+    std::vector<Boundary> mBoundaries;
+
+    std::unordered_map<MetricDimensionKey, Column> mColumns;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
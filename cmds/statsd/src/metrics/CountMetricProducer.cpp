@@ -22,6 +22,7 @@
 #include "stats_util.h"
 #include "stats_log_util.h"
 
+#include <algorithm>
 #include <limits.h>
 #include <stdlib.h>
 
@@ -203,24 +204,27 @@ void CountMetricProducer::onDumpReportLocked(const int64_t dumpTimeNs,
                                                str_set, protoOutput);
             }
         }
-        // Then fill bucket_info (CountBucketInfo).
-        for (const auto& bucket : counter.second) {
+        // Then fill bucket_info (CountBucketInfo), decoding the buckets straight into the proto.
+        ColumnarPastBuckets::Reader bucket = mPastBuckets.read(counter.second);
+        while (bucket.next()) {
+            const int64_t bucketStartNs = bucket.getBucketStartNs();
+            const int64_t bucketEndNs = bucket.getBucketEndNs();
             uint64_t bucketInfoToken = protoOutput->start(
                     FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_BUCKET_INFO);
             // Partial bucket.
-            if (bucket.mBucketEndNs - bucket.mBucketStartNs != mBucketSizeNs) {
+            if (bucketEndNs - bucketStartNs != mBucketSizeNs) {
                 protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_START_BUCKET_ELAPSED_MILLIS,
-                                   (long long)NanoToMillis(bucket.mBucketStartNs));
+                                   (long long)NanoToMillis(bucketStartNs));
                 protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_END_BUCKET_ELAPSED_MILLIS,
-                                   (long long)NanoToMillis(bucket.mBucketEndNs));
+                                   (long long)NanoToMillis(bucketEndNs));
             } else {
                 protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_BUCKET_NUM,
-                                   (long long)(getBucketNumFromEndTimeNs(bucket.mBucketEndNs)));
+                                   (long long)(getBucketNumFromEndTimeNs(bucketEndNs)));
             }
-            protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_COUNT, (long long)bucket.mCount);
+            protoOutput->write(FIELD_TYPE_INT64 | FIELD_ID_COUNT, (long long)bucket.getValue());
             protoOutput->end(bucketInfoToken);
-            VLOG("\t bucket [%lld - %lld] count: %lld", (long long)bucket.mBucketStartNs,
-                 (long long)bucket.mBucketEndNs, (long long)bucket.mCount);
+            VLOG("\t bucket [%lld - %lld] count: %lld", (long long)bucketStartNs,
+                 (long long)bucketEndNs, (long long)bucket.getValue());
         }
         protoOutput->end(wrapperToken);
     }
@@ -318,17 +322,12 @@ void CountMetricProducer::flushIfNeededLocked(const int64_t& eventTimeNs) {
 
 void CountMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
     int64_t fullBucketEndTimeNs = getCurrentBucketEndTimeNs();
-    CountBucket info;
-    info.mBucketStartNs = mCurrentBucketStartTimeNs;
-    if (eventTimeNs < fullBucketEndTimeNs) {
-        info.mBucketEndNs = eventTimeNs;
-    } else {
-        info.mBucketEndNs = fullBucketEndTimeNs;
+    if (!mCurrentSlicedCounter->empty()) {
+        mPastBuckets.addBucket(mCurrentBucketStartTimeNs,
+                               std::min(eventTimeNs, fullBucketEndTimeNs));
     }
     for (const auto& counter : *mCurrentSlicedCounter) {
-        info.mCount = counter.second;
-        auto& bucketList = mPastBuckets[counter.first];
-        bucketList.push_back(info);
+        mPastBuckets.addValue(counter.first, counter.second);
         VLOG("metric %lld, dump key value: %s -> %lld", (long long)mMetricId,
              counter.first.toString().c_str(),
              (long long)counter.second);
@@ -363,15 +362,9 @@ void CountMetricProducer::flushCurrentBucketLocked(const int64_t& eventTimeNs) {
     mCurrentSlicedCounter = std::make_shared<DimToValMap>();
 }
 
-// Rough estimate of CountMetricProducer buffer stored. This number will be
-// greater than actual data size as it contains each dimension of
-// CountMetricData is  duplicated.
+// Rough estimate of CountMetricProducer buffer stored. The dimension keys are not counted.
 size_t CountMetricProducer::byteSizeLocked() const {
-    size_t totalSize = 0;
-    for (const auto& pair : mPastBuckets) {
-        totalSize += pair.second.size() * kBucketSize;
-    }
-    return totalSize;
+    return mPastBuckets.byteSize();
 }
 
 }  // namespace statsd
@@ -24,6 +24,7 @@
 #include "../anomaly/AnomalyTracker.h"
 #include "../condition/ConditionTracker.h"
 #include "../matchers/matcher_util.h"
+#include "ColumnarPastBuckets.h"
 #include "MetricProducer.h"
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
 #include "stats_util.h"
@@ -32,12 +33,6 @@ namespace android {
 namespace os {
 namespace statsd {
 
-struct CountBucket {
-    int64_t mBucketStartNs;
-    int64_t mBucketEndNs;
-    int64_t mCount;
-};
-
 class CountMetricProducer : public MetricProducer {
 public:
     // TODO: Pass in the start time from MetricsManager, it should be consistent for all metrics.
@@ -81,7 +76,8 @@ private:
     void flushCurrentBucketLocked(const int64_t& eventTimeNs) override;
 
     // TODO: Add a lock to mPastBuckets.
-    std::unordered_map<MetricDimensionKey, std::vector<CountBucket>> mPastBuckets;
+    // The count of each dimension in each past bucket.
+    ColumnarPastBuckets mPastBuckets;
 
     // The current bucket (may be a partial bucket).
     std::shared_ptr<DimToValMap> mCurrentSlicedCounter = std::make_shared<DimToValMap>();
@@ -90,8 +86,6 @@ private:
     // partial bucket). This is only updated while flushing the current bucket.
     std::shared_ptr<DimToValMap> mCurrentFullCounters = std::make_shared<DimToValMap>();
 
-    static const size_t kBucketSize = sizeof(CountBucket{});
-
     bool hitGuardRailLocked(const MetricDimensionKey& newKey);
 
     FRIEND_TEST(CountMetricProducerTest, TestNonDimensionalEvents);
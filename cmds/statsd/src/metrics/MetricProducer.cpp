@@ -54,7 +54,7 @@ void MetricProducer::onMatchedLogEventLocked(const size_t matcherIndex, const Lo
 
     HashableDimensionKey dimensionInWhat;
     filterValues(mDimensionsInWhat, event.getValues(), &dimensionInWhat);
-    MetricDimensionKey metricKey(dimensionInWhat, DEFAULT_DIMENSION_KEY);
+    MetricDimensionKey metricKey(std::move(dimensionInWhat), DEFAULT_DIMENSION_KEY);
     for (const auto& conditionDimensionKey : dimensionKeysInCondition) {
         metricKey.setDimensionKeyInCondition(conditionDimensionKey);
         onMatchedLogEventInternalLocked(
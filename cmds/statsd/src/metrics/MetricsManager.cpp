@@ -69,11 +69,18 @@ MetricsManager::MetricsManager(const ConfigKey& key, const StatsdConfig& config,
 
     mConfigValid =
             initStatsdConfig(key, config, *uidMap, anomalyAlarmMonitor, periodicAlarmMonitor,
-                             timeBaseNs, currentTimeNs, mTagIds, mAllAtomMatchers,
+                             timeBaseNs, currentTimeNs, mTagIds, mTagIdToMatchersMap,
+                             mAllAtomMatchers,
                              mAllConditionTrackers, mAllMetricProducers, mAllAnomalyTrackers,
                              mAllPeriodicAlarmTrackers, mConditionToMetricMap, mTrackerToMetricMap,
                              mTrackerToConditionMap, mNoReportMetricIds);
 
+    mMatcherCache.resize(mAllAtomMatchers.size(), MatchingState::kNotComputed);
+    mConditionToBeEvaluated.resize(mAllConditionTrackers.size(), false);
+    mConditionsToBeEvaluated.reserve(mAllConditionTrackers.size());
+    mConditionCache.resize(mAllConditionTrackers.size(), ConditionState::kNotEvaluated);
+    mChangedCache.resize(mAllConditionTrackers.size(), false);
+
     mHashStringsInReport = config.hash_strings_in_metric_report();
 
     if (config.allowed_log_source_size() == 0) {
@@ -299,43 +306,67 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
 
     int tagId = event.GetTagId();
     int64_t eventTime = event.GetElapsedTimestampNs();
-    if (mTagIds.find(tagId) == mTagIds.end()) {
+    const auto matchersIt = mTagIdToMatchersMap.find(tagId);
+    if (matchersIt == mTagIdToMatchersMap.end()) {
         // not interesting...
         return;
     }
+    // Only these matchers can match the event, every other matcher would report kNotMatched.
+    const vector<int>& matcherIndices = matchersIt->second;
 
-    vector<MatchingState> matcherCache(mAllAtomMatchers.size(), MatchingState::kNotComputed);
+    vector<MatchingState>& matcherCache = mMatcherCache;
+    std::fill(matcherCache.begin(), matcherCache.end(), MatchingState::kNotComputed);
 
-    for (auto& matcher : mAllAtomMatchers) {
-        matcher->onLogEvent(event, mAllAtomMatchers, matcherCache);
+    for (const int matcherIndex : matcherIndices) {
+        mAllAtomMatchers[matcherIndex]->onLogEvent(event, mAllAtomMatchers, matcherCache);
     }
 
-    // A bitmap to see which ConditionTracker needs to be re-evaluated.
-    vector<bool> conditionToBeEvaluated(mAllConditionTrackers.size(), false);
-
-    for (const auto& pair : mTrackerToConditionMap) {
-        if (matcherCache[pair.first] == MatchingState::kMatched) {
-            const auto& conditionList = pair.second;
-            for (const int conditionIndex : conditionList) {
-                conditionToBeEvaluated[conditionIndex] = true;
+    // The ConditionTrackers that use a matched matcher, and need to be re-evaluated. A
+    // CombinationConditionTracker uses the matchers of all its descendants, so it is re-evaluated
+    // whenever one of them may have changed, and only then. The bitmap dedups the list.
+    vector<bool>& conditionToBeEvaluated = mConditionToBeEvaluated;
+    vector<int>& conditionsToBeEvaluated = mConditionsToBeEvaluated;
+    conditionsToBeEvaluated.clear();
+    int matchedMatcherCount = 0;
+    for (const int matcherIndex : matcherIndices) {
+        if (matcherCache[matcherIndex] != MatchingState::kMatched) {
+            continue;
+        }
+        matchedMatcherCount++;
+        auto pair = mTrackerToConditionMap.find(matcherIndex);
+        if (pair != mTrackerToConditionMap.end()) {
+            for (const int conditionIndex : pair->second) {
+                if (!conditionToBeEvaluated[conditionIndex]) {
+                    conditionToBeEvaluated[conditionIndex] = true;
+                    conditionsToBeEvaluated.push_back(conditionIndex);
+                }
             }
         }
     }
+    for (const int conditionIndex : conditionsToBeEvaluated) {
+        conditionToBeEvaluated[conditionIndex] = false;
+    }
+    // Each list is in index order already. Keep evaluating and notifying in index order when
+    // several matchers matched.
+    if (matchedMatcherCount > 1) {
+        std::sort(conditionsToBeEvaluated.begin(), conditionsToBeEvaluated.end());
+    }
 
-    vector<ConditionState> conditionCache(mAllConditionTrackers.size(),
-                                          ConditionState::kNotEvaluated);
+    vector<ConditionState>& conditionCache = mConditionCache;
+    std::fill(conditionCache.begin(), conditionCache.end(), ConditionState::kNotEvaluated);
     // A bitmap to track if a condition has changed value.
-    vector<bool> changedCache(mAllConditionTrackers.size(), false);
-    for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
-        if (conditionToBeEvaluated[i] == false) {
-            continue;
-        }
+    vector<bool>& changedCache = mChangedCache;
+    std::fill(changedCache.begin(), changedCache.end(), false);
+    // Children are evaluated by their parents on demand, and at most once per event thanks to
+    // conditionCache.
+    for (const int i : conditionsToBeEvaluated) {
         sp<ConditionTracker>& condition = mAllConditionTrackers[i];
         condition->evaluateCondition(event, matcherCache, mAllConditionTrackers, conditionCache,
                                      changedCache);
     }
 
-    for (size_t i = 0; i < mAllConditionTrackers.size(); i++) {
+    // Only the conditions using a matched matcher can have changed.
+    for (const int i : conditionsToBeEvaluated) {
         if (changedCache[i] == false) {
             continue;
         }
@@ -360,7 +391,7 @@ void MetricsManager::onLogEvent(const LogEvent& event) {
     }
 
     // For matched AtomMatchers, tell relevant metrics that a matched event has come.
-    for (size_t i = 0; i < mAllAtomMatchers.size(); i++) {
+    for (const int i : matcherIndices) {
         if (matcherCache[i] == MatchingState::kMatched) {
             StatsdStats::getInstance().noteMatcherMatched(mConfigKey,
                                                           mAllAtomMatchers[i]->getId());
@@ -149,6 +149,10 @@ private:
     // All event tags that are interesting to my metrics.
     std::set<int> mTagIds;
 
+    // maps from an event tag to the index of every LogMatchingTracker that can match it, in
+    // ascending order.
+    std::unordered_map<int, std::vector<int>> mTagIdToMatchersMap;
+
     // We only store the sp of LogMatchingTracker, MetricProducer, and ConditionTracker in
     // MetricsManager. There are relationships between them, and the relationships are denoted by
     // index instead of pointers. The reasons for this are: (1) the relationship between them are
@@ -174,9 +178,9 @@ private:
     // To make the log processing more efficient, we want to do as much filtering as possible
     // before we go into individual trackers and conditions to match.
 
-    // 1st filter: check if the event tag id is in mTagIds.
+    // 1st filter: check if the event tag id is in mTagIdToMatchersMap.
     // 2nd filter: if it is, we parse the event because there is at least one member is interested.
-    //             then pass to all LogMatchingTrackers (itself also filter events by ids).
+    //             then pass to the LogMatchingTrackers listed for the tag id.
     // 3nd filter: for LogMatchingTrackers that matched this event, we pass this event to the
     //             ConditionTrackers and MetricProducers that use this matcher.
     // 4th filter: for ConditionTrackers that changed value due to this event, we pass
@@ -193,6 +197,15 @@ private:
     // maps from ConditionTracker to MetricProducer
     std::unordered_map<int, std::vector<int>> mConditionToMetricMap;
 
+    // Scratch space for onLogEvent, sized to the number of matchers or conditions. They are kept
+    // across events so that processing an event doesn't allocate. onLogEvent is never called
+    // concurrently for the same MetricsManager.
+    std::vector<MatchingState> mMatcherCache;
+    std::vector<bool> mConditionToBeEvaluated;
+    std::vector<int> mConditionsToBeEvaluated;
+    std::vector<ConditionState> mConditionCache;
+    std::vector<bool> mChangedCache;
+
     void initLogSourceWhiteList();
 
     // The metrics that don't need to be uploaded or even reported.
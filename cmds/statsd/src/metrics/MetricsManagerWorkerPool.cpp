@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "MetricsManagerWorkerPool.h"
+
+#include <sys/prctl.h>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+MetricsManagerWorkerPool::MetricsManagerWorkerPool(size_t threadCount) {
+    mThreads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        // Shard 0 belongs to the calling thread.
+        mThreads.emplace_back([this, i] { workerLoop(i + 1); });
+    }
+    VLOG("MetricsManagerWorkerPool started %zu threads", threadCount);
+}
+
+MetricsManagerWorkerPool::~MetricsManagerWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mEventPosted.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void MetricsManagerWorkerPool::onLogEvent(const vector<sp<MetricsManager>>& metricsManagers,
+                                          const LogEvent& event) {
+    if (mThreads.empty() || metricsManagers.size() < 2) {
+        for (const auto& metricsManager : metricsManagers) {
+            metricsManager->onLogEvent(event);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMetricsManagers = &metricsManagers;
+        mEvent = &event;
+        mPendingWorkers = mThreads.size();
+        mGeneration++;
+    }
+    mEventPosted.notify_all();
+
+    runShard(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mEventDone.wait(lock, [this] { return mPendingWorkers == 0; });
+    mMetricsManagers = nullptr;
+    mEvent = nullptr;
+}
+
+void MetricsManagerWorkerPool::runShard(size_t shard) {
+    const size_t shardCount = mThreads.size() + 1;
+    for (size_t i = shard; i < mMetricsManagers->size(); i += shardCount) {
+        (*mMetricsManagers)[i]->onLogEvent(*mEvent);
+    }
+}
+
+void MetricsManagerWorkerPool::workerLoop(size_t shard) {
+    prctl(PR_SET_NAME, "statsd.metrics");
+
+    uint64_t lastGeneration = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mEventPosted.wait(lock, [this, lastGeneration] {
+            return mStopping || mGeneration != lastGeneration;
+        });
+        if (mStopping) {
+            return;
+        }
+        lastGeneration = mGeneration;
+
+        // The event and the list can't change until every worker is done with them.
+        lock.unlock();
+        runShard(shard);
+        lock.lock();
+
+        if (--mPendingWorkers == 0) {
+            mEventDone.notify_one();
+        }
+    }
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
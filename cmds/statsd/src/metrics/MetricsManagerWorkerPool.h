@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MetricsManager.h"
+#include "logd/LogEvent.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * A small pool of threads that hands a log event to several MetricsManagers in parallel.
+ *
+ * The MetricsManagers are split in shards: the i-th one goes to shard i % (threadCount + 1).
+ * Shard 0 runs on the calling thread and the others on the worker threads. onLogEvent() returns
+ * once every shard is done, so each MetricsManager still sees the events one at a time and in
+ * order, and the caller can keep guarding the MetricsManagers with a single lock.
+ *
+ * The MetricsManagers only share thread safe state (StatsdStats, UidMap, the pullers and the
+ * alarm monitors), so they can process the same event at the same time.
+ */
+class MetricsManagerWorkerPool {
+public:
+    explicit MetricsManagerWorkerPool(size_t threadCount);
+
+    // Waits for the worker threads to exit.
+    ~MetricsManagerWorkerPool();
+
+    size_t getThreadCount() const {
+        return mThreads.size();
+    }
+
+    // Calls onLogEvent([event]) on each of [metricsManagers], and returns once they are all done.
+    // Not thread safe: the calls must be serialized by the caller.
+    void onLogEvent(const std::vector<sp<MetricsManager>>& metricsManagers,
+                    const LogEvent& event);
+
+private:
+    void runShard(size_t shard);
+
+    void workerLoop(size_t shard);
+
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+
+    // Signaled when a new event is posted or the pool is stopping.
+    std::condition_variable mEventPosted;
+
+    // Signaled when the last worker is done with the current event.
+    std::condition_variable mEventDone;
+
+    // All fields below are guarded by mMutex.
+
+    // Incremented for each event posted to the workers.
+    uint64_t mGeneration = 0;
+
+    // Number of workers still processing the current event.
+    size_t mPendingWorkers = 0;
+
+    bool mStopping = false;
+
+    // The current event, and who to send it to. Only valid while mPendingWorkers > 0.
+    const std::vector<sp<MetricsManager>>* mMetricsManagers = nullptr;
+    const LogEvent* mEvent = nullptr;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
@@ -115,7 +115,8 @@ bool handleMetricWithConditions(
 
 bool initLogTrackers(const StatsdConfig& config, const UidMap& uidMap,
                      unordered_map<int64_t, int>& logTrackerMap,
-                     vector<sp<LogMatchingTracker>>& allAtomMatchers, set<int>& allTagIds) {
+                     vector<sp<LogMatchingTracker>>& allAtomMatchers, set<int>& allTagIds,
+                     unordered_map<int, std::vector<int>>& tagIdToMatchersMap) {
     vector<AtomMatcher> matcherConfigs;
     const int atomMatcherCount = config.atom_matcher_size();
     matcherConfigs.reserve(atomMatcherCount);
@@ -156,6 +157,14 @@ bool initLogTrackers(const StatsdConfig& config, const UidMap& uidMap,
         const set<int>& tagIds = matcher->getAtomIds();
         allTagIds.insert(tagIds.begin(), tagIds.end());
     }
+
+    // Matchers are visited in index order, so every list ends up sorted. A combination matcher
+    // reports the tag ids of all its children, so it is listed under each of them.
+    for (size_t i = 0; i < allAtomMatchers.size(); i++) {
+        for (const int tagId : allAtomMatchers[i]->getAtomIds()) {
+            tagIdToMatchersMap[tagId].push_back(i);
+        }
+    }
     return true;
 }
 
@@ -649,6 +658,7 @@ bool initStatsdConfig(const ConfigKey& key, const StatsdConfig& config, UidMap&
                       const sp<AlarmMonitor>& periodicAlarmMonitor,
                       const int64_t timeBaseNs, const int64_t currentTimeNs,
                       set<int>& allTagIds,
+                      unordered_map<int, std::vector<int>>& tagIdToMatchersMap,
                       vector<sp<LogMatchingTracker>>& allAtomMatchers,
                       vector<sp<ConditionTracker>>& allConditionTrackers,
                       vector<sp<MetricProducer>>& allMetricProducers,
@@ -662,7 +672,8 @@ bool initStatsdConfig(const ConfigKey& key, const StatsdConfig& config, UidMap&
     unordered_map<int64_t, int> conditionTrackerMap;
     unordered_map<int64_t, int> metricProducerMap;
 
-    if (!initLogTrackers(config, uidMap, logTrackerMap, allAtomMatchers, allTagIds)) {
+    if (!initLogTrackers(config, uidMap, logTrackerMap, allAtomMatchers, allTagIds,
+                         tagIdToMatchersMap)) {
         ALOGE("initLogMatchingTrackers failed");
         return false;
     }
@@ -45,11 +45,14 @@ namespace statsd {
 // [logTrackerMap]: this map should contain matcher name to index mapping
 // [allAtomMatchers]: should store the sp to all the LogMatchingTracker
 // [allTagIds]: contains the set of all interesting tag ids to this config.
+// [tagIdToMatchersMap]: maps each interesting tag id to the indices, in ascending order, of the
+//                       LogMatchingTrackers that can match it.
 bool initLogTrackers(const StatsdConfig& config,
                      const UidMap& uidMap,
                      std::unordered_map<int64_t, int>& logTrackerMap,
                      std::vector<sp<LogMatchingTracker>>& allAtomMatchers,
-                     std::set<int>& allTagIds);
+                     std::set<int>& allTagIds,
+                     std::unordered_map<int, std::vector<int>>& tagIdToMatchersMap);
 
 // Initialize ConditionTrackers
 // input:
@@ -60,7 +63,9 @@ bool initLogTrackers(const StatsdConfig& config,
 // [conditionTrackerMap]: this map should contain condition name to index mapping
 // [allConditionTrackers]: stores the sp to all the ConditionTrackers
 // [trackerToConditionMap]: contain the mapping from index of
-//                        log tracker to condition trackers that use the log tracker
+//                        log tracker to condition trackers that use the log tracker, in index
+//                        order. A combination condition uses the log trackers of all its
+//                        descendants.
 bool initConditions(const ConfigKey& key, const StatsdConfig& config,
                     const std::unordered_map<int64_t, int>& logTrackerMap,
                     std::unordered_map<int64_t, int>& conditionTrackerMap,
@@ -101,6 +106,7 @@ bool initStatsdConfig(const ConfigKey& key, const StatsdConfig& config, UidMap&
                       const sp<AlarmMonitor>& periodicAlarmMonitor,
                       const int64_t timeBaseNs, const int64_t currentTimeNs,
                       std::set<int>& allTagIds,
+                      std::unordered_map<int, std::vector<int>>& tagIdToMatchersMap,
                       std::vector<sp<LogMatchingTracker>>& allAtomMatchers,
                       std::vector<sp<ConditionTracker>>& allConditionTrackers,
                       std::vector<sp<MetricProducer>>& allMetricProducers,
@@ -118,6 +118,7 @@ void UidMap::updateMap(const int64_t& timestamp, const vector<int32_t>& uid,
             }
         }
 
+        mMapGeneration++;
         mMap.clear();
         for (size_t j = 0; j < uid.size(); j++) {
             string package = string(String8(packageName[j]).string());
@@ -155,6 +156,7 @@ void UidMap::updateApp(const int64_t& timestamp, const String16& app_16, const i
     string appName = string(String8(app_16).string());
     {
         lock_guard<mutex> lock(mMutex);
+        mMapGeneration++;
         int32_t prevVersion = 0;
         bool found = false;
         auto it = mMap.find(std::make_pair(uid, appName));
@@ -225,6 +227,7 @@ void UidMap::removeApp(const int64_t& timestamp, const String16& app_16, const i
     {
         lock_guard<mutex> lock(mMutex);
 
+        mMapGeneration++;
         int64_t prevVersion = 0;
         auto key = std::make_pair(uid, app);
         auto it = mMap.find(key);
@@ -417,6 +420,20 @@ set<int32_t> UidMap::getAppUid(const string& package) const {
     return results;
 }
 
+int64_t UidMap::getUidsFromNormalizedAppName(const string& normalizedAppName,
+                                             std::unordered_set<int32_t>* uids) const {
+    lock_guard<mutex> lock(mMutex);
+
+    uids->clear();
+    for (const auto& kv : mMap) {
+        if (!kv.second.deleted && kv.first.second.size() == normalizedAppName.size() &&
+            normalizeAppName(kv.first.second) == normalizedAppName) {
+            uids->insert(kv.first.first);
+        }
+    }
+    return mMapGeneration.load(std::memory_order_relaxed);
+}
+
 // Note not all the following AIDs are used as uids. Some are used only for gids.
 // It's ok to leave them in the map, but we won't ever see them in the log's uid field.
 // App's uid starts from 10000, and will not overlap with the following AIDs.
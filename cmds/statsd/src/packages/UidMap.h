@@ -27,11 +27,13 @@
 #include <log/logprint.h>
 #include <stdio.h>
 #include <utils/RefBase.h>
+#include <atomic>
 #include <list>
 #include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace android;
 using namespace std;
@@ -140,6 +142,17 @@ public:
 
     std::set<int32_t> getAppUid(const string& package) const;
 
+    // Stores in [uids] the uids with an app whose normalized name is [normalizedAppName]. Returns
+    // the generation of the map they were read from.
+    int64_t getUidsFromNormalizedAppName(const string& normalizedAppName,
+                                         std::unordered_set<int32_t>* uids) const;
+
+    // Changes each time an app is added, updated or removed, so that callers can tell when
+    // something they computed from the map is stale.
+    int64_t getMapGeneration() const {
+        return mMapGeneration.load(std::memory_order_relaxed);
+    }
+
 private:
     std::set<string> getAppNamesFromUidLocked(const int32_t& uid, bool returnNormalized) const;
     string normalizeAppName(const string& appName) const;
@@ -159,6 +172,9 @@ private:
     // Maps uid and package name to application data.
     std::unordered_map<std::pair<int, string>, AppData, PairHash> mMap;
 
+    // Incremented, while holding mMutex, each time mMap changes.
+    std::atomic<int64_t> mMapGeneration{0};
+
     // Maps isolated uid to the parent uid. Any metrics for an isolated uid will instead contribute
     // to the parent uid.
     std::unordered_map<int, int> mIsolatedUidMap;
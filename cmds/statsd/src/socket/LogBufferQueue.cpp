@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "LogBufferQueue.h"
+
+#include <algorithm>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+LogBufferQueue::LogBufferQueue(size_t capacity)
+    : mCapacity(capacity),
+      mBuffers(new LogBuffer[capacity]),
+      mPublished(0),
+      mReleased(0),
+      mClosed(false),
+      mReaderWaiting(false),
+      mWriterWaiting(false) {
+}
+
+size_t LogBufferQueue::size() const {
+    const uint64_t released = mReleased.load(std::memory_order_acquire);
+    return mPublished.load(std::memory_order_acquire) - released;
+}
+
+size_t LogBufferQueue::acquireFree(LogBuffer* buffers[], size_t max) {
+    // Only this thread moves mPublished.
+    const uint64_t published = mPublished.load(std::memory_order_relaxed);
+    // Acquire so that the reader is done with the buffers it released. Sequentially consistent
+    // for waitForFree(), see release().
+    const uint64_t released = mReleased.load(std::memory_order_seq_cst);
+    size_t count = std::min<uint64_t>(max, mCapacity - (published - released));
+    for (size_t i = 0; i < count; i++) {
+        buffers[i] = &mBuffers[(published + i) % mCapacity];
+    }
+    return count;
+}
+
+size_t LogBufferQueue::waitForFree(LogBuffer* buffers[], size_t max) {
+    size_t count = acquireFree(buffers, max);
+    if (count == 0) {
+        std::unique_lock<std::mutex> lock(mWaitMutex);
+        mWriterWaiting.store(true, std::memory_order_seq_cst);
+        mFreeCondition.wait(lock, [this, buffers, max, &count] {
+            count = acquireFree(buffers, max);
+            return count > 0 || mClosed.load();
+        });
+        mWriterWaiting.store(false, std::memory_order_relaxed);
+    }
+    if (mClosed.load()) {
+        return 0;
+    }
+    return count;
+}
+
+void LogBufferQueue::publish(size_t count) {
+    if (count == 0) {
+        return;
+    }
+    mPublished.fetch_add(count, std::memory_order_seq_cst);
+    // Pairs with the reader setting mReaderWaiting before it checks for published buffers: either
+    // it sees the new buffers, or we see that it is waiting and wake it up.
+    if (mReaderWaiting.load(std::memory_order_seq_cst)) {
+        {
+            // Wait until the reader is actually parked, so that the notification isn't lost.
+            std::lock_guard<std::mutex> lock(mWaitMutex);
+        }
+        mPublishedCondition.notify_one();
+    }
+}
+
+size_t LogBufferQueue::waitForPublished(LogBuffer* buffers[], size_t max) {
+    // Only this thread moves mReleased.
+    const uint64_t released = mReleased.load(std::memory_order_relaxed);
+    uint64_t published = mPublished.load(std::memory_order_acquire);
+    if (published == released) {
+        std::unique_lock<std::mutex> lock(mWaitMutex);
+        mReaderWaiting.store(true, std::memory_order_seq_cst);
+        mPublishedCondition.wait(lock, [this, released, &published] {
+            published = mPublished.load(std::memory_order_seq_cst);
+            return published != released || mClosed.load();
+        });
+        mReaderWaiting.store(false, std::memory_order_relaxed);
+    }
+    if (mClosed.load()) {
+        return 0;
+    }
+
+    size_t count = std::min<uint64_t>(max, published - released);
+    for (size_t i = 0; i < count; i++) {
+        buffers[i] = &mBuffers[(released + i) % mCapacity];
+    }
+    return count;
+}
+
+void LogBufferQueue::release(size_t count) {
+    if (count == 0) {
+        return;
+    }
+    mReleased.fetch_add(count, std::memory_order_seq_cst);
+    // Pairs with the writer setting mWriterWaiting before it checks for free buffers, like in
+    // publish().
+    if (mWriterWaiting.load(std::memory_order_seq_cst)) {
+        {
+            std::lock_guard<std::mutex> lock(mWaitMutex);
+        }
+        mFreeCondition.notify_one();
+    }
+}
+
+void LogBufferQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(mWaitMutex);
+        mClosed.store(true);
+    }
+    mPublishedCondition.notify_all();
+    mFreeCondition.notify_all();
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
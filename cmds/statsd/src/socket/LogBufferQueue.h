@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <log/log_read.h>
+#include <private/android_logger.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * A raw datagram read from the statsd socket, along with the credentials of its writer.
+ */
+struct LogBuffer {
+    // + 1 to ensure null terminator if MAX_PAYLOAD buffer is received
+    char data[sizeof_log_id_t + sizeof(uint16_t) + sizeof(log_time) + LOGGER_ENTRY_MAX_PAYLOAD +
+              1];
+
+    // Number of bytes received in data. Datagrams that are too short to hold an event are kept
+    // with a size of 0 and skipped by the reader.
+    size_t size;
+
+    // Wall clock time when the datagram was received, in seconds.
+    time_t sec;
+
+    pid_t pid;
+    uid_t uid;
+};
+
+/**
+ * A fixed size ring of LogBuffers handed from a single writer thread to a single reader thread.
+ * The buffers are allocated once, and the writer receives datagrams directly into them.
+ *
+ * Neither side takes a lock to hand over buffers. The mutex is only used to park the reader
+ * while the queue is empty, and the writer while it is full.
+ */
+class LogBufferQueue {
+public:
+    explicit LogBufferQueue(size_t capacity);
+
+    size_t capacity() const {
+        return mCapacity;
+    }
+
+    // Number of buffers written but not yet released by the reader.
+    size_t size() const;
+
+    /**
+     * Writer side. Stores in [buffers] up to [max] free buffers, in queue order, and returns how
+     * many were stored. Returns 0 if the queue is full.
+     */
+    size_t acquireFree(LogBuffer* buffers[], size_t max);
+
+    /**
+     * Writer side. Like acquireFree(), but blocks until at least one buffer is free or the queue
+     * is closed. Returns 0 once the queue is closed.
+     */
+    size_t waitForFree(LogBuffer* buffers[], size_t max);
+
+    /**
+     * Writer side. Hands the first [count] buffers from the last acquireFree() to the reader.
+     */
+    void publish(size_t count);
+
+    /**
+     * Reader side. Blocks until at least one buffer is published or the queue is closed. Stores in
+     * [buffers] up to [max] published buffers, in queue order, and returns how many were stored.
+     * Returns 0 once the queue is closed.
+     */
+    size_t waitForPublished(LogBuffer* buffers[], size_t max);
+
+    /**
+     * Reader side. Returns the first [count] buffers from the last waitForPublished() to the
+     * writer.
+     */
+    void release(size_t count);
+
+    // Wakes up both sides and makes waitForPublished() and waitForFree() return 0 from now on.
+    void close();
+
+private:
+    const size_t mCapacity;
+    std::unique_ptr<LogBuffer[]> mBuffers;
+
+    // Total number of buffers ever published (written by the writer) and released (written by
+    // the reader). Both only grow, and their difference is the number of buffers in use.
+    std::atomic<uint64_t> mPublished;
+    std::atomic<uint64_t> mReleased;
+
+    std::atomic<bool> mClosed;
+
+    // Set while the reader is parked on mPublishedCondition.
+    std::atomic<bool> mReaderWaiting;
+    // Set while the writer is parked on mFreeCondition.
+    std::atomic<bool> mWriterWaiting;
+    std::mutex mWaitMutex;
+    std::condition_variable mPublishedCondition;
+    std::condition_variable mFreeCondition;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
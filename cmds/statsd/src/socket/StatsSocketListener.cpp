@@ -29,6 +29,7 @@
 #include <cutils/sockets.h>
 #include <private/android_filesystem_config.h>
 #include <private/android_logger.h>
+#include <memory>
 #include <unordered_map>
 
 #include "StatsSocketListener.h"
@@ -42,10 +43,21 @@ namespace statsd {
 static const int kLogMsgHeaderSize = 28;
 
 StatsSocketListener::StatsSocketListener(const sp<LogListener>& listener)
-    : SocketListener(getLogSocket(), false /*start listen*/), mListener(listener) {
+    : StatsSocketListener(listener, getLogSocket()) {
+}
+
+StatsSocketListener::StatsSocketListener(const sp<LogListener>& listener, int socket)
+    : SocketListener(socket, false /*start listen*/),
+      mListener(listener),
+      mQueue(kQueueCapacity) {
+    mProcessingThread = std::thread([this] { processEvents(); });
 }
 
 StatsSocketListener::~StatsSocketListener() {
+    mQueue.close();
+    if (mProcessingThread.joinable()) {
+        mProcessingThread.join();
+    }
 }
 
 bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
@@ -55,65 +67,117 @@ bool StatsSocketListener::onDataAvailable(SocketClient* cli) {
         name_set = true;
     }
 
-    // + 1 to ensure null terminator if MAX_PAYLOAD buffer is received
-    char buffer[sizeof_log_id_t + sizeof(uint16_t) + sizeof(log_time) + LOGGER_ENTRY_MAX_PAYLOAD +
-                1];
-    struct iovec iov = {buffer, sizeof(buffer) - 1};
+    LogBuffer* buffers[kMaxBatchSize];
+    size_t count = mQueue.acquireFree(buffers, kMaxBatchSize);
+    if (count == 0) {
+        // The processing thread is behind. Wait for it, and leave the events in the socket
+        // meanwhile, rather than dropping them.
+        StatsdStats::getInstance().noteEventQueueFull();
+        count = mQueue.waitForFree(buffers, kMaxBatchSize);
+        if (count == 0) {
+            return false;
+        }
+    }
 
-    alignas(4) char control[CMSG_SPACE(sizeof(struct ucred))];
-    struct msghdr hdr = {
-            NULL, 0, &iov, 1, control, sizeof(control), 0,
-    };
+    for (size_t i = 0; i < count; i++) {
+        // -1 to ensure null terminator if MAX_PAYLOAD buffer is received
+        mIovecs[i] = {buffers[i]->data, sizeof(buffers[i]->data) - 1};
+        struct msghdr& hdr = mMessages[i].msg_hdr;
+        hdr.msg_name = NULL;
+        hdr.msg_namelen = 0;
+        hdr.msg_iov = &mIovecs[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = mControls[i];
+        hdr.msg_controllen = sizeof(mControls[i]);
+        hdr.msg_flags = 0;
+    }
 
     int socket = cli->getSocket();
 
-    // To clear the entire buffer is secure/safe, but this contributes to 1.68%
-    // overhead under logging load. We are safe because we check counts, but
-    // still need to clear null terminator
-    // memset(buffer, 0, sizeof(buffer));
-    ssize_t n = recvmsg(socket, &hdr, 0);
-    if (n <= (ssize_t)(sizeof(android_log_header_t))) {
+    // Only the first event is known to be there, take whatever else is already queued up.
+    int received = recvmmsg(socket, mMessages, count, MSG_DONTWAIT, NULL);
+    if (received <= 0) {
         return false;
     }
 
-    buffer[n] = 0;
-
-    struct ucred* cred = NULL;
-
-    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
-    while (cmsg != NULL) {
-        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS) {
-            cred = (struct ucred*)CMSG_DATA(cmsg);
-            break;
+    const time_t now = time(nullptr);
+    for (int i = 0; i < received; i++) {
+        LogBuffer* buffer = buffers[i];
+        ssize_t n = mMessages[i].msg_len;
+        if (n <= (ssize_t)(sizeof(android_log_header_t))) {
+            buffer->size = 0;
+            continue;
+        }
+        // To clear the entire buffer is secure/safe, but this contributes to 1.68%
+        // overhead under logging load. We are safe because we check counts, but
+        // still need to clear null terminator
+        buffer->data[n] = 0;
+        buffer->size = n;
+        buffer->sec = now;
+
+        struct ucred* cred = NULL;
+
+        struct msghdr* hdr = &mMessages[i].msg_hdr;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(hdr);
+        while (cmsg != NULL) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS) {
+                cred = (struct ucred*)CMSG_DATA(cmsg);
+                break;
+            }
+            cmsg = CMSG_NXTHDR(hdr, cmsg);
         }
-        cmsg = CMSG_NXTHDR(&hdr, cmsg);
-    }
 
-    struct ucred fake_cred;
-    if (cred == NULL) {
-        cred = &fake_cred;
-        cred->pid = 0;
-        cred->uid = DEFAULT_OVERFLOWUID;
+        if (cred == NULL) {
+            buffer->pid = 0;
+            buffer->uid = DEFAULT_OVERFLOWUID;
+        } else {
+            buffer->pid = cred->pid;
+            buffer->uid = cred->uid;
+        }
     }
 
-    char* ptr = ((char*)buffer) + sizeof(android_log_header_t);
-    n -= sizeof(android_log_header_t);
-
-    log_msg msg;
+    mQueue.publish(received);
+    StatsdStats::getInstance().noteEventQueueSize(mQueue.size());
 
-    msg.entry.len = n;
-    msg.entry.hdr_size = kLogMsgHeaderSize;
-    msg.entry.sec = time(nullptr);
-    msg.entry.pid = cred->pid;
-    msg.entry.uid = cred->uid;
-
-    memcpy(msg.buf + kLogMsgHeaderSize, ptr, n + 1);
-    LogEvent event(msg);
+    return true;
+}
 
-    // Call the listener
-    mListener->OnLogEvent(&event, false /*reconnected, N/A in statsd socket*/);
+void StatsSocketListener::processEvents() {
+    prctl(PR_SET_NAME, "statsd.events");
 
-    return true;
+    LogBuffer* buffers[kMaxBatchSize];
+    log_msg msg;
+    // The listener doesn't keep the events it is given, so one is recycled for all of them.
+    std::unique_ptr<LogEvent> event;
+    size_t count;
+    while ((count = mQueue.waitForPublished(buffers, kMaxBatchSize)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            const LogBuffer* buffer = buffers[i];
+            if (buffer->size == 0) {
+                continue;
+            }
+
+            const char* ptr = buffer->data + sizeof(android_log_header_t);
+            size_t n = buffer->size - sizeof(android_log_header_t);
+
+            msg.entry.len = n;
+            msg.entry.hdr_size = kLogMsgHeaderSize;
+            msg.entry.sec = buffer->sec;
+            msg.entry.pid = buffer->pid;
+            msg.entry.uid = buffer->uid;
+
+            memcpy(msg.buf + kLogMsgHeaderSize, ptr, n + 1);
+            if (event == nullptr) {
+                event = std::make_unique<LogEvent>(msg);
+            } else {
+                event->readFrom(msg);
+            }
+
+            // Call the listener
+            mListener->OnLogEvent(event.get(), false /*reconnected, N/A in statsd socket*/);
+        }
+        mQueue.release(count);
+    }
 }
 
 int StatsSocketListener::getLogSocket() {
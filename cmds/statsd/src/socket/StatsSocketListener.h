@@ -15,9 +15,13 @@
  */
 #pragma once
 
+#include <sys/socket.h>
 #include <sysutils/SocketListener.h>
 #include <utils/RefBase.h>
 #include "logd/LogListener.h"
+#include "socket/LogBufferQueue.h"
+
+#include <thread>
 
 // DEFAULT_OVERFLOWUID is defined in linux/highuid.h, which is not part of
 // the uapi headers for userspace to use.  This value is filled in on the
@@ -33,21 +37,52 @@ namespace android {
 namespace os {
 namespace statsd {
 
+/**
+ * Reads events from the statsd socket and hands them to a LogListener.
+ *
+ * The socket is read in batches on the listener thread, straight into the buffers of a
+ * LogBufferQueue. A separate processing thread turns the buffers into LogEvents and calls the
+ * LogListener, so that slow event processing does not stall the socket and drop logs. If the
+ * processing thread falls too far behind, the listener thread waits for it and the events wait in
+ * the socket.
+ */
 class StatsSocketListener : public SocketListener, public virtual android::RefBase {
 public:
     StatsSocketListener(const sp<LogListener>& listener);
 
+    // Listens on [socket] instead of the statsd socket. For benchmarks.
+    StatsSocketListener(const sp<LogListener>& listener, int socket);
+
     virtual ~StatsSocketListener();
 
+    // The number of events that can wait for the processing thread.
+    static const size_t kQueueCapacity = 128;
+
+    // The maximum number of events read from the socket at once.
+    static const size_t kMaxBatchSize = 32;
+
 protected:
     virtual bool onDataAvailable(SocketClient* cli);
 
 private:
     static int getLogSocket();
+
+    // Runs on the processing thread until the queue is closed.
+    void processEvents();
+
     /**
      * Who is going to get the events when they're read.
      */
     sp<LogListener> mListener;
+
+    LogBufferQueue mQueue;
+
+    // Scratch space for one recvmmsg() call on the listener thread.
+    struct mmsghdr mMessages[kMaxBatchSize];
+    struct iovec mIovecs[kMaxBatchSize];
+    alignas(4) char mControls[kMaxBatchSize][CMSG_SPACE(sizeof(struct ucred))];
+
+    std::thread mProcessingThread;
 };
 }  // namespace statsd
 }  // namespace os
@@ -0,0 +1,645 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#define DEBUG false  // STOPSHIP if true
+#include "Log.h"
+
+#include "storage/ReportLogStore.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android/util/protobuf.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "guardrail/StatsdStats.h"
+#include "stats_log_util.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using android::base::ReadFullyAtOffset;
+using android::base::StringPrintf;
+using android::base::WriteFully;
+using android::util::FIELD_COUNT_REPEATED;
+using android::util::FIELD_TYPE_MESSAGE;
+using android::util::ProtoOutputStream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// for ConfigMetricsReportList
+const int FIELD_ID_REPORTS = 2;
+
+const uint32_t kLogMagic = 0x73746c67;     // "stlg"
+const uint32_t kLogVersion = 1;
+const uint32_t kRecordMagic = 0x73747263;  // "strc"
+
+const char kLogSuffix[] = ".log";
+const char kCompactionSuffix[] = ".tmp";
+
+// Size of the chunks that reports are copied in.
+const size_t kCopyChunkSize = 64 * 1024;
+
+// A log is rewritten once its dead space is at least this large, and larger than its live records.
+const off_t kMinCompactionBytes = 256 * 1024;
+
+struct LogHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t head;
+};
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t size;
+    // Of the report, so that a report whose data didn't all make it to disk isn't loaded.
+    uint32_t crc;
+    uint32_t reserved;
+    int64_t wallClockSec;
+};
+
+// CRC-32 (IEEE 802.3), continuing from [crc], which is 0 for the first bytes.
+static uint32_t updateCrc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const vector<uint32_t> table = [] {
+        vector<uint32_t> table(256);
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static bool endsWith(const string& str, const char* suffix) {
+    size_t suffixLen = strlen(suffix);
+    return str.size() >= suffixLen && str.compare(str.size() - suffixLen, suffixLen, suffix) == 0;
+}
+
+static bool writeFullyAtOffset(int fd, const void* data, size_t size, off_t offset) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(pwrite(fd, p, size, offset));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+// Copies the bytes of a log file between [begin] and [end] to a new log, [deadBytes] earlier.
+static bool copyLogBytes(int fd, off_t begin, off_t end, off_t deadBytes, int newFd,
+                         uint8_t* chunk) {
+    for (off_t offset = begin; offset < end;) {
+        size_t toCopy = std::min<off_t>(kCopyChunkSize, end - offset);
+        if (!ReadFullyAtOffset(fd, chunk, toCopy, offset) ||
+            !writeFullyAtOffset(newFd, chunk, toCopy, offset - deadBytes)) {
+            return false;
+        }
+        offset += toCopy;
+    }
+    return true;
+}
+
+ReportLogStore::ReportLogStore(const string& dir)
+    : mDir(dir), mRecordCount(0), mRecordBytes(0), mDiskBytes(0) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        loadLocked();
+        trimLocked(getWallClockSec());
+    }
+    compactLogs();
+}
+
+ReportLogStore::~ReportLogStore() {
+    for (auto& pair : mLogs) {
+        close(pair.second.mFd);
+    }
+}
+
+void ReportLogStore::loadLocked() {
+    unique_ptr<DIR, decltype(&closedir)> dir(opendir(mDir.c_str()), closedir);
+    if (dir == NULL) {
+        VLOG("Path %s does not exist", mDir.c_str());
+        return;
+    }
+
+    // Reports written one file each, named by their timestamp, uid and config id, by older
+    // versions. Sorted by timestamp.
+    std::map<std::pair<int64_t, string>, ConfigKey> legacyReports;
+
+    dirent* de;
+    while ((de = readdir(dir.get()))) {
+        const string name = de->d_name;
+        if (name[0] == '.') continue;
+        const string path = mDir + "/" + name;
+
+        if (endsWith(name, kCompactionSuffix)) {
+            // A rewrite that was interrupted. The log it was replacing is still complete.
+            unlink(path.c_str());
+            continue;
+        }
+
+        int uid;
+        long long configId;
+        long long timestamp;
+        if (sscanf(name.c_str(), "%d_%lld", &uid, &configId) == 2 &&
+            name == StringPrintf("%d_%lld%s", uid, configId, kLogSuffix)) {
+            Log log = {path, open(path.c_str(), O_RDWR | O_CLOEXEC), 0, 0, {}, false, false, false};
+            if (log.mFd == -1) {
+                ALOGE("Failed to open %s", path.c_str());
+                continue;
+            }
+            if (!loadLogLocked(&log) || log.mRecords.empty()) {
+                close(log.mFd);
+                unlink(path.c_str());
+                continue;
+            }
+            mRecordCount += log.mRecords.size();
+            mRecordBytes += log.mEnd - log.mHead;
+            mDiskBytes += log.mEnd;
+            mLogs.emplace(ConfigKey(uid, configId), std::move(log));
+        } else if (sscanf(name.c_str(), "%lld_%d_%lld", &timestamp, &uid, &configId) == 3 &&
+                   name == StringPrintf("%lld_%d_%lld", timestamp, uid, configId)) {
+            legacyReports.emplace(std::make_pair(timestamp, path), ConfigKey(uid, configId));
+        }
+    }
+
+    for (const auto& report : legacyReports) {
+        const string& path = report.first.second;
+        string content;
+        Log* log = getOrCreateLogLocked(report.second);
+        if (log != nullptr && android::base::ReadFileToString(path, &content)) {
+            appendLocked(log, report.first.first,
+                         {{reinterpret_cast<const uint8_t*>(content.data()), content.size()}});
+        }
+        unlink(path.c_str());
+    }
+}
+
+bool ReportLogStore::loadLogLocked(Log* log) {
+    struct stat fileStat;
+    if (fstat(log->mFd, &fileStat) != 0) {
+        return false;
+    }
+    const off_t fileSize = fileStat.st_size;
+
+    LogHeader header;
+    if (fileSize < (off_t)sizeof(header) ||
+        !ReadFullyAtOffset(log->mFd, &header, sizeof(header), 0) || header.magic != kLogMagic ||
+        header.version != kLogVersion || header.head < (off_t)sizeof(header) ||
+        header.head > fileSize) {
+        ALOGE("Dropping unreadable report log %s", log->mPath.c_str());
+        return false;
+    }
+
+    log->mHead = header.head;
+    off_t offset = header.head;
+    RecordHeader recordHeader;
+    unique_ptr<uint8_t[]> chunk(new uint8_t[kCopyChunkSize]);
+    while (offset + (off_t)sizeof(recordHeader) <= fileSize &&
+           ReadFullyAtOffset(log->mFd, &recordHeader, sizeof(recordHeader), offset) &&
+           recordHeader.magic == kRecordMagic &&
+           offset + (off_t)sizeof(recordHeader) + recordHeader.size <= fileSize) {
+        uint32_t crc = 0;
+        const off_t reportOffset = offset + sizeof(recordHeader);
+        for (size_t read = 0; read < recordHeader.size;) {
+            size_t toRead = std::min<size_t>(kCopyChunkSize, recordHeader.size - read);
+            if (!ReadFullyAtOffset(log->mFd, chunk.get(), toRead, reportOffset + read)) {
+                break;
+            }
+            crc = updateCrc32(crc, chunk.get(), toRead);
+            read += toRead;
+        }
+        if (crc != recordHeader.crc) {
+            break;
+        }
+        log->mRecords.push_back({offset + (off_t)sizeof(recordHeader), recordHeader.size,
+                                 recordHeader.wallClockSec});
+        offset += sizeof(recordHeader) + recordHeader.size;
+    }
+    if (offset != fileSize) {
+        ALOGW("Dropping %lld bytes of partially written reports from %s",
+              (long long)(fileSize - offset), log->mPath.c_str());
+        if (ftruncate(log->mFd, offset) != 0) {
+            return false;
+        }
+    }
+    log->mEnd = offset;
+    return true;
+}
+
+ReportLogStore::Log* ReportLogStore::getOrCreateLogLocked(const ConfigKey& key) {
+    auto it = mLogs.find(key);
+    if (it != mLogs.end()) {
+        return &it->second;
+    }
+
+    string path = StringPrintf("%s/%d_%lld%s", mDir.c_str(), key.GetUid(),
+                               (long long)key.GetId(), kLogSuffix);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        ALOGE("Failed to create %s", path.c_str());
+        return nullptr;
+    }
+    Log log = {path, fd, sizeof(LogHeader), sizeof(LogHeader), {}, false, false, false};
+    if (!writeHeadLocked(log)) {
+        ALOGE("Failed to write %s", path.c_str());
+        close(fd);
+        unlink(path.c_str());
+        return nullptr;
+    }
+    mDiskBytes += log.mEnd;
+    return &mLogs.emplace(key, std::move(log)).first->second;
+}
+
+bool ReportLogStore::writeHeadLocked(const Log& log) {
+    LogHeader header = {kLogMagic, kLogVersion, log.mHead};
+    return writeFullyAtOffset(log.mFd, &header, sizeof(header), 0);
+}
+
+bool ReportLogStore::append(const ConfigKey& key, int64_t wallClockSec, ProtoOutputStream* report) {
+    vector<std::pair<const uint8_t*, size_t>> chunks;
+    auto iter = report->data();
+    while (iter.readBuffer() != NULL) {
+        size_t toRead = iter.currentToRead();
+        chunks.emplace_back(iter.readBuffer(), toRead);
+        iter.rp()->move(toRead);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Log* log = getOrCreateLogLocked(key);
+    if (log == nullptr) {
+        return false;
+    }
+    bool appended = appendLocked(log, wallClockSec, chunks);
+    trimLocked(wallClockSec);
+    return appended;
+}
+
+bool ReportLogStore::appendLocked(Log* log, int64_t wallClockSec,
+                                  const vector<std::pair<const uint8_t*, size_t>>& report) {
+    const off_t offset = log->mEnd + sizeof(RecordHeader);
+    size_t size = 0;
+    uint32_t crc = 0;
+    bool written = true;
+    for (const auto& chunk : report) {
+        written = written && writeFullyAtOffset(log->mFd, chunk.first, chunk.second, offset + size);
+        crc = updateCrc32(crc, chunk.first, chunk.second);
+        size += chunk.second;
+    }
+    RecordHeader header = {kRecordMagic, (uint32_t)size, crc, 0, wallClockSec};
+    if (!written || !writeFullyAtOffset(log->mFd, &header, sizeof(header), log->mEnd)) {
+        ALOGE("Failed to append a report to %s", log->mPath.c_str());
+        // Cut off what was written of the record, so that the following ones can be read back.
+        if (ftruncate(log->mFd, log->mEnd) != 0) {
+            ALOGE("Failed to truncate %s", log->mPath.c_str());
+        }
+        return false;
+    }
+    log->mRecords.push_back({offset, size, wallClockSec});
+    log->mEnd = offset + size;
+    log->mDirty = true;
+    mRecordCount++;
+    mRecordBytes += sizeof(header) + size;
+    mDiskBytes += sizeof(header) + size;
+    return true;
+}
+
+void ReportLogStore::sync() {
+    compactLogs();
+
+    // The logs are synced through duplicated descriptors, so that appends don't wait for the
+    // disk, and a log rewritten in the meantime doesn't close the descriptor being synced.
+    vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& pair : mLogs) {
+            Log& log = pair.second;
+            if (log.mDirty) {
+                int fd = dup(log.mFd);
+                if (fd == -1) {
+                    ALOGE("Failed to sync %s", log.mPath.c_str());
+                    continue;
+                }
+                fds.push_back(fd);
+                log.mDirty = false;
+            }
+        }
+    }
+    for (int fd : fds) {
+        if (fsync(fd) != 0) {
+            ALOGE("Failed to sync a report log in %s", mDir.c_str());
+        }
+        close(fd);
+    }
+}
+
+bool ReportLogStore::hasReports(const ConfigKey& key) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mLogs.find(key);
+    return it != mLogs.end() && !it->second.mRecords.empty();
+}
+
+void ReportLogStore::forEachConfigWithReports(
+        const std::function<void(const ConfigKey&)>& callback) {
+    vector<ConfigKey> keys;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& pair : mLogs) {
+            if (!pair.second.mRecords.empty()) {
+                keys.push_back(pair.first);
+            }
+        }
+    }
+    for (const auto& key : keys) {
+        callback(key);
+    }
+}
+
+bool ReportLogStore::takeReports(const ConfigKey& key,
+                                 const std::function<bool(int fd, const Record& record)>& write) {
+    int fd;
+    vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mLogs.find(key);
+        if (it == mLogs.end() || it->second.mTaking) {
+            return true;
+        }
+        Log& log = it->second;
+        // Duplicated, since the log can be rewritten while the records are read. The rewrite
+        // leaves the old file as it is, so the records can still be read from it.
+        fd = dup(log.mFd);
+        if (fd == -1) {
+            ALOGE("Failed to read %s", log.mPath.c_str());
+            return false;
+        }
+        log.mTaking = true;
+        records.assign(log.mRecords.begin(), log.mRecords.end());
+    }
+
+    // The records are only read, and new ones are appended after them, so this doesn't need the
+    // lock, and appends don't wait for the reader.
+    bool written = true;
+    for (const Record& record : records) {
+        if (!write(fd, record)) {
+            written = false;
+            break;
+        }
+    }
+    close(fd);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Log& log = mLogs.find(key)->second;
+    log.mTaking = false;
+    if (written) {
+        dropRecordsLocked(&log, records.size());
+    }
+    // Catch up with the trimming that was held off while reading.
+    trimLocked(getWallClockSec());
+    return written;
+}
+
+void ReportLogStore::takeReports(const ConfigKey& key, ProtoOutputStream* proto) {
+    string content;
+    takeReports(key, [proto, &content](int fd, const Record& record) {
+        content.resize(record.mSize);
+        if (!ReadFullyAtOffset(fd, &content[0], record.mSize, record.mOffset)) {
+            return false;
+        }
+        proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
+                     content.c_str(), content.size());
+        return true;
+    });
+}
+
+ssize_t ReportLogStore::takeReports(const ConfigKey& key, int outFd) {
+    unique_ptr<uint8_t[]> chunk;
+    ssize_t bytesWritten = 0;
+    bool written = takeReports(key, [outFd, &chunk, &bytesWritten](int fd, const Record& record) {
+        uint8_t header[20];
+        uint8_t* headerEnd =
+                android::util::write_length_delimited_tag_header(header, FIELD_ID_REPORTS,
+                                                                 record.mSize);
+        if (!WriteFully(outFd, header, headerEnd - header)) {
+            return false;
+        }
+        bytesWritten += headerEnd - header;
+
+        if (chunk == nullptr) {
+            chunk.reset(new uint8_t[kCopyChunkSize]);
+        }
+        for (size_t copied = 0; copied < record.mSize;) {
+            size_t toCopy = std::min(kCopyChunkSize, record.mSize - copied);
+            if (!ReadFullyAtOffset(fd, chunk.get(), toCopy, record.mOffset + copied) ||
+                !WriteFully(outFd, chunk.get(), toCopy)) {
+                return false;
+            }
+            copied += toCopy;
+            bytesWritten += toCopy;
+        }
+        return true;
+    });
+    if (!written) {
+        ALOGE("Failed to write the reports of %s", key.ToString().c_str());
+        return -1;
+    }
+    return bytesWritten;
+}
+
+void ReportLogStore::dropRecordsLocked(Log* log, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        mRecordCount--;
+        mRecordBytes -= sizeof(RecordHeader) + log->mRecords.front().mSize;
+        log->mRecords.pop_front();
+    }
+    if (log->mRecords.empty() && !log->mCompacting) {
+        // Nothing left, so the log starts over instead of being rewritten.
+        if (ftruncate(log->mFd, sizeof(LogHeader)) == 0) {
+            mDiskBytes -= log->mEnd - sizeof(LogHeader);
+            log->mEnd = sizeof(LogHeader);
+        }
+        log->mHead = log->mEnd;
+    } else {
+        log->mHead = log->mRecords.front().mOffset - sizeof(RecordHeader);
+    }
+    if (!writeHeadLocked(*log)) {
+        ALOGE("Failed to write %s", log->mPath.c_str());
+    }
+    log->mDirty = true;
+}
+
+void ReportLogStore::trimLocked(int64_t nowWallClockSec) {
+    while (true) {
+        // The log with the oldest report.
+        Log* oldest = nullptr;
+        for (auto& pair : mLogs) {
+            Log& log = pair.second;
+            if (log.mTaking || log.mRecords.empty()) {
+                continue;
+            }
+            if (oldest == nullptr ||
+                log.mRecords.front().mWallClockSec < oldest->mRecords.front().mWallClockSec) {
+                oldest = &log;
+            }
+        }
+        if (oldest == nullptr ||
+            (nowWallClockSec - oldest->mRecords.front().mWallClockSec <=
+                     StatsdStats::kMaxAgeSecond &&
+             mRecordCount <= (size_t)StatsdStats::kMaxFileNumber &&
+             mRecordBytes <= (size_t)StatsdStats::kMaxFileSize)) {
+            break;
+        }
+        dropRecordsLocked(oldest, 1);
+    }
+}
+
+ReportLogStore::Log* ReportLogStore::getLogToCompactLocked(const std::set<ConfigKey>& skipped,
+                                                           ConfigKey* key) {
+    // The dropped reports take space on disk until their log is rewritten. While the files are
+    // over the size limit, the log with the most dead space is rewritten, whatever it holds.
+    const bool overSizeLimit = mDiskBytes > (size_t)StatsdStats::kMaxFileSize;
+    Log* chosen = nullptr;
+    for (auto& pair : mLogs) {
+        Log& log = pair.second;
+        const off_t deadBytes = log.mHead - sizeof(LogHeader);
+        const off_t liveBytes = log.mEnd - log.mHead;
+        if (log.mCompacting || deadBytes == 0 || skipped.find(pair.first) != skipped.end()) {
+            continue;
+        }
+        if (overSizeLimit) {
+            if (chosen == nullptr || log.mHead > chosen->mHead) {
+                chosen = &log;
+                *key = pair.first;
+            }
+        } else if (deadBytes >= kMinCompactionBytes && deadBytes > liveBytes) {
+            // Each rewrite copies less than what was dropped since the previous one, so the cost
+            // of compaction stays proportional to what is appended.
+            *key = pair.first;
+            return &log;
+        }
+    }
+    return chosen;
+}
+
+void ReportLogStore::compactLogs() {
+    // The logs already rewritten, or that failed to be.
+    std::set<ConfigKey> compacted;
+    while (true) {
+        ConfigKey key;
+        int fd;
+        off_t head;
+        off_t end;
+        string path;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            Log* log = getLogToCompactLocked(compacted, &key);
+            if (log == nullptr) {
+                return;
+            }
+            compacted.insert(key);
+            fd = dup(log->mFd);
+            if (fd == -1) {
+                ALOGE("Failed to compact %s", log->mPath.c_str());
+                continue;
+            }
+            log->mCompacting = true;
+            head = log->mHead;
+            end = log->mEnd;
+            path = log->mPath;
+        }
+
+        // Copies the live records without holding the lock. The records are not modified, and the
+        // head only moves forward in the meantime, so they can be read from a duplicated
+        // descriptor while reports are appended or taken.
+        const off_t deadBytes = head - sizeof(LogHeader);
+        const string newPath = path + kCompactionSuffix;
+        int newFd = open(newPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                         S_IRUSR | S_IWUSR);
+        unique_ptr<uint8_t[]> chunk(new uint8_t[kCopyChunkSize]);
+        bool copied = newFd != -1 && copyLogBytes(fd, head, end, deadBytes, newFd, chunk.get()) &&
+                      fdatasync(newFd) == 0;
+        close(fd);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        Log& log = mLogs.find(key)->second;
+        log.mCompacting = false;
+        // What was appended while copying is copied under the lock, which is little. Then the
+        // new log has to be on disk before it replaces the old one.
+        LogHeader header = {kLogMagic, kLogVersion, log.mHead - deadBytes};
+        copied = copied && copyLogBytes(log.mFd, end, log.mEnd, deadBytes, newFd, chunk.get()) &&
+                 writeFullyAtOffset(newFd, &header, sizeof(header), 0) && fsync(newFd) == 0 &&
+                 rename(newPath.c_str(), path.c_str()) == 0;
+        if (!copied) {
+            ALOGE("Failed to compact %s", path.c_str());
+            if (newFd != -1) {
+                close(newFd);
+                unlink(newPath.c_str());
+            }
+            continue;
+        }
+
+        close(log.mFd);
+        log.mFd = newFd;
+        log.mHead -= deadBytes;
+        log.mEnd -= deadBytes;
+        for (Record& record : log.mRecords) {
+            record.mOffset -= deadBytes;
+        }
+        mDiskBytes -= deadBytes;
+    }
+}
+
+void ReportLogStore::printStats(FILE* out) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    fprintf(out, "Printing stats of %s\n", mDir.c_str());
+    int logCount = 0;
+    for (const auto& pair : mLogs) {
+        const Log& log = pair.second;
+        fprintf(out,
+                "\t #%d, UID: %d, Config ID: %lld, Reports: %zu, Report Size: %lld bytes, "
+                "Log Size: %lld bytes\n",
+                ++logCount, pair.first.GetUid(), (long long)pair.first.GetId(),
+                log.mRecords.size(), (long long)(log.mEnd - log.mHead), (long long)log.mEnd);
+    }
+    fprintf(out,
+            "\tTotal number of reports: %zu, Total size of reports: %zu bytes, Total size on "
+            "disk: %zu bytes.\n",
+            mRecordCount, mRecordBytes, mDiskBytes);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
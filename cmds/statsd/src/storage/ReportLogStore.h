@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <android/util/ProtoOutputStream.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "config/ConfigKey.h"
+
+namespace android {
+namespace os {
+namespace statsd {
+
+/**
+ * Keeps the ConfigMetricsReports written to disk until they are collected, in one append-only log
+ * file per config.
+ *
+ * A log starts with a header holding the offset of its first live record, and each record is a
+ * small header (size, checksum and wall clock time) followed by the serialized report. The
+ * position of every live record is indexed in memory, so that appending, reading and trimming
+ * reports never lists the directory or stats the files. The directory is only listed once, when
+ * the store is created, to load the index.
+ *
+ * Trimming the oldest reports only moves the head offset of their log. The dead space at the start
+ * of a log is reclaimed by rewriting the log once it outweighs the live records, or as soon as the
+ * log files are over the size limit of StatsdStats, so that the limit holds for the files on disk
+ * and not just for the live records.
+ *
+ * Appends neither rewrite the logs nor sync them to disk. sync() does both for all the logs
+ * appended to since the last sync, so that a round of flushes costs one fsync per config. It copies
+ * and syncs without holding the lock of the store, so appends don't wait for the disk.
+ */
+class ReportLogStore {
+public:
+    explicit ReportLogStore(const std::string& dir);
+
+    ~ReportLogStore();
+
+    /**
+     * Appends the serialized ConfigMetricsReport [report], written at [wallClockSec], to the log
+     * of [key]. Then drops the oldest reports of all the configs while the store is over the
+     * limits of StatsdStats. Returns false if the report could not be written.
+     */
+    bool append(const ConfigKey& key, int64_t wallClockSec, util::ProtoOutputStream* report);
+
+    /**
+     * Rewrites the logs with too much dead space, then syncs to disk the logs appended to since
+     * the last call. The files can be over the size limit until then. This does disk I/O, so it
+     * shouldn't be called while holding a lock that event processing needs.
+     */
+    void sync();
+
+    bool hasReports(const ConfigKey& key);
+
+    // Calls [callback] with each config that has reports.
+    void forEachConfigWithReports(const std::function<void(const ConfigKey&)>& callback);
+
+    /**
+     * Writes the reports of [key], oldest first, as reports of a ConfigMetricsReportList, and
+     * removes them.
+     */
+    void takeReports(const ConfigKey& key, util::ProtoOutputStream* proto);
+
+    /**
+     * Same as above, but copies the reports to [outFd] a fixed size chunk at a time. Returns the
+     * number of bytes written, or -1 if writing failed, in which case the reports are kept.
+     */
+    ssize_t takeReports(const ConfigKey& key, int outFd);
+
+    void printStats(FILE* out);
+
+private:
+    struct Record {
+        // Offset of the serialized report in the log.
+        off_t mOffset;
+        size_t mSize;
+        int64_t mWallClockSec;
+    };
+
+    struct Log {
+        std::string mPath;
+        int mFd;
+        // Offset of the header of the first live record.
+        off_t mHead;
+        off_t mEnd;
+        std::deque<Record> mRecords;
+        // Appended to since the last sync().
+        bool mDirty;
+        // Set while takeReports() reads the records without holding mMutex. The head of the log
+        // doesn't move in the meantime.
+        bool mTaking;
+        // Set while compactLogs() copies the records without holding mMutex. The log isn't
+        // truncated in the meantime.
+        bool mCompacting;
+    };
+
+    // Runs [write] on each record of [key], without holding mMutex, and removes the records if
+    // [write] succeeded for all of them.
+    bool takeReports(const ConfigKey& key,
+                     const std::function<bool(int fd, const Record& record)>& write);
+
+    void loadLocked();
+
+    // Reads the records of an existing log. Cuts off a record that was only partially written, or
+    // whose checksum doesn't match.
+    bool loadLogLocked(Log* log);
+
+    Log* getOrCreateLogLocked(const ConfigKey& key);
+
+    bool writeHeadLocked(const Log& log);
+
+    // Appends to [log] a record of the report made of the chunks of [report].
+    bool appendLocked(Log* log, int64_t wallClockSec,
+                      const std::vector<std::pair<const uint8_t*, size_t>>& report);
+
+    // Removes the [count] oldest records of [log].
+    void dropRecordsLocked(Log* log, size_t count);
+
+    // Drops the oldest reports of all the logs while over the limits.
+    void trimLocked(int64_t nowWallClockSec);
+
+    // Returns the next log to rewrite without its dead space, other than those of [skipped], and
+    // sets [key] to its config. Returns nullptr if none needs to be.
+    Log* getLogToCompactLocked(const std::set<ConfigKey>& skipped, ConfigKey* key);
+
+    // Rewrites the logs that need it.
+    void compactLogs();
+
+    const std::string mDir;
+
+    std::mutex mMutex;
+
+    std::map<ConfigKey, Log> mLogs;
+
+    // Sum over all logs.
+    size_t mRecordCount;
+    size_t mRecordBytes;
+    // Size of all the log files, including the dead space before their heads.
+    size_t mDiskBytes;
+};
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
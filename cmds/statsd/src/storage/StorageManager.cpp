@@ -19,6 +19,7 @@
 
 #include "android-base/stringprintf.h"
 #include "guardrail/StatsdStats.h"
+#include "storage/ReportLogStore.h"
 #include "storage/StorageManager.h"
 #include "stats_log_util.h"
 
@@ -32,16 +33,11 @@ namespace android {
 namespace os {
 namespace statsd {
 
-using android::util::FIELD_COUNT_REPEATED;
-using android::util::FIELD_TYPE_MESSAGE;
 using std::map;
 
 #define STATS_DATA_DIR "/data/misc/stats-data"
 #define STATS_SERVICE_DIR "/data/misc/stats-service"
 
-// for ConfigMetricsReportList
-const int FIELD_ID_REPORTS = 2;
-
 using android::base::StringPrintf;
 using std::unique_ptr;
 
@@ -68,20 +64,33 @@ static string getFilePath(const char* path, int64_t timestamp, int64_t uid, int6
                         (long long)configID);
 }
 
+// Returns the path of the file [file] is written to before being renamed into place. Its name
+// starts with a dot, so the directory listings skip it.
+static string getTempFilePath(const char* file) {
+    const char* name = strrchr(file, '/');
+    if (name == nullptr) {
+        return StringPrintf(".%s", file);
+    }
+    return StringPrintf("%.*s/.%s", (int)(name - file), file, name + 1);
+}
+
 void StorageManager::writeFile(const char* file, const void* buffer, int numBytes) {
-    int fd = open(file, O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    // Write to a temp file then rename it, so that whoever lists the directory only ever sees
+    // complete files.
+    const string tempFile = getTempFilePath(file);
+    int fd = open(tempFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
     if (fd == -1) {
-        VLOG("Attempt to access %s but failed", file);
+        VLOG("Attempt to access %s but failed", tempFile.c_str());
         return;
     }
     trimToFit(STATS_SERVICE_DIR);
-    trimToFit(STATS_DATA_DIR);
 
     int result = write(fd, buffer, numBytes);
-    if (result == numBytes) {
-        VLOG("Successfully wrote %s", file);
-    } else {
+    if (result != numBytes) {
         VLOG("Failed to write %s", file);
+        close(fd);
+        remove(tempFile.c_str());
+        return;
     }
 
     result = fchown(fd, AID_STATSD, AID_STATSD);
@@ -90,6 +99,12 @@ void StorageManager::writeFile(const char* file, const void* buffer, int numByte
     }
 
     close(fd);
+    if (rename(tempFile.c_str(), file) != 0) {
+        VLOG("Failed to rename %s to %s", tempFile.c_str(), file);
+        remove(tempFile.c_str());
+        return;
+    }
+    VLOG("Successfully wrote %s", file);
 }
 
 void StorageManager::deleteFile(const char* file) {
@@ -136,98 +151,34 @@ void StorageManager::deleteSuffixedFiles(const char* path, const char* suffix) {
     }
 }
 
-void StorageManager::sendBroadcast(const char* path,
-                                   const std::function<void(const ConfigKey&)>& sendBroadcast) {
-    unique_ptr<DIR, decltype(&closedir)> dir(opendir(path), closedir);
-    if (dir == NULL) {
-        VLOG("no stats-data directory on disk");
-        return;
-    }
+static ReportLogStore& getReportLogStore() {
+    static ReportLogStore store(STATS_DATA_DIR);
+    return store;
+}
 
-    dirent* de;
-    while ((de = readdir(dir.get()))) {
-        char* name = de->d_name;
-        if (name[0] == '.') continue;
-        VLOG("file %s", name);
+void StorageManager::sendBroadcast(const std::function<void(const ConfigKey&)>& sendBroadcast) {
+    getReportLogStore().forEachConfigWithReports(sendBroadcast);
+}
 
-        int64_t result[3];
-        parseFileName(name, result);
-        if (result[0] == -1) continue;
-        int64_t uid = result[1];
-        int64_t configID = result[2];
+bool StorageManager::writeConfigMetricsReport(const ConfigKey& key, int64_t wallClockSec,
+                                              ProtoOutputStream* report) {
+    return getReportLogStore().append(key, wallClockSec, report);
+}
 
-        sendBroadcast(ConfigKey((int)uid, configID));
-    }
+void StorageManager::syncConfigMetricsReports() {
+    getReportLogStore().sync();
 }
 
 bool StorageManager::hasConfigMetricsReport(const ConfigKey& key) {
-    unique_ptr<DIR, decltype(&closedir)> dir(opendir(STATS_DATA_DIR), closedir);
-    if (dir == NULL) {
-        VLOG("Path %s does not exist", STATS_DATA_DIR);
-        return false;
-    }
-
-    string suffix = StringPrintf("%d_%lld", key.GetUid(), (long long)key.GetId());
-
-    dirent* de;
-    while ((de = readdir(dir.get()))) {
-        char* name = de->d_name;
-        if (name[0] == '.') continue;
-
-        size_t nameLen = strlen(name);
-        size_t suffixLen = suffix.length();
-        if (suffixLen <= nameLen &&
-            strncmp(name + nameLen - suffixLen, suffix.c_str(), suffixLen) == 0) {
-            // Check again that the file name is parseable.
-            int64_t result[3];
-            parseFileName(name, result);
-            if (result[0] == -1) continue;
-            return true;
-        }
-    }
-    return false;
+    return getReportLogStore().hasReports(key);
 }
 
 void StorageManager::appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto) {
-    unique_ptr<DIR, decltype(&closedir)> dir(opendir(STATS_DATA_DIR), closedir);
-    if (dir == NULL) {
-        VLOG("Path %s does not exist", STATS_DATA_DIR);
-        return;
-    }
-
-    string suffix = StringPrintf("%d_%lld", key.GetUid(), (long long)key.GetId());
-
-    dirent* de;
-    while ((de = readdir(dir.get()))) {
-        char* name = de->d_name;
-        if (name[0] == '.') continue;
-
-        size_t nameLen = strlen(name);
-        size_t suffixLen = suffix.length();
-        if (suffixLen <= nameLen &&
-            strncmp(name + nameLen - suffixLen, suffix.c_str(), suffixLen) == 0) {
-            int64_t result[3];
-            parseFileName(name, result);
-            if (result[0] == -1) continue;
-            int64_t timestamp = result[0];
-            int64_t uid = result[1];
-            int64_t configID = result[2];
-
-            string file_name = getFilePath(STATS_DATA_DIR, timestamp, uid, configID);
-            int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
-            if (fd != -1) {
-                string content;
-                if (android::base::ReadFdToString(fd, &content)) {
-                    proto->write(FIELD_TYPE_MESSAGE | FIELD_COUNT_REPEATED | FIELD_ID_REPORTS,
-                                content.c_str(), content.size());
-                }
-                close(fd);
-            }
+    getReportLogStore().takeReports(key, proto);
+}
 
-            // Remove file from disk after reading.
-            remove(file_name.c_str());
-        }
-    }
+ssize_t StorageManager::appendConfigMetricsReport(const ConfigKey& key, int outFd) {
+    return getReportLogStore().takeReports(key, outFd);
 }
 
 bool StorageManager::readFileToString(const char* file, string* content) {
@@ -394,7 +345,7 @@ void StorageManager::trimToFit(const char* path) {
 
 void StorageManager::printStats(FILE* out) {
     printDirStats(out, STATS_SERVICE_DIR);
-    printDirStats(out, STATS_DATA_DIR);
+    getReportLogStore().printStats(out);
 }
 
 void StorageManager::printDirStats(FILE* out, const char* path) {
@@ -32,7 +32,8 @@ using android::util::ProtoOutputStream;
 class StorageManager : public virtual RefBase {
 public:
     /**
-     * Writes a given byte array as a file to the specified file path.
+     * Writes a given byte array as a file to the specified file path. The file is written under a
+     * temp name and renamed into place, so it never shows up partially written.
      */
     static void writeFile(const char* file, const void* buffer, int numBytes);
 
@@ -59,8 +60,22 @@ public:
     /**
      * Send broadcasts to relevant receiver for each data stored on disk.
      */
-    static void sendBroadcast(const char* path,
-                              const std::function<void(const ConfigKey&)>& sendBroadcast);
+    static void sendBroadcast(const std::function<void(const ConfigKey&)>& sendBroadcast);
+
+    /**
+     * Writes a ConfigMetricsReport to disk, to be collected later. Drops the oldest reports if
+     * the reports on disk are over the limits. The report is only guaranteed to be on disk after
+     * syncConfigMetricsReports().
+     */
+    static bool writeConfigMetricsReport(const ConfigKey& key, int64_t wallClockSec,
+                                         ProtoOutputStream* report);
+
+    /**
+     * Syncs to disk the ConfigMetricsReports written since the last call, and reclaims the space
+     * of the ones dropped. Does disk I/O, so it shouldn't be called while holding a lock that
+     * event processing needs.
+     */
+    static void syncConfigMetricsReports();
 
     /**
      * Returns true if there's at least one report on disk.
@@ -73,6 +88,14 @@ public:
      */
     static void appendConfigMetricsReport(const ConfigKey& key, ProtoOutputStream* proto);
 
+    /**
+     * Writes ConfigMetricsReport found on disk to the file descriptor, as reports of a
+     * ConfigMetricsReportList, and delete it. The files are copied a fixed size chunk at a time
+     * instead of being read into memory. Returns the number of bytes written, or -1 if writing to
+     * the file descriptor failed, in which case the reports that were not fully written are kept.
+     */
+    static ssize_t appendConfigMetricsReport(const ConfigKey& key, int outFd);
+
     /**
      * Call to load the saved configs from disk.
      */
@@ -171,6 +171,40 @@ TEST(AtomMatcherTest, TestSubDimension) {
     EXPECT_TRUE(dim.contains(subDim4));
 }
 
+TEST(AtomMatcherTest, TestCachedDimensionHash) {
+    int pos1[] = {1, 0, 0};
+    int pos2[] = {2, 0, 0};
+    Field field1(10, pos1, 0);
+    Field field2(10, pos2, 0);
+
+    HashableDimensionKey empty;
+    EXPECT_EQ(hashDimension(empty), empty.getHash());
+
+    HashableDimensionKey dim1;
+    dim1.addValue(FieldValue(field1, Value((int32_t)10025)));
+    dim1.addValue(FieldValue(field2, Value("tag")));
+    EXPECT_EQ(hashDimension(dim1), dim1.getHash());
+
+    HashableDimensionKey dim2(dim1);
+    EXPECT_EQ(dim1.getHash(), dim2.getHash());
+    EXPECT_TRUE(dim1 == dim2);
+
+    // Modifying the values must not leave a stale hash behind.
+    dim2.mutableValue(0)->mValue.setInt(10026);
+    EXPECT_EQ(hashDimension(dim2), dim2.getHash());
+    EXPECT_FALSE(dim1 == dim2);
+
+    HashableDimensionKey moved(std::move(dim2));
+    EXPECT_EQ(hashDimension(moved), moved.getHash());
+    EXPECT_TRUE(dim2 == empty);
+    EXPECT_EQ(empty.getHash(), dim2.getHash());
+
+    MetricDimensionKey key1(dim1, empty);
+    MetricDimensionKey key2(HashableDimensionKey(dim1), empty);
+    EXPECT_EQ(std::hash<MetricDimensionKey>()(key1), std::hash<MetricDimensionKey>()(key2));
+    EXPECT_TRUE(key1 == key2);
+}
+
 TEST(AtomMatcherTest, TestMetric2ConditionLink) {
     AttributionNodeInternal attribution_node1;
     attribution_node1.set_uid(1111);
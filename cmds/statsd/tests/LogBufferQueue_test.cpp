@@ -0,0 +1,158 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/socket/LogBufferQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(LogBufferQueueTest, TestWrapAround) {
+    LogBufferQueue queue(4);
+    LogBuffer* written[4];
+    LogBuffer* read[4];
+
+    EXPECT_EQ(3u, queue.acquireFree(written, 3));
+    for (size_t i = 0; i < 3; i++) {
+        written[i]->size = i;
+    }
+    queue.publish(3);
+    EXPECT_EQ(3u, queue.size());
+
+    // Only one buffer is left.
+    EXPECT_EQ(1u, queue.acquireFree(written, 4));
+
+    EXPECT_EQ(2u, queue.waitForPublished(read, 2));
+    EXPECT_EQ(0u, read[0]->size);
+    EXPECT_EQ(1u, read[1]->size);
+    queue.release(2);
+    EXPECT_EQ(1u, queue.size());
+
+    // The free buffers now wrap around the end of the ring.
+    EXPECT_EQ(3u, queue.acquireFree(written, 4));
+    for (size_t i = 0; i < 3; i++) {
+        written[i]->size = 3 + i;
+    }
+    queue.publish(3);
+    EXPECT_EQ(0u, queue.acquireFree(written, 4));
+
+    EXPECT_EQ(4u, queue.waitForPublished(read, 4));
+    for (size_t i = 0; i < 4; i++) {
+        EXPECT_EQ(2 + i, read[i]->size);
+    }
+    queue.release(4);
+    EXPECT_EQ(0u, queue.size());
+}
+
+TEST(LogBufferQueueTest, TestHandOverBetweenThreads) {
+    const size_t kBufferCount = 10000;
+    LogBufferQueue queue(8);
+
+    // Set if the reader gives up, so that the writer doesn't spin on a full queue forever.
+    std::atomic<bool> stopped(false);
+    std::thread writer([&queue, &stopped] {
+        size_t next = 0;
+        LogBuffer* buffers[3];
+        while (next < kBufferCount && !stopped) {
+            size_t count = queue.acquireFree(buffers, 3);
+            for (size_t i = 0; i < count && next < kBufferCount; i++) {
+                buffers[i]->size = next++;
+                queue.publish(1);
+            }
+        }
+    });
+
+    size_t expected = 0;
+    LogBuffer* buffers[5];
+    while (expected < kBufferCount) {
+        size_t count = queue.waitForPublished(buffers, 5);
+        // No ASSERT until the writer is joined, since returning would destroy a joinable thread.
+        EXPECT_GT(count, 0u);
+        if (count == 0) {
+            stopped = true;
+            break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(expected++, buffers[i]->size);
+        }
+        queue.release(count);
+    }
+    writer.join();
+}
+
+TEST(LogBufferQueueTest, TestWaitForFree) {
+    LogBufferQueue queue(2);
+    LogBuffer* written[2];
+    ASSERT_EQ(2u, queue.acquireFree(written, 2));
+    written[0]->size = 0;
+    written[1]->size = 1;
+    queue.publish(2);
+
+    // The writer waits for the reader instead of overwriting the buffers it hasn't read.
+    std::thread writer([&queue] {
+        LogBuffer* buffers[2];
+        EXPECT_EQ(1u, queue.waitForFree(buffers, 2));
+        buffers[0]->size = 2;
+        queue.publish(1);
+    });
+
+    LogBuffer* read[2];
+    ASSERT_EQ(2u, queue.waitForPublished(read, 2));
+    EXPECT_EQ(0u, read[0]->size);
+    EXPECT_EQ(1u, read[1]->size);
+    queue.release(1);
+
+    writer.join();
+    EXPECT_EQ(2u, queue.size());
+    queue.release(1);
+    ASSERT_EQ(1u, queue.waitForPublished(read, 2));
+    EXPECT_EQ(2u, read[0]->size);
+    queue.release(1);
+}
+
+TEST(LogBufferQueueTest, TestCloseWakesWriter) {
+    LogBufferQueue queue(1);
+    LogBuffer* buffers[1];
+    ASSERT_EQ(1u, queue.acquireFree(buffers, 1));
+    queue.publish(1);
+
+    std::thread closer([&queue] { queue.close(); });
+
+    EXPECT_EQ(0u, queue.waitForFree(buffers, 1));
+    closer.join();
+}
+
+TEST(LogBufferQueueTest, TestCloseWakesReader) {
+    LogBufferQueue queue(4);
+
+    std::thread closer([&queue] { queue.close(); });
+
+    LogBuffer* buffers[4];
+    EXPECT_EQ(0u, queue.waitForPublished(buffers, 4));
+    closer.join();
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "frameworks/base/cmds/statsd/src/statsd_config.pb.h"
+#include "matchers/CompiledSimpleAtomMatcher.h"
 #include "matchers/matcher_util.h"
 #include "stats_log_util.h"
 #include "stats_util.h"
@@ -626,6 +627,131 @@ TEST(AtomMatcherTest, TestFloatComparisonMatcher) {
     EXPECT_FALSE(matchesSimple(uidMap, *simpleMatcher, event4));
 }
 
+TEST(AtomMatcherTest, TestCompiledMatcherAgreesWithMatchesSimple) {
+    UidMap uidMap;
+    uidMap.updateMap(
+            1, {1111, 1111, 2222, 3333, 3333} /* uid list */, {1, 1, 2, 1, 2} /* version list */,
+            {android::String16("pkg0"), android::String16("pkg1"), android::String16("pkg1"),
+             android::String16("Pkg2"), android::String16("PkG3")} /* package name list */);
+
+    AttributionNodeInternal attribution_node1;
+    attribution_node1.set_uid(1111);
+    attribution_node1.set_tag("location1");
+
+    AttributionNodeInternal attribution_node2;
+    attribution_node2.set_uid(2222);
+    attribution_node2.set_tag("location2");
+
+    AttributionNodeInternal attribution_node3;
+    attribution_node3.set_uid(0);
+    attribution_node3.set_tag("location3");
+    std::vector<AttributionNodeInternal> attribution_nodes = {attribution_node1, attribution_node2,
+                                                              attribution_node3};
+
+    LogEvent event(TAG_ID, 0);
+    event.write(attribution_nodes);
+    event.write("some value");
+    event.write(11);
+    event.write(10.5f);
+    event.init();
+
+    vector<SimpleAtomMatcher> matchers;
+    const std::string packages[] = {"pkg0", "pkg1", "pkg2", "pkg3", "pkg4", "AID_ROOT", "AID_SYSTEM"};
+    const Position positions[] = {Position::FIRST, Position::LAST, Position::ANY, Position::ALL};
+    for (const Position position : positions) {
+        for (const std::string& package : packages) {
+            for (const char* tag : {"location1", "location3"}) {
+                SimpleAtomMatcher matcher;
+                matcher.set_atom_id(TAG_ID);
+                auto attributionMatcher = matcher.add_field_value_matcher();
+                attributionMatcher->set_field(FIELD_ID_1);
+                attributionMatcher->set_position(position);
+                auto tuple = attributionMatcher->mutable_matches_tuple();
+                auto uidMatcher = tuple->add_field_value_matcher();
+                uidMatcher->set_field(ATTRIBUTION_UID_FIELD_ID);
+                uidMatcher->set_eq_string(package);
+                auto tagMatcher = tuple->add_field_value_matcher();
+                tagMatcher->set_field(ATTRIBUTION_TAG_FIELD_ID);
+                tagMatcher->set_eq_string(tag);
+                matchers.push_back(matcher);
+
+                uidMatcher->mutable_neq_any_string()->add_str_value(package);
+                uidMatcher->mutable_neq_any_string()->add_str_value("pkg1");
+                matchers.push_back(matcher);
+            }
+        }
+    }
+    for (int i = 9; i <= 13; i++) {
+        SimpleAtomMatcher matcher;
+        matcher.set_atom_id(TAG_ID);
+        auto stringMatcher = matcher.add_field_value_matcher();
+        stringMatcher->set_field(2);
+        stringMatcher->mutable_eq_any_string()->add_str_value("other value");
+        stringMatcher->mutable_eq_any_string()->add_str_value("some value");
+        auto intMatcher = matcher.add_field_value_matcher();
+        intMatcher->set_field(3);
+        intMatcher->set_gte_int(i);
+        matchers.push_back(matcher);
+        intMatcher->set_lt_int(i);
+        matchers.push_back(matcher);
+        intMatcher->set_eq_bool(i % 2 == 0);
+        matchers.push_back(matcher);
+        auto floatMatcher = matcher.add_field_value_matcher();
+        floatMatcher->set_field(4);
+        floatMatcher->set_gt_float(i);
+        matchers.push_back(matcher);
+    }
+    // No field matchers, and a field that doesn't exist.
+    SimpleAtomMatcher matcher;
+    matcher.set_atom_id(TAG_ID);
+    matchers.push_back(matcher);
+    matcher.add_field_value_matcher()->set_field(5);
+    matchers.push_back(matcher);
+
+    for (const auto& simpleMatcher : matchers) {
+        CompiledSimpleAtomMatcher compiled(simpleMatcher);
+        EXPECT_EQ(matchesSimple(uidMap, simpleMatcher, event), compiled.matches(uidMap, event))
+                << simpleMatcher.DebugString();
+    }
+}
+
+TEST(AtomMatcherTest, TestCompiledMatcherFollowsUidMapUpdates) {
+    UidMap uidMap;
+    AttributionNodeInternal attribution_node;
+    attribution_node.set_uid(1111);
+    attribution_node.set_tag("location1");
+    std::vector<AttributionNodeInternal> attribution_nodes = {attribution_node};
+
+    LogEvent event(TAG_ID, 0);
+    event.write(attribution_nodes);
+    event.init();
+
+    SimpleAtomMatcher matcher;
+    matcher.set_atom_id(TAG_ID);
+    auto attributionMatcher = matcher.add_field_value_matcher();
+    attributionMatcher->set_field(FIELD_ID_1);
+    attributionMatcher->set_position(Position::FIRST);
+    auto uidMatcher = attributionMatcher->mutable_matches_tuple()->add_field_value_matcher();
+    uidMatcher->set_field(ATTRIBUTION_UID_FIELD_ID);
+    uidMatcher->set_eq_string("pkg0");
+    CompiledSimpleAtomMatcher compiled(matcher);
+
+    EXPECT_FALSE(compiled.matches(uidMap, event));
+
+    uidMap.updateMap(1, {1111} /* uid list */, {1} /* version list */,
+                     {android::String16("Pkg0")} /* package name list */);
+    EXPECT_TRUE(compiled.matches(uidMap, event));
+
+    uidMap.updateApp(2, android::String16("pkg1"), 1111, 1);
+    EXPECT_TRUE(compiled.matches(uidMap, event));
+
+    uidMap.removeApp(3, android::String16("Pkg0"), 1111);
+    EXPECT_FALSE(compiled.matches(uidMap, event));
+
+    uidMap.updateApp(4, android::String16("pkg0"), 1111, 2);
+    EXPECT_TRUE(compiled.matches(uidMap, event));
+}
+
 // Helper for the composite matchers.
 void addSimpleMatcher(SimpleAtomMatcher* simpleMatcher, int tag, int key, int val) {
     simpleMatcher->set_atom_id(tag);
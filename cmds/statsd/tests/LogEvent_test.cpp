@@ -89,6 +89,40 @@ TEST(LogEventTest, TestLogParsing) {
     EXPECT_EQ((float)1.1, item7.mValue.float_value);
 }
 
+static void writeSimpleLogMsg(int32_t atomId, const std::string& value, log_msg* msg) {
+    android_log_event_list list(1937006964);  // the event tag shared by all stats logs
+    list << (int64_t)1000 << atomId << value;
+    std::string payload = list;  // the serialized list, without its event tag.
+
+    const uint32_t tag = 1937006964;
+    const int kLogMsgHeaderSize = 28;
+    memcpy(msg->buf + kLogMsgHeaderSize, &tag, sizeof(tag));
+    memcpy(msg->buf + kLogMsgHeaderSize + sizeof(tag), payload.data(), payload.size());
+    msg->entry.len = sizeof(tag) + payload.size();
+    msg->entry.hdr_size = kLogMsgHeaderSize;
+    msg->entry.sec = 1;
+    msg->entry.uid = 1000;
+}
+
+TEST(LogEventTest, TestReadFromRecyclesEvent) {
+    log_msg msg;
+    writeSimpleLogMsg(10, "a string that is too long for any small string optimization", &msg);
+    LogEvent event(msg);
+    EXPECT_EQ(10, event.GetTagId());
+    EXPECT_EQ(1000, event.GetElapsedTimestampNs());
+    ASSERT_EQ(1, event.size());
+    EXPECT_EQ("a string that is too long for any small string optimization",
+              event.getValues()[0].mValue.str_value);
+
+    writeSimpleLogMsg(20, "short", &msg);
+    event.readFrom(msg);
+    EXPECT_EQ(20, event.GetTagId());
+    EXPECT_EQ(1000u, event.GetUid());
+    ASSERT_EQ(1, event.size());
+    EXPECT_EQ(0x00010000, event.getValues()[0].mField.getField());
+    EXPECT_EQ("short", event.getValues()[0].mValue.str_value);
+}
+
 TEST(LogEventTest, TestLogParsing2) {
     LogEvent event1(1, 2000);
 
@@ -158,6 +192,40 @@ TEST(LogEventTest, TestLogParsing2) {
     EXPECT_EQ((float)1.1, item7.mValue.float_value);
 }
 
+static void writeSimpleLogMsg(int32_t atomId, const std::string& value, log_msg* msg) {
+    android_log_event_list list(1937006964);  // the event tag shared by all stats logs
+    list << (int64_t)1000 << atomId << value;
+    std::string payload = list;  // the serialized list, without its event tag.
+
+    const uint32_t tag = 1937006964;
+    const int kLogMsgHeaderSize = 28;
+    memcpy(msg->buf + kLogMsgHeaderSize, &tag, sizeof(tag));
+    memcpy(msg->buf + kLogMsgHeaderSize + sizeof(tag), payload.data(), payload.size());
+    msg->entry.len = sizeof(tag) + payload.size();
+    msg->entry.hdr_size = kLogMsgHeaderSize;
+    msg->entry.sec = 1;
+    msg->entry.uid = 1000;
+}
+
+TEST(LogEventTest, TestReadFromRecyclesEvent) {
+    log_msg msg;
+    writeSimpleLogMsg(10, "a string that is too long for any small string optimization", &msg);
+    LogEvent event(msg);
+    EXPECT_EQ(10, event.GetTagId());
+    EXPECT_EQ(1000, event.GetElapsedTimestampNs());
+    ASSERT_EQ(1, event.size());
+    EXPECT_EQ("a string that is too long for any small string optimization",
+              event.getValues()[0].mValue.str_value);
+
+    writeSimpleLogMsg(20, "short", &msg);
+    event.readFrom(msg);
+    EXPECT_EQ(20, event.GetTagId());
+    EXPECT_EQ(1000u, event.GetUid());
+    ASSERT_EQ(1, event.size());
+    EXPECT_EQ(0x00010000, event.getValues()[0].mField.getField());
+    EXPECT_EQ("short", event.getValues()[0].mValue.str_value);
+}
+
 
 }  // namespace statsd
 }  // namespace os
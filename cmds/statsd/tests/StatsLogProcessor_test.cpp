@@ -19,17 +19,29 @@
 #include "guardrail/StatsdStats.h"
 #include "logd/LogEvent.h"
 #include "packages/UidMap.h"
+#include "stats_log_util.h"
 #include "statslog.h"
+#include "storage/StorageManager.h"
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "tests/statsd_test_util.h"
 
+#include <android-base/file.h>
+#include <malloc.h>
 #include <stdio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 using namespace android;
 using namespace testing;
+using android::util::FIELD_COUNT_REPEATED;
+using android::util::FIELD_TYPE_STRING;
+using android::util::ProtoOutputStream;
 
 namespace android {
 namespace os {
@@ -39,6 +51,9 @@ using android::util::ProtoOutputStream;
 
 #ifdef __ANDROID__
 
+// for ConfigMetricsReport
+const int FIELD_ID_STRINGS = 9;
+
 /**
  * Mock MetricsManager (ByteSize() is called).
  */
@@ -217,6 +232,240 @@ TEST(StatsLogProcessorTest, TestReportIncludesSubConfig) {
     EXPECT_EQ(2, report.annotation(0).field_int32());
 }
 
+// Writes [count] reports of [stringBytes] strings each to disk, as if they were written before a
+// shutdown.
+static void writeReportsToDisk(const ConfigKey& key, int count, size_t stringBytes) {
+    const string content(stringBytes, 'x');
+    for (int i = 0; i < count; i++) {
+        ProtoOutputStream report;
+        report.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS, content);
+        StorageManager::writeConfigMetricsReport(key, getWallClockSec(), &report);
+    }
+    StorageManager::syncConfigMetricsReports();
+}
+
+TEST(StatsLogProcessorTest, TestStreamedDumpReportIncludesReportsOnDisk) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    ConfigKey key(3, 101);
+    p.OnConfigUpdated(0, key, MakeConfig(true));
+    writeReportsToDisk(key, 2, 10);
+
+    FILE* file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    p.onDumpReport(key, 1, false, ADB_DUMP, fileno(file));
+
+    string bytes;
+    ASSERT_EQ(0, lseek(fileno(file), 0, SEEK_SET));
+    ASSERT_TRUE(android::base::ReadFdToString(fileno(file), &bytes));
+    fclose(file);
+
+    ConfigMetricsReportList output;
+    ASSERT_TRUE(output.ParseFromString(bytes));
+    EXPECT_EQ(3, output.config_key().uid());
+    EXPECT_EQ(101, output.config_key().id());
+    ASSERT_EQ(3, output.reports_size());
+    EXPECT_EQ(string(10, 'x'), output.reports(0).strings(0));
+    EXPECT_EQ(string(10, 'x'), output.reports(1).strings(0));
+    // The data in memory comes last.
+    EXPECT_EQ(1, output.reports(2).metrics_size());
+
+    // The reports on disk are only sent once.
+    vector<uint8_t> dumpAgain;
+    p.onDumpReport(key, 2, false, ADB_DUMP, &dumpAgain);
+    output.ParseFromArray(dumpAgain.data(), dumpAgain.size());
+    EXPECT_EQ(1, output.reports_size());
+}
+
+TEST(StatsLogProcessorTest, TestStreamedDumpReportHasBoundedMemory) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    ConfigKey key(3, 102);
+    p.OnConfigUpdated(0, key, MakeConfig(true));
+    // 32 MB of reports on disk, which used to be all read into memory, and then copied.
+    const int reportCount = 8;
+    const size_t reportBytes = 4 * 1024 * 1024;
+    writeReportsToDisk(key, reportCount, reportBytes);
+
+    int fds[2];
+    ASSERT_EQ(0, pipe(fds));
+    const size_t baseline = mallinfo().uordblks;
+    std::atomic<size_t> peak(baseline);
+    size_t bytesRead = 0;
+    std::thread reader([&] {
+        char buffer[64 * 1024];
+        ssize_t count;
+        while ((count = read(fds[0], buffer, sizeof(buffer))) > 0) {
+            bytesRead += count;
+            peak = std::max<size_t>(peak, mallinfo().uordblks);
+        }
+    });
+    p.onDumpReport(key, 1, false, ADB_DUMP, fds[1]);
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+
+    EXPECT_GT(bytesRead, reportCount * reportBytes);
+    EXPECT_LT(peak - baseline, 2u * 1024 * 1024);
+}
+
+TEST(StatsLogProcessorTest, TestStreamedDumpReportWhileWritingToDisk) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    ConfigKey key(3, 103);
+    p.OnConfigUpdated(0, key, MakeConfig(true));
+
+    const int reportCount = 200;
+    std::atomic<bool> done(false);
+    std::thread writer([&] {
+        for (int i = 0; i < reportCount; i++) {
+            ProtoOutputStream report;
+            report.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS,
+                         std::to_string(i));
+            StorageManager::writeConfigMetricsReport(key, getWallClockSec(), &report);
+        }
+        done = true;
+    });
+
+    // Every report written to disk is sent by exactly one dump, in the order it was written.
+    vector<int> dumped;
+    auto dump = [&](int64_t dumpTimeNs) {
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        p.onDumpReport(key, dumpTimeNs, false, ADB_DUMP, fileno(file));
+        string bytes;
+        EXPECT_EQ(0, lseek(fileno(file), 0, SEEK_SET));
+        EXPECT_TRUE(android::base::ReadFdToString(fileno(file), &bytes));
+        fclose(file);
+
+        ConfigMetricsReportList output;
+        EXPECT_TRUE(output.ParseFromString(bytes));
+        for (const auto& report : output.reports()) {
+            if (report.strings_size() > 0) {
+                dumped.push_back(std::stoi(report.strings(0)));
+            }
+        }
+    };
+    int64_t dumpTimeNs = 1;
+    while (!done) {
+        dump(dumpTimeNs++);
+    }
+    writer.join();
+    dump(dumpTimeNs);
+
+    ASSERT_EQ(reportCount, (int)dumped.size());
+    for (int i = 0; i < reportCount; i++) {
+        EXPECT_EQ(i, dumped[i]);
+    }
+}
+
+TEST(StatsLogProcessorTest, TestStreamedDumpReportWhileUpdatingConfig) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    ConfigKey key(3, 104);
+    const StatsdConfig config = MakeConfig(true);
+    p.OnConfigUpdated(0, key, config);
+
+    // Each config update writes the data in memory to disk, between the phases of the dumps.
+    const int updateCount = 200;
+    std::atomic<int64_t> timeNs(1);
+    std::atomic<bool> done(false);
+    std::thread updater([&] {
+        for (int i = 0; i < updateCount; i++) {
+            p.OnConfigUpdated(timeNs++, key, config);
+        }
+        done = true;
+    });
+
+    vector<ConfigMetricsReport> dumped;
+    auto dump = [&] {
+        FILE* file = tmpfile();
+        ASSERT_NE(nullptr, file);
+        p.onDumpReport(key, timeNs++, false, ADB_DUMP, fileno(file));
+        string bytes;
+        EXPECT_EQ(0, lseek(fileno(file), 0, SEEK_SET));
+        EXPECT_TRUE(android::base::ReadFdToString(fileno(file), &bytes));
+        fclose(file);
+
+        ConfigMetricsReportList output;
+        EXPECT_TRUE(output.ParseFromString(bytes));
+        dumped.insert(dumped.end(), output.reports().begin(), output.reports().end());
+    };
+    while (!done) {
+        dump();
+    }
+    updater.join();
+    dump();
+
+    // Each report starts where the one before it ended, so none was sent out of order.
+    ASSERT_LE(updateCount, (int)dumped.size());
+    EXPECT_EQ(0, dumped[0].last_report_elapsed_nanos());
+    for (size_t i = 1; i < dumped.size(); i++) {
+        EXPECT_EQ(dumped[i - 1].current_report_elapsed_nanos(),
+                  dumped[i].last_report_elapsed_nanos());
+    }
+}
+
+TEST(StatsLogProcessorTest, TestWorkerThreadsProcessEveryConfig) {
+    sp<UidMap> m = new UidMap();
+    sp<AlarmMonitor> anomalyAlarmMonitor;
+    sp<AlarmMonitor> subscriberAlarmMonitor;
+    StatsLogProcessor p(m, anomalyAlarmMonitor, subscriberAlarmMonitor, 0,
+                        [](const ConfigKey& key) { return true; });
+    p.setWorkerThreadCount(2);
+
+    // More configs than threads, so that some threads get several configs.
+    const int configCount = 5;
+    StatsdConfig config = MakeConfig(true);
+    for (int i = 0; i < configCount; i++) {
+        p.OnConfigUpdated(0, ConfigKey(5, i), config);
+    }
+
+    const int eventCount = 10;
+    for (int i = 0; i < eventCount; i++) {
+        auto event = CreateAppCrashEvent(100, 100 + i);
+        p.OnLogEvent(event.get());
+    }
+
+    for (int i = 0; i < configCount; i++) {
+        vector<uint8_t> bytes;
+        p.onDumpReport(ConfigKey(5, i), 1000, true, ADB_DUMP, &bytes);
+
+        ConfigMetricsReportList output;
+        output.ParseFromArray(bytes.data(), bytes.size());
+        ASSERT_EQ(1, output.reports_size());
+        ASSERT_EQ(1, output.reports(0).metrics_size());
+        const auto& countMetrics = output.reports(0).metrics(0).count_metrics();
+        ASSERT_EQ(1, countMetrics.data_size());
+        ASSERT_EQ(1, countMetrics.data(0).bucket_info_size());
+        EXPECT_EQ(eventCount, countMetrics.data(0).bucket_info(0).count());
+    }
+
+    // Back to processing every config on the calling thread.
+    p.setWorkerThreadCount(0);
+    auto event = CreateAppCrashEvent(100, 2000);
+    p.OnLogEvent(event.get());
+    vector<uint8_t> bytes;
+    p.onDumpReport(ConfigKey(5, 0), 3000, true, ADB_DUMP, &bytes);
+    ConfigMetricsReportList output;
+    output.ParseFromArray(bytes.data(), bytes.size());
+    ASSERT_EQ(1, output.reports_size());
+    ASSERT_EQ(1, output.reports(0).metrics_size());
+    EXPECT_EQ(1, output.reports(0).metrics(0).count_metrics().data(0).bucket_info(0).count());
+}
+
 TEST(StatsLogProcessorTest, TestOutOfOrderLogs) {
     // Setup simple config key corresponding to empty config.
     sp<UidMap> m = new UidMap();
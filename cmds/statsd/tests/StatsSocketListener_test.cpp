@@ -0,0 +1,144 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/socket/StatsSocketListener.h"
+
+#include <gtest/gtest.h>
+#include <private/android_logger.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+using std::vector;
+
+namespace {
+
+/* Special markers for android_log_list_element type */
+const char EVENT_TYPE_LIST_STOP = '\n'; /* declare end of list  */
+
+const char EVENT_TYPE_INT = 0;
+const char EVENT_TYPE_LONG = 1;
+const char EVENT_TYPE_LIST = 3;
+
+void write4Bytes(int val, vector<char>* buffer) {
+    buffer->push_back(static_cast<char>(val));
+    buffer->push_back(static_cast<char>((val >> 8) & 0xFF));
+    buffer->push_back(static_cast<char>((val >> 16) & 0xFF));
+    buffer->push_back(static_cast<char>((val >> 24) & 0xFF));
+}
+
+void write8Bytes(int64_t val, vector<char>* buffer) {
+    write4Bytes(static_cast<int>(val), buffer);
+    write4Bytes(static_cast<int>(val >> 32), buffer);
+}
+
+// A datagram as written to the statsd socket by a client: a log header followed by the event.
+vector<char> getSocketData(int value) {
+    vector<char> buffer(sizeof(android_log_header_t), 0);
+    buffer[0] = LOG_ID_STATS;
+    // stats_log tag id
+    write4Bytes(1937006964, &buffer);
+    buffer.push_back(EVENT_TYPE_LIST);
+    buffer.push_back(3);  // field counts;
+    buffer.push_back(EVENT_TYPE_LONG);
+    write8Bytes(1000 /* elapsed timestamp */, &buffer);
+    buffer.push_back(EVENT_TYPE_INT);
+    write4Bytes(10 /* atom id */, &buffer);
+    buffer.push_back(EVENT_TYPE_INT);
+    write4Bytes(value, &buffer);
+    buffer.push_back(EVENT_TYPE_LIST_STOP);
+    return buffer;
+}
+
+// Counts the events, and holds up the processing thread until open() is called.
+class GatedLogListener : public LogListener {
+public:
+    void OnLogEvent(LogEvent* /*msg*/, bool /*reconnectionStarts*/) override {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this] { return mOpen; });
+        mCount++;
+        mCondition.notify_all();
+    }
+
+    void open() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mOpen = true;
+        mCondition.notify_all();
+    }
+
+    // Waits until [count] events were processed, or for a few seconds. Returns the number of
+    // events processed.
+    size_t waitForCount(size_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait_for(lock, std::chrono::seconds(10), [this, count] {
+            return mCount >= count;
+        });
+        return mCount;
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mOpen = false;
+    size_t mCount = 0;
+};
+
+}  // namespace
+
+TEST(StatsSocketListenerTest, TestNoEventsLostWhileQueueIsFull) {
+    int sockets[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets));
+
+    sp<GatedLogListener> gate = new GatedLogListener();
+    sp<StatsSocketListener> listener = new StatsSocketListener(gate, sockets[0]);
+    ASSERT_EQ(0, listener->startListener(600));
+
+    // Several times what the queue holds. The writes block once the socket is full, so every
+    // event ends up in the socket or in the queue.
+    const size_t kEventCount = StatsSocketListener::kQueueCapacity * 4;
+    std::thread writer([&sockets, kEventCount] {
+        for (size_t i = 0; i < kEventCount; i++) {
+            const vector<char> data = getSocketData(i);
+            EXPECT_EQ((ssize_t)data.size(), send(sockets[1], data.data(), data.size(), 0));
+        }
+    });
+
+    // The processing thread is held up on the first event until the queue has filled up.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    gate->open();
+    writer.join();
+
+    EXPECT_EQ(kEventCount, gate->waitForCount(kEventCount));
+
+    listener->stopListener();
+    close(sockets[1]);
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
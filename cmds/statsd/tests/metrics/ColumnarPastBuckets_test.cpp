@@ -0,0 +1,107 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/metrics/ColumnarPastBuckets.h"
+#include "metrics_test_helper.h"
+
+#include <gtest/gtest.h>
+#include <limits>
+#include <vector>
+
+using std::vector;
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+TEST(ColumnarPastBucketsTest, TestDimensionsShareBuckets) {
+    const int64_t bucketSizeNs = 60 * NS_PER_SEC;
+    const int64_t bucketStartTimeNs = 10000000000;
+    MetricDimensionKey key1 = getMockedMetricDimensionKey(1, 1, "111");
+    MetricDimensionKey key2 = getMockedMetricDimensionKey(1, 1, "222");
+
+    ColumnarPastBuckets pastBuckets;
+    EXPECT_TRUE(pastBuckets.empty());
+
+    pastBuckets.addBucket(bucketStartTimeNs, bucketStartTimeNs + bucketSizeNs);
+    pastBuckets.addValue(key1, 3);
+    pastBuckets.addValue(key2, 10);
+    // key2 has no value in the second bucket.
+    pastBuckets.addBucket(bucketStartTimeNs + bucketSizeNs, bucketStartTimeNs + 2 * bucketSizeNs);
+    pastBuckets.addValue(key1, 1);
+    // A partial bucket.
+    pastBuckets.addBucket(bucketStartTimeNs + 2 * bucketSizeNs,
+                          bucketStartTimeNs + 2 * bucketSizeNs + 10);
+    pastBuckets.addValue(key1, 5);
+    pastBuckets.addValue(key2, 7);
+
+    EXPECT_EQ(2UL, pastBuckets.size());
+
+    vector<PastBucket> buckets = pastBuckets.getBuckets(key1);
+    ASSERT_EQ(3UL, buckets.size());
+    EXPECT_EQ(bucketStartTimeNs, buckets[0].mBucketStartNs);
+    EXPECT_EQ(bucketStartTimeNs + bucketSizeNs, buckets[0].mBucketEndNs);
+    EXPECT_EQ(3, buckets[0].mValue);
+    EXPECT_EQ(bucketStartTimeNs + bucketSizeNs, buckets[1].mBucketStartNs);
+    EXPECT_EQ(1, buckets[1].mValue);
+    EXPECT_EQ(bucketStartTimeNs + 2 * bucketSizeNs + 10, buckets[2].mBucketEndNs);
+    EXPECT_EQ(5, buckets[2].mValue);
+
+    buckets = pastBuckets.getBuckets(key2);
+    ASSERT_EQ(2UL, buckets.size());
+    EXPECT_EQ(bucketStartTimeNs, buckets[0].mBucketStartNs);
+    EXPECT_EQ(10, buckets[0].mValue);
+    EXPECT_EQ(bucketStartTimeNs + 2 * bucketSizeNs, buckets[1].mBucketStartNs);
+    EXPECT_EQ(7, buckets[1].mValue);
+
+    // 3 shared boundaries, plus 2 bytes per small value.
+    EXPECT_EQ(3 * 2 * sizeof(int64_t) + 5 * 2, pastBuckets.byteSize());
+
+    pastBuckets.clear();
+    EXPECT_TRUE(pastBuckets.empty());
+    EXPECT_EQ(0UL, pastBuckets.byteSize());
+    EXPECT_TRUE(pastBuckets.getBuckets(key1).empty());
+}
+
+TEST(ColumnarPastBucketsTest, TestExtremeValues) {
+    const vector<int64_t> values = {0,
+                                    -1,
+                                    std::numeric_limits<int64_t>::max(),
+                                    std::numeric_limits<int64_t>::min(),
+                                    std::numeric_limits<int64_t>::max(),
+                                    42};
+    ColumnarPastBuckets pastBuckets;
+    for (size_t i = 0; i < values.size(); i++) {
+        pastBuckets.addBucket(i * 10, (i + 1) * 10);
+        pastBuckets.addValue(DEFAULT_METRIC_DIMENSION_KEY, values[i]);
+    }
+
+    ColumnarPastBuckets::Reader reader =
+            pastBuckets.read(pastBuckets.find(DEFAULT_METRIC_DIMENSION_KEY)->second);
+    for (size_t i = 0; i < values.size(); i++) {
+        ASSERT_TRUE(reader.next());
+        EXPECT_EQ((int64_t)i * 10, reader.getBucketStartNs());
+        EXPECT_EQ(values[i], reader.getValue());
+    }
+    EXPECT_FALSE(reader.next());
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
@@ -72,11 +72,11 @@ TEST(CountMetricProducerTest, TestNonDimensionalEvents) {
     EXPECT_EQ(1UL, countProducer.mPastBuckets.size());
     EXPECT_TRUE(countProducer.mPastBuckets.find(DEFAULT_METRIC_DIMENSION_KEY) !=
                 countProducer.mPastBuckets.end());
-    const auto& buckets = countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY];
+    const auto buckets = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
     EXPECT_EQ(1UL, buckets.size());
     EXPECT_EQ(bucketStartTimeNs, buckets[0].mBucketStartNs);
     EXPECT_EQ(bucketStartTimeNs + bucketSizeNs, buckets[0].mBucketEndNs);
-    EXPECT_EQ(2LL, buckets[0].mCount);
+    EXPECT_EQ(2LL, buckets[0].mValue);
 
     // 1 matched event happens in bucket 2.
     LogEvent event3(tagId, bucketStartTimeNs + bucketSizeNs + 2);
@@ -87,18 +87,19 @@ TEST(CountMetricProducerTest, TestNonDimensionalEvents) {
     EXPECT_EQ(1UL, countProducer.mPastBuckets.size());
     EXPECT_TRUE(countProducer.mPastBuckets.find(DEFAULT_METRIC_DIMENSION_KEY) !=
                 countProducer.mPastBuckets.end());
-    EXPECT_EQ(2UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
-    const auto& bucketInfo2 = countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][1];
+    const auto buckets2 = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
+    EXPECT_EQ(2UL, buckets2.size());
+    const auto& bucketInfo2 = buckets2[1];
     EXPECT_EQ(bucket2StartTimeNs, bucketInfo2.mBucketStartNs);
     EXPECT_EQ(bucket2StartTimeNs + bucketSizeNs, bucketInfo2.mBucketEndNs);
-    EXPECT_EQ(1LL, bucketInfo2.mCount);
+    EXPECT_EQ(1LL, bucketInfo2.mValue);
 
     // nothing happens in bucket 3. we should not record anything for bucket 3.
     countProducer.flushIfNeededLocked(bucketStartTimeNs + 3 * bucketSizeNs + 1);
     EXPECT_EQ(1UL, countProducer.mPastBuckets.size());
     EXPECT_TRUE(countProducer.mPastBuckets.find(DEFAULT_METRIC_DIMENSION_KEY) !=
                 countProducer.mPastBuckets.end());
-    const auto& buckets3 = countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY];
+    const auto buckets3 = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
     EXPECT_EQ(2UL, buckets3.size());
 }
 
@@ -136,12 +137,12 @@ TEST(CountMetricProducerTest, TestEventsWithNonSlicedCondition) {
     EXPECT_TRUE(countProducer.mPastBuckets.find(DEFAULT_METRIC_DIMENSION_KEY) !=
                 countProducer.mPastBuckets.end());
     {
-        const auto& buckets = countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY];
+        const auto buckets = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
         EXPECT_EQ(1UL, buckets.size());
         const auto& bucketInfo = buckets[0];
         EXPECT_EQ(bucketStartTimeNs, bucketInfo.mBucketStartNs);
         EXPECT_EQ(bucketStartTimeNs + bucketSizeNs, bucketInfo.mBucketEndNs);
-        EXPECT_EQ(1LL, bucketInfo.mCount);
+        EXPECT_EQ(1LL, bucketInfo.mValue);
     }
 }
 
@@ -193,12 +194,12 @@ TEST(CountMetricProducerTest, TestEventsWithSlicedCondition) {
     EXPECT_EQ(1UL, countProducer.mPastBuckets.size());
     EXPECT_TRUE(countProducer.mPastBuckets.find(DEFAULT_METRIC_DIMENSION_KEY) !=
                 countProducer.mPastBuckets.end());
-    const auto& buckets = countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY];
+    const auto buckets = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
     EXPECT_EQ(1UL, buckets.size());
     const auto& bucketInfo = buckets[0];
     EXPECT_EQ(bucketStartTimeNs, bucketInfo.mBucketStartNs);
     EXPECT_EQ(bucketStartTimeNs + bucketSizeNs, bucketInfo.mBucketEndNs);
-    EXPECT_EQ(1LL, bucketInfo.mCount);
+    EXPECT_EQ(1LL, bucketInfo.mValue);
 }
 
 TEST(CountMetricProducerTest, TestEventWithAppUpgrade) {
@@ -235,11 +236,10 @@ TEST(CountMetricProducerTest, TestEventWithAppUpgrade) {
     // App upgrade forces bucket flush.
     // Check that there's a past bucket and the bucket end is not adjusted.
     countProducer.notifyAppUpgrade(eventUpgradeTimeNs, "ANY.APP", 1, 1);
-    EXPECT_EQ(1UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
-    EXPECT_EQ((long long)bucketStartTimeNs,
-              countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][0].mBucketStartNs);
-    EXPECT_EQ((long long)eventUpgradeTimeNs,
-              countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][0].mBucketEndNs);
+    const auto buckets = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
+    EXPECT_EQ(1UL, buckets.size());
+    EXPECT_EQ((long long)bucketStartTimeNs, buckets[0].mBucketStartNs);
+    EXPECT_EQ((long long)eventUpgradeTimeNs, buckets[0].mBucketEndNs);
     EXPECT_EQ(eventUpgradeTimeNs, countProducer.mCurrentBucketStartTimeNs);
     // Anomaly tracker only contains full buckets.
     EXPECT_EQ(0, anomalyTracker->getSumOverPastBuckets(DEFAULT_METRIC_DIMENSION_KEY));
@@ -250,7 +250,7 @@ TEST(CountMetricProducerTest, TestEventWithAppUpgrade) {
     event2.write("222");  // uid
     event2.init();
     countProducer.onMatchedLogEvent(1 /*log matcher index*/, event2);
-    EXPECT_EQ(1UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
+    EXPECT_EQ(1UL, countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY).size());
     EXPECT_EQ(eventUpgradeTimeNs, countProducer.mCurrentBucketStartTimeNs);
     EXPECT_EQ(0, anomalyTracker->getSumOverPastBuckets(DEFAULT_METRIC_DIMENSION_KEY));
 
@@ -259,7 +259,7 @@ TEST(CountMetricProducerTest, TestEventWithAppUpgrade) {
     event3.write("333");  // uid
     event3.init();
     countProducer.onMatchedLogEvent(1 /*log matcher index*/, event3);
-    EXPECT_EQ(2UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
+    EXPECT_EQ(2UL, countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY).size());
     EXPECT_EQ(lastEndTimeNs, countProducer.mCurrentBucketStartTimeNs);
     EXPECT_EQ(2, anomalyTracker->getSumOverPastBuckets(DEFAULT_METRIC_DIMENSION_KEY));
 }
@@ -290,11 +290,10 @@ TEST(CountMetricProducerTest, TestEventWithAppUpgradeInNextBucket) {
     // App upgrade forces bucket flush.
     // Check that there's a past bucket and the bucket end is not adjusted.
     countProducer.notifyAppUpgrade(eventUpgradeTimeNs, "ANY.APP", 1, 1);
-    EXPECT_EQ(1UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
-    EXPECT_EQ((int64_t)bucketStartTimeNs,
-              countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][0].mBucketStartNs);
-    EXPECT_EQ(bucketStartTimeNs + bucketSizeNs,
-              countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][0].mBucketEndNs);
+    const auto buckets = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
+    EXPECT_EQ(1UL, buckets.size());
+    EXPECT_EQ((int64_t)bucketStartTimeNs, buckets[0].mBucketStartNs);
+    EXPECT_EQ(bucketStartTimeNs + bucketSizeNs, buckets[0].mBucketEndNs);
     EXPECT_EQ(eventUpgradeTimeNs, countProducer.mCurrentBucketStartTimeNs);
 
     // Next event occurs in same bucket as partial bucket created.
@@ -302,18 +301,17 @@ TEST(CountMetricProducerTest, TestEventWithAppUpgradeInNextBucket) {
     event2.write("222");  // uid
     event2.init();
     countProducer.onMatchedLogEvent(1 /*log matcher index*/, event2);
-    EXPECT_EQ(1UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
+    EXPECT_EQ(1UL, countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY).size());
 
     // Third event in following bucket.
     LogEvent event3(tagId, bucketStartTimeNs + 121 * NS_PER_SEC + 10);
     event3.write("333");  // uid
     event3.init();
     countProducer.onMatchedLogEvent(1 /*log matcher index*/, event3);
-    EXPECT_EQ(2UL, countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY].size());
-    EXPECT_EQ((int64_t)eventUpgradeTimeNs,
-              countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][1].mBucketStartNs);
-    EXPECT_EQ(bucketStartTimeNs + 2 * bucketSizeNs,
-              countProducer.mPastBuckets[DEFAULT_METRIC_DIMENSION_KEY][1].mBucketEndNs);
+    const auto buckets3 = countProducer.mPastBuckets.getBuckets(DEFAULT_METRIC_DIMENSION_KEY);
+    EXPECT_EQ(2UL, buckets3.size());
+    EXPECT_EQ((int64_t)eventUpgradeTimeNs, buckets3[1].mBucketStartNs);
+    EXPECT_EQ(bucketStartTimeNs + 2 * bucketSizeNs, buckets3[1].mBucketEndNs);
 }
 
 TEST(CountMetricProducerTest, TestAnomalyDetectionUnSliced) {
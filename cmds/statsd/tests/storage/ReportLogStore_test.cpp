@@ -0,0 +1,370 @@
+// Copyright (C) 2018 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/storage/ReportLogStore.h"
+#include "frameworks/base/cmds/statsd/src/stats_log.pb.h"
+#include "guardrail/StatsdStats.h"
+#include "stats_log_util.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/test_utils.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using android::base::StringPrintf;
+using android::util::FIELD_COUNT_REPEATED;
+using android::util::FIELD_TYPE_STRING;
+using android::util::ProtoOutputStream;
+using std::string;
+using std::vector;
+
+#ifdef __ANDROID__
+
+namespace android {
+namespace os {
+namespace statsd {
+
+// for ConfigMetricsReport
+const int FIELD_ID_STRINGS = 9;
+
+const ConfigKey kConfigKey(3, 101);
+
+// Appends a report holding the single string [content].
+static bool appendReport(ReportLogStore* store, const ConfigKey& key, int64_t wallClockSec,
+                         const string& content) {
+    ProtoOutputStream report;
+    report.write(FIELD_TYPE_STRING | FIELD_COUNT_REPEATED | FIELD_ID_STRINGS, content);
+    return store->append(key, wallClockSec, &report);
+}
+
+static ConfigMetricsReportList takeReports(ReportLogStore* store, const ConfigKey& key) {
+    ProtoOutputStream proto;
+    store->takeReports(key, &proto);
+    vector<uint8_t> bytes;
+    bytes.resize(proto.size());
+    size_t pos = 0;
+    auto iter = proto.data();
+    while (iter.readBuffer() != NULL) {
+        size_t toRead = iter.currentToRead();
+        std::memcpy(&((bytes)[pos]), iter.readBuffer(), toRead);
+        pos += toRead;
+        iter.rp()->move(toRead);
+    }
+    ConfigMetricsReportList reports;
+    EXPECT_TRUE(reports.ParseFromArray(bytes.data(), bytes.size()));
+    return reports;
+}
+
+static vector<string> listDir(const string& path) {
+    vector<string> names;
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
+    dirent* de;
+    while ((de = readdir(dir.get()))) {
+        if (de->d_name[0] != '.') {
+            names.push_back(de->d_name);
+        }
+    }
+    return names;
+}
+
+static string logPath(const TemporaryDir& dir, const ConfigKey& key) {
+    return StringPrintf("%s/%d_%lld.log", dir.path, key.GetUid(), (long long)key.GetId());
+}
+
+TEST(ReportLogStoreTest, TestTakeReportsOldestFirst) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const int64_t now = getWallClockSec();
+    const ConfigKey otherKey(3, 102);
+
+    EXPECT_FALSE(store.hasReports(kConfigKey));
+    EXPECT_TRUE(appendReport(&store, kConfigKey, now, "a"));
+    EXPECT_TRUE(appendReport(&store, otherKey, now, "other"));
+    EXPECT_TRUE(appendReport(&store, kConfigKey, now + 1, "b"));
+    EXPECT_TRUE(appendReport(&store, kConfigKey, now + 2, "c"));
+    EXPECT_TRUE(store.hasReports(kConfigKey));
+
+    vector<ConfigKey> keys;
+    store.forEachConfigWithReports([&keys](const ConfigKey& key) { keys.push_back(key); });
+    EXPECT_EQ(2UL, keys.size());
+
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(3, reports.reports_size());
+    EXPECT_EQ("a", reports.reports(0).strings(0));
+    EXPECT_EQ("b", reports.reports(1).strings(0));
+    EXPECT_EQ("c", reports.reports(2).strings(0));
+
+    // Taken reports are removed, and the other config keeps its reports.
+    EXPECT_FALSE(store.hasReports(kConfigKey));
+    EXPECT_EQ(0, takeReports(&store, kConfigKey).reports_size());
+    EXPECT_TRUE(store.hasReports(otherKey));
+
+    // The log is reused after it was emptied.
+    EXPECT_TRUE(appendReport(&store, kConfigKey, now + 3, "d"));
+    reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(1, reports.reports_size());
+    EXPECT_EQ("d", reports.reports(0).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestReportsAreReloaded) {
+    TemporaryDir dir;
+    const int64_t now = getWallClockSec();
+    {
+        ReportLogStore store(dir.path);
+        appendReport(&store, kConfigKey, now, "a");
+        appendReport(&store, kConfigKey, now, "b");
+        appendReport(&store, kConfigKey, now, "c");
+        // Drops "a".
+        ProtoOutputStream proto;
+        store.takeReports(kConfigKey, &proto);
+        appendReport(&store, kConfigKey, now, "d");
+        appendReport(&store, kConfigKey, now, "e");
+        store.sync();
+    }
+
+    ReportLogStore store(dir.path);
+    EXPECT_TRUE(store.hasReports(kConfigKey));
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(2, reports.reports_size());
+    EXPECT_EQ("d", reports.reports(0).strings(0));
+    EXPECT_EQ("e", reports.reports(1).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestDropsPartiallyWrittenReport) {
+    TemporaryDir dir;
+    const int64_t now = getWallClockSec();
+    {
+        ReportLogStore store(dir.path);
+        appendReport(&store, kConfigKey, now, "a");
+        appendReport(&store, kConfigKey, now, "b");
+        store.sync();
+    }
+    // A record cut short by a crash.
+    struct stat fileStat;
+    ASSERT_EQ(0, stat(logPath(dir, kConfigKey).c_str(), &fileStat));
+    {
+        ReportLogStore store(dir.path);
+        appendReport(&store, kConfigKey, now, string(100, 'c'));
+    }
+    ASSERT_EQ(0, truncate(logPath(dir, kConfigKey).c_str(), fileStat.st_size + 50));
+
+    ReportLogStore store(dir.path);
+    EXPECT_TRUE(appendReport(&store, kConfigKey, now, "d"));
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(3, reports.reports_size());
+    EXPECT_EQ("a", reports.reports(0).strings(0));
+    EXPECT_EQ("b", reports.reports(1).strings(0));
+    EXPECT_EQ("d", reports.reports(2).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestDropsReportWithBadChecksum) {
+    TemporaryDir dir;
+    const int64_t now = getWallClockSec();
+    {
+        ReportLogStore store(dir.path);
+        appendReport(&store, kConfigKey, now, "a");
+        appendReport(&store, kConfigKey, now, string(100, 'b'));
+        store.sync();
+    }
+    // The size of the file was updated, but the end of the last report never made it to disk.
+    struct stat fileStat;
+    ASSERT_EQ(0, stat(logPath(dir, kConfigKey).c_str(), &fileStat));
+    int fd = open(logPath(dir, kConfigKey).c_str(), O_WRONLY | O_CLOEXEC);
+    ASSERT_NE(-1, fd);
+    const string zeros(50, '\0');
+    ASSERT_EQ((ssize_t)zeros.size(),
+              pwrite(fd, zeros.data(), zeros.size(), fileStat.st_size - zeros.size()));
+    close(fd);
+
+    ReportLogStore store(dir.path);
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(1, reports.reports_size());
+    EXPECT_EQ("a", reports.reports(0).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestTrimsToReportCountLimit) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const int64_t now = getWallClockSec();
+    const int extraReports = 5;
+    for (int i = 0; i < StatsdStats::kMaxFileNumber + extraReports; i++) {
+        // Spread over two configs, to check that the oldest reports overall are dropped.
+        appendReport(&store, ConfigKey(3, i % 2), now + i, std::to_string(i));
+    }
+
+    ConfigMetricsReportList reports0 = takeReports(&store, ConfigKey(3, 0));
+    ConfigMetricsReportList reports1 = takeReports(&store, ConfigKey(3, 1));
+    EXPECT_EQ((int)StatsdStats::kMaxFileNumber, reports0.reports_size() + reports1.reports_size());
+    EXPECT_EQ(std::to_string(extraReports + 1), reports0.reports(0).strings(0));
+    EXPECT_EQ(std::to_string(extraReports), reports1.reports(0).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestDropsOldReportsAndCompacts) {
+    TemporaryDir dir;
+    const int64_t now = getWallClockSec();
+    const string content(100 * 1024, 'x');
+    {
+        ReportLogStore store(dir.path);
+        for (int i = 0; i < 10; i++) {
+            appendReport(&store, kConfigKey, now + i, content + std::to_string(i));
+        }
+        // Makes the first 8 reports too old.
+        appendReport(&store, kConfigKey, now + 7 + StatsdStats::kMaxAgeSecond + 1, "new");
+        store.sync();
+    }
+
+    // The dropped reports don't take space on disk anymore.
+    struct stat fileStat;
+    ASSERT_EQ(0, stat(logPath(dir, kConfigKey).c_str(), &fileStat));
+    EXPECT_LT(fileStat.st_size, 5 * (off_t)content.size());
+
+    ReportLogStore store(dir.path);
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(3, reports.reports_size());
+    EXPECT_EQ(content + "8", reports.reports(0).strings(0));
+    EXPECT_EQ(content + "9", reports.reports(1).strings(0));
+    EXPECT_EQ("new", reports.reports(2).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestFilesStayUnderSizeLimit) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const int64_t now = getWallClockSec();
+    const string content(1024 * 1024, 'x');
+    const ConfigKey otherKey(3, 102);
+    for (int i = 0; i < 60; i++) {
+        // Over the size limit after 50 reports. The oldest reports alternate between the logs, so
+        // that both have dead space.
+        appendReport(&store, i % 2 ? kConfigKey : otherKey, now + i, content);
+        store.sync();
+
+        struct stat fileStat;
+        off_t diskBytes = 0;
+        for (const auto& key : {kConfigKey, otherKey}) {
+            if (stat(logPath(dir, key).c_str(), &fileStat) == 0) {
+                diskBytes += fileStat.st_size;
+            }
+        }
+        EXPECT_LE(diskBytes, (off_t)StatsdStats::kMaxFileSize);
+    }
+}
+
+TEST(ReportLogStoreTest, TestSyncWhileAppendingAndTaking) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const int64_t now = getWallClockSec();
+    const string content(64 * 1024, 'x');
+    const int reportCount = 400;
+
+    std::atomic<bool> done(false);
+    std::thread syncer([&] {
+        while (!done) {
+            store.sync();
+        }
+    });
+    // Each report makes the ones 5 reports older too old, so that the log keeps getting
+    // rewritten.
+    const int64_t secondsPerReport = StatsdStats::kMaxAgeSecond / 5;
+    int lastTaken = -1;
+    for (int i = 0; i < reportCount; i++) {
+        appendReport(&store, kConfigKey, now + i * secondsPerReport, content + std::to_string(i));
+        if (i % 37 == 0) {
+            ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+            for (int j = 0; j < reports.reports_size(); j++) {
+                const string& taken = reports.reports(j).strings(0);
+                ASSERT_EQ(content, taken.substr(0, content.size()));
+                int number = std::stoi(taken.substr(content.size()));
+                EXPECT_GT(number, lastTaken);
+                lastTaken = number;
+            }
+        }
+    }
+    done = true;
+    syncer.join();
+
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_GT(reports.reports_size(), 0);
+    EXPECT_EQ(content + std::to_string(reportCount - 1),
+              reports.reports(reports.reports_size() - 1).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestMigratesReportFiles) {
+    TemporaryDir dir;
+    const int64_t now = getWallClockSec();
+    // Reports in one file each, as written by older versions.
+    for (int i = 0; i < 3; i++) {
+        ConfigMetricsReport report;
+        report.add_strings(std::to_string(i));
+        string content;
+        report.SerializeToString(&content);
+        string path = StringPrintf("%s/%lld_%d_%lld", dir.path, (long long)(now + i),
+                                   kConfigKey.GetUid(), (long long)kConfigKey.GetId());
+        ASSERT_TRUE(android::base::WriteStringToFile(content, path));
+    }
+
+    ReportLogStore store(dir.path);
+    EXPECT_EQ(vector<string>{"3_101.log"}, listDir(dir.path));
+    ConfigMetricsReportList reports = takeReports(&store, kConfigKey);
+    ASSERT_EQ(3, reports.reports_size());
+    EXPECT_EQ("0", reports.reports(0).strings(0));
+    EXPECT_EQ("1", reports.reports(1).strings(0));
+    EXPECT_EQ("2", reports.reports(2).strings(0));
+}
+
+TEST(ReportLogStoreTest, TestTakeReportsToFd) {
+    TemporaryDir dir;
+    ReportLogStore store(dir.path);
+    const int64_t now = getWallClockSec();
+    appendReport(&store, kConfigKey, now, "a");
+    appendReport(&store, kConfigKey, now, string(200 * 1024, 'b'));
+
+    FILE* file = tmpfile();
+    ASSERT_NE(nullptr, file);
+    ssize_t bytesWritten = store.takeReports(kConfigKey, fileno(file));
+    string bytes;
+    ASSERT_EQ(0, lseek(fileno(file), 0, SEEK_SET));
+    ASSERT_TRUE(android::base::ReadFdToString(fileno(file), &bytes));
+    fclose(file);
+
+    EXPECT_EQ((ssize_t)bytes.size(), bytesWritten);
+    ConfigMetricsReportList reports;
+    ASSERT_TRUE(reports.ParseFromString(bytes));
+    ASSERT_EQ(2, reports.reports_size());
+    EXPECT_EQ("a", reports.reports(0).strings(0));
+    EXPECT_EQ(string(200 * 1024, 'b'), reports.reports(1).strings(0));
+    EXPECT_FALSE(store.hasReports(kConfigKey));
+
+    // The reports are kept if they could not be written.
+    appendReport(&store, kConfigKey, now, "c");
+    EXPECT_EQ(-1, store.takeReports(kConfigKey, -1));
+    EXPECT_TRUE(store.hasReports(kConfigKey));
+}
+
+}  // namespace statsd
+}  // namespace os
+}  // namespace android
+#else
+GTEST_LOG_(INFO) << "This test does nothing.\n";
+#endif
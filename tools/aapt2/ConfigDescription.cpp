@@ -16,7 +16,9 @@
 
 #include "ConfigDescription.h"
 
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "androidfw/ResourceTypes.h"
@@ -24,6 +26,7 @@
 
 #include "Locale.h"
 #include "SdkConstants.h"
+#include "util/Maybe.h"
 #include "util/Util.h"
 
 using android::ResTable_config;
@@ -643,7 +646,7 @@ static bool parseVersion(const char* name, ResTable_config* out) {
   return true;
 }
 
-bool ConfigDescription::Parse(const StringPiece& str, ConfigDescription* out) {
+static bool ParseUncached(const StringPiece& str, ConfigDescription* out) {
   std::vector<std::string> parts = util::SplitAndLowercase(str, '-');
 
   ConfigDescription config;
@@ -829,12 +832,70 @@ bool ConfigDescription::Parse(const StringPiece& str, ConfigDescription* out) {
 
 success:
   if (out != NULL) {
-    ApplyVersionForCompatibility(&config);
+    ConfigDescription::ApplyVersionForCompatibility(&config);
     *out = config;
   }
   return true;
 }
 
+namespace {
+
+// Remembers the configuration that each qualifier string parsed to. Only a handful of distinct
+// qualifier strings appear in a build, but they are parsed again for every resource file and
+// every split, and tokenizing them is far more costly than copying the result.
+class ParseCache {
+ public:
+  static ParseCache* Get() {
+    static ParseCache* cache = new ParseCache();
+    return cache;
+  }
+
+  // Returns the result of parsing `str`, which is nothing if it is not a valid configuration.
+  Maybe<ConfigDescription> Parse(const StringPiece& str) {
+    std::string key = str.to_string();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto iter = entries_.find(key);
+      if (iter != entries_.end()) {
+        return iter->second;
+      }
+    }
+
+    Maybe<ConfigDescription> result;
+    ConfigDescription config;
+    if (ParseUncached(str, &config)) {
+      result = config;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.size() < kMaxEntries) {
+      entries_.emplace(std::move(key), result);
+    }
+    return result;
+  }
+
+ private:
+  // Bounds the memory taken by callers that parse arbitrary strings.
+  static constexpr size_t kMaxEntries = 4096u;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, Maybe<ConfigDescription>> entries_;
+};
+
+}  // namespace
+
+bool ConfigDescription::Parse(const StringPiece& str, ConfigDescription* out) {
+  Maybe<ConfigDescription> config = ParseCache::Get()->Parse(str);
+  if (!config) {
+    return false;
+  }
+
+  if (out != nullptr) {
+    *out = config.value();
+  }
+  return true;
+}
+
 void ConfigDescription::ApplyVersionForCompatibility(
     ConfigDescription* config) {
   uint16_t min_sdk = 0;
@@ -49,6 +49,24 @@ TEST(ConfigDescriptionTest, ParseFailWhenQualifiersHaveTrailingDash) {
   EXPECT_FALSE(TestParse("en-sw600dp-land-"));
 }
 
+TEST(ConfigDescriptionTest, ParseSameStringRepeatedly) {
+  ConfigDescription config;
+  ASSERT_TRUE(TestParse("fr-rCA-sw600dp-land", &config));
+  EXPECT_EQ(std::string("fr-rCA-sw600dp-land-v13"), config.to_string());
+
+  ConfigDescription config_again;
+  ASSERT_TRUE(TestParse("fr-rCA-sw600dp-land", &config_again));
+  EXPECT_EQ(config, config_again);
+
+  // A repeated parse must not be affected by what was already in the output.
+  ASSERT_TRUE(TestParse("land", &config));
+  EXPECT_EQ(std::string("land"), config.to_string());
+
+  EXPECT_FALSE(TestParse("land-fr"));
+  EXPECT_FALSE(TestParse("land-fr", &config));
+  EXPECT_EQ(std::string("land"), config.to_string());
+}
+
 TEST(ConfigDescriptionTest, ParseBasicQualifiers) {
   ConfigDescription config;
   EXPECT_TRUE(TestParse("", &config));
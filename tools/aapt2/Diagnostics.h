@@ -20,6 +20,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "android-base/macros.h"
 #include "androidfw/StringPiece.h"
@@ -142,6 +144,48 @@ class SourcePathDiagnostics : public IDiagnostics {
   DISALLOW_COPY_AND_ASSIGN(SourcePathDiagnostics);
 };
 
+/**
+ * Records diagnostics so that they can be replayed later, in order, to another IDiagnostics.
+ * Used to keep output deterministic when work is spread across multiple threads.
+ */
+class BufferedDiagnostics : public IDiagnostics {
+ public:
+  BufferedDiagnostics() = default;
+
+  void Log(Level level, DiagMessageActual& actual_msg) override {
+    messages_.emplace_back(level, actual_msg);
+  }
+
+  bool empty() const {
+    return messages_.empty();
+  }
+
+  /**
+   * Replays every recorded message to `diag` and clears the buffer.
+   */
+  void FlushTo(IDiagnostics* diag) {
+    for (auto& message : messages_) {
+      diag->Log(message.first, message.second);
+    }
+    messages_.clear();
+  }
+
+  /**
+   * Replays every recorded message to `diag`, and keeps them.
+   */
+  void ReplayTo(IDiagnostics* diag) const {
+    for (const auto& message : messages_) {
+      DiagMessageActual actual_msg = message.second;
+      diag->Log(message.first, actual_msg);
+    }
+  }
+
+ private:
+  std::vector<std::pair<Level, DiagMessageActual>> messages_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferedDiagnostics);
+};
+
 }  // namespace aapt
 
 #endif /* AAPT_DIAGNOSTICS_H */
@@ -48,25 +48,21 @@ bool DominatorTree::Node::TryAddChild(std::unique_ptr<Node> new_child) {
 }
 
 bool DominatorTree::Node::AddChild(std::unique_ptr<Node> new_child) {
-  bool has_dominated_children = false;
-  // Demote children dominated by the new config.
+  // Demote children dominated by the new config, compacting the remaining children in place.
+  auto kept_end = children_.begin();
   for (auto& child : children_) {
     if (new_child->Dominates(child.get())) {
       child->parent_ = new_child.get();
       new_child->children_.push_back(std::move(child));
-      child = {};
-      has_dominated_children = true;
+    } else {
+      if (&*kept_end != &child) {
+        *kept_end = std::move(child);
+      }
+      ++kept_end;
     }
   }
-  // Remove dominated children.
-  if (has_dominated_children) {
-    children_.erase(
-        std::remove_if(children_.begin(), children_.end(),
-                       [](const std::unique_ptr<Node>& child) -> bool {
-                         return child == nullptr;
-                       }),
-        children_.end());
-  }
+  children_.erase(kept_end, children_.end());
+
   // Add the new config to a child if a child dominates the new config.
   for (auto& child : children_) {
     if (child->Dominates(new_child.get())) {
@@ -87,7 +83,12 @@ bool DominatorTree::Node::Dominates(const Node* other) const {
   } else if (is_root_node()) {
     return true;
   }
-  // Neither node is a root node; compare the configurations.
+  // Neither node is a root node; compare the configurations. Configurations with different
+  // languages or regions never dominate each other, since locales are not de-duplicated. Checking
+  // that first is much cheaper, and rules out most siblings in tables with many locales.
+  if (value_->config.locale != other->value_->config.locale) {
+    return false;
+  }
   return value_->config.Dominates(other->value_->config);
 }
 
@@ -29,7 +29,10 @@
 #include "androidfw/StringPiece.h"
 
 #include "Diagnostics.h"
+#include "Flags.h"
+#include "ResourceUtils.h"
 #include "util/Files.h"
+#include "util/InputCache.h"
 #include "util/Util.h"
 
 using ::android::StringPiece;
@@ -41,7 +44,10 @@ namespace aapt {
 static const char* sMajorVersion = "2";
 
 // Update minor version whenever a feature or flag is added.
-static const char* sMinorVersion = "19";
+static const char* sMinorVersion = "20";
+
+// The default number of megabytes of inputs that the daemon keeps between commands.
+constexpr static const uint32_t kDefaultInputCacheSizeMb = 512u;
 
 static void PrintVersion() {
   std::cerr << StringPrintf("Android Asset Packaging Tool (aapt) %s:%s", sMajorVersion,
@@ -82,6 +88,36 @@ static int ExecuteCommand(const StringPiece& command, const std::vector<StringPi
   return -1;
 }
 
+// Parses the arguments of the daemon itself and sets up the cache of inputs that it keeps
+// between commands.
+static bool InitDaemon(const std::vector<StringPiece>& args) {
+  Maybe<std::string> cache_size;
+  Flags flags = Flags().OptionalFlag(
+      "--input-cache-size",
+      StringPrintf("Megabytes of loaded inputs to keep in memory between commands, so\n"
+                   "that later commands don't load unchanged inputs again. 0 disables\n"
+                   "the cache. Defaults to %u.",
+                   kDefaultInputCacheSizeMb),
+      &cache_size);
+  if (!flags.Parse("aapt2 daemon", args, &std::cerr)) {
+    return false;
+  }
+
+  uint32_t cache_size_mb = kDefaultInputCacheSizeMb;
+  if (cache_size) {
+    Maybe<uint32_t> parsed_size = ResourceUtils::ParseInt(cache_size.value());
+    if (!parsed_size || static_cast<int32_t>(parsed_size.value()) < 0) {
+      std::cerr << "--input-cache-size must be a non-negative integer.\n\n";
+      flags.Usage("aapt2 daemon", &std::cerr);
+      return false;
+    }
+    cache_size_mb = parsed_size.value();
+  }
+
+  InputCache::Get()->SetMemoryLimit(static_cast<size_t>(cache_size_mb) * 1024u * 1024u);
+  return true;
+}
+
 static void RunDaemon(IDiagnostics* diagnostics) {
   std::cout << "Ready" << std::endl;
 
@@ -149,6 +185,9 @@ int MainImpl(int argc, char** argv) {
     return result;
   }
 
+  if (!aapt::InitDaemon(args)) {
+    return 1;
+  }
   aapt::RunDaemon(&diagnostics);
   return 0;
 }
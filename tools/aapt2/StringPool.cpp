@@ -25,6 +25,7 @@
 #include "androidfw/StringPiece.h"
 
 #include "util/BigBuffer.h"
+#include "util/Parallel.h"
 #include "util/Util.h"
 
 using ::android::StringPiece;
@@ -295,23 +296,108 @@ void StringPool::Prune() {
   ReAssignIndices();
 }
 
+// An entry, keyed by eight bytes of its value from some offset on.
+template <typename E>
+struct PrefixKey {
+  // The next eight bytes of the value, big-endian and padded with zeros.
+  uint64_t prefix;
+
+  // How many of those bytes the value has. Orders a value that ends before one that continues
+  // with zeros.
+  size_t length;
+
+  E* entry;
+
+  bool operator<(const PrefixKey& rhs) const {
+    return prefix != rhs.prefix ? prefix < rhs.prefix : length < rhs.length;
+  }
+};
+
+// Entries that still tie are compared as strings once they are this few, or share this many
+// bytes. This bounds the recursion, which many identical long values would otherwise take eight
+// bytes at a time.
+constexpr static const size_t kMinRadixSortCount = 16u;
+constexpr static const size_t kMaxRadixSortDepth = 64u;
+
+// Sorts `count` entries whose values share the same first `depth` bytes. This is a most significant
+// digit radix sort on eight byte digits: each pass sorts plain integer keys, which keeps the
+// comparisons away from the strings, and only the entries that still tie, like paths with a long
+// common prefix, go on to the next eight bytes. The order is the same as std::string's operator<.
+template <typename E>
+static void SortPrefixKeys(PrefixKey<E>* keys, size_t count, size_t depth) {
+  if (count < kMinRadixSortCount || depth >= kMaxRadixSortDepth) {
+    std::sort(keys, keys + count, [depth](const PrefixKey<E>& a, const PrefixKey<E>& b) {
+      return a.entry->value.compare(depth, std::string::npos, b.entry->value, depth,
+                                    std::string::npos) < 0;
+    });
+    return;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const std::string& value = keys[i].entry->value;
+    const size_t length = std::min<size_t>(value.size() - depth, 8u);
+    uint64_t prefix = 0u;
+    for (size_t j = 0; j < length; j++) {
+      prefix |= static_cast<uint64_t>(static_cast<uint8_t>(value[depth + j])) << (56u - 8u * j);
+    }
+    keys[i].prefix = prefix;
+    keys[i].length = length;
+  }
+
+  std::sort(keys, keys + count);
+
+  size_t start = 0u;
+  while (start < count) {
+    size_t end = start + 1;
+    while (end < count && !(keys[start] < keys[end])) {
+      end++;
+    }
+
+    // Values that are equal so far and continue past these eight bytes are ordered by the rest.
+    if (end - start > 1 && keys[start].length == 8u) {
+      SortPrefixKeys(keys + start, end - start, depth + 8u);
+    }
+    start = end;
+  }
+}
+
+template <typename E>
+static void SortByValue(std::unique_ptr<E>* entries, size_t count) {
+  std::vector<PrefixKey<E>> keys(count);
+  for (size_t i = 0; i < count; i++) {
+    keys[i].entry = entries[i].release();
+  }
+
+  SortPrefixKeys(keys.data(), count, 0u);
+
+  for (size_t i = 0; i < count; i++) {
+    entries[i].reset(keys[i].entry);
+  }
+}
+
 template <typename E>
 static void SortEntries(
     std::vector<std::unique_ptr<E>>& entries,
     const std::function<int(const StringPool::Context&, const StringPool::Context&)>& cmp) {
   using UEntry = std::unique_ptr<E>;
 
-  if (cmp != nullptr) {
-    std::sort(entries.begin(), entries.end(), [&cmp](const UEntry& a, const UEntry& b) -> bool {
-      int r = cmp(a->context, b->context);
-      if (r == 0) {
-        r = a->value.compare(b->value);
-      }
-      return r < 0;
+  if (cmp == nullptr) {
+    SortByValue(entries.data(), entries.size());
+    return;
+  }
+
+  // Group the entries by context, then sort the values of each group of equal contexts.
+  std::sort(entries.begin(), entries.end(), [&cmp](const UEntry& a, const UEntry& b) -> bool {
+    return cmp(a->context, b->context) < 0;
+  });
+
+  auto group_start = entries.begin();
+  while (group_start != entries.end()) {
+    auto group_end = std::find_if(group_start + 1, entries.end(), [&](const UEntry& entry) {
+      return cmp((*group_start)->context, entry->context) != 0;
     });
-  } else {
-    std::sort(entries.begin(), entries.end(),
-              [](const UEntry& a, const UEntry& b) -> bool { return a->value < b->value; });
+    SortByValue(&*group_start, group_end - group_start);
+    group_start = group_end;
   }
 }
 
@@ -431,8 +517,18 @@ static bool EncodeString(const std::string& str, const bool utf8, BigBuffer* out
   return true;
 }
 
-bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8,
-                         IDiagnostics* diag) {
+// Strings are encoded in chunks of this many, which are spread across threads.
+constexpr size_t kStringsPerChunk = 4096u;
+
+// The encoded strings of one chunk.
+struct EncodedChunk {
+  BigBuffer buffer{4096};
+  BufferedDiagnostics diagnostics;
+  bool no_error = true;
+};
+
+bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8, IDiagnostics* diag,
+                         size_t max_jobs) {
   bool no_error = true;
   const size_t start_index = out->size();
   android::ResStringPool_header* header = out->NextBlock<android::ResStringPool_header>();
@@ -451,15 +547,35 @@ bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8,
   const size_t before_strings_index = out->size();
   header->stringsStart = before_strings_index - start_index;
 
-  // Styles always come first.
-  for (const std::unique_ptr<StyleEntry>& entry : pool.styles_) {
-    *indices++ = out->size() - before_strings_index;
-    no_error = EncodeString(entry->value, utf8, out, diag) && no_error;
-  }
-
-  for (const std::unique_ptr<Entry>& entry : pool.strings_) {
-    *indices++ = out->size() - before_strings_index;
-    no_error = EncodeString(entry->value, utf8, out, diag) && no_error;
+  // Styles always come first. Each chunk of strings is encoded into its own buffer, possibly on its
+  // own thread, with offsets relative to the start of the chunk. The buffers are then appended in
+  // order and the offsets adjusted, so the output is the same however many threads are used.
+  const size_t style_count = pool.styles_.size();
+  const size_t string_count = pool.size();
+  const size_t chunk_count = (string_count + kStringsPerChunk - 1) / kStringsPerChunk;
+  std::vector<EncodedChunk> chunks(chunk_count);
+  util::ParallelFor(chunk_count, max_jobs, [&](size_t c) {
+    EncodedChunk& chunk = chunks[c];
+    const size_t end = std::min((c + 1) * kStringsPerChunk, string_count);
+    for (size_t i = c * kStringsPerChunk; i < end; i++) {
+      const std::string& value =
+          i < style_count ? pool.styles_[i]->value : pool.strings_[i - style_count]->value;
+      indices[i] = chunk.buffer.size();
+      chunk.no_error = EncodeString(value, utf8, &chunk.buffer, &chunk.diagnostics) &&
+                       chunk.no_error;
+    }
+  });
+
+  for (size_t c = 0; c < chunk_count; c++) {
+    EncodedChunk& chunk = chunks[c];
+    const uint32_t chunk_offset = out->size() - before_strings_index;
+    const size_t end = std::min((c + 1) * kStringsPerChunk, string_count);
+    for (size_t i = c * kStringsPerChunk; i < end; i++) {
+      indices[i] += chunk_offset;
+    }
+    chunk.diagnostics.FlushTo(diag);
+    no_error = chunk.no_error && no_error;
+    out->AppendBuffer(std::move(chunk.buffer));
   }
 
   out->Align4();
@@ -500,12 +616,14 @@ bool StringPool::Flatten(BigBuffer* out, const StringPool& pool, bool utf8,
   return no_error;
 }
 
-bool StringPool::FlattenUtf8(BigBuffer* out, const StringPool& pool, IDiagnostics* diag) {
-  return Flatten(out, pool, true, diag);
+bool StringPool::FlattenUtf8(BigBuffer* out, const StringPool& pool, IDiagnostics* diag,
+                             size_t max_jobs) {
+  return Flatten(out, pool, true, diag, max_jobs);
 }
 
-bool StringPool::FlattenUtf16(BigBuffer* out, const StringPool& pool, IDiagnostics* diag) {
-  return Flatten(out, pool, false, diag);
+bool StringPool::FlattenUtf16(BigBuffer* out, const StringPool& pool, IDiagnostics* diag,
+                              size_t max_jobs) {
+  return Flatten(out, pool, false, diag, max_jobs);
 }
 
 }  // namespace aapt
@@ -153,8 +153,14 @@ class StringPool {
     int ref_;
   };
 
-  static bool FlattenUtf8(BigBuffer* out, const StringPool& pool, IDiagnostics* diag);
-  static bool FlattenUtf16(BigBuffer* out, const StringPool& pool, IDiagnostics* diag);
+  // Flattens the pool into a ResStringPool. Large pools are encoded on up to `max_jobs` threads
+  // (0 is the default of util::ParallelFor: one per CPU core, or one when already running within a
+  // parallel loop, like when flattening split APKs); the output does not depend on the number of
+  // threads.
+  static bool FlattenUtf8(BigBuffer* out, const StringPool& pool, IDiagnostics* diag,
+                          size_t max_jobs = 0);
+  static bool FlattenUtf16(BigBuffer* out, const StringPool& pool, IDiagnostics* diag,
+                           size_t max_jobs = 0);
 
   StringPool() = default;
   StringPool(StringPool&&) = default;
@@ -198,7 +204,7 @@ class StringPool {
   void HintWillAdd(size_t string_count, size_t style_count);
 
   // Sorts the strings according to their Context using some comparison function.
-  // Equal Contexts are further sorted by string value, lexicographically.
+  // Equal Contexts are further sorted by string value, lexicographically, with a radix sort.
   // If no comparison function is provided, values are only sorted lexicographically.
   void Sort(const std::function<int(const Context&, const Context&)>& cmp = nullptr);
 
@@ -208,7 +214,8 @@ class StringPool {
  private:
   DISALLOW_COPY_AND_ASSIGN(StringPool);
 
-  static bool Flatten(BigBuffer* out, const StringPool& pool, bool utf8, IDiagnostics* diag);
+  static bool Flatten(BigBuffer* out, const StringPool& pool, bool utf8, IDiagnostics* diag,
+                      size_t max_jobs);
 
   Ref MakeRefImpl(const android::StringPiece& str, const Context& context, bool unique);
   void ReAssignIndices();
@@ -16,8 +16,10 @@
 
 #include "StringPool.h"
 
+#include <algorithm>
 #include <string>
 
+#include "android-base/stringprintf.h"
 #include "androidfw/StringPiece.h"
 
 #include "Diagnostics.h"
@@ -26,7 +28,10 @@
 
 using ::android::StringPiece;
 using ::android::StringPiece16;
+using ::android::base::StringPrintf;
 using ::testing::Eq;
+using ::testing::Le;
+using ::testing::Lt;
 using ::testing::Ne;
 using ::testing::NotNull;
 using ::testing::Pointee;
@@ -157,6 +162,73 @@ TEST(StringPoolTest, SortAndStillDedupe) {
   EXPECT_THAT(ref_f.index(), Eq(ref_c.index()));
 }
 
+TEST(StringPoolTest, SortInByteOrder) {
+  StringPool pool;
+
+  // Enough strings to be partitioned rather than insertion sorted, with shared prefixes, prefixes
+  // of other strings, non-ASCII bytes and embedded nulls.
+  std::vector<std::string> values = {"", "a", std::string("a\0", 2), std::string("a\0b", 3),
+                                     "\xc3\xa9", "\x7f", "res/layout/main.xml"};
+  for (int i = 0; i < 200; i++) {
+    values.push_back(StringPrintf("res/drawable-%s/icon_%d.png", i % 2 ? "hdpi" : "xhdpi", i));
+  }
+  for (const std::string& value : values) {
+    pool.MakeRef(value);
+  }
+
+  pool.Sort();
+
+  std::sort(values.begin(), values.end());
+  ASSERT_THAT(pool.strings().size(), Eq(values.size()));
+  for (size_t i = 0; i < values.size(); i++) {
+    EXPECT_THAT(pool.strings()[i]->value, Eq(values[i]));
+  }
+}
+
+TEST(StringPoolTest, SortIdenticalLongStrings) {
+  StringPool pool;
+
+  // Identical values are kept apart by their contexts. Sorting them one eight byte digit at a
+  // time would recurse once per digit.
+  const std::string long_value(1024u * 1024u, 'x');
+  for (int i = 0; i < 100; i++) {
+    pool.MakeRef(long_value + (i % 2 ? "b" : "a"),
+                 StringPool::Context(static_cast<uint32_t>(i)));
+  }
+
+  pool.Sort();
+
+  const auto& strings = pool.strings();
+  ASSERT_THAT(strings.size(), Eq(100u));
+  for (size_t i = 0; i < strings.size(); i++) {
+    EXPECT_THAT(strings[i]->value.back(), Eq(i < 50u ? 'a' : 'b'));
+  }
+}
+
+TEST(StringPoolTest, SortByContextThenValue) {
+  StringPool pool;
+
+  for (int i = 0; i < 100; i++) {
+    pool.MakeRef(StringPrintf("string_%d", 99 - i),
+                 StringPool::Context(static_cast<uint32_t>(i % 3)));
+  }
+
+  pool.Sort([](const StringPool::Context& a, const StringPool::Context& b) -> int {
+    return a.priority - b.priority;
+  });
+
+  const auto& strings = pool.strings();
+  ASSERT_THAT(strings.size(), Eq(100u));
+  for (size_t i = 1; i < strings.size(); i++) {
+    const StringPool::Entry& prev = *strings[i - 1];
+    const StringPool::Entry& cur = *strings[i];
+    ASSERT_THAT(prev.context.priority, Le(cur.context.priority));
+    if (prev.context.priority == cur.context.priority) {
+      EXPECT_THAT(prev.value, Lt(cur.value));
+    }
+  }
+}
+
 TEST(StringPoolTest, AddStyles) {
   StringPool pool;
 
@@ -303,6 +375,38 @@ TEST(StringPoolTest, Flatten) {
   }
 }
 
+TEST(StringPoolTest, FlattenLargePoolIndependentlyOfThreadCount) {
+  using namespace android;  // For NO_ERROR on Windows.
+  StdErrDiagnostics diag;
+
+  // Spans several chunks of encoded strings.
+  StringPool pool;
+  pool.MakeRef(StyleString{{"style"}, {Span{{"b"}, 0, 1}}});
+  for (int i = 0; i < 10000; i++) {
+    pool.MakeRef(i % 7 == 0 ? StringPrintf("%d %s", i, sLongString) : StringPrintf("string_%d", i));
+  }
+
+  for (bool utf8 : {true, false}) {
+    BigBuffer serial(1024);
+    BigBuffer parallel(1024);
+    if (utf8) {
+      ASSERT_TRUE(StringPool::FlattenUtf8(&serial, pool, &diag, 1u));
+      ASSERT_TRUE(StringPool::FlattenUtf8(&parallel, pool, &diag, 4u));
+    } else {
+      ASSERT_TRUE(StringPool::FlattenUtf16(&serial, pool, &diag, 1u));
+      ASSERT_TRUE(StringPool::FlattenUtf16(&parallel, pool, &diag, 4u));
+    }
+    EXPECT_THAT(parallel.to_string(), Eq(serial.to_string()));
+
+    std::unique_ptr<uint8_t[]> data = util::Copy(parallel);
+    ResStringPool test;
+    ASSERT_EQ(test.setTo(data.get(), parallel.size()), NO_ERROR);
+    EXPECT_THAT(util::GetString(test, 0), Eq("style"));
+    for (size_t i : {1u, 4096u, 4097u, 8192u, 10000u}) {
+      EXPECT_THAT(util::GetString(test, i), Eq(pool.strings()[i - 1]->value));
+    }
+  }
+}
 
 TEST(StringPoolTest, MaxEncodingLength) {
   StdErrDiagnostics diag;
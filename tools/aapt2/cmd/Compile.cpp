@@ -16,6 +16,8 @@
 
 #include <dirent.h>
 
+#include <map>
+#include <memory>
 #include <string>
 
 #include "android-base/errors.h"
@@ -30,11 +32,13 @@
 #include "Flags.h"
 #include "ResourceParser.h"
 #include "ResourceTable.h"
+#include "ResourceUtils.h"
 #include "compile/IdAssigner.h"
 #include "compile/InlineXmlFormatParser.h"
 #include "compile/Png.h"
 #include "compile/PseudolocaleGenerator.h"
 #include "compile/XmlIdCollector.h"
+#include "compile/XmlStreamCompiler.h"
 #include "format/Archive.h"
 #include "format/Container.h"
 #include "format/proto/ProtoSerialize.h"
@@ -43,7 +47,9 @@
 #include "io/StringStream.h"
 #include "io/Util.h"
 #include "util/Files.h"
+#include "util/InputCache.h"
 #include "util/Maybe.h"
+#include "util/Parallel.h"
 #include "util/Util.h"
 #include "xml/XmlDom.h"
 #include "xml/XmlPullParser.h"
@@ -128,6 +134,9 @@ struct CompileOptions {
   bool no_png_crunch = false;
   bool legacy_mode = false;
   bool verbose = false;
+
+  // Maximum number of PNGs to crunch concurrently. 0 means one per available CPU core.
+  size_t max_jobs = 0;
 };
 
 static std::string BuildIntermediateContainerFilename(const ResourcePathData& data) {
@@ -365,13 +374,11 @@ static bool WriteHeaderAndDataToWriter(const StringPiece& output_path, const Res
   return true;
 }
 
-static bool FlattenXmlToOutStream(const StringPiece& output_path, const xml::XmlResource& xmlres,
-                                  ContainerWriter* container_writer, IDiagnostics* diag) {
+static bool WriteXmlNodeToOutStream(const StringPiece& output_path, const ResourceFile& file,
+                                    const pb::XmlNode& pb_xml_node,
+                                    ContainerWriter* container_writer, IDiagnostics* diag) {
   pb::internal::CompiledFile pb_compiled_file;
-  SerializeCompiledFileToPb(xmlres.file, &pb_compiled_file);
-
-  pb::XmlNode pb_xml_node;
-  SerializeXmlToPb(*xmlres.root, &pb_xml_node);
+  SerializeCompiledFileToPb(file, &pb_compiled_file);
 
   std::string serialized_xml = pb_xml_node.SerializeAsString();
   io::StringInputStream serialized_in(serialized_xml);
@@ -383,6 +390,13 @@ static bool FlattenXmlToOutStream(const StringPiece& output_path, const xml::Xml
   return true;
 }
 
+static bool FlattenXmlToOutStream(const StringPiece& output_path, const xml::XmlResource& xmlres,
+                                  ContainerWriter* container_writer, IDiagnostics* diag) {
+  pb::XmlNode pb_xml_node;
+  SerializeXmlToPb(*xmlres.root, &pb_xml_node);
+  return WriteXmlNodeToOutStream(output_path, xmlres.file, pb_xml_node, container_writer, diag);
+}
+
 static bool IsValidFile(IAaptContext* context, const std::string& input_path) {
   const file::FileType file_type = file::GetFileType(input_path);
   if (file_type != file::FileType::kRegular && file_type != file::FileType::kSymlink) {
@@ -400,6 +414,76 @@ static bool IsValidFile(IAaptContext* context, const std::string& input_path) {
   return true;
 }
 
+static bool WriteXmlTextSymbols(IAaptContext* context, const CompileOptions& options,
+                                const ResourcePathData& path_data,
+                                const std::vector<SourcedResourceName>& exported_symbols) {
+  if (!options.generate_text_symbols_path) {
+    return true;
+  }
+
+  io::FileOutputStream fout_text(options.generate_text_symbols_path.value());
+
+  if (fout_text.HadError()) {
+    context->GetDiagnostics()->Error(DiagMessage()
+                                     << "failed writing to'"
+                                     << options.generate_text_symbols_path.value()
+                                     << "': " << fout_text.GetError());
+    return false;
+  }
+
+  Printer r_txt_printer(&fout_text);
+  for (const auto res : exported_symbols) {
+    r_txt_printer.Print("default int id ");
+    r_txt_printer.Println(res.name.entry);
+  }
+
+  // And print ourselves.
+  r_txt_printer.Print("default int ");
+  r_txt_printer.Print(path_data.resource_dir);
+  r_txt_printer.Print(" ");
+  r_txt_printer.Println(path_data.name);
+  return true;
+}
+
+// Compiles an XML file that has no inline XML documents straight from the parser events, without
+// building its DOM.
+static bool CompileXmlWithoutDom(IAaptContext* context, const CompileOptions& options,
+                                 const ResourcePathData& path_data, const std::string& content,
+                                 IArchiveWriter* writer, const std::string& output_path) {
+  ResourceFile file;
+  file.name = ResourceName({}, *ParseResourceType(path_data.resource_dir), path_data.name);
+  file.config = path_data.config;
+  file.source = path_data.source;
+  file.type = ResourceFile::Type::kProtoXml;
+
+  pb::XmlNode pb_xml_node;
+  if (!CompileXmlStream(content, path_data.source, context->GetDiagnostics(), &pb_xml_node,
+                        &file.exported_symbols)) {
+    return false;
+  }
+
+  if (!writer->StartEntry(output_path, 0)) {
+    context->GetDiagnostics()->Error(DiagMessage(output_path) << "failed to open file");
+    return false;
+  }
+
+  // Make sure CopyingOutputStreamAdaptor is deleted before we call writer->FinishEntry().
+  {
+    CopyingOutputStreamAdaptor copying_adaptor(writer);
+    ContainerWriter container_writer(&copying_adaptor, 1u);
+    if (!WriteXmlNodeToOutStream(output_path, file, pb_xml_node, &container_writer,
+                                 context->GetDiagnostics())) {
+      return false;
+    }
+  }
+
+  if (!writer->FinishEntry()) {
+    context->GetDiagnostics()->Error(DiagMessage(output_path) << "failed to finish writing data");
+    return false;
+  }
+  return WriteXmlTextSymbols(context, options, path_data, file.exported_symbols);
+}
+
 static bool CompileXml(IAaptContext* context, const CompileOptions& options,
                        const ResourcePathData& path_data, IArchiveWriter* writer,
                        const std::string& output_path) {
@@ -407,16 +491,25 @@ static bool CompileXml(IAaptContext* context, const CompileOptions& options,
     context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "compiling XML");
   }
 
+  std::string content;
+  if (!android::base::ReadFileToString(path_data.source.path, &content,
+                                       true /*follow_symlinks*/)) {
+    context->GetDiagnostics()->Error(DiagMessage(path_data.source)
+                                     << "failed to open file: "
+                                     << SystemErrorCodeToString(errno));
+    return false;
+  }
+
+  // Most files only need their IDs collected, so only build the DOM when inline XML documents
+  // have to be extracted from it.
+  if (!XmlRequiresDom(content)) {
+    return CompileXmlWithoutDom(context, options, path_data, content, writer, output_path);
+  }
+
   std::unique_ptr<xml::XmlResource> xmlres;
   {
-    FileInputStream fin(path_data.source.path);
-    if (fin.HadError()) {
-      context->GetDiagnostics()->Error(DiagMessage(path_data.source)
-                                       << "failed to open file: " << fin.GetError());
-      return false;
-    }
-
-    xmlres = xml::Inflate(&fin, context->GetDiagnostics(), path_data.source);
+    io::StringInputStream in(content);
+    xmlres = xml::Inflate(&in, context->GetDiagnostics(), path_data.source);
   }
 
   if (!xmlres) {
@@ -472,144 +565,140 @@ static bool CompileXml(IAaptContext* context, const CompileOptions& options,
     context->GetDiagnostics()->Error(DiagMessage(output_path) << "failed to finish writing data");
     return false;
   }
+  return WriteXmlTextSymbols(context, options, path_data, xmlres->file.exported_symbols);
+}
 
-  if (options.generate_text_symbols_path) {
-    io::FileOutputStream fout_text(options.generate_text_symbols_path.value());
+// Crunches the PNG whose file contents are `content`, and writes the smallest acceptable encoding
+// to `out_buffer`.
+static bool CrunchPng(IAaptContext* context, const ResourcePathData& path_data,
+                      const std::string& content, BigBuffer* out_buffer) {
+  BigBuffer crunched_png_buffer(4096);
+  io::BigBufferOutputStream crunched_png_buffer_out(&crunched_png_buffer);
+
+  // Ensure that we only keep the chunks we care about if we end up
+  // using the original PNG instead of the crunched one.
+  PngChunkFilter png_chunk_filter(content);
+  std::unique_ptr<Image> image = ReadPng(context, path_data.source, &png_chunk_filter);
+  if (!image) {
+    return false;
+  }
 
-    if (fout_text.HadError()) {
-      context->GetDiagnostics()->Error(DiagMessage()
-                                       << "failed writing to'"
-                                       << options.generate_text_symbols_path.value()
-                                       << "': " << fout_text.GetError());
+  std::unique_ptr<NinePatch> nine_patch;
+  if (path_data.extension == "9.png") {
+    std::string err;
+    nine_patch = NinePatch::Create(image->rows.get(), image->width, image->height, &err);
+    if (!nine_patch) {
+      context->GetDiagnostics()->Error(DiagMessage() << err);
       return false;
     }
 
-    Printer r_txt_printer(&fout_text);
-    for (const auto res : xmlres->file.exported_symbols) {
-      r_txt_printer.Print("default int id ");
-      r_txt_printer.Println(res.name.entry);
+    // Remove the 1px border around the NinePatch.
+    // Basically the row array is shifted up by 1, and the length is treated
+    // as height - 2.
+    // For each row, shift the array to the left by 1, and treat the length as
+    // width - 2.
+    image->width -= 2;
+    image->height -= 2;
+    memmove(image->rows.get(), image->rows.get() + 1, image->height * sizeof(uint8_t**));
+    for (int32_t h = 0; h < image->height; h++) {
+      memmove(image->rows[h], image->rows[h] + 4, image->width * 4);
+    }
+
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "9-patch: "
+                                                                    << *nine_patch);
+    }
+  }
+
+  // Write the crunched PNG.
+  if (!WritePng(context, image.get(), nine_patch.get(), &crunched_png_buffer_out, {})) {
+    return false;
+  }
+
+  if (nine_patch != nullptr ||
+      crunched_png_buffer_out.ByteCount() <= png_chunk_filter.ByteCount()) {
+    // No matter what, we must use the re-encoded PNG, even if it is larger.
+    // 9-patch images must be re-encoded since their borders are stripped.
+    out_buffer->AppendBuffer(std::move(crunched_png_buffer));
+  } else {
+    // The re-encoded PNG is larger than the original, and there is
+    // no mandatory transformation. Use the original.
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage(path_data.source)
+                                      << "original PNG is smaller than crunched PNG"
+                                      << ", using original");
     }
 
-    // And print ourselves.
-    r_txt_printer.Print("default int ");
-    r_txt_printer.Print(path_data.resource_dir);
-    r_txt_printer.Print(" ");
-    r_txt_printer.Println(path_data.name);
+    png_chunk_filter.Rewind();
+    BigBuffer filtered_png_buffer(4096);
+    io::BigBufferOutputStream filtered_png_buffer_out(&filtered_png_buffer);
+    io::Copy(&filtered_png_buffer_out, &png_chunk_filter);
+    out_buffer->AppendBuffer(std::move(filtered_png_buffer));
   }
 
+  if (context->IsVerbose()) {
+    // For debugging only, use the legacy PNG cruncher and compare the resulting file sizes.
+    // This will help catch exotic cases where the new code may generate larger PNGs.
+    std::stringstream legacy_stream(content);
+    BigBuffer legacy_buffer(4096);
+    Png png(context->GetDiagnostics());
+    if (!png.process(path_data.source, &legacy_stream, &legacy_buffer, {})) {
+      return false;
+    }
+
+    context->GetDiagnostics()->Note(DiagMessage(path_data.source)
+                                    << "legacy=" << legacy_buffer.size()
+                                    << " new=" << out_buffer->size());
+  }
   return true;
 }
 
-static bool CompilePng(IAaptContext* context, const CompileOptions& options,
-                       const ResourcePathData& path_data, IArchiveWriter* writer,
-                       const std::string& output_path) {
-  if (context->IsVerbose()) {
-    context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "compiling PNG");
+static bool ReadPngFile(IAaptContext* context, const ResourcePathData& path_data,
+                        std::string* out_content) {
+  if (!android::base::ReadFileToString(path_data.source.path, out_content,
+                                       true /*follow_symlinks*/)) {
+    context->GetDiagnostics()->Error(DiagMessage(path_data.source)
+                                     << "failed to open file: "
+                                     << SystemErrorCodeToString(errno));
+    return false;
   }
+  return true;
+}
 
-  BigBuffer buffer(4096);
+// Writes an already crunched PNG to the container at `output_path`.
+static bool WriteCrunchedPng(IAaptContext* context, const ResourcePathData& path_data,
+                             const BigBuffer* buffer, IArchiveWriter* writer,
+                             const std::string& output_path) {
   ResourceFile res_file;
   res_file.name = ResourceName({}, *ParseResourceType(path_data.resource_dir), path_data.name);
   res_file.config = path_data.config;
   res_file.source = path_data.source;
   res_file.type = ResourceFile::Type::kPng;
 
-  {
-    std::string content;
-    if (!android::base::ReadFileToString(path_data.source.path, &content,
-                                         true /*follow_symlinks*/)) {
-      context->GetDiagnostics()->Error(DiagMessage(path_data.source)
-                                       << "failed to open file: "
-                                       << SystemErrorCodeToString(errno));
-      return false;
-    }
+  io::BigBufferInputStream buffer_in(buffer);
+  return WriteHeaderAndDataToWriter(output_path, res_file, &buffer_in, writer,
+                                    context->GetDiagnostics());
+}
 
-    BigBuffer crunched_png_buffer(4096);
-    io::BigBufferOutputStream crunched_png_buffer_out(&crunched_png_buffer);
+static bool CompilePng(IAaptContext* context, const CompileOptions& options,
+                       const ResourcePathData& path_data, IArchiveWriter* writer,
+                       const std::string& output_path) {
+  if (context->IsVerbose()) {
+    context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "compiling PNG");
+  }
 
-    // Ensure that we only keep the chunks we care about if we end up
-    // using the original PNG instead of the crunched one.
-    PngChunkFilter png_chunk_filter(content);
-    std::unique_ptr<Image> image = ReadPng(context, path_data.source, &png_chunk_filter);
-    if (!image) {
+  BigBuffer buffer(4096);
+  {
+    std::string content;
+    if (!ReadPngFile(context, path_data, &content)) {
       return false;
     }
 
-    std::unique_ptr<NinePatch> nine_patch;
-    if (path_data.extension == "9.png") {
-      std::string err;
-      nine_patch = NinePatch::Create(image->rows.get(), image->width, image->height, &err);
-      if (!nine_patch) {
-        context->GetDiagnostics()->Error(DiagMessage() << err);
-        return false;
-      }
-
-      // Remove the 1px border around the NinePatch.
-      // Basically the row array is shifted up by 1, and the length is treated
-      // as height - 2.
-      // For each row, shift the array to the left by 1, and treat the length as
-      // width - 2.
-      image->width -= 2;
-      image->height -= 2;
-      memmove(image->rows.get(), image->rows.get() + 1, image->height * sizeof(uint8_t**));
-      for (int32_t h = 0; h < image->height; h++) {
-        memmove(image->rows[h], image->rows[h] + 4, image->width * 4);
-      }
-
-      if (context->IsVerbose()) {
-        context->GetDiagnostics()->Note(DiagMessage(path_data.source) << "9-patch: "
-                                                                      << *nine_patch);
-      }
-    }
-
-    // Write the crunched PNG.
-    if (!WritePng(context, image.get(), nine_patch.get(), &crunched_png_buffer_out, {})) {
+    if (!CrunchPng(context, path_data, content, &buffer)) {
       return false;
     }
-
-    if (nine_patch != nullptr ||
-        crunched_png_buffer_out.ByteCount() <= png_chunk_filter.ByteCount()) {
-      // No matter what, we must use the re-encoded PNG, even if it is larger.
-      // 9-patch images must be re-encoded since their borders are stripped.
-      buffer.AppendBuffer(std::move(crunched_png_buffer));
-    } else {
-      // The re-encoded PNG is larger than the original, and there is
-      // no mandatory transformation. Use the original.
-      if (context->IsVerbose()) {
-        context->GetDiagnostics()->Note(DiagMessage(path_data.source)
-                                        << "original PNG is smaller than crunched PNG"
-                                        << ", using original");
-      }
-
-      png_chunk_filter.Rewind();
-      BigBuffer filtered_png_buffer(4096);
-      io::BigBufferOutputStream filtered_png_buffer_out(&filtered_png_buffer);
-      io::Copy(&filtered_png_buffer_out, &png_chunk_filter);
-      buffer.AppendBuffer(std::move(filtered_png_buffer));
-    }
-
-    if (context->IsVerbose()) {
-      // For debugging only, use the legacy PNG cruncher and compare the resulting file sizes.
-      // This will help catch exotic cases where the new code may generate larger PNGs.
-      std::stringstream legacy_stream(content);
-      BigBuffer legacy_buffer(4096);
-      Png png(context->GetDiagnostics());
-      if (!png.process(path_data.source, &legacy_stream, &legacy_buffer, {})) {
-        return false;
-      }
-
-      context->GetDiagnostics()->Note(DiagMessage(path_data.source)
-                                      << "legacy=" << legacy_buffer.size()
-                                      << " new=" << buffer.size());
-    }
   }
-
-  io::BigBufferInputStream buffer_in(&buffer);
-  if (!WriteHeaderAndDataToWriter(output_path, res_file, &buffer_in, writer,
-                                  context->GetDiagnostics())) {
-    return false;
-  }
-  return true;
+  return WriteCrunchedPng(context, path_data, &buffer, writer, output_path);
 }
 
 static bool CompileFile(IAaptContext* context, const CompileOptions& options,
@@ -694,12 +783,201 @@ class CompileContext : public IAaptContext {
   bool verbose_ = false;
 };
 
+using CompileFunc = bool (*)(IAaptContext*, const CompileOptions&, const ResourcePathData&,
+                             IArchiveWriter*, const std::string&);
+
+// How many PNGs per thread are crunched ahead of the thread that writes the archive. This bounds
+// the PNGs held in memory until they are written.
+constexpr static const size_t kPngsInFlightPerJob = 4u;
+
+struct CompileJob;
+struct CrunchedPng;
+
+// The PNGs with the same extension and size, which are the only ones that can be identical.
+struct SameSizePngs {
+  // How many of them are not read yet.
+  size_t unread = 0;
+
+  // The distinct PNGs read so far, which later ones are compared with. They are kept, along with
+  // their contents, until all of them are read.
+  std::vector<std::pair<const CompileJob*, std::shared_ptr<CrunchedPng>>> distinct;
+};
+
+// A PNG that is crunched ahead of time, off the thread that writes the archive.
+struct CrunchedPng {
+  bool readable = false;
+
+  // The contents of the file, which is only read once. They are dropped once crunched, unless a
+  // later PNG may be identical to this one.
+  std::string content;
+  size_t content_hash = 0;
+
+  // Set if other PNGs have the same extension and size as this one.
+  SameSizePngs* same_size = nullptr;
+
+  // An earlier PNG with identical contents, whose crunched output is reused instead.
+  std::shared_ptr<CrunchedPng> duplicate_of;
+
+  // Set when the crunched output was found in the InputCache, and the file isn't read.
+  std::shared_ptr<std::string> cached;
+
+  // The stamp of the file, if the crunched output may be cached.
+  InputCache::Inputs inputs;
+
+  bool success = false;
+  BigBuffer buffer{4096};
+  BufferedDiagnostics diagnostics;
+};
+
+struct CompileJob {
+  ResourcePathData* path_data;
+  CompileFunc compile_func;
+  std::string output_path;
+
+  // Set for PNGs that are crunched ahead of time, until the PNG is written.
+  std::shared_ptr<CrunchedPng> png;
+};
+
+// Prepares every PNG in `png_jobs` to be crunched by CrunchPngs(). In a long running process,
+// PNGs whose crunched output is in the InputCache are not read at all. The other PNGs are grouped
+// in `same_size_pngs` by extension and size, without reading them, since only PNGs of the same
+// group can be identical. 9-patches have their borders stripped, so they only match other
+// 9-patches.
+static void PreparePngs(const CompileOptions& options, const std::vector<CompileJob*>& png_jobs,
+                        std::map<std::pair<std::string, uint64_t>, SameSizePngs>* same_size_pngs) {
+  InputCache* cache = InputCache::Get();
+  std::vector<Maybe<uint64_t>> sizes(png_jobs.size());
+  util::ParallelFor(png_jobs.size(), options.max_jobs, [&](size_t i) {
+    CrunchedPng* png = png_jobs[i]->png.get();
+    const Source& source = png_jobs[i]->path_data->source;
+    if (cache->IsEnabled() && InputCache::StampInputs({source.path}, &png->inputs)) {
+      png->cached =
+          cache->Find<std::string>(InputCache::Kind::kCrunchedPng, source.path, png->inputs);
+      if (png->cached != nullptr) {
+        png->readable = true;
+        return;
+      }
+      sizes[i] = png->inputs.front().second.size;
+    } else if (Maybe<file::FileStamp> stamp = file::GetFileStamp(source.path)) {
+      sizes[i] = stamp.value().size;
+    }
+  });
+
+  for (size_t i = 0; i < png_jobs.size(); i++) {
+    if (sizes[i]) {
+      (*same_size_pngs)[std::make_pair(png_jobs[i]->path_data->extension, sizes[i].value())]
+          .unread++;
+    }
+  }
+  for (size_t i = 0; i < png_jobs.size(); i++) {
+    if (sizes[i]) {
+      SameSizePngs* same_size = &same_size_pngs->at(
+          std::make_pair(png_jobs[i]->path_data->extension, sizes[i].value()));
+      if (same_size->unread > 1u) {
+        png_jobs[i]->png->same_size = same_size;
+      }
+    }
+  }
+}
+
+// Reads and crunches the `count` PNGs at `jobs`, prepared by PreparePngs(), on a pool of threads.
+// Each file is read once. A PNG identical to an earlier one isn't crunched, and reuses the output
+// of the earlier one instead. The output of crunching an unchanged file is put in the InputCache.
+// Diagnostics are buffered per file so that they can be reported in input order.
+static void CrunchPngs(IAaptContext* context, const CompileOptions& options, CompileJob** jobs,
+                       size_t count) {
+  util::ParallelFor(count, options.max_jobs, [&](size_t i) {
+    CrunchedPng* png = jobs[i]->png.get();
+    if (png->cached != nullptr) {
+      return;
+    }
+
+    CompileContext job_context(&png->diagnostics);
+    job_context.SetVerbose(context->IsVerbose());
+    png->readable = ReadPngFile(&job_context, *jobs[i]->path_data, &png->content);
+    if (png->readable && png->same_size != nullptr) {
+      png->content_hash = std::hash<std::string>()(png->content);
+    }
+  });
+
+  // Looks for identical PNGs in input order, so that the first of them is the one crunched.
+  for (size_t i = 0; i < count; i++) {
+    const std::shared_ptr<CrunchedPng>& png = jobs[i]->png;
+    SameSizePngs* same_size = png->same_size;
+    if (same_size == nullptr) {
+      continue;
+    }
+
+    if (png->readable) {
+      for (const auto& other : same_size->distinct) {
+        if (other.second->content_hash == png->content_hash &&
+            other.second->content == png->content) {
+          png->duplicate_of = other.second;
+          std::string().swap(png->content);
+          if (context->IsVerbose()) {
+            png->diagnostics.Note(DiagMessage(jobs[i]->path_data->source)
+                                  << "identical to " << other.first->path_data->source
+                                  << ", reusing crunched PNG");
+          }
+          break;
+        }
+      }
+      if (png->duplicate_of == nullptr) {
+        same_size->distinct.push_back(std::make_pair(jobs[i], png));
+      }
+    }
+
+    if (--same_size->unread == 0u) {
+      same_size->distinct.clear();
+    }
+  }
+
+  InputCache* cache = InputCache::Get();
+  util::ParallelFor(count, options.max_jobs, [&](size_t i) {
+    const CompileJob* job = jobs[i];
+    CrunchedPng* png = job->png.get();
+    if (!png->readable || png->duplicate_of != nullptr) {
+      return;
+    }
+
+    if (png->cached != nullptr) {
+      memcpy(png->buffer.NextBlock<uint8_t>(png->cached->size()), png->cached->data(),
+             png->cached->size());
+      png->cached = {};
+      png->success = true;
+      if (context->IsVerbose()) {
+        png->diagnostics.Note(DiagMessage(job->path_data->source) << "using cached crunched PNG");
+      }
+      return;
+    }
+
+    CompileContext job_context(&png->diagnostics);
+    job_context.SetVerbose(context->IsVerbose());
+    if (job_context.IsVerbose()) {
+      png->diagnostics.Note(DiagMessage(job->path_data->source) << "compiling PNG");
+    }
+    png->success = CrunchPng(&job_context, *job->path_data, png->content, &png->buffer);
+    if (png->same_size == nullptr || png->same_size->unread == 0u) {
+      std::string().swap(png->content);
+    }
+
+    // PNGs that had anything to report are crunched again, so that the report is repeated.
+    if (png->success && !png->inputs.empty() && png->diagnostics.empty()) {
+      auto crunched = std::make_shared<std::string>(png->buffer.to_string());
+      const size_t size = crunched->size();
+      cache->Insert(InputCache::Kind::kCrunchedPng, job->path_data->source.path,
+                    std::move(png->inputs), std::move(crunched), size);
+    }
+  });
+}
+
 // Entry point for compilation phase. Parses arguments and dispatches to the correct steps.
 int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
   CompileContext context(diagnostics);
   CompileOptions options;
 
   bool verbose = false;
+  Maybe<std::string> jobs;
   Flags flags =
       Flags()
           .RequiredFlag("-o", "Output path", &options.output_path)
@@ -715,11 +993,25 @@ int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
           .OptionalSwitch("--no-crunch", "Disables PNG processing", &options.no_png_crunch)
           .OptionalSwitch("--legacy", "Treat errors that used to be valid in AAPT as warnings",
                           &options.legacy_mode)
+          .OptionalFlag("-j",
+                        "Maximum number of PNGs to crunch concurrently. Defaults to the\n"
+                        "number of CPU cores.",
+                        &jobs)
           .OptionalSwitch("-v", "Enables verbose logging", &verbose);
   if (!flags.Parse("aapt2 compile", args, &std::cerr)) {
     return 1;
   }
 
+  if (jobs) {
+    Maybe<uint32_t> max_jobs = ResourceUtils::ParseInt(jobs.value());
+    if (!max_jobs || max_jobs.value() == 0) {
+      context.GetDiagnostics()->Error(DiagMessage() << "-j value '" << jobs.value()
+                                                    << "' is not a positive integer");
+      return 1;
+    }
+    options.max_jobs = max_jobs.value();
+  }
+
   context.SetVerbose(verbose);
 
   std::unique_ptr<IArchiveWriter> archive_writer;
@@ -761,6 +1053,7 @@ int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
   }
 
   bool error = false;
+  std::vector<CompileJob> jobs_to_run;
   for (ResourcePathData& path_data : input_data) {
     if (options.verbose) {
       context.GetDiagnostics()->Note(DiagMessage(path_data.source) << "processing");
@@ -772,7 +1065,7 @@ int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
     }
 
     // Determine how to compile the file based on its type.
-    auto compile_func = &CompileFile;
+    CompileFunc compile_func = &CompileFile;
     if (path_data.resource_dir == "values" && path_data.extension == "xml") {
       compile_func = &CompileTable;
       // We use a different extension (not necessary anymore, but avoids altering the existing
@@ -806,9 +1099,55 @@ int Compile(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
       continue;
     }
 
+    jobs_to_run.push_back(
+        CompileJob{&path_data, compile_func, BuildIntermediateContainerFilename(path_data), {}});
+  }
+
+  std::vector<CompileJob*> png_jobs;
+  for (CompileJob& job : jobs_to_run) {
+    if (job.compile_func == &CompilePng) {
+      job.png = std::make_shared<CrunchedPng>();
+      png_jobs.push_back(&job);
+    }
+  }
+  std::map<std::pair<std::string, uint64_t>, SameSizePngs> same_size_pngs;
+  PreparePngs(options, png_jobs, &same_size_pngs);
+
+  // Crunching PNGs dominates compile time, so it is done on multiple threads, a window of PNGs at
+  // a time. The archive is still written from this thread, in input order, and the PNGs are freed
+  // once written, unless a later PNG may be identical to them.
+  const size_t png_window =
+      kPngsInFlightPerJob *
+      (options.max_jobs != 0 ? options.max_jobs : util::GetDefaultJobCount());
+  size_t pngs_crunched = 0;
+  size_t pngs_written = 0;
+
+  for (CompileJob& job : jobs_to_run) {
     // Compile the file.
-    const std::string out_path = BuildIntermediateContainerFilename(path_data);
-    error |= !compile_func(&context, options, path_data, archive_writer.get(), out_path);
+    if (job.png != nullptr) {
+      if (pngs_written == pngs_crunched) {
+        const size_t count = std::min(png_window, png_jobs.size() - pngs_crunched);
+        CrunchPngs(&context, options, png_jobs.data() + pngs_crunched, count);
+        pngs_crunched += count;
+      }
+      pngs_written++;
+
+      CrunchedPng* png = job.png.get();
+      png->diagnostics.FlushTo(context.GetDiagnostics());
+      const CrunchedPng* original = png->duplicate_of != nullptr ? png->duplicate_of.get() : png;
+      if (!png->readable || !original->success) {
+        error = true;
+      } else {
+        error |= !WriteCrunchedPng(&context, *job.path_data, &original->buffer,
+                                   archive_writer.get(), job.output_path);
+      }
+
+      // The crunched output lives on while a later PNG may reuse it.
+      job.png.reset();
+    } else {
+      error |= !job.compile_func(&context, options, *job.path_data, archive_writer.get(),
+                                 job.output_path);
+    }
   }
   return error ? 1 : 0;
 }
@@ -17,9 +17,15 @@
 #include "Compile.h"
 
 #include "android-base/file.h"
+#include "android-base/stringprintf.h"
+#include "android-base/test_utils.h"
 #include "io/StringStream.h"
+#include "io/ZipArchive.h"
 #include "java/AnnotationProcessor.h"
 #include "test/Test.h"
+#include "util/Files.h"
+
+using ::android::base::StringPrintf;
 
 namespace aapt {
 
@@ -93,4 +99,71 @@ TEST(CompilerTest, MultiplePeriods) {
   ASSERT_EQ(remove(path5_out.c_str()), 0);
 }
 
+
+// 1x1 PNGs of two different colors.
+static const uint8_t kRedPng[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48,
+    0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00,
+    0x00, 0x1f, 0x15, 0xc4, 0x89, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x44, 0x41, 0x54, 0x78,
+    0x9c, 0x63, 0xf8, 0xcf, 0xc0, 0xf0, 0x1f, 0x00, 0x05, 0x00, 0x01, 0xff, 0x89, 0x99,
+    0x3d, 0x1d, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82};
+static const uint8_t kBluePng[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x48,
+    0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00,
+    0x00, 0x1f, 0x15, 0xc4, 0x89, 0x00, 0x00, 0x00, 0x0d, 0x49, 0x44, 0x41, 0x54, 0x78,
+    0x9c, 0x63, 0x60, 0x60, 0xf8, 0xff, 0x1f, 0x00, 0x03, 0x02, 0x01, 0xff, 0xe6, 0x77,
+    0x0b, 0xae, 0x00, 0x00, 0x00, 0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82};
+
+TEST(CompilerTest, CrunchPngsInWindowsAndReuseIdenticalOnes) {
+  StdErrDiagnostics diag;
+  TemporaryDir dir;
+  std::string res_dir = dir.path;
+  file::AppendPath(&res_dir, "res");
+  std::string drawable_dir = res_dir;
+  file::AppendPath(&drawable_dir, "drawable");
+  ASSERT_TRUE(file::mkdirs(drawable_dir));
+
+  // More PNGs than are crunched at a time with one job, so that identical PNGs are in different
+  // windows.
+  const int png_count = 10;
+  for (int i = 0; i < png_count; i++) {
+    std::string path = drawable_dir;
+    file::AppendPath(&path, StringPrintf("icon_%d.png", i));
+    const std::string content =
+        i % 3 == 0 ? std::string(reinterpret_cast<const char*>(kBluePng), sizeof(kBluePng))
+                   : std::string(reinterpret_cast<const char*>(kRedPng), sizeof(kRedPng));
+    ASSERT_TRUE(android::base::WriteStringToFile(content, path));
+  }
+
+  std::vector<std::unique_ptr<io::ZipFileCollection>> outputs;
+  for (const char* jobs : {"1", "3"}) {
+    std::string output_path = dir.path;
+    file::AppendPath(&output_path, StringPrintf("out_%s.zip", jobs));
+    ASSERT_EQ(0, Compile({"--dir", res_dir, "-o", output_path, "-j", jobs}, &diag));
+
+    std::string error;
+    outputs.push_back(io::ZipFileCollection::Create(output_path, &error));
+    ASSERT_NE(nullptr, outputs.back()) << error;
+  }
+
+  // The output doesn't depend on how the PNGs were spread across threads.
+  for (int i = 0; i < png_count; i++) {
+    const std::string name = StringPrintf("drawable_icon_%d.png.flat", i);
+    std::vector<std::string> contents;
+    for (const auto& output : outputs) {
+      io::IFile* file = output->FindFile(name);
+      ASSERT_NE(nullptr, file) << name;
+      std::unique_ptr<io::IData> data = file->OpenAsData();
+      ASSERT_NE(nullptr, data) << name;
+      contents.push_back(std::string(reinterpret_cast<const char*>(data->data()), data->size()));
+    }
+    EXPECT_EQ(contents[0], contents[1]) << name;
+  }
+
+  // Like the other invalid options, an invalid -j is reported and fails the compilation.
+  std::string output_path = dir.path;
+  file::AppendPath(&output_path, "out_invalid.zip");
+  EXPECT_NE(0, Compile({"--dir", res_dir, "-o", output_path, "-j", "0"}, &diag));
+  EXPECT_NE(0, Compile({"--dir", res_dir, "-o", output_path, "-j", "many"}, &diag));
+}
 }
\ No newline at end of file
@@ -18,6 +18,7 @@
 
 #include "android-base/macros.h"
 #include "androidfw/StringPiece.h"
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 #include "Flags.h"
 #include "LoadedApk.h"
@@ -225,10 +226,32 @@ class ProtoApkSerializer : public IApkSerializer {
   }
 
   bool SerializeTable(ResourceTable* table, IArchiveWriter* writer) override {
-    pb::ResourceTable pb_table;
-    SerializeTableToPb(*table, &pb_table, context_->GetDiagnostics());
-    return io::CopyProtoToArchive(context_, &pb_table, kProtoResourceTablePath,
-                                  ArchiveEntry::kCompress, writer);
+    // Stream the table into the archive, so that the protobuf form of the whole table, which is
+    // several times larger than the table itself, is never held in memory.
+    if (!writer->StartEntry(kProtoResourceTablePath, ArchiveEntry::kCompress)) {
+      context_->GetDiagnostics()->Error(DiagMessage() << "failed to write "
+                                        << kProtoResourceTablePath << " to archive: "
+                                        << writer->GetError());
+      return false;
+    }
+
+    // Make sure CopyingOutputStreamAdaptor is deleted before we call writer->FinishEntry().
+    {
+      ::google::protobuf::io::CopyingOutputStreamAdaptor adaptor(writer);
+      if (!SerializeTableToPbStream(*table, &adaptor, context_->GetDiagnostics())) {
+        context_->GetDiagnostics()->Error(DiagMessage() << "failed to write "
+                                          << kProtoResourceTablePath << " to archive");
+        return false;
+      }
+    }
+
+    if (!writer->FinishEntry()) {
+      context_->GetDiagnostics()->Error(DiagMessage() << "failed to write "
+                                        << kProtoResourceTablePath << " to archive: "
+                                        << writer->GetError());
+      return false;
+    }
+    return true;
   }
 
   bool SerializeFile(FileReference* file, IArchiveWriter* writer) override {
@@ -367,7 +390,7 @@ int Convert(const vector<StringPiece>& args) {
   context.package_ = app_info.value().package;
 
   unique_ptr<IArchiveWriter> writer =
-      CreateZipFileArchiveWriter(context.GetDiagnostics(), output_path);
+      CreateParallelZipFileArchiveWriter(context.GetDiagnostics(), output_path);
   if (writer == nullptr) {
     return 1;
   }
@@ -385,7 +408,16 @@ int Convert(const vector<StringPiece>& args) {
   }
 
 
-  return ConvertApk(&context, std::move(apk), serializer.get(), writer.get()) ? 0 : 1;
+  if (!ConvertApk(&context, std::move(apk), serializer.get(), writer.get())) {
+    return 1;
+  }
+
+  if (!writer->Finish()) {
+    context.GetDiagnostics()->Error(DiagMessage(output_path)
+                                    << "failed to write archive: " << writer->GetError());
+    return 1;
+  }
+  return 0;
 }
 
 }  // namespace aapt
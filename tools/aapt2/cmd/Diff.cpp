@@ -14,13 +14,21 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+
 #include "android-base/macros.h"
 
+#include "Diagnostics.h"
 #include "Flags.h"
 #include "LoadedApk.h"
+#include "ResourceUtils.h"
 #include "ValueVisitor.h"
 #include "process/IResourceTableConsumer.h"
 #include "process/SymbolTable.h"
+#include "util/Parallel.h"
 
 using ::android::StringPiece;
 
@@ -71,8 +79,9 @@ class DiffContext : public IAaptContext {
   SymbolTable symbol_table_;
 };
 
-static void EmitDiffLine(const Source& source, const StringPiece& message) {
-  std::cerr << source << ": " << message << "\n";
+static void EmitDiffLine(const Source& source, const StringPiece& message,
+                         std::ostream* out = &std::cerr) {
+  *out << source << ": " << message << "\n";
 }
 
 static bool IsSymbolVisibilityDifferent(const Visibility& vis_a, const Visibility& vis_b) {
@@ -93,7 +102,7 @@ static bool EmitResourceConfigValueDiff(IAaptContext* context, LoadedApk* apk_a,
                                         ResourceEntry* entry_a, ResourceConfigValue* config_value_a,
                                         LoadedApk* apk_b, ResourceTablePackage* pkg_b,
                                         ResourceTableType* type_b, ResourceEntry* entry_b,
-                                        ResourceConfigValue* config_value_b) {
+                                        ResourceConfigValue* config_value_b, std::ostream* out) {
   Value* value_a = config_value_a->value.get();
   Value* value_b = config_value_b->value.get();
   if (!value_a->Equals(value_b)) {
@@ -103,7 +112,7 @@ static bool EmitResourceConfigValueDiff(IAaptContext* context, LoadedApk* apk_a,
     value_a->Print(&str_stream);
     str_stream << "\n vs \n";
     value_b->Print(&str_stream);
-    EmitDiffLine(apk_b->GetSource(), str_stream.str());
+    EmitDiffLine(apk_b->GetSource(), str_stream.str(), out);
     return true;
   }
   return false;
@@ -113,7 +122,7 @@ static bool EmitResourceEntryDiff(IAaptContext* context, LoadedApk* apk_a,
                                   ResourceTablePackage* pkg_a, ResourceTableType* type_a,
                                   ResourceEntry* entry_a, LoadedApk* apk_b,
                                   ResourceTablePackage* pkg_b, ResourceTableType* type_b,
-                                  ResourceEntry* entry_b) {
+                                  ResourceEntry* entry_b, std::ostream* out) {
   bool diff = false;
   for (std::unique_ptr<ResourceConfigValue>& config_value_a : entry_a->values) {
     ResourceConfigValue* config_value_b = entry_b->FindValue(config_value_a->config);
@@ -121,12 +130,12 @@ static bool EmitResourceEntryDiff(IAaptContext* context, LoadedApk* apk_a,
       std::stringstream str_stream;
       str_stream << "missing " << pkg_a->name << ":" << type_a->type << "/" << entry_a->name
                  << " config=" << config_value_a->config;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
+      EmitDiffLine(apk_b->GetSource(), str_stream.str(), out);
       diff = true;
     } else {
       diff |=
           EmitResourceConfigValueDiff(context, apk_a, pkg_a, type_a, entry_a, config_value_a.get(),
-                                      apk_b, pkg_b, type_b, entry_b, config_value_b);
+                                      apk_b, pkg_b, type_b, entry_b, config_value_b, out);
     }
   }
 
@@ -137,24 +146,28 @@ static bool EmitResourceEntryDiff(IAaptContext* context, LoadedApk* apk_a,
       std::stringstream str_stream;
       str_stream << "new config " << pkg_b->name << ":" << type_b->type << "/" << entry_b->name
                  << " config=" << config_value_b->config;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
+      EmitDiffLine(apk_b->GetSource(), str_stream.str(), out);
       diff = true;
     }
   }
   return false;
 }
 
-static bool EmitResourceTypeDiff(IAaptContext* context, LoadedApk* apk_a,
-                                 ResourceTablePackage* pkg_a, ResourceTableType* type_a,
-                                 LoadedApk* apk_b, ResourceTablePackage* pkg_b,
-                                 ResourceTableType* type_b) {
+// Compares the entries in [begin, end) of `type_a` against `type_b`, writing the differences to
+// `out`.
+static bool EmitResourceEntriesDiff(IAaptContext* context, LoadedApk* apk_a,
+                                    ResourceTablePackage* pkg_a, ResourceTableType* type_a,
+                                    size_t begin, size_t end, LoadedApk* apk_b,
+                                    ResourceTablePackage* pkg_b, ResourceTableType* type_b,
+                                    std::ostream* out) {
   bool diff = false;
-  for (std::unique_ptr<ResourceEntry>& entry_a : type_a->entries) {
+  for (size_t i = begin; i < end; i++) {
+    std::unique_ptr<ResourceEntry>& entry_a = type_a->entries[i];
     ResourceEntry* entry_b = type_b->FindEntry(entry_a->name);
     if (!entry_b) {
       std::stringstream str_stream;
       str_stream << "missing " << pkg_a->name << ":" << type_a->type << "/" << entry_a->name;
-      EmitDiffLine(apk_b->GetSource(), str_stream.str());
+      EmitDiffLine(apk_b->GetSource(), str_stream.str(), out);
       diff = true;
     } else {
       if (IsSymbolVisibilityDifferent(entry_a->visibility, entry_b->visibility)) {
@@ -173,7 +186,7 @@ static bool EmitResourceTypeDiff(IAaptContext* context, LoadedApk* apk_a,
           str_stream << "PRIVATE";
         }
         str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
+        EmitDiffLine(apk_b->GetSource(), str_stream.str(), out);
         diff = true;
       } else if (IsIdDiff(entry_a->visibility.level, entry_a->id, entry_b->visibility.level,
                           entry_b->id)) {
@@ -192,13 +205,41 @@ static bool EmitResourceTypeDiff(IAaptContext* context, LoadedApk* apk_a,
           str_stream << "none";
         }
         str_stream << ")";
-        EmitDiffLine(apk_b->GetSource(), str_stream.str());
+        EmitDiffLine(apk_b->GetSource(), str_stream.str(), out);
         diff = true;
       }
       diff |= EmitResourceEntryDiff(context, apk_a, pkg_a, type_a, entry_a.get(), apk_b, pkg_b,
-                                    type_b, entry_b);
+                                    type_b, entry_b, out);
     }
   }
+  return diff;
+}
+
+static bool EmitResourceTypeDiff(IAaptContext* context, LoadedApk* apk_a,
+                                 ResourceTablePackage* pkg_a, ResourceTableType* type_a,
+                                 LoadedApk* apk_b, ResourceTablePackage* pkg_b,
+                                 ResourceTableType* type_b, size_t max_jobs) {
+  // Comparing values dominates for large tables, so the entries are compared in parallel in chunks
+  // that each write to their own buffer. The buffers are printed in order afterwards, so the output
+  // doesn't depend on the number of threads.
+  constexpr size_t kEntriesPerChunk = 256u;
+  const size_t entry_count = type_a->entries.size();
+  const size_t chunk_count = (entry_count + kEntriesPerChunk - 1) / kEntriesPerChunk;
+
+  std::vector<std::stringstream> chunk_outs(chunk_count);
+  std::unique_ptr<bool[]> chunk_diffs(new bool[chunk_count]());
+  util::ParallelFor(chunk_count, max_jobs, [&](size_t chunk) {
+    const size_t begin = chunk * kEntriesPerChunk;
+    const size_t end = std::min(begin + kEntriesPerChunk, entry_count);
+    chunk_diffs[chunk] = EmitResourceEntriesDiff(context, apk_a, pkg_a, type_a, begin, end, apk_b,
+                                                 pkg_b, type_b, &chunk_outs[chunk]);
+  });
+
+  bool diff = false;
+  for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+    std::cerr << chunk_outs[chunk].str();
+    diff |= chunk_diffs[chunk];
+  }
 
   // Check for any newly added entries.
   for (std::unique_ptr<ResourceEntry>& entry_b : type_b->entries) {
@@ -215,7 +256,7 @@ static bool EmitResourceTypeDiff(IAaptContext* context, LoadedApk* apk_a,
 
 static bool EmitResourcePackageDiff(IAaptContext* context, LoadedApk* apk_a,
                                     ResourceTablePackage* pkg_a, LoadedApk* apk_b,
-                                    ResourceTablePackage* pkg_b) {
+                                    ResourceTablePackage* pkg_b, size_t max_jobs) {
   bool diff = false;
   for (std::unique_ptr<ResourceTableType>& type_a : pkg_a->types) {
     ResourceTableType* type_b = pkg_b->FindType(type_a->type);
@@ -261,7 +302,8 @@ static bool EmitResourcePackageDiff(IAaptContext* context, LoadedApk* apk_a,
         EmitDiffLine(apk_b->GetSource(), str_stream.str());
         diff = true;
       }
-      diff |= EmitResourceTypeDiff(context, apk_a, pkg_a, type_a.get(), apk_b, pkg_b, type_b);
+      diff |= EmitResourceTypeDiff(context, apk_a, pkg_a, type_a.get(), apk_b, pkg_b, type_b,
+                                   max_jobs);
     }
   }
 
@@ -278,7 +320,8 @@ static bool EmitResourcePackageDiff(IAaptContext* context, LoadedApk* apk_a,
   return diff;
 }
 
-static bool EmitResourceTableDiff(IAaptContext* context, LoadedApk* apk_a, LoadedApk* apk_b) {
+static bool EmitResourceTableDiff(IAaptContext* context, LoadedApk* apk_a, LoadedApk* apk_b,
+                                  size_t max_jobs) {
   ResourceTable* table_a = apk_a->GetResourceTable();
   ResourceTable* table_b = apk_b->GetResourceTable();
 
@@ -309,7 +352,7 @@ static bool EmitResourceTableDiff(IAaptContext* context, LoadedApk* apk_a, Loade
         EmitDiffLine(apk_b->GetSource(), str_stream.str());
         diff = true;
       }
-      diff |= EmitResourcePackageDiff(context, apk_a, pkg_a.get(), apk_b, pkg_b);
+      diff |= EmitResourcePackageDiff(context, apk_a, pkg_a.get(), apk_b, pkg_b, max_jobs);
     }
   }
 
@@ -347,29 +390,52 @@ static void ZeroOutAppReferences(ResourceTable* table) {
 int Diff(const std::vector<StringPiece>& args) {
   DiffContext context;
 
-  Flags flags;
+  Maybe<std::string> jobs;
+  Flags flags = Flags().OptionalFlag(
+      "-j",
+      "Maximum number of threads to use for loading and comparing the APKs.\n"
+      "Defaults to the number of CPU cores.",
+      &jobs);
   if (!flags.Parse("aapt2 diff", args, &std::cerr)) {
     return 1;
   }
 
+  size_t max_jobs = 0u;
+  if (jobs) {
+    Maybe<uint32_t> parsed_jobs = ResourceUtils::ParseInt(jobs.value());
+    if (!parsed_jobs || parsed_jobs.value() == 0) {
+      std::cerr << "-j must be a positive integer.\n\n";
+      flags.Usage("aapt2 diff", &std::cerr);
+      return 1;
+    }
+    max_jobs = parsed_jobs.value();
+  }
+
   if (flags.GetArgs().size() != 2u) {
     std::cerr << "must have two apks as arguments.\n\n";
     flags.Usage("aapt2 diff", &std::cerr);
     return 1;
   }
 
-  IDiagnostics* diag = context.GetDiagnostics();
-  std::unique_ptr<LoadedApk> apk_a = LoadedApk::LoadApkFromPath(flags.GetArgs()[0], diag);
-  std::unique_ptr<LoadedApk> apk_b = LoadedApk::LoadApkFromPath(flags.GetArgs()[1], diag);
-  if (!apk_a || !apk_b) {
-    return 1;
+  // Load both APKs at the same time, and zero out Application IDs in their references.
+  std::unique_ptr<LoadedApk> apks[2];
+  std::vector<BufferedDiagnostics> load_diags(2u);
+  util::ParallelFor(2u, max_jobs, [&](size_t i) {
+    apks[i] = LoadedApk::LoadApkFromPath(flags.GetArgs()[i], &load_diags[i]);
+    if (apks[i]) {
+      ZeroOutAppReferences(apks[i]->GetResourceTable());
+    }
+  });
+
+  for (BufferedDiagnostics& load_diag : load_diags) {
+    load_diag.FlushTo(context.GetDiagnostics());
   }
 
-  // Zero out Application IDs in references.
-  ZeroOutAppReferences(apk_a->GetResourceTable());
-  ZeroOutAppReferences(apk_b->GetResourceTable());
+  if (!apks[0] || !apks[1]) {
+    return 1;
+  }
 
-  if (EmitResourceTableDiff(&context, apk_a.get(), apk_b.get())) {
+  if (EmitResourceTableDiff(&context, apks[0].get(), apks[1].get(), max_jobs)) {
     // We emitted a diff, so return 1 (failure).
     return 1;
   }
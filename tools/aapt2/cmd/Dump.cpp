@@ -14,10 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cinttypes>
 #include <vector>
 
 #include "android-base/stringprintf.h"
+#include "androidfw/ResourceUtils.h"
 #include "androidfw/StringPiece.h"
 
 #include "Debug.h"
@@ -27,6 +29,7 @@
 #include "format/binary/BinaryResourceParser.h"
 #include "format/proto/ProtoDeserialize.h"
 #include "io/FileStream.h"
+#include "io/FileSystem.h"
 #include "io/ZipArchive.h"
 #include "process/IResourceTableConsumer.h"
 #include "text/Printer.h"
@@ -43,8 +46,71 @@ struct DumpOptions {
 
   // The path to a file within an APK to dump.
   Maybe<std::string> file_to_dump_path;
+
+  // The resources to dump from a resource table.
+  BinaryResourceFilter filter;
 };
 
+// Parses a resource filter of the form [package:]type[/entry].
+static bool ParseResourceFilter(const StringPiece& str, BinaryResourceFilter* out_filter) {
+  StringPiece package;
+  StringPiece type;
+  StringPiece entry;
+  if (str.empty() || !android::ExtractResourceName(str, &package, &type, &entry)) {
+    return false;
+  }
+
+  if (type.empty()) {
+    // There was no entry, so what was parsed as the entry is the type.
+    std::swap(type, entry);
+  }
+
+  const ResourceType* parsed_type = ParseResourceType(type);
+  if (parsed_type == nullptr) {
+    return false;
+  }
+
+  out_filter->type = *parsed_type;
+  if (!package.empty()) {
+    out_filter->package = package.to_string();
+  }
+  if (!entry.empty()) {
+    out_filter->entry = entry.to_string();
+  }
+  return true;
+}
+
+// Removes the resources that `filter` does not select from `table`. This is for tables that can
+// only be read whole, and are filtered after the fact.
+static void FilterTable(const BinaryResourceFilter& filter, ResourceTable* table) {
+  auto& packages = table->packages;
+  for (auto& package : packages) {
+    if (filter.package && filter.package.value() != package->name) {
+      package.reset();
+      continue;
+    }
+
+    for (auto& type : package->types) {
+      if (filter.type && filter.type.value() != type->type) {
+        type.reset();
+        continue;
+      }
+
+      if (filter.entry) {
+        auto& entries = type->entries;
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [&](const std::unique_ptr<ResourceEntry>& entry) -> bool {
+                                       return entry->name != filter.entry.value();
+                                     }),
+                      entries.end());
+      }
+    }
+    package->types.erase(std::remove(package->types.begin(), package->types.end(), nullptr),
+                         package->types.end());
+  }
+  packages.erase(std::remove(packages.begin(), packages.end(), nullptr), packages.end());
+}
+
 static const char* ResourceFileTypeToString(const ResourceFile::Type& type) {
   switch (type) {
     case ResourceFile::Type::kPng:
@@ -152,6 +218,7 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
                                          << "failed to parse table: " << err);
         return false;
       }
+      FilterTable(options.filter, &table);
     } else if (io::IFile* file = zip->FindFile("resources.arsc")) {
       std::unique_ptr<io::IData> data = file->OpenAsData();
       if (!data) {
@@ -161,6 +228,7 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
 
       BinaryResourceParser parser(context->GetDiagnostics(), &table, Source(file_path),
                                   data->data(), data->size());
+      parser.SetFilter(options.filter);
       if (!parser.Parse()) {
         return false;
       }
@@ -188,15 +256,16 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
 
   err.clear();
 
-  io::FileInputStream input(file_path);
-  if (input.HadError()) {
-    context->GetDiagnostics()->Error(DiagMessage(file_path)
-                                     << "failed to open file: " << input.GetError());
+  // Map the file so that the container can be parsed in place.
+  io::RegularFile container_file{Source(file_path)};
+  std::unique_ptr<io::IData> data = container_file.OpenAsData();
+  if (data == nullptr) {
+    context->GetDiagnostics()->Error(DiagMessage(file_path) << "failed to open file");
     return false;
   }
 
   // Try as a compiled file.
-  ContainerReader reader(&input);
+  ContainerReader reader(data.get());
   if (reader.HadError()) {
     context->GetDiagnostics()->Error(DiagMessage(file_path)
                                      << "failed to read container: " << reader.GetError());
@@ -223,6 +292,7 @@ static bool TryDumpFile(IAaptContext* context, const std::string& file_path,
                                          << "failed to parse table: " << err);
         continue;
       }
+      FilterTable(options.filter, &table);
 
       printer.Indent();
       Debug::PrintTable(table, options.print_options, &printer);
@@ -309,6 +379,7 @@ class DumpContext : public IAaptContext {
 int Dump(const std::vector<StringPiece>& args) {
   bool verbose = false;
   bool no_values = false;
+  Maybe<std::string> resource;
   DumpOptions options;
   Flags flags = Flags()
                     .OptionalSwitch("--no-values",
@@ -316,6 +387,11 @@ int Dump(const std::vector<StringPiece>& args) {
                                     &no_values)
                     .OptionalFlag("--file", "Dumps the specified file from the APK passed as arg.",
                                   &options.file_to_dump_path)
+                    .OptionalFlag("--resource",
+                                  "Only dumps the resources matching [package:]type[/entry].\n"
+                                  "Other resources in a binary table are skipped without\n"
+                                  "decoding them.",
+                                  &resource)
                     .OptionalSwitch("-v", "increase verbosity of output", &verbose);
   if (!flags.Parse("aapt2 dump", args, &std::cerr)) {
     return 1;
@@ -324,6 +400,12 @@ int Dump(const std::vector<StringPiece>& args) {
   DumpContext context;
   context.SetVerbose(verbose);
 
+  if (resource && !ParseResourceFilter(resource.value(), &options.filter)) {
+    context.GetDiagnostics()->Error(DiagMessage() << "invalid resource '" << resource.value()
+                                                  << "', expected [package:]type[/entry]");
+    return 1;
+  }
+
   options.print_options.show_sources = true;
   options.print_options.show_values = !no_values;
   for (const std::string& arg : flags.GetArgs()) {
@@ -15,6 +15,7 @@
  */
 
 #include <sys/stat.h>
+#include <unistd.h>
 #include <cinttypes>
 
 #include <queue>
@@ -48,6 +49,7 @@
 #include "io/BigBufferStream.h"
 #include "io/FileStream.h"
 #include "io/FileSystem.h"
+#include "io/StringStream.h"
 #include "io/Util.h"
 #include "io/ZipArchive.h"
 #include "java/JavaClassGenerator.h"
@@ -62,9 +64,11 @@
 #include "optimize/ResourceDeduper.h"
 #include "optimize/VersionCollapser.h"
 #include "process/IResourceTableConsumer.h"
+#include "process/SymbolIndex.h"
 #include "process/SymbolTable.h"
 #include "split/TableSplitter.h"
 #include "util/Files.h"
+#include "util/InputCache.h"
 #include "xml/XmlDom.h"
 
 using ::aapt::io::FileInputStream;
@@ -82,6 +86,7 @@ struct LinkOptions {
   std::string output_path;
   std::string manifest_path;
   std::vector<std::string> include_paths;
+  Maybe<std::string> include_symbol_cache_dir;
   std::vector<std::string> overlay_files;
   std::vector<std::string> assets_dirs;
   bool output_to_directory = false;
@@ -771,6 +776,78 @@ static int32_t FindFrameworkAssetManagerCookie(const android::AssetManager& asse
   return table.getTableCookie(idx);
 }
 
+// The entries of a compiled resource container (.flat or .apc file), kept in the InputCache so
+// that later links in the same process don't read the container again.
+struct CompiledContainer {
+  struct Entry {
+    // Set for a kResTable entry. Otherwise the entry is a kResFile.
+    std::unique_ptr<ResourceTable> table;
+
+    ResourceFile file;
+    off64_t offset = 0;
+    size_t len = 0u;
+  };
+
+  std::vector<Entry> entries;
+
+  // What was reported while reading the container, which is reported again when it is merged
+  // from the cache.
+  BufferedDiagnostics diagnostics;
+};
+
+// A static library include kept in the InputCache.
+struct CachedStaticLibrary {
+  std::unique_ptr<LoadedApk> apk;
+
+  // What was reported while loading the library, which is reported again when it is included
+  // from the cache.
+  BufferedDiagnostics diagnostics;
+};
+
+// Reports to `diag`, and also records what was reported in `record`.
+class RecordingDiagnostics : public IDiagnostics {
+ public:
+  RecordingDiagnostics(IDiagnostics* diag, BufferedDiagnostics* record)
+      : diag_(diag), record_(record) {
+  }
+
+  void Log(Level level, DiagMessageActual& actual_msg) override {
+    DiagMessageActual recorded_msg = actual_msg;
+    record_->Log(level, recorded_msg);
+    diag_->Log(level, actual_msg);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RecordingDiagnostics);
+
+  IDiagnostics* diag_;
+  BufferedDiagnostics* record_;
+};
+
+// Lets a SymbolTable use a symbol source that is also kept in the InputCache.
+class SharedSymbolSource : public ISymbolSource {
+ public:
+  explicit SharedSymbolSource(std::shared_ptr<ISymbolSource> source) : source_(std::move(source)) {
+  }
+
+  std::unique_ptr<SymbolTable::Symbol> FindByName(const ResourceName& name) override {
+    return source_->FindByName(name);
+  }
+
+  std::unique_ptr<SymbolTable::Symbol> FindById(ResourceId id) override {
+    return source_->FindById(id);
+  }
+
+  std::unique_ptr<SymbolTable::Symbol> FindByReference(const Reference& ref) override {
+    return source_->FindByReference(ref);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SharedSymbolSource);
+
+  std::shared_ptr<ISymbolSource> source_;
+};
+
 class LinkCommand {
  public:
   LinkCommand(LinkContext* context, const LinkOptions& options)
@@ -780,7 +857,11 @@ class LinkCommand {
         file_collection_(util::make_unique<io::FileCollection>()) {
   }
 
-  void ExtractCompileSdkVersions(android::AssetManager* assets) {
+  // Reads the android:versionCode and android:versionName of the framework from its
+  // AndroidManifest.xml, if the framework is loaded in `assets`.
+  static void ReadCompileSdkVersions(android::AssetManager* assets,
+                                     Maybe<std::string>* out_version,
+                                     Maybe<std::string>* out_version_codename) {
     using namespace android;
 
     int32_t cookie = FindFrameworkAssetManagerCookie(*assets);
@@ -804,47 +885,291 @@ class LinkCommand {
       return;
     }
 
-    if (!options_.manifest_fixer_options.compile_sdk_version) {
-      xml::Attribute* attr = manifest_xml->root->FindAttribute(xml::kSchemaAndroid, "versionCode");
-      if (attr != nullptr) {
-        Maybe<std::string>& compile_sdk_version = options_.manifest_fixer_options.compile_sdk_version;
-        if (BinaryPrimitive* prim = ValueCast<BinaryPrimitive>(attr->compiled_value.get())) {
-          switch (prim->value.dataType) {
-            case Res_value::TYPE_INT_DEC:
-              compile_sdk_version = StringPrintf("%" PRId32, static_cast<int32_t>(prim->value.data));
-              break;
-            case Res_value::TYPE_INT_HEX:
-              compile_sdk_version = StringPrintf("%" PRIx32, prim->value.data);
-              break;
-            default:
-              break;
+    xml::Attribute* attr = manifest_xml->root->FindAttribute(xml::kSchemaAndroid, "versionCode");
+    if (attr != nullptr) {
+      if (BinaryPrimitive* prim = ValueCast<BinaryPrimitive>(attr->compiled_value.get())) {
+        switch (prim->value.dataType) {
+          case Res_value::TYPE_INT_DEC:
+            *out_version = StringPrintf("%" PRId32, static_cast<int32_t>(prim->value.data));
+            break;
+          case Res_value::TYPE_INT_HEX:
+            *out_version = StringPrintf("%" PRIx32, prim->value.data);
+            break;
+          default:
+            break;
+        }
+      } else if (String* str = ValueCast<String>(attr->compiled_value.get())) {
+        *out_version = *str->value;
+      } else {
+        *out_version = attr->value;
+      }
+    }
+
+    attr = manifest_xml->root->FindAttribute(xml::kSchemaAndroid, "versionName");
+    if (attr != nullptr) {
+      if (String* str = ValueCast<String>(attr->compiled_value.get())) {
+        *out_version_codename = *str->value;
+      } else {
+        *out_version_codename = attr->value;
+      }
+    }
+  }
+
+  // Uses the framework version as the compile SDK version, unless one was given explicitly.
+  void ApplyCompileSdkVersions(const Maybe<std::string>& version,
+                               const Maybe<std::string>& version_codename) {
+    if (!options_.manifest_fixer_options.compile_sdk_version && version) {
+      options_.manifest_fixer_options.compile_sdk_version = version;
+    }
+
+    if (!options_.manifest_fixer_options.compile_sdk_version_codename && version_codename) {
+      options_.manifest_fixer_options.compile_sdk_version_codename = version_codename;
+    }
+  }
+
+  void ExtractCompileSdkVersions(android::AssetManager* assets) {
+    Maybe<std::string> version;
+    Maybe<std::string> version_codename;
+    ReadCompileSdkVersions(assets, &version, &version_codename);
+    ApplyCompileSdkVersions(version, version_codename);
+  }
+
+  // Returns true if `source` has a public android:compileSdkVersion attribute, which means that
+  // the version of the framework can be used as the compile SDK version.
+  static bool HasPublicCompileSdkVersion(ISymbolSource* source) {
+    std::unique_ptr<SymbolTable::Symbol> symbol =
+        source->FindByName(ResourceName("android", ResourceType::kAttr, "compileSdkVersion"));
+    return symbol != nullptr && symbol->is_public;
+  }
+
+  // Builds a symbol index of every resource in the include APK at `path`, by looking each one up
+  // the same way AssetManagerSymbolSource does. Returns false if the APK has shared library
+  // packages, whose IDs depend on the other includes, or can't be parsed.
+  bool BuildSymbolIndex(const std::string& path, SymbolIndexBuilder* builder) {
+    AssetManagerSymbolSource asset_source;
+    if (!asset_source.AddAssetPath(path)) {
+      return false;
+    }
+
+    for (auto& entry : asset_source.GetAssignedPackageIds()) {
+      if (asset_source.IsPackageDynamic(entry.first)) {
+        return false;
+      }
+      builder->AddPackage(static_cast<uint8_t>(entry.first), entry.second);
+      if (entry.first == kFrameworkPackageId && HasPublicCompileSdkVersion(&asset_source)) {
+        Maybe<std::string> version;
+        Maybe<std::string> version_codename;
+        ReadCompileSdkVersions(asset_source.GetAssetManager(), &version, &version_codename);
+        builder->SetCompileSdkVersions(version, version_codename);
+      }
+    }
+
+    // The resource table is only used to enumerate the resources, so errors parsing it are not
+    // reported. The include is loaded through AssetManager instead.
+    BufferedDiagnostics diag;
+    std::unique_ptr<LoadedApk> apk = LoadedApk::LoadApkFromPath(path, &diag);
+    if (apk == nullptr || apk->GetResourceTable() == nullptr) {
+      return false;
+    }
+
+    for (auto& package : apk->GetResourceTable()->packages) {
+      for (auto& type : package->types) {
+        for (auto& entry : type->entries) {
+          if (!package->id || !type->id || !entry->id) {
+            continue;
+          }
+
+          const ResourceId id(package->id.value(), type->id.value(), entry->id.value());
+          std::unique_ptr<SymbolTable::Symbol> symbol;
+          if (type->type == ResourceType::kAttrPrivate) {
+            // Private attrs are found by looking up an attr of the same name, and then come with
+            // their attribute, which looking them up by ID leaves out.
+            symbol = asset_source.FindByName(
+                ResourceName(package->name, ResourceType::kAttr, entry->name));
+            if (symbol != nullptr && (!symbol->id || symbol->id.value() != id)) {
+              // An attr of the same name hides this one from lookups by name.
+              symbol = {};
+            }
+          }
+          if (symbol == nullptr) {
+            symbol = asset_source.FindById(id);
+          }
+          if (symbol != nullptr &&
+              !builder->AddSymbol(ResourceName(package->name, type->type, entry->name), *symbol)) {
+            return false;
           }
-        } else if (String* str = ValueCast<String>(attr->compiled_value.get())) {
-          compile_sdk_version = *str->value;
-        } else {
-          compile_sdk_version = attr->value;
         }
       }
     }
+    return true;
+  }
 
-    if (!options_.manifest_fixer_options.compile_sdk_version_codename) {
-      xml::Attribute* attr = manifest_xml->root->FindAttribute(xml::kSchemaAndroid, "versionName");
-      if (attr != nullptr) {
-        Maybe<std::string>& compile_sdk_version_codename =
-            options_.manifest_fixer_options.compile_sdk_version_codename;
-        if (String* str = ValueCast<String>(attr->compiled_value.get())) {
-          compile_sdk_version_codename = *str->value;
-        } else {
-          compile_sdk_version_codename = attr->value;
+  // Loads the symbol index of the include APK at `path` from the include symbol cache, creating
+  // or replacing it if it is missing or out of date. Returns nullptr if the APK can't be indexed,
+  // in which case it should be loaded through AssetManager.
+  std::unique_ptr<SymbolIndex> LoadIncludeSymbolIndex(const std::string& path) {
+    Maybe<file::FileStamp> stamp = file::GetFileStamp(path);
+    Maybe<std::string> canonical_path = file::GetCanonicalPath(path);
+    if (!stamp || !canonical_path) {
+      return {};
+    }
+
+    // Links that include the same APK through different paths share its index. The index records
+    // the full path, so an index whose name collides with that of another APK is rebuilt.
+    SymbolIndexSource source;
+    source.path = canonical_path.value();
+    source.size = stamp.value().size;
+    source.mtime = stamp.value().mtime_ns;
+
+    std::string index_path = options_.include_symbol_cache_dir.value();
+    file::AppendPath(&index_path,
+                     StringPrintf("%zx.symidx", std::hash<std::string>()(source.path)));
+
+    std::string error;
+    std::unique_ptr<SymbolIndex> index = SymbolIndex::Load(index_path, &error);
+    if (index != nullptr && index->IsFrom(source)) {
+      if (context_->IsVerbose()) {
+        context_->GetDiagnostics()->Note(DiagMessage(path)
+                                         << "using symbol index " << index_path);
+      }
+      return index;
+    }
+    index = {};
+
+    SymbolIndexBuilder builder(source);
+    if (!BuildSymbolIndex(path, &builder)) {
+      return {};
+    }
+
+    std::string data;
+    builder.Flatten(&data);
+
+    // Write to a temporary file first, so that links running in parallel never read a partially
+    // written index.
+    const std::string temp_path = StringPrintf("%s.%d.tmp", index_path.c_str(), getpid());
+    bool written = android::base::WriteStringToFile(data, temp_path);
+    if (written && rename(temp_path.c_str(), index_path.c_str()) != 0) {
+      // Renaming over an existing file fails on Windows, so remove the out of date index first.
+      unlink(index_path.c_str());
+      written = rename(temp_path.c_str(), index_path.c_str()) == 0;
+    }
+
+    if (!written) {
+      const std::string write_error = android::base::SystemErrorCodeToString(errno);
+      unlink(temp_path.c_str());
+      context_->GetDiagnostics()->Warn(DiagMessage(index_path)
+                                       << "failed to write symbol index: " << write_error);
+      return {};
+    }
+
+    if (context_->IsVerbose()) {
+      context_->GetDiagnostics()->Note(DiagMessage(path) << "created symbol index " << index_path);
+    }
+
+    index = SymbolIndex::Load(index_path, &error);
+    if (index == nullptr) {
+      context_->GetDiagnostics()->Warn(DiagMessage(index_path)
+                                       << "failed to load symbol index: " << error);
+    }
+    return index;
+  }
+
+  // Loads the static library at `path` and returns its resource table, which this command owns
+  // and may modify. In a long running process the library is kept in the InputCache, and each
+  // command gets its own copy of the table.
+  ResourceTable* LoadStaticLibrary(const std::string& path,
+                                   std::unique_ptr<io::ZipFileCollection> collection) {
+    InputCache* cache = InputCache::Get();
+    InputCache::Inputs inputs;
+    if (!cache->IsEnabled() || !InputCache::StampInputs({path}, &inputs)) {
+      std::unique_ptr<LoadedApk> static_apk = LoadedApk::LoadProtoApkFromFileCollection(
+          Source(path), std::move(collection), context_->GetDiagnostics());
+      if (static_apk == nullptr) {
+        return nullptr;
+      }
+      ResourceTable* table = static_apk->GetResourceTable();
+      static_library_includes_.push_back(std::move(static_apk));
+      return table;
+    }
+
+    std::shared_ptr<CachedStaticLibrary> library =
+        cache->Find<CachedStaticLibrary>(InputCache::Kind::kStaticLibrary, path, inputs);
+    if (library == nullptr) {
+      library = std::make_shared<CachedStaticLibrary>();
+      RecordingDiagnostics diag(context_->GetDiagnostics(), &library->diagnostics);
+      library->apk =
+          LoadedApk::LoadProtoApkFromFileCollection(Source(path), std::move(collection), &diag);
+      if (library->apk == nullptr) {
+        return nullptr;
+      }
+      const size_t size = inputs.front().second.size;
+      cache->Insert(InputCache::Kind::kStaticLibrary, path, std::move(inputs), library, size);
+    } else {
+      library->diagnostics.ReplayTo(context_->GetDiagnostics());
+      if (context_->IsVerbose()) {
+        context_->GetDiagnostics()->Note(DiagMessage(path) << "using cached static library");
+      }
+    }
+
+    // The copy refers to the files of the library, so the library is kept along with it in case
+    // the cache evicts it.
+    StaticLibraryCopy copy;
+    copy.library = library;
+    copy.table = library->apk->GetResourceTable()->Clone();
+    static_library_copies_.push_back(std::move(copy));
+    return static_library_copies_.back().table.get();
+  }
+
+  // Loads the include APKs at `paths` into one AssetManager. In a long running process the
+  // AssetManager is kept in the InputCache, and is reused while the same APKs are included.
+  std::shared_ptr<AssetManagerSymbolSource> LoadIncludeAssets(
+      const std::vector<std::string>& paths) {
+    InputCache* cache = InputCache::Get();
+    InputCache::Inputs inputs;
+    std::string key;
+    for (const std::string& path : paths) {
+      key += path;
+      key += '\n';
+    }
+
+    const bool cacheable =
+        !paths.empty() && cache->IsEnabled() && InputCache::StampInputs(paths, &inputs);
+    if (cacheable) {
+      std::shared_ptr<AssetManagerSymbolSource> asset_source =
+          cache->Find<AssetManagerSymbolSource>(InputCache::Kind::kIncludeAssets, key, inputs);
+      if (asset_source != nullptr) {
+        if (context_->IsVerbose()) {
+          context_->GetDiagnostics()->Note(DiagMessage() << "using cached include APKs");
         }
+        return asset_source;
       }
     }
+
+    auto asset_source = std::make_shared<AssetManagerSymbolSource>();
+    for (const std::string& path : paths) {
+      if (!asset_source->AddAssetPath(path)) {
+        context_->GetDiagnostics()->Error(DiagMessage()
+                                          << "failed to load include path " << path);
+        return {};
+      }
+    }
+
+    if (cacheable) {
+      // Most of what AssetManager keeps is mapped from the APKs, so their sizes are a generous
+      // estimate of what it costs to keep it.
+      size_t size = 0u;
+      for (const auto& input : inputs) {
+        size += input.second.size;
+      }
+      cache->Insert(InputCache::Kind::kIncludeAssets, key, std::move(inputs), asset_source, size);
+    }
+    return asset_source;
   }
 
   // Creates a SymbolTable that loads symbols from the various APKs.
   // Pre-condition: context_->GetCompilationPackage() needs to be set.
   bool LoadSymbolsFromIncludePaths() {
-    auto asset_source = util::make_unique<AssetManagerSymbolSource>();
+    std::vector<std::string> asset_paths;
     for (const std::string& path : options_.include_paths) {
       if (context_->IsVerbose()) {
         context_->GetDiagnostics()->Note(DiagMessage() << "including " << path);
@@ -859,9 +1184,8 @@ class LinkCommand {
 
       if (zip_collection->FindFile(kProtoResourceTablePath) != nullptr) {
         // Load this as a static library include.
-        std::unique_ptr<LoadedApk> static_apk = LoadedApk::LoadProtoApkFromFileCollection(
-            Source(path), std::move(zip_collection), context_->GetDiagnostics());
-        if (static_apk == nullptr) {
+        ResourceTable* table = LoadStaticLibrary(path, std::move(zip_collection));
+        if (table == nullptr) {
           return false;
         }
 
@@ -873,8 +1197,6 @@ class LinkCommand {
           return false;
         }
 
-        ResourceTable* table = static_apk->GetResourceTable();
-
         // If we are using --no-static-lib-packages, we need to rename the package of this table to
         // our compilation package.
         if (options_.no_static_lib_packages) {
@@ -892,16 +1214,38 @@ class LinkCommand {
 
         context_->GetExternalSymbols()->AppendSource(
             util::make_unique<ResourceTableSymbolSource>(table));
-        static_library_includes_.push_back(std::move(static_apk));
       } else {
-        if (!asset_source->AddAssetPath(path)) {
-          context_->GetDiagnostics()->Error(DiagMessage()
-                                            << "failed to load include path " << path);
-          return false;
+        asset_paths.push_back(path);
+      }
+    }
+
+    // The indexes are only used when every include APK has one. Otherwise the APKs loaded through
+    // AssetManager would be looked up after all the indexed ones, whatever their order on the
+    // command line.
+    std::vector<std::unique_ptr<SymbolIndex>> symbol_indices;
+    if (options_.include_symbol_cache_dir) {
+      for (const std::string& path : asset_paths) {
+        std::unique_ptr<SymbolIndex> index = LoadIncludeSymbolIndex(path);
+        if (index == nullptr) {
+          if (context_->IsVerbose()) {
+            context_->GetDiagnostics()->Note(DiagMessage(path)
+                                             << "can't be indexed, loading all include APKs");
+          }
+          symbol_indices.clear();
+          break;
         }
+        symbol_indices.push_back(std::move(index));
+      }
+      if (!symbol_indices.empty()) {
+        asset_paths.clear();
       }
     }
 
+    std::shared_ptr<AssetManagerSymbolSource> asset_source = LoadIncludeAssets(asset_paths);
+    if (asset_source == nullptr) {
+      return false;
+    }
+
     // Capture the shared libraries so that the final resource table can be properly flattened
     // with support for shared libraries.
     for (auto& entry : asset_source->GetAssignedPackageIds()) {
@@ -912,9 +1256,7 @@ class LinkCommand {
         // Try to embed which version of the framework we're compiling against.
         // First check if we should use compileSdkVersion at all. Otherwise compilation may fail
         // when linking our synthesized 'android:compileSdkVersion' attribute.
-        std::unique_ptr<SymbolTable::Symbol> symbol = asset_source->FindByName(
-            ResourceName("android", ResourceType::kAttr, "compileSdkVersion"));
-        if (symbol != nullptr && symbol->is_public) {
+        if (HasPublicCompileSdkVersion(asset_source.get())) {
           // The symbol is present and public, extract the android:versionName and
           // android:versionCode from the framework AndroidManifest.xml.
           ExtractCompileSdkVersions(asset_source->GetAssetManager());
@@ -924,7 +1266,22 @@ class LinkCommand {
       }
     }
 
-    context_->GetExternalSymbols()->AppendSource(std::move(asset_source));
+    // Indexed includes never have shared libraries, and the index records the framework version
+    // only when android:compileSdkVersion is public.
+    for (std::unique_ptr<SymbolIndex>& index : symbol_indices) {
+      for (auto& entry : index->GetPackages()) {
+        if (entry.first == kAppPackageId) {
+          included_feature_base_ = entry.second;
+        } else if (entry.first == kFrameworkPackageId) {
+          ApplyCompileSdkVersions(index->GetCompileSdkVersion(),
+                                  index->GetCompileSdkVersionCodename());
+        }
+      }
+      context_->GetExternalSymbols()->AppendSource(std::move(index));
+    }
+
+    context_->GetExternalSymbols()->AppendSource(
+        util::make_unique<SharedSymbolSource>(std::move(asset_source)));
     return true;
   }
 
@@ -1062,10 +1419,20 @@ class LinkCommand {
     if (options_.output_to_directory) {
       return CreateDirectoryArchiveWriter(context_->GetDiagnostics(), out);
     } else {
-      return CreateZipFileArchiveWriter(context_->GetDiagnostics(), out);
+      return CreateParallelZipFileArchiveWriter(context_->GetDiagnostics(), out);
     }
   }
 
+  // Completes an archive created by MakeArchiveWriter().
+  bool FinishArchive(IArchiveWriter* writer, const StringPiece& out) {
+    if (!writer->Finish()) {
+      context_->GetDiagnostics()->Error(DiagMessage(out)
+                                        << "failed to write archive: " << writer->GetError());
+      return false;
+    }
+    return true;
+  }
+
   bool FlattenTable(ResourceTable* table, OutputFormat format, IArchiveWriter* writer) {
     switch (format) {
       case OutputFormat::kApk: {
@@ -1098,8 +1465,11 @@ class LinkCommand {
       return true;
     }
 
+    // The R class is generated in memory first, so that files whose contents didn't change can be
+    // left untouched and don't cause the Java sources depending on them to be recompiled.
     std::string out_path;
-    std::unique_ptr<io::FileOutputStream> fout;
+    std::string java_contents;
+    std::unique_ptr<io::StringOutputStream> out_java;
     if (options_.generate_java_class_path) {
       out_path = options_.generate_java_class_path.value();
       file::AppendPath(&out_path, file::PackageToPath(out_package));
@@ -1110,32 +1480,50 @@ class LinkCommand {
       }
 
       file::AppendPath(&out_path, "R.java");
+      out_java = util::make_unique<io::StringOutputStream>(&java_contents);
+    }
 
-      fout = util::make_unique<io::FileOutputStream>(out_path);
-      if (fout->HadError()) {
-        context_->GetDiagnostics()->Error(DiagMessage() << "failed writing to '" << out_path
-                                                        << "': " << fout->GetError());
+    std::string text_symbols_contents;
+    std::unique_ptr<io::StringOutputStream> out_text;
+    if (out_text_symbols_path) {
+      out_text = util::make_unique<io::StringOutputStream>(&text_symbols_contents);
+    }
+
+    JavaClassGenerator generator(context_, table, java_options);
+    if (!generator.Generate(package_name_to_generate, out_package, out_java.get(),
+                            out_text.get())) {
+      context_->GetDiagnostics()->Error(DiagMessage(out_path) << generator.GetError());
+      return false;
+    }
+
+    if (out_java) {
+      out_java->Flush();
+      if (!WriteFileIfChanged(out_path, java_contents)) {
         return false;
       }
     }
 
-    std::unique_ptr<io::FileOutputStream> fout_text;
-    if (out_text_symbols_path) {
-      fout_text = util::make_unique<io::FileOutputStream>(out_text_symbols_path.value());
-      if (fout_text->HadError()) {
-        context_->GetDiagnostics()->Error(DiagMessage()
-                                          << "failed writing to '" << out_text_symbols_path.value()
-                                          << "': " << fout_text->GetError());
+    if (out_text) {
+      out_text->Flush();
+      if (!WriteFileIfChanged(out_text_symbols_path.value(), text_symbols_contents)) {
         return false;
       }
     }
+    return true;
+  }
 
-    JavaClassGenerator generator(context_, table, java_options);
-    if (!generator.Generate(package_name_to_generate, out_package, fout.get(), fout_text.get())) {
-      context_->GetDiagnostics()->Error(DiagMessage(out_path) << generator.GetError());
+  bool WriteFileIfChanged(const std::string& path, const std::string& contents) {
+    bool changed = false;
+    std::string error;
+    if (!file::WriteFileIfChanged(path, contents, &changed, &error)) {
+      context_->GetDiagnostics()->Error(DiagMessage() << "failed writing to '" << path
+                                                      << "': " << error);
       return false;
     }
 
+    if (!changed && context_->IsVerbose()) {
+      context_->GetDiagnostics()->Note(DiagMessage() << "'" << path << "' is up to date");
+    }
     return true;
   }
 
@@ -1261,22 +1649,11 @@ class LinkCommand {
 
     file::AppendPath(&out_path, "Manifest.java");
 
-    io::FileOutputStream fout(out_path);
-    if (fout.HadError()) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed to open '" << out_path
-                                                      << "': " << fout.GetError());
-      return false;
-    }
-
-    ClassDefinition::WriteJavaFile(manifest_class.get(), package_utf8, true, &fout);
-    fout.Flush();
-
-    if (fout.HadError()) {
-      context_->GetDiagnostics()->Error(DiagMessage() << "failed writing to '" << out_path
-                                                      << "': " << fout.GetError());
-      return false;
-    }
-    return true;
+    std::string contents;
+    io::StringOutputStream out(&contents);
+    ClassDefinition::WriteJavaFile(manifest_class.get(), package_utf8, true, &out);
+    out.Flush();
+    return WriteFileIfChanged(out_path, contents);
   }
 
   bool WriteProguardFile(const Maybe<std::string>& out, const proguard::KeepSet& keep_set) {
@@ -1461,24 +1838,52 @@ class LinkCommand {
       }
     }
 
-    std::unique_ptr<io::InputStream> input_stream = file->OpenInputStream();
-    if (input_stream == nullptr) {
-      context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to open file");
+    // In a long running process, reuse what an earlier command loaded from an unchanged file.
+    InputCache* cache = InputCache::Get();
+    InputCache::Inputs inputs;
+    std::shared_ptr<CompiledContainer> container;
+    if (cache->IsEnabled() && InputCache::StampInputs({src.path}, &inputs)) {
+      container = cache->Find<CompiledContainer>(InputCache::Kind::kCompiledContainer, src.path,
+                                                 inputs);
+      if (container != nullptr) {
+        container->diagnostics.ReplayTo(context_->GetDiagnostics());
+        return MergeCachedContainer(file, *container, override);
+      }
+      container = std::make_shared<CompiledContainer>();
+    }
+
+    // What is reported about reading the container is cached along with its entries. What is
+    // reported about merging them is reported again by every command that merges them.
+    IDiagnostics* diag = context_->GetDiagnostics();
+    std::unique_ptr<RecordingDiagnostics> recording_diag;
+    if (container != nullptr) {
+      recording_diag = util::make_unique<RecordingDiagnostics>(diag, &container->diagnostics);
+      diag = recording_diag.get();
+    }
+
+    // Map the whole file and parse the container in place. Files on disk and uncompressed ZIP
+    // entries are mmapped, so the compiled files within them are handed out as views of the same
+    // mapping rather than being opened again for every file.
+    std::shared_ptr<io::IData> data = file->OpenAsData();
+    if (data == nullptr) {
+      diag->Error(DiagMessage(src) << "failed to open file");
       return false;
     }
 
-    if (input_stream->HadError()) {
-      context_->GetDiagnostics()->Error(DiagMessage(src)
-                                        << "failed to open file: " << input_stream->GetError());
+    if (data->HadError()) {
+      diag->Error(DiagMessage(src) << "failed to open file: " << data->GetError());
       return false;
     }
 
+    // Inflated ZIP entries are not shared, so that their contents are only held in memory
+    // while they are needed.
+    const bool share_data = !file->WasCompressed();
+
     ContainerReaderEntry* entry;
-    ContainerReader reader(input_stream.get());
+    ContainerReader reader(data.get());
 
     if (reader.HadError()) {
-      context_->GetDiagnostics()->Error(DiagMessage(src)
-                                        << "failed to read file: " << reader.GetError());
+      diag->Error(DiagMessage(src) << "failed to read file: " << reader.GetError());
       return false;
     }
 
@@ -1486,19 +1891,23 @@ class LinkCommand {
       if (entry->Type() == ContainerEntryType::kResTable) {
         pb::ResourceTable pb_table;
         if (!entry->GetResTable(&pb_table)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to read resource table: "
-                                                             << entry->GetError());
+          diag->Error(DiagMessage(src) << "failed to read resource table: " << entry->GetError());
           return false;
         }
 
         ResourceTable table;
         std::string error;
         if (!DeserializeTableFromPb(pb_table, nullptr /*files*/, &table, &error)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src)
-                                            << "failed to deserialize resource table: " << error);
+          diag->Error(DiagMessage(src) << "failed to deserialize resource table: " << error);
           return false;
         }
 
+        if (container != nullptr) {
+          CompiledContainer::Entry cached_entry;
+          cached_entry.table = table.Clone();
+          container->entries.push_back(std::move(cached_entry));
+        }
+
         if (!table_merger_->Merge(src, &table, override)) {
           context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to merge resource table");
           return false;
@@ -1508,22 +1917,55 @@ class LinkCommand {
         off64_t offset;
         size_t len;
         if (!entry->GetResFileOffsets(&pb_compiled_file, &offset, &len)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to get resource file: "
-                                                             << entry->GetError());
+          diag->Error(DiagMessage(src) << "failed to get resource file: " << entry->GetError());
           return false;
         }
 
         ResourceFile resource_file;
         std::string error;
         if (!DeserializeCompiledFileFromPb(pb_compiled_file, &resource_file, &error)) {
-          context_->GetDiagnostics()->Error(DiagMessage(src)
-                                            << "failed to read compiled header: " << error);
+          diag->Error(DiagMessage(src) << "failed to read compiled header: " << error);
+          return false;
+        }
+
+        if (container != nullptr) {
+          CompiledContainer::Entry cached_entry;
+          cached_entry.file = resource_file;
+          cached_entry.offset = offset;
+          cached_entry.len = len;
+          container->entries.push_back(std::move(cached_entry));
+        }
+
+        io::IFile* segment = share_data ? file->CreateFileSegment(data, offset, len)
+                                        : file->CreateFileSegment(offset, len);
+        if (!MergeCompiledFile(resource_file, segment, override)) {
           return false;
         }
+      }
+    }
+
+    if (container != nullptr && !reader.HadError()) {
+      cache->Insert(InputCache::Kind::kCompiledContainer, src.path, std::move(inputs),
+                    std::move(container), data->size());
+    }
+    return true;
+  }
 
-        if (!MergeCompiledFile(resource_file, file->CreateFileSegment(offset, len), override)) {
+  // Merges the entries of a container that an earlier command in this process already read
+  // from `file`. The compiled files are opened from `file` again when they are needed.
+  bool MergeCachedContainer(io::IFile* file, const CompiledContainer& container, bool override) {
+    const Source& src = file->GetSource();
+    for (const CompiledContainer::Entry& entry : container.entries) {
+      if (entry.table != nullptr) {
+        // Merging takes values out of the table, so merge a copy.
+        std::unique_ptr<ResourceTable> table = entry.table->Clone();
+        if (!table_merger_->Merge(src, table.get(), override)) {
+          context_->GetDiagnostics()->Error(DiagMessage(src) << "failed to merge resource table");
           return false;
         }
+      } else if (!MergeCompiledFile(entry.file, file->CreateFileSegment(entry.offset, entry.len),
+                                    override)) {
+        return false;
       }
     }
     return true;
@@ -1915,6 +2357,10 @@ class LinkCommand {
           return 1;
         }
 
+        if (!FinishArchive(archive_writer.get(), *path_iter)) {
+          return 1;
+        }
+
         ++path_iter;
         ++split_constraints_iter;
       }
@@ -1979,6 +2425,10 @@ class LinkCommand {
       return 1;
     }
 
+    if (!FinishArchive(archive_writer.get(), options_.output_path)) {
+      return 1;
+    }
+
     if (options_.generate_java_class_path || options_.generate_text_symbols_path) {
       if (!GenerateJavaClasses()) {
         return 1;
@@ -2018,6 +2468,13 @@ class LinkCommand {
   // The set of included APKs (not merged). This is mainly here to retain ownership of the APKs.
   std::vector<std::unique_ptr<LoadedApk>> static_library_includes_;
 
+  // Copies of the tables of static libraries that are kept in the InputCache.
+  struct StaticLibraryCopy {
+    std::shared_ptr<CachedStaticLibrary> library;
+    std::unique_ptr<ResourceTable> table;
+  };
+  std::vector<StaticLibraryCopy> static_library_copies_;
+
   // The set of shared libraries being used, mapping their assigned package ID to package name.
   std::map<size_t, std::string> shared_libs_;
 
@@ -2048,6 +2505,11 @@ int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics) {
           .RequiredFlag("--manifest", "Path to the Android manifest to build.",
                         &options.manifest_path)
           .OptionalFlagList("-I", "Adds an Android APK to link against.", &options.include_paths)
+          .OptionalFlag("--include-symbol-cache",
+                        "Directory in which to cache indexes of the symbols in the APKs added\n"
+                        "with -I. Links that share the directory look up symbols in the\n"
+                        "index instead of loading the APK again. The directory must exist.",
+                        &options.include_symbol_cache_dir)
           .OptionalFlagList("-A",
                             "An assets directory to include in the APK. These are unprocessed.",
                             &options.assets_dirs)
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "android-base/file.h"
+#include "android-base/stringprintf.h"
+#include "android-base/test_utils.h"
+
+#include "Compile.h"
+#include "io/ZipArchive.h"
+#include "test/Test.h"
+#include "util/Files.h"
+
+using ::android::StringPiece;
+using ::android::base::StringPrintf;
+
+namespace aapt {
+
+extern int Link(const std::vector<StringPiece>& args, IDiagnostics* diagnostics);
+
+class LinkTest : public ::testing::Test {
+ protected:
+  // Compiles `values` as the values resources of `package` and links them, with `link_args`, into
+  // an APK named `name` in the test directory. Returns the path of the APK.
+  std::string BuildApk(const std::string& name, const std::string& package,
+                       const std::string& values, const std::vector<std::string>& link_args) {
+    std::string dir = dir_.path;
+    file::AppendPath(&dir, name);
+    std::string values_dir = dir;
+    file::AppendPath(&values_dir, "res");
+    file::AppendPath(&values_dir, "values");
+    if (!file::mkdirs(values_dir)) {
+      ADD_FAILURE() << "failed to create " << values_dir;
+      return {};
+    }
+
+    std::string values_path = values_dir;
+    file::AppendPath(&values_path, "values.xml");
+    std::string manifest_path = dir;
+    file::AppendPath(&manifest_path, "AndroidManifest.xml");
+    if (!android::base::WriteStringToFile(values, values_path) ||
+        !android::base::WriteStringToFile(
+            "<manifest xmlns:android=\"http://schemas.android.com/apk/res/android\" package=\"" +
+                package + "\"/>",
+            manifest_path)) {
+      ADD_FAILURE() << "failed to write the sources of " << name;
+      return {};
+    }
+
+    if (Compile({values_path, "-o", dir}, &diag_) != 0) {
+      ADD_FAILURE() << "failed to compile " << values_path;
+      return {};
+    }
+
+    std::string flat_path = dir;
+    file::AppendPath(&flat_path, "values_values.arsc.flat");
+    std::string apk_path = dir;
+    file::AppendPath(&apk_path, "out.apk");
+    std::vector<StringPiece> args = {"-o", apk_path, "--manifest", manifest_path, flat_path};
+    args.insert(args.end(), link_args.begin(), link_args.end());
+    if (Link(args, &diag_) != 0) {
+      ADD_FAILURE() << "failed to link " << name;
+      return {};
+    }
+    return apk_path;
+  }
+
+  // Returns the resources.arsc of the APK at `path`.
+  std::string ReadResourceTable(const std::string& path) {
+    std::string error;
+    std::unique_ptr<io::ZipFileCollection> collection =
+        io::ZipFileCollection::Create(path, &error);
+    if (collection == nullptr) {
+      ADD_FAILURE() << "failed to open " << path << ": " << error;
+      return {};
+    }
+
+    io::IFile* file = collection->FindFile("resources.arsc");
+    std::unique_ptr<io::IData> data = file != nullptr ? file->OpenAsData() : nullptr;
+    if (data == nullptr) {
+      ADD_FAILURE() << "no resources.arsc in " << path;
+      return {};
+    }
+    return std::string(reinterpret_cast<const char*>(data->data()), data->size());
+  }
+
+  std::string GetCacheDir() {
+    std::string cache_dir = dir_.path;
+    file::AppendPath(&cache_dir, "symbol-cache");
+    EXPECT_TRUE(file::mkdirs(cache_dir));
+    return cache_dir;
+  }
+
+  TemporaryDir dir_;
+  StdErrDiagnostics diag_;
+};
+
+// The symbols resolved through the include symbol cache are the same as those loaded from the
+// include APKs, whether or not all the includes can be indexed.
+TEST_F(LinkTest, IncludeSymbolCacheResolvesTheSameSymbols) {
+  // The attr that is not public is moved to ^attr-private.
+  const std::string framework_apk =
+      BuildApk("framework", "android",
+               "<resources>"
+               "  <string name=\"hello\">hello</string>"
+               "  <attr name=\"pub\" format=\"string\"/>"
+               "  <public type=\"attr\" name=\"pub\"/>"
+               "  <attr name=\"priv\" format=\"integer\"/>"
+               "</resources>",
+               {"-x"});
+  // Shared libraries can't be indexed.
+  const std::string shared_lib_apk =
+      BuildApk("lib", "com.lib", "<resources><string name=\"world\">world</string></resources>",
+               {"--shared-lib", "-I", framework_apk});
+  ASSERT_FALSE(framework_apk.empty());
+  ASSERT_FALSE(shared_lib_apk.empty());
+
+  const std::string framework_values =
+      "<resources>"
+      "  <string name=\"a\">@*android:string/hello</string>"
+      "  <style name=\"s\"><item name=\"*android:priv\">5</item></style>"
+      "</resources>";
+  const std::string mixed_values =
+      "<resources>"
+      "  <string name=\"a\">@*android:string/hello</string>"
+      "  <string name=\"b\">@*com.lib:string/world</string>"
+      "</resources>";
+  struct TestCase {
+    std::string values;
+    std::vector<std::string> includes;
+  };
+  const std::vector<TestCase> test_cases = {
+      {framework_values, {"-I", framework_apk}},
+      {mixed_values, {"-I", shared_lib_apk, "-I", framework_apk}},
+      {mixed_values, {"-I", framework_apk, "-I", shared_lib_apk}},
+  };
+
+  const std::string cache_dir = GetCacheDir();
+  for (size_t i = 0; i < test_cases.size(); i++) {
+    const TestCase& test_case = test_cases[i];
+    std::vector<std::string> cached_includes = test_case.includes;
+    cached_includes.push_back("--include-symbol-cache");
+    cached_includes.push_back(cache_dir);
+
+    const std::string expected = ReadResourceTable(
+        BuildApk(StringPrintf("app%zu", i), "com.app", test_case.values, test_case.includes));
+    ASSERT_FALSE(expected.empty());
+    // Twice through the cache, to link with both a new and an existing index.
+    EXPECT_EQ(expected,
+              ReadResourceTable(BuildApk(StringPrintf("app%zu_new_index", i), "com.app",
+                                         test_case.values, cached_includes)));
+    EXPECT_EQ(expected,
+              ReadResourceTable(BuildApk(StringPrintf("app%zu_cached_index", i), "com.app",
+                                         test_case.values, cached_includes)));
+  }
+}
+
+}  // namespace aapt
@@ -78,6 +78,9 @@ struct OptimizeOptions {
   // Set of artifacts to keep when generating multi-APK splits. If the list is empty, all artifacts
   // are kept and will be written as output.
   std::unordered_set<std::string> kept_artifacts;
+
+  // Maximum number of jobs to run concurrently. 0 means one job per available CPU core.
+  size_t max_jobs = 0;
 };
 
 class OptimizeContext : public IAaptContext {
@@ -148,12 +151,12 @@ class OptimizeCommand {
       context_->GetDiagnostics()->Note(DiagMessage() << "Optimizing APK...");
     }
 
-    VersionCollapser collapser;
+    VersionCollapser collapser(options_.max_jobs);
     if (!collapser.Consume(context_, apk->GetResourceTable())) {
       return 1;
     }
 
-    ResourceDeduper deduper;
+    ResourceDeduper deduper(options_.max_jobs);
     if (!deduper.Consume(context_, apk->GetResourceTable())) {
       context_->GetDiagnostics()->Error(DiagMessage() << "failed deduping resources");
       return 1;
@@ -184,8 +187,8 @@ class OptimizeCommand {
       // Generate an AndroidManifest.xml for each split.
       std::unique_ptr<xml::XmlResource> split_manifest =
           GenerateSplitManifest(options_.app_info, *split_constraints_iter);
-      std::unique_ptr<IArchiveWriter> split_writer =
-          CreateZipFileArchiveWriter(context_->GetDiagnostics(), *path_iter);
+      std::unique_ptr<IArchiveWriter> split_writer = CreateParallelZipFileArchiveWriter(
+          context_->GetDiagnostics(), *path_iter, options_.max_jobs);
       if (!split_writer) {
         return 1;
       }
@@ -194,6 +197,10 @@ class OptimizeCommand {
         return 1;
       }
 
+      if (!FinishArchive(split_writer.get(), *path_iter)) {
+        return 1;
+      }
+
       ++path_iter;
       ++split_constraints_iter;
     }
@@ -202,18 +209,26 @@ class OptimizeCommand {
       MultiApkGenerator generator{apk.get(), context_};
       MultiApkGeneratorOptions generator_options = {
           options_.output_dir.value(), options_.apk_artifacts.value(),
-          options_.table_flattener_options, options_.kept_artifacts};
+          options_.table_flattener_options, options_.kept_artifacts, options_.max_jobs};
       if (!generator.FromBaseApk(generator_options)) {
         return 1;
       }
     }
 
     if (options_.output_path) {
-      std::unique_ptr<IArchiveWriter> writer =
-          CreateZipFileArchiveWriter(context_->GetDiagnostics(), options_.output_path.value());
+      std::unique_ptr<IArchiveWriter> writer = CreateParallelZipFileArchiveWriter(
+          context_->GetDiagnostics(), options_.output_path.value(), options_.max_jobs);
+      if (!writer) {
+        return 1;
+      }
+
       if (!apk->WriteToArchive(context_, options_.table_flattener_options, writer.get())) {
         return 1;
       }
+
+      if (!FinishArchive(writer.get(), options_.output_path.value())) {
+        return 1;
+      }
     }
 
     return 0;
@@ -280,6 +295,15 @@ class OptimizeCommand {
                                         ArchiveEntry::kAlign, writer);
   }
 
+  bool FinishArchive(IArchiveWriter* writer, const std::string& path) {
+    if (!writer->Finish()) {
+      context_->GetDiagnostics()->Error(DiagMessage(path)
+                                        << "failed to write archive: " << writer->GetError());
+      return false;
+    }
+    return true;
+  }
+
   OptimizeOptions options_;
   OptimizeContext* context_;
 };
@@ -323,6 +347,7 @@ int Optimize(const std::vector<StringPiece>& args) {
   Maybe<std::string> config_path;
   Maybe<std::string> whitelist_path;
   Maybe<std::string> target_densities;
+  Maybe<std::string> jobs;
   std::vector<std::string> configs;
   std::vector<std::string> split_args;
   std::unordered_set<std::string> kept_artifacts;
@@ -364,12 +389,28 @@ int Optimize(const std::vector<StringPiece>& args) {
           .OptionalSwitch("--enable-resource-obfuscation",
                           "Enables obfuscation of key string pool to single value",
                           &options.table_flattener_options.collapse_key_stringpool)
+          .OptionalFlag("-j",
+                        "Maximum number of threads to use for optimizing the resource table,\n"
+                        "generating multi APK artifacts and compressing APK entries. Each\n"
+                        "concurrent artifact holds its own copy of the resource table, so lower\n"
+                        "values reduce peak memory. Defaults to the number of CPU cores.",
+                        &jobs)
           .OptionalSwitch("-v", "Enables verbose logging", &verbose);
 
   if (!flags.Parse("aapt2 optimize", args, &std::cerr)) {
     return 1;
   }
 
+  if (jobs) {
+    Maybe<uint32_t> max_jobs = ResourceUtils::ParseInt(jobs.value());
+    if (!max_jobs || max_jobs.value() == 0) {
+      std::cerr << "-j must be a positive integer.\n\n";
+      flags.Usage("aapt2 optimize", &std::cerr);
+      return 1;
+    }
+    options.max_jobs = max_jobs.value();
+  }
+
   if (flags.GetArgs().size() != 1u) {
     std::cerr << "must have one APK as argument.\n\n";
     flags.Usage("aapt2 optimize", &std::cerr);
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/PixelAnalysis.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace aapt {
+
+static void AnalyzePixelsScalar(const uint8_t* pixels, size_t pixel_count, PixelStats* stats) {
+  for (size_t i = 0; i < pixel_count; i++) {
+    int red = *pixels++;
+    int green = *pixels++;
+    int blue = *pixels++;
+    int alpha = *pixels++;
+
+    stats->opaque &= alpha == 0xff;
+    if (alpha == 0) {
+      stats->has_colored_transparent_pixels |= (red != 0 || green != 0 || blue != 0);
+      continue;
+    }
+
+    stats->max_gray_deviation = std::max(std::abs(red - green), stats->max_gray_deviation);
+    stats->max_gray_deviation = std::max(std::abs(green - blue), stats->max_gray_deviation);
+    stats->max_gray_deviation = std::max(std::abs(blue - red), stats->max_gray_deviation);
+  }
+}
+
+#if defined(__SSE2__)
+
+// Returns |a - b| for each unsigned byte.
+static inline __m128i AbsDiffU8(__m128i a, __m128i b) {
+  return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+void AnalyzePixels(const uint8_t* pixels, size_t pixel_count, PixelStats* stats) {
+  // Each 32-bit lane holds one pixel. Pixels are stored as R, G, B, A bytes, so on a little-endian
+  // machine the alpha channel is the most significant byte of the lane.
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i color_mask = _mm_set1_epi32(0x00ffffff);
+  const __m128i opaque_alpha = _mm_set1_epi32(0xff);
+  const __m128i two_byte_mask = _mm_set1_epi32(0x0000ffff);
+  const __m128i one_byte_mask = _mm_set1_epi32(0x000000ff);
+  const __m128i all_ones = _mm_cmpeq_epi32(zero, zero);
+
+  __m128i max_deviation = zero;
+  __m128i not_opaque = zero;
+  __m128i colored_transparent = zero;
+
+  size_t i = 0;
+  for (; i + 4 <= pixel_count; i += 4, pixels += 16) {
+    __m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    const __m128i alpha = _mm_srli_epi32(rgba, 24);
+    const __m128i transparent = _mm_cmpeq_epi32(alpha, zero);
+
+    not_opaque =
+        _mm_or_si128(not_opaque, _mm_xor_si128(_mm_cmpeq_epi32(alpha, opaque_alpha), all_ones));
+    colored_transparent = _mm_or_si128(colored_transparent,
+                                       _mm_and_si128(transparent, _mm_and_si128(rgba, color_mask)));
+
+    // Treat the color channels of fully transparent pixels as 0x00.
+    rgba = _mm_andnot_si128(transparent, rgba);
+
+    // Byte 0 of each lane becomes |R - G| and byte 1 becomes |G - B|.
+    const __m128i adjacent =
+        _mm_and_si128(AbsDiffU8(rgba, _mm_srli_epi32(rgba, 8)), two_byte_mask);
+    // Byte 0 of each lane becomes |R - B|.
+    const __m128i outer =
+        _mm_and_si128(AbsDiffU8(rgba, _mm_srli_epi32(rgba, 16)), one_byte_mask);
+    max_deviation = _mm_max_epu8(max_deviation, _mm_max_epu8(adjacent, outer));
+  }
+
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(not_opaque, zero)) != 0xffff) {
+    stats->opaque = false;
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(colored_transparent, zero)) != 0xffff) {
+    stats->has_colored_transparent_pixels = true;
+  }
+
+  alignas(16) uint8_t deviations[16];
+  _mm_store_si128(reinterpret_cast<__m128i*>(deviations), max_deviation);
+  stats->max_gray_deviation =
+      std::max<int>(stats->max_gray_deviation, *std::max_element(deviations, deviations + 16));
+
+  AnalyzePixelsScalar(pixels, pixel_count - i, stats);
+}
+
+#else
+
+void AnalyzePixels(const uint8_t* pixels, size_t pixel_count, PixelStats* stats) {
+  AnalyzePixelsScalar(pixels, pixel_count, stats);
+}
+
+#endif  // defined(__SSE2__)
+
+}  // namespace aapt
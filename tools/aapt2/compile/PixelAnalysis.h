@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_COMPILE_PIXELANALYSIS_H
+#define AAPT_COMPILE_PIXELANALYSIS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aapt {
+
+/**
+ * Properties of RGBA_8888 pixel data that determine how an image can be encoded. Fully
+ * transparent pixels are treated as if their color channels were all 0x00.
+ */
+struct PixelStats {
+  // True if every pixel has an alpha of 0xff.
+  bool opaque = true;
+
+  // True if a fully transparent pixel has a non-zero color channel.
+  bool has_colored_transparent_pixels = false;
+
+  // The largest difference between any two color channels of a single pixel. An image whose
+  // deviation is 0 is grayscale.
+  int max_gray_deviation = 0;
+};
+
+/**
+ * Scans `pixel_count` RGBA_8888 pixels starting at `pixels` and merges the result into `stats`.
+ * Pixels are processed 4 at a time with SIMD instructions where they are available.
+ */
+void AnalyzePixels(const uint8_t* pixels, size_t pixel_count, PixelStats* stats);
+
+}  // namespace aapt
+
+#endif  // AAPT_COMPILE_PIXELANALYSIS_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compile/PixelAnalysis.h"
+
+#include <vector>
+
+#include "test/Test.h"
+
+namespace aapt {
+
+static std::vector<uint8_t> MakePixels(size_t count, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  std::vector<uint8_t> pixels;
+  for (size_t i = 0; i < count; i++) {
+    pixels.insert(pixels.end(), {r, g, b, a});
+  }
+  return pixels;
+}
+
+TEST(PixelAnalysisTest, OpaqueGrayscale) {
+  std::vector<uint8_t> pixels = MakePixels(13, 0x80, 0x80, 0x80, 0xff);
+
+  PixelStats stats;
+  AnalyzePixels(pixels.data(), 13, &stats);
+  EXPECT_TRUE(stats.opaque);
+  EXPECT_FALSE(stats.has_colored_transparent_pixels);
+  EXPECT_EQ(0, stats.max_gray_deviation);
+}
+
+TEST(PixelAnalysisTest, MaxGrayDeviationInVectorAndTail) {
+  std::vector<uint8_t> pixels = MakePixels(9, 0x10, 0x10, 0x10, 0xff);
+  // Inside the first 4-pixel block.
+  pixels[2 * 4 + 1] = 0x30;
+  PixelStats stats;
+  AnalyzePixels(pixels.data(), 9, &stats);
+  EXPECT_EQ(0x20, stats.max_gray_deviation);
+
+  // In the scalar tail.
+  pixels[8 * 4 + 2] = 0x60;
+  stats = {};
+  AnalyzePixels(pixels.data(), 9, &stats);
+  EXPECT_EQ(0x50, stats.max_gray_deviation);
+}
+
+TEST(PixelAnalysisTest, RedBlueDeviation) {
+  std::vector<uint8_t> pixels = MakePixels(4, 0xf0, 0x80, 0x10, 0xff);
+
+  PixelStats stats;
+  AnalyzePixels(pixels.data(), 4, &stats);
+  EXPECT_EQ(0xe0, stats.max_gray_deviation);
+}
+
+TEST(PixelAnalysisTest, TranslucentPixelIsNotOpaque) {
+  std::vector<uint8_t> pixels = MakePixels(8, 0x00, 0x00, 0x00, 0xff);
+  pixels[5 * 4 + 3] = 0x7f;
+
+  PixelStats stats;
+  AnalyzePixels(pixels.data(), 8, &stats);
+  EXPECT_FALSE(stats.opaque);
+  EXPECT_FALSE(stats.has_colored_transparent_pixels);
+}
+
+TEST(PixelAnalysisTest, TransparentPixelsAreTreatedAsBlack) {
+  std::vector<uint8_t> pixels = MakePixels(5, 0xff, 0x00, 0x00, 0x00);
+
+  PixelStats stats;
+  AnalyzePixels(pixels.data(), 5, &stats);
+  EXPECT_FALSE(stats.opaque);
+  EXPECT_TRUE(stats.has_colored_transparent_pixels);
+  EXPECT_EQ(0, stats.max_gray_deviation);
+}
+
+TEST(PixelAnalysisTest, MergesIntoExistingStats) {
+  std::vector<uint8_t> gray = MakePixels(4, 0x40, 0x40, 0x40, 0xff);
+  std::vector<uint8_t> color = MakePixels(4, 0x40, 0x48, 0x40, 0x80);
+
+  PixelStats stats;
+  AnalyzePixels(color.data(), 4, &stats);
+  AnalyzePixels(gray.data(), 4, &stats);
+  EXPECT_FALSE(stats.opaque);
+  EXPECT_EQ(8, stats.max_gray_deviation);
+}
+
+}  // namespace aapt
@@ -27,6 +27,8 @@
 #include "android-base/logging.h"
 #include "android-base/macros.h"
 
+#include "compile/PixelAnalysis.h"
+
 namespace aapt {
 
 // Custom deleter that destroys libpng read and info structs.
@@ -521,14 +523,25 @@ bool WritePng(IAaptContext* context, const Image* image,
   // 1. Every pixel has R == G == B (grayscale)
   // 2. Every pixel has A == 255 (opaque)
   // 3. There are no more than 256 distinct RGBA colors (palette).
+  //
+  // The first two are computed with vectorized kernels. Collecting the palette is the expensive
+  // part, so it stops as soon as the image is known to need more than 256 colors, and it skips
+  // runs of identical pixels.
+  constexpr const size_t kMaxPaletteSize = 256u;
   std::unordered_map<uint32_t, int> color_palette;
   std::unordered_set<uint32_t> alpha_palette;
-  bool needs_to_zero_rgb_channels_of_transparent_pixels = false;
-  bool grayscale = true;
-  int max_gray_deviation = 0;
+  PixelStats stats;
+  bool has_last_color = false;
+  uint32_t last_color = 0;
 
   for (int32_t y = 0; y < image->height; y++) {
     const uint8_t* row = image->rows[y];
+    AnalyzePixels(row, image->width, &stats);
+
+    if (color_palette.size() > kMaxPaletteSize) {
+      continue;
+    }
+
     for (int32_t x = 0; x < image->width; x++) {
       int red = *row++;
       int green = *row++;
@@ -539,14 +552,17 @@ bool WritePng(IAaptContext* context, const Image* image,
         // The color is completely transparent.
         // For purposes of palettes and grayscale optimization,
         // treat all channels as 0x00.
-        needs_to_zero_rgb_channels_of_transparent_pixels =
-            needs_to_zero_rgb_channels_of_transparent_pixels ||
-            (red != 0 || green != 0 || blue != 0);
         red = green = blue = 0;
       }
 
-      // Insert the color into the color palette.
       const uint32_t color = red << 24 | green << 16 | blue << 8 | alpha;
+      if (has_last_color && color == last_color) {
+        continue;
+      }
+      has_last_color = true;
+      last_color = color;
+
+      // Insert the color into the color palette.
       color_palette[color] = -1;
 
       // If the pixel has non-opaque alpha, insert it into the
@@ -555,24 +571,26 @@ bool WritePng(IAaptContext* context, const Image* image,
         alpha_palette.insert(color);
       }
 
-      // Check if the image is indeed grayscale.
-      if (grayscale) {
-        if (red != green || red != blue) {
-          grayscale = false;
-        }
+      if (color_palette.size() > kMaxPaletteSize) {
+        break;
       }
-
-      // Calculate the gray scale deviation so that it can be compared
-      // with the threshold.
-      max_gray_deviation = std::max(std::abs(red - green), max_gray_deviation);
-      max_gray_deviation = std::max(std::abs(green - blue), max_gray_deviation);
-      max_gray_deviation = std::max(std::abs(blue - red), max_gray_deviation);
     }
   }
 
+  const bool needs_to_zero_rgb_channels_of_transparent_pixels =
+      stats.has_colored_transparent_pixels;
+  const bool grayscale = stats.max_gray_deviation == 0;
+  const int max_gray_deviation = stats.max_gray_deviation;
+
+  // The alpha palette is incomplete when palette collection stopped early, but then only whether
+  // it is empty matters.
+  const size_t alpha_palette_size =
+      stats.opaque ? 0u : std::max(alpha_palette.size(), static_cast<size_t>(1u));
+
   if (context->IsVerbose()) {
     DiagMessage msg;
     msg << " paletteSize=" << color_palette.size()
+        << (color_palette.size() > kMaxPaletteSize ? "+" : "")
         << " alphaPaletteSize=" << alpha_palette.size()
         << " maxGrayDeviation=" << max_gray_deviation
         << " grayScale=" << (grayscale ? "true" : "false");
@@ -583,7 +601,7 @@ bool WritePng(IAaptContext* context, const Image* image,
 
   const int new_color_type = PickColorType(
       image->width, image->height, grayscale, convertible_to_grayscale,
-      nine_patch != nullptr, color_palette.size(), alpha_palette.size());
+      nine_patch != nullptr, color_palette.size(), alpha_palette_size);
 
   if (context->IsVerbose()) {
     DiagMessage msg;
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "compile/XmlStreamCompiler.h"
+
+#include <expat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "android-base/logging.h"
+
+#include "ResourceUtils.h"
+#include "xml/XmlUtil.h"
+
+using ::android::StringPiece;
+
+namespace aapt {
+
+namespace {
+
+constexpr char kXmlNamespaceSep = 1;
+
+// A namespace declaration that belongs to the next element to start.
+struct PendingNamespace {
+  std::string prefix;
+  std::string uri;
+  size_t line_number;
+  size_t column_number;
+};
+
+// An attribute of the element being started. The strings point into the parser's buffers.
+struct AttributeRef {
+  StringPiece namespace_uri;
+  StringPiece name;
+  StringPiece value;
+};
+
+struct CompileState {
+  XML_Parser parser;
+  pb::XmlNode* root;
+  std::vector<SourcedResourceName>* exported_symbols;
+
+  // The elements that were started but not ended yet.
+  std::vector<pb::XmlElement*> element_stack;
+  std::vector<PendingNamespace> pending_namespaces;
+
+  // The text node that character data is appended to, until another node starts or ends.
+  pb::XmlNode* text_node = nullptr;
+
+  // Reused for every element, to avoid allocating while the document is parsed.
+  std::vector<AttributeRef> attributes;
+};
+
+// Orders strings the same way as std::string, so that attributes are sorted like in the DOM.
+int CompareBytes(const StringPiece& a, const StringPiece& b) {
+  const int result =
+      std::char_traits<char>::compare(a.data(), b.data(), std::min(a.size(), b.size()));
+  if (result != 0) {
+    return result;
+  }
+  return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+}
+
+bool LessAttribute(const AttributeRef& lhs, const AttributeRef& rhs) {
+  int result = CompareBytes(lhs.namespace_uri, rhs.namespace_uri);
+  if (result == 0) {
+    result = CompareBytes(lhs.name, rhs.name);
+    if (result == 0) {
+      result = CompareBytes(lhs.value, rhs.value);
+    }
+  }
+  return result < 0;
+}
+
+// Splits an expanded element or attribute name into its namespace and name.
+void SplitName(const char* name, StringPiece* out_ns, StringPiece* out_name) {
+  const char* sep = std::strchr(name, kXmlNamespaceSep);
+  if (sep == nullptr) {
+    *out_ns = StringPiece();
+    *out_name = StringPiece(name);
+  } else {
+    *out_ns = StringPiece(name, sep - name);
+    *out_name = StringPiece(sep + 1);
+  }
+}
+
+void SetSource(XML_Parser parser, pb::SourcePosition* out_source) {
+  out_source->set_line_number(XML_GetCurrentLineNumber(parser));
+  out_source->set_column_number(XML_GetCurrentColumnNumber(parser));
+}
+
+// Records the IDs that `value` creates, keeping the first line each one appears on.
+void CollectId(const StringPiece& value, size_t line_number,
+               std::vector<SourcedResourceName>* out_symbols) {
+  ResourceNameRef name;
+  bool create = false;
+  if (!ResourceUtils::ParseReference(value, &name, &create, nullptr) || !create ||
+      name.type != ResourceType::kId) {
+    return;
+  }
+
+  auto iter = std::lower_bound(
+      out_symbols->begin(), out_symbols->end(), name,
+      [](const SourcedResourceName& a, const ResourceNameRef& b) { return a.name < b; });
+  if (iter == out_symbols->end() || iter->name != name) {
+    out_symbols->insert(iter, SourcedResourceName{name.ToResourceName(), line_number});
+  }
+}
+
+void XMLCALL StartNamespaceHandler(void* user_data, const char* prefix, const char* uri) {
+  CompileState* state = reinterpret_cast<CompileState*>(user_data);
+  state->text_node = nullptr;
+  state->pending_namespaces.push_back(
+      PendingNamespace{prefix ? prefix : "", uri ? uri : "",
+                       XML_GetCurrentLineNumber(state->parser),
+                       XML_GetCurrentColumnNumber(state->parser)});
+}
+
+void XMLCALL EndNamespaceHandler(void* user_data, const char* /*prefix*/) {
+  CompileState* state = reinterpret_cast<CompileState*>(user_data);
+  state->text_node = nullptr;
+}
+
+void XMLCALL StartElementHandler(void* user_data, const char* name, const char** attrs) {
+  CompileState* state = reinterpret_cast<CompileState*>(user_data);
+  state->text_node = nullptr;
+
+  pb::XmlNode* node;
+  if (state->element_stack.empty()) {
+    node = state->root;
+  } else {
+    node = state->element_stack.back()->add_child();
+  }
+  SetSource(state->parser, node->mutable_source());
+  const size_t line_number = XML_GetCurrentLineNumber(state->parser);
+
+  pb::XmlElement* element = node->mutable_element();
+  StringPiece ns;
+  StringPiece element_name;
+  SplitName(name, &ns, &element_name);
+  element->set_name(element_name.data(), element_name.size());
+  element->set_namespace_uri(ns.data(), ns.size());
+
+  for (PendingNamespace& pending : state->pending_namespaces) {
+    pb::XmlNamespace* pb_ns = element->add_namespace_declaration();
+    pb_ns->set_prefix(std::move(pending.prefix));
+    pb_ns->set_uri(std::move(pending.uri));
+    pb::SourcePosition* pb_src = pb_ns->mutable_source();
+    pb_src->set_line_number(pending.line_number);
+    pb_src->set_column_number(pending.column_number);
+  }
+  state->pending_namespaces.clear();
+
+  state->attributes.clear();
+  while (*attrs) {
+    AttributeRef attr;
+    SplitName(*attrs++, &attr.namespace_uri, &attr.name);
+    attr.value = *attrs++;
+    state->attributes.push_back(attr);
+  }
+  std::sort(state->attributes.begin(), state->attributes.end(), LessAttribute);
+
+  for (const AttributeRef& attr : state->attributes) {
+    pb::XmlAttribute* pb_attr = element->add_attribute();
+    pb_attr->set_name(attr.name.data(), attr.name.size());
+    pb_attr->set_namespace_uri(attr.namespace_uri.data(), attr.namespace_uri.size());
+    pb_attr->set_value(attr.value.data(), attr.value.size());
+    CollectId(attr.value, line_number, state->exported_symbols);
+  }
+
+  state->element_stack.push_back(element);
+}
+
+void XMLCALL EndElementHandler(void* user_data, const char* /*name*/) {
+  CompileState* state = reinterpret_cast<CompileState*>(user_data);
+  state->text_node = nullptr;
+
+  CHECK(!state->element_stack.empty());
+  state->element_stack.pop_back();
+}
+
+void XMLCALL CharacterDataHandler(void* user_data, const char* s, int len) {
+  CompileState* state = reinterpret_cast<CompileState*>(user_data);
+  if (len <= 0 || state->element_stack.empty()) {
+    return;
+  }
+
+  // Consecutive runs of character data form a single text node.
+  if (state->text_node == nullptr) {
+    state->text_node = state->element_stack.back()->add_child();
+    SetSource(state->parser, state->text_node->mutable_source());
+    state->text_node->set_text(s, len);
+  } else {
+    state->text_node->mutable_text()->append(s, len);
+  }
+}
+
+void XMLCALL CommentDataHandler(void* user_data, const char* /*comment*/) {
+  // Comments are not compiled, but like in the DOM they split the text around them.
+  CompileState* state = reinterpret_cast<CompileState*>(user_data);
+  state->text_node = nullptr;
+}
+
+}  // namespace
+
+bool XmlRequiresDom(const StringPiece& data) {
+  const StringPiece schema(xml::kSchemaAapt);
+  return std::search(data.begin(), data.end(), schema.begin(), schema.end()) != data.end();
+}
+
+bool CompileXmlStream(const StringPiece& data, const Source& source, IDiagnostics* diag,
+                      pb::XmlNode* out_node,
+                      std::vector<SourcedResourceName>* out_exported_symbols) {
+  std::unique_ptr<std::remove_pointer<XML_Parser>::type, decltype(XML_ParserFree)*> parser = {
+      XML_ParserCreateNS(nullptr, kXmlNamespaceSep), XML_ParserFree};
+
+  CompileState state;
+  state.parser = parser.get();
+  state.root = out_node;
+  state.exported_symbols = out_exported_symbols;
+  out_exported_symbols->clear();
+
+  XML_SetUserData(parser.get(), &state);
+  XML_SetElementHandler(parser.get(), StartElementHandler, EndElementHandler);
+  XML_SetNamespaceDeclHandler(parser.get(), StartNamespaceHandler, EndNamespaceHandler);
+  XML_SetCharacterDataHandler(parser.get(), CharacterDataHandler);
+  XML_SetCommentHandler(parser.get(), CommentDataHandler);
+
+  if (XML_Parse(parser.get(), data.data(), data.size(), true) == XML_STATUS_ERROR) {
+    diag->Error(DiagMessage(source.WithLine(XML_GetCurrentLineNumber(parser.get())))
+                << XML_ErrorString(XML_GetErrorCode(parser.get())));
+    return false;
+  }
+  return true;
+}
+
+}  // namespace aapt
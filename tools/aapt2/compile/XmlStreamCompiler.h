@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef AAPT_COMPILE_XMLSTREAMCOMPILER_H
+#define AAPT_COMPILE_XMLSTREAMCOMPILER_H
+
+#include <vector>
+
+#include "androidfw/StringPiece.h"
+
+#include "Diagnostics.h"
+#include "Resource.h"
+#include "Resources.pb.h"
+#include "Source.h"
+
+namespace aapt {
+
+// Returns true if the XML document in `data` must be compiled through the xml::XmlResource DOM,
+// because it may contain inline <aapt:attr> values that are extracted into separate documents.
+bool XmlRequiresDom(const android::StringPiece& data);
+
+// Compiles the XML document in `data` straight from the parser's events into its protobuf form,
+// without building an xml::XmlResource. The result is the same as inflating the document,
+// collecting its IDs with XmlIdCollector and serializing it with SerializeXmlToPb. The IDs that
+// the document creates with "@+id/" are written to `out_exported_symbols`.
+//
+// Must not be used for documents for which XmlRequiresDom() returns true.
+bool CompileXmlStream(const android::StringPiece& data, const Source& source, IDiagnostics* diag,
+                      pb::XmlNode* out_node,
+                      std::vector<SourcedResourceName>* out_exported_symbols);
+
+}  // namespace aapt
+
+#endif  // AAPT_COMPILE_XMLSTREAMCOMPILER_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "compile/XmlStreamCompiler.h"
+
+#include "compile/XmlIdCollector.h"
+#include "format/proto/ProtoSerialize.h"
+#include "io/StringStream.h"
+#include "test/Test.h"
+#include "xml/XmlDom.h"
+
+using ::testing::ElementsAre;
+
+namespace aapt {
+
+// Compiles `input` both with and without the DOM, and checks that the results are the same.
+static ::testing::AssertionResult CompilesLikeDom(const std::string& input) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+
+  io::StringInputStream in(input);
+  std::unique_ptr<xml::XmlResource> doc = xml::Inflate(&in, context->GetDiagnostics(), {});
+  if (doc == nullptr) {
+    return ::testing::AssertionFailure() << "failed to inflate";
+  }
+
+  XmlIdCollector collector;
+  if (!collector.Consume(context.get(), doc.get())) {
+    return ::testing::AssertionFailure() << "failed to collect IDs";
+  }
+
+  pb::XmlNode expected_node;
+  SerializeXmlToPb(*doc->root, &expected_node);
+
+  pb::XmlNode node;
+  std::vector<SourcedResourceName> symbols;
+  if (!CompileXmlStream(input, {}, context->GetDiagnostics(), &node, &symbols)) {
+    return ::testing::AssertionFailure() << "failed to compile";
+  }
+
+  if (node.SerializeAsString() != expected_node.SerializeAsString()) {
+    return ::testing::AssertionFailure() << "compiled to a different XmlNode";
+  }
+
+  if (symbols != doc->file.exported_symbols) {
+    return ::testing::AssertionFailure() << "collected different IDs";
+  }
+  return ::testing::AssertionSuccess();
+}
+
+TEST(XmlStreamCompilerTest, CompilesLikeDom) {
+  EXPECT_TRUE(CompilesLikeDom(R"(<?xml version="1.0" encoding="utf-8"?>
+      <!-- A comment before the root. -->
+      <LinearLayout xmlns:android="http://schemas.android.com/apk/res/android"
+          xmlns:app="http://schemas.android.com/apk/res-auto"
+          android:orientation="vertical"
+          app:layout="@layout/other"
+          android:id="@+id/root">
+        <TextView android:text="hello &amp; goodbye" android:id="@+id/text" text="plain"/>
+        text before <!-- comment --> text after <![CDATA[<cdata>]]>
+        <View android:id="@+id/text" android:tag="@+string/not_an_id" />
+        <merge xmlns:tools="http://schemas.android.com/tools" tools:ignore="All">
+          <include layout="@layout/foo" />
+        </merge>
+      </LinearLayout>)"));
+}
+
+TEST(XmlStreamCompilerTest, CollectsIdsOnFirstLine) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+
+  pb::XmlNode node;
+  std::vector<SourcedResourceName> symbols;
+  ASSERT_TRUE(CompileXmlStream("<View\n  a=\"@+id/foo\">\n  <View b=\"@+id/bar\" c=\"@+id/foo\"/>"
+                               "\n</View>",
+                               {}, context->GetDiagnostics(), &node, &symbols));
+  EXPECT_THAT(symbols, ElementsAre(SourcedResourceName{test::ParseNameOrDie("id/bar"), 3u},
+                                   SourcedResourceName{test::ParseNameOrDie("id/foo"), 1u}));
+}
+
+TEST(XmlStreamCompilerTest, FailOnMalformedXml) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+
+  pb::XmlNode node;
+  std::vector<SourcedResourceName> symbols;
+  EXPECT_FALSE(CompileXmlStream("<View><Other></View>", {}, context->GetDiagnostics(), &node,
+                                &symbols));
+}
+
+TEST(XmlStreamCompilerTest, InlineXmlRequiresDom) {
+  EXPECT_TRUE(XmlRequiresDom(R"(<View xmlns:aapt="http://schemas.android.com/aapt">
+        <aapt:attr name="android:drawable"><vector /></aapt:attr></View>)"));
+  EXPECT_FALSE(
+      XmlRequiresDom("<View xmlns:android=\"http://schemas.android.com/apk/res/android\"/>"));
+}
+
+}  // namespace aapt
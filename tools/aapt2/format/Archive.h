@@ -26,6 +26,7 @@
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 #include "Diagnostics.h"
+#include "io/File.h"
 #include "io/Io.h"
 #include "util/BigBuffer.h"
 #include "util/Files.h"
@@ -68,6 +69,25 @@ class IArchiveWriter : public ::google::protobuf::io::CopyingOutputStream {
 
   // Returns the error message if HadError() returns true.
   virtual std::string GetError() const = 0;
+
+  // Returns true if WriteDeflatedFile() can be used with this writer.
+  virtual bool SupportsDeflatedFiles() const {
+    return false;
+  }
+
+  // Writes an entry whose contents are already deflated, copying them as-is. The entry is
+  // compressed regardless of `flags`.
+  virtual bool WriteDeflatedFile(const android::StringPiece& path, uint32_t flags,
+                                 io::DeflatedData data) {
+    return false;
+  }
+
+  // Writes out anything that is still buffered and completes the archive. Writers that write
+  // everything as it is received complete the archive when destroyed, and need not be finished
+  // explicitly. Returns false if there was an error writing to the archive.
+  virtual bool Finish() {
+    return !HadError();
+  }
 };
 
 std::unique_ptr<IArchiveWriter> CreateDirectoryArchiveWriter(IDiagnostics* diag,
@@ -76,6 +96,13 @@ std::unique_ptr<IArchiveWriter> CreateDirectoryArchiveWriter(IDiagnostics* diag,
 std::unique_ptr<IArchiveWriter> CreateZipFileArchiveWriter(IDiagnostics* diag,
                                                            const android::StringPiece& path);
 
+// Creates a ZIP archive writer that deflates entries on up to `max_jobs` threads (0 means one per
+// CPU core) and copies already deflated entries without recompressing them. Entries are buffered
+// and written in batches, in the order they were added, so the output is deterministic.
+// Finish() must be called to learn whether the last batch was written successfully.
+std::unique_ptr<IArchiveWriter> CreateParallelZipFileArchiveWriter(
+    IDiagnostics* diag, const android::StringPiece& path, size_t max_jobs = 0);
+
 }  // namespace aapt
 
 #endif /* AAPT_FORMAT_ARCHIVE_H */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "format/Archive.h"
+
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
+
+#include "io/Data.h"
+#include "io/StringStream.h"
+#include "io/ZipArchive.h"
+#include "test/Test.h"
+
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+using ::testing::NotNull;
+
+namespace aapt {
+
+static std::string ReadFile(io::IFile* file) {
+  std::unique_ptr<io::IData> data = file->OpenAsData();
+  CHECK(data != nullptr);
+  return std::string(reinterpret_cast<const char*>(data->data()), data->size());
+}
+
+static uint32_t ReadLE(const std::string& data, size_t offset, size_t size) {
+  uint32_t value = 0u;
+  for (size_t i = 0; i < size; i++) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data[offset + i])) << (8u * i);
+  }
+  return value;
+}
+
+// Returns the names of the entries of the ZIP file at `path` in the order of its central
+// directory. Fails the test if the local file headers of the entries are not in the same order.
+// ZipFileCollection can't be used for this, since it iterates the entries in hash order.
+static std::vector<std::string> ReadEntryNamesInOrder(const std::string& path) {
+  constexpr uint32_t kEndOfCentralDirSignature = 0x06054b50u;
+  constexpr uint32_t kCentralDirHeaderSignature = 0x02014b50u;
+  constexpr size_t kEndOfCentralDirSize = 22u;
+  constexpr size_t kCentralDirHeaderSize = 46u;
+
+  std::string data;
+  if (!android::base::ReadFileToString(path, &data) || data.size() < kEndOfCentralDirSize) {
+    ADD_FAILURE() << "failed to read " << path;
+    return {};
+  }
+
+  // The archives written here have no comment, so the end of central directory record is last.
+  const size_t eocd = data.size() - kEndOfCentralDirSize;
+  if (ReadLE(data, eocd, 4u) != kEndOfCentralDirSignature) {
+    ADD_FAILURE() << "no end of central directory record in " << path;
+    return {};
+  }
+
+  const uint32_t entry_count = ReadLE(data, eocd + 10u, 2u);
+  size_t offset = ReadLE(data, eocd + 16u, 4u);
+  std::vector<std::string> names;
+  uint32_t last_local_header_offset = 0u;
+  for (uint32_t i = 0; i < entry_count; i++) {
+    if (offset + kCentralDirHeaderSize > eocd ||
+        ReadLE(data, offset, 4u) != kCentralDirHeaderSignature) {
+      ADD_FAILURE() << "corrupt central directory in " << path;
+      return {};
+    }
+    const size_t name_size = ReadLE(data, offset + 28u, 2u);
+    const size_t extra_size = ReadLE(data, offset + 30u, 2u);
+    const size_t comment_size = ReadLE(data, offset + 32u, 2u);
+    const uint32_t local_header_offset = ReadLE(data, offset + 42u, 4u);
+    names.push_back(data.substr(offset + kCentralDirHeaderSize, name_size));
+    if (i > 0u) {
+      EXPECT_GT(local_header_offset, last_local_header_offset) << names.back();
+    }
+    last_local_header_offset = local_header_offset;
+    offset += kCentralDirHeaderSize + name_size + extra_size + comment_size;
+  }
+  return names;
+}
+
+TEST(ParallelZipFileWriterTest, WritesEntriesInOrder) {
+  StdErrDiagnostics diag;
+  TemporaryFile file;
+  const std::string compressible(4096, 'a');
+  // Enough entries that the workers finish them out of order, and that no other order matches.
+  const int kEntryCount = 200;
+  std::vector<std::string> expected_names;
+  {
+    std::unique_ptr<IArchiveWriter> writer =
+        CreateParallelZipFileArchiveWriter(&diag, file.path, 4u);
+    ASSERT_THAT(writer, NotNull());
+
+    for (int i = 0; i < kEntryCount; i++) {
+      // Entries of different sizes take different times to deflate.
+      const std::string contents = compressible.substr(0, (i * 997) % 4096) + std::to_string(i);
+      io::StringInputStream in(contents);
+      expected_names.push_back("res/raw/file" + std::to_string(i));
+      ASSERT_TRUE(writer->WriteFile(expected_names.back(), ArchiveEntry::kCompress, &in));
+    }
+
+    expected_names.push_back("resources.arsc");
+    ASSERT_TRUE(writer->StartEntry("resources.arsc", ArchiveEntry::kAlign));
+    ASSERT_TRUE(writer->Write("abc", 3));
+    ASSERT_TRUE(writer->FinishEntry());
+    ASSERT_TRUE(writer->Finish()) << writer->GetError();
+  }
+
+  EXPECT_THAT(ReadEntryNamesInOrder(file.path), ElementsAreArray(expected_names));
+
+  std::string error;
+  std::unique_ptr<io::ZipFileCollection> zip = io::ZipFileCollection::Create(file.path, &error);
+  ASSERT_THAT(zip, NotNull()) << error;
+
+  for (int i = 0; i < kEntryCount; i++) {
+    io::IFile* entry = zip->FindFile(expected_names[i]);
+    ASSERT_THAT(entry, NotNull());
+    EXPECT_THAT(ReadFile(entry),
+                Eq(compressible.substr(0, (i * 997) % 4096) + std::to_string(i)));
+  }
+
+  io::IFile* table = zip->FindFile("resources.arsc");
+  ASSERT_THAT(table, NotNull());
+  EXPECT_FALSE(table->WasCompressed());
+  std::unique_ptr<io::IData> table_data = table->OpenAsData();
+  ASSERT_THAT(table_data, NotNull());
+  EXPECT_THAT(reinterpret_cast<uintptr_t>(table_data->data()) % 4u, Eq(0u));
+}
+
+TEST(ParallelZipFileWriterTest, StoresFilesThatDoNotCompress) {
+  StdErrDiagnostics diag;
+  TemporaryFile file;
+  {
+    std::unique_ptr<IArchiveWriter> writer = CreateParallelZipFileArchiveWriter(&diag, file.path);
+    ASSERT_THAT(writer, NotNull());
+
+    // Only inputs that can be rewound fall back to being stored.
+    std::unique_ptr<uint8_t[]> data(new uint8_t[1]{'x'});
+    io::MallocData in(std::move(data), 1u);
+    ASSERT_TRUE(writer->WriteFile("tiny.txt", ArchiveEntry::kCompress, &in));
+    ASSERT_TRUE(writer->Finish()) << writer->GetError();
+  }
+
+  std::unique_ptr<io::ZipFileCollection> zip = io::ZipFileCollection::Create(file.path, nullptr);
+  ASSERT_THAT(zip, NotNull());
+  io::IFile* entry = zip->FindFile("tiny.txt");
+  ASSERT_THAT(entry, NotNull());
+  EXPECT_FALSE(entry->WasCompressed());
+  EXPECT_THAT(ReadFile(entry), Eq("x"));
+}
+
+TEST(ParallelZipFileWriterTest, CopiesDeflatedFilesWithoutRecompressing) {
+  StdErrDiagnostics diag;
+  TemporaryFile source_file;
+  const std::string contents(8192, 'z');
+  {
+    std::unique_ptr<IArchiveWriter> writer =
+        CreateParallelZipFileArchiveWriter(&diag, source_file.path);
+    ASSERT_THAT(writer, NotNull());
+    io::StringInputStream in(contents);
+    ASSERT_TRUE(writer->WriteFile("res/raw/big", ArchiveEntry::kCompress, &in));
+    ASSERT_TRUE(writer->Finish()) << writer->GetError();
+  }
+
+  std::unique_ptr<io::ZipFileCollection> source =
+      io::ZipFileCollection::Create(source_file.path, nullptr);
+  ASSERT_THAT(source, NotNull());
+  io::IFile* source_entry = source->FindFile("res/raw/big");
+  ASSERT_THAT(source_entry, NotNull());
+
+  io::DeflatedData deflated;
+  ASSERT_TRUE(source_entry->OpenDeflatedData(&deflated));
+  EXPECT_THAT(deflated.uncompressed_size, Eq(contents.size()));
+  EXPECT_LT(deflated.data->size(), contents.size());
+
+  TemporaryFile dest_file;
+  {
+    std::unique_ptr<IArchiveWriter> writer =
+        CreateParallelZipFileArchiveWriter(&diag, dest_file.path);
+    ASSERT_THAT(writer, NotNull());
+    ASSERT_TRUE(writer->SupportsDeflatedFiles());
+    ASSERT_TRUE(writer->WriteDeflatedFile("res/raw/copy", 0u, std::move(deflated)));
+    ASSERT_TRUE(writer->Finish()) << writer->GetError();
+  }
+
+  std::unique_ptr<io::ZipFileCollection> dest =
+      io::ZipFileCollection::Create(dest_file.path, nullptr);
+  ASSERT_THAT(dest, NotNull());
+  io::IFile* dest_entry = dest->FindFile("res/raw/copy");
+  ASSERT_THAT(dest_entry, NotNull());
+  EXPECT_TRUE(dest_entry->WasCompressed());
+  EXPECT_THAT(ReadFile(dest_entry), Eq(contents));
+}
+
+}  // namespace aapt
@@ -16,6 +16,9 @@
 
 #include "format/Container.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "android-base/scopeguard.h"
 #include "android-base/stringprintf.h"
 
@@ -241,7 +244,14 @@ bool ContainerReaderEntry::GetResFileOffsets(pb::internal::CompiledFile* out_fil
   *out_offset = coded_in.CurrentPosition();
   *out_len = data_length;
 
-  coded_in.Skip(static_cast<int>(data_length));
+  if (data_length > static_cast<::google::protobuf::uint64>(std::numeric_limits<int>::max()) ||
+      !coded_in.Skip(static_cast<int>(data_length))) {
+    std::ostringstream error;
+    error << "failed to skip " << data_length << " bytes of data from input: "
+          << reader_->in_->GetError();
+    reader_->error_ = error.str();
+    return false;
+  }
   AlignRead(&coded_in);
   return true;
 }
@@ -261,6 +271,25 @@ ContainerReader::ContainerReader(io::InputStream* in)
       total_entry_count_(0u),
       current_entry_count_(0u),
       entry_(this) {
+  ReadHeader();
+}
+
+ContainerReader::ContainerReader(io::IData* data)
+    : in_(data),
+      adaptor_(data),
+      coded_in_(static_cast<const ::google::protobuf::uint8*>(data->data()),
+                static_cast<int>(std::min<size_t>(data->size(), std::numeric_limits<int>::max()))),
+      total_entry_count_(0u),
+      current_entry_count_(0u),
+      entry_(this) {
+  if (data->size() > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    error_ = StringPrintf("input of %zu bytes is too large", data->size());
+    return;
+  }
+  ReadHeader();
+}
+
+void ContainerReader::ReadHeader() {
   ::google::protobuf::uint32 magic;
   if (!coded_in_.ReadLittleEndian32(&magic)) {
     std::ostringstream error;
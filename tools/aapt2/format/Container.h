@@ -24,6 +24,7 @@
 
 #include "Resources.pb.h"
 #include "ResourcesInternal.pb.h"
+#include "io/Data.h"
 #include "io/Io.h"
 #include "io/Util.h"
 #include "util/BigBuffer.h"
@@ -82,6 +83,12 @@ class ContainerReader {
  public:
   explicit ContainerReader(io::InputStream* in);
 
+  // Reads the container directly out of `data`, which is usually a mmapped file. Entries are parsed
+  // in place without copying the input into intermediate buffers, and the offsets returned by
+  // ContainerReaderEntry::GetResFileOffsets() can be used to create views into `data`.
+  // `data` must outlive the reader.
+  explicit ContainerReader(io::IData* data);
+
   ContainerReaderEntry* Next();
 
   bool HadError() const;
@@ -92,6 +99,8 @@ class ContainerReader {
 
   friend class ContainerReaderEntry;
 
+  void ReadHeader();
+
   io::InputStream* in_;
   io::ZeroCopyInputAdaptor adaptor_;
   ::google::protobuf::io::CodedInputStream coded_in_;
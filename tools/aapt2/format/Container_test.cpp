@@ -16,6 +16,8 @@
 
 #include "format/Container.h"
 
+#include <cstring>
+
 #include "google/protobuf/io/zero_copy_stream_impl_lite.h"
 
 #include "io/StringStream.h"
@@ -87,4 +89,91 @@ TEST(ContainerTest, SerializeCompiledFile) {
   EXPECT_THAT(reader.GetError(), IsEmpty());
 }
 
+TEST(ContainerTest, ReadContainerInPlaceFromData) {
+  const std::string expected_data = "12345";
+
+  std::string output_str;
+  {
+    StringOutputStream out_stream(&output_str);
+    ContainerWriter writer(&out_stream, 2u);
+    ASSERT_FALSE(writer.HadError());
+
+    pb::internal::CompiledFile pb_compiled_file;
+    pb_compiled_file.set_resource_name("android:layout/main.xml");
+    io::StringInputStream data(expected_data);
+    ASSERT_TRUE(writer.AddResFileEntry(pb_compiled_file, &data));
+
+    pb::ResourceTable pb_table;
+    pb_table.add_package()->set_package_name("android");
+    ASSERT_TRUE(writer.AddResTableEntry(pb_table));
+    ASSERT_FALSE(writer.HadError());
+  }
+
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[output_str.size()]);
+  memcpy(buffer.get(), output_str.data(), output_str.size());
+  std::shared_ptr<io::IData> data =
+      std::make_shared<io::MallocData>(std::move(buffer), output_str.size());
+
+  ContainerReader reader(data.get());
+  ASSERT_FALSE(reader.HadError()) << reader.GetError();
+
+  ContainerReaderEntry* entry = reader.Next();
+  ASSERT_THAT(entry, NotNull());
+  ASSERT_THAT(entry->Type(), Eq(ContainerEntryType::kResFile));
+
+  pb::internal::CompiledFile pb_new_file;
+  off64_t offset;
+  size_t len;
+  ASSERT_TRUE(entry->GetResFileOffsets(&pb_new_file, &offset, &len)) << entry->GetError();
+  EXPECT_THAT(pb_new_file.resource_name(), StrEq("android:layout/main.xml"));
+
+  // The segment is a view into the shared data, and stays valid after the reader is gone.
+  io::DataSegment segment(data, static_cast<size_t>(offset), len);
+  EXPECT_THAT(std::string(static_cast<const char*>(segment.data()), segment.size()),
+              StrEq(expected_data));
+
+  entry = reader.Next();
+  ASSERT_THAT(entry, NotNull());
+  ASSERT_THAT(entry->Type(), Eq(ContainerEntryType::kResTable));
+
+  pb::ResourceTable pb_new_table;
+  ASSERT_TRUE(entry->GetResTable(&pb_new_table));
+  ASSERT_THAT(pb_new_table.package_size(), Eq(1));
+  EXPECT_THAT(pb_new_table.package(0).package_name(), StrEq("android"));
+
+  EXPECT_THAT(reader.Next(), IsNull());
+  EXPECT_FALSE(reader.HadError());
+}
+
+TEST(ContainerTest, ReadTruncatedContainerFromData) {
+  std::string output_str;
+  {
+    StringOutputStream out_stream(&output_str);
+    ContainerWriter writer(&out_stream, 1u);
+    pb::internal::CompiledFile pb_compiled_file;
+    pb_compiled_file.set_resource_name("android:layout/main.xml");
+    const std::string contents = "12345678";
+    io::StringInputStream data(contents);
+    ASSERT_TRUE(writer.AddResFileEntry(pb_compiled_file, &data));
+  }
+
+  // Cut off the payload.
+  const size_t truncated_size = output_str.size() - 6u;
+  std::unique_ptr<uint8_t[]> buffer(new uint8_t[truncated_size]);
+  memcpy(buffer.get(), output_str.data(), truncated_size);
+  io::MallocData data(std::move(buffer), truncated_size);
+
+  ContainerReader reader(&data);
+  ASSERT_FALSE(reader.HadError()) << reader.GetError();
+
+  ContainerReaderEntry* entry = reader.Next();
+  ASSERT_THAT(entry, NotNull());
+
+  pb::internal::CompiledFile pb_new_file;
+  off64_t offset;
+  size_t len;
+  EXPECT_FALSE(entry->GetResFileOffsets(&pb_new_file, &offset, &len));
+  EXPECT_TRUE(reader.HadError());
+}
+
 }  // namespace aapt
@@ -183,8 +183,13 @@ bool BinaryResourceParser::ParsePackage(const ResChunk_header* chunk) {
     package_name[i] = util::DeviceToHost16(package_header->name[i]);
   }
 
+  const std::string package_name_utf8 = util::Utf16ToUtf8(package_name);
+  if (filter_.package && filter_.package.value() != package_name_utf8) {
+    return true;
+  }
+
   ResourceTablePackage* package =
-      table_->CreatePackage(util::Utf16ToUtf8(package_name), static_cast<uint8_t>(package_id));
+      table_->CreatePackage(package_name_utf8, static_cast<uint8_t>(package_id));
   if (!package) {
     diag_->Error(DiagMessage(source_)
                  << "incompatible package '" << package_name << "' with ID " << package_id);
@@ -278,6 +283,14 @@ bool BinaryResourceParser::ParseTypeSpec(const ResourceTablePackage* package,
     return false;
   }
 
+  if (filter_.type) {
+    std::string type_str;
+    const ResourceType* parsed_type = GetResourceType(type_spec->id, &type_str);
+    if (parsed_type != nullptr && *parsed_type != filter_.type.value()) {
+      return true;
+    }
+  }
+
   // The data portion of this chunk contains entry_count 32bit entries,
   // each one representing a set of flags.
   const size_t entry_count = dtohl(type_spec->entryCount);
@@ -336,15 +349,15 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
   ConfigDescription config;
   config.copyFromDtoH(type->config);
 
-  const std::string type_str = util::GetString(type_pool_, type->id - 1);
-
-  const ResourceType* parsed_type = ParseResourceType(type_str);
+  std::string type_str;
+  const ResourceType* parsed_type = GetResourceType(type->id, &type_str);
   if (!parsed_type) {
     diag_->Error(DiagMessage(source_)
                  << "invalid type name '" << type_str << "' for type with ID " << (int)type->id);
     return false;
   }
 
+  const bool type_selected = !filter_.type || filter_.type.value() == *parsed_type;
   TypeVariant tv(type);
   for (auto it = tv.beginEntries(); it != tv.endEntries(); ++it) {
     const ResTable_entry* entry = *it;
@@ -357,6 +370,12 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
 
     const ResourceId res_id(package->id.value(), type->id, static_cast<uint16_t>(it.index()));
 
+    if (!type_selected || (filter_.entry && filter_.entry.value() != name.entry)) {
+      // Skip decoding the value, but remember the name so references to it can still be resolved.
+      id_index_.insert({res_id, name});
+      continue;
+    }
+
     std::unique_ptr<Value> resource_value;
     if (entry->flags & ResTable_entry::FLAG_COMPLEX) {
       const ResTable_map_entry* mapEntry = static_cast<const ResTable_map_entry*>(entry);
@@ -415,6 +434,12 @@ bool BinaryResourceParser::ParseType(const ResourceTablePackage* package,
   return true;
 }
 
+const ResourceType* BinaryResourceParser::GetResourceType(uint8_t type_id,
+                                                          std::string* out_type_str) {
+  *out_type_str = util::GetString(type_pool_, type_id - 1);
+  return ParseResourceType(*out_type_str);
+}
+
 bool BinaryResourceParser::ParseLibrary(const ResChunk_header* chunk) {
   DynamicRefTable dynamic_ref_table;
   if (dynamic_ref_table.load(reinterpret_cast<const ResTable_lib_header*>(chunk)) != NO_ERROR) {
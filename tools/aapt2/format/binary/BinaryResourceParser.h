@@ -26,12 +26,21 @@
 #include "ResourceValues.h"
 #include "Source.h"
 #include "process/IResourceTableConsumer.h"
+#include "util/Maybe.h"
 #include "util/Util.h"
 
 namespace aapt {
 
 struct SymbolTable_entry;
 
+// Selects the resources that a BinaryResourceParser decodes. Fields that are not set match
+// anything.
+struct BinaryResourceFilter {
+  Maybe<std::string> package;
+  Maybe<ResourceType> type;
+  Maybe<std::string> entry;
+};
+
 // Parses a binary resource table (resources.arsc) and adds the entries to a ResourceTable.
 // This is different than the libandroidfw ResTable in that it scans the table from top to bottom
 // and doesn't require support for random access.
@@ -42,6 +51,14 @@ class BinaryResourceParser {
   BinaryResourceParser(IDiagnostics* diag, ResourceTable* table, const Source& source,
                        const void* data, size_t data_len, io::IFileCollection* files = nullptr);
 
+  // Only decodes the resources selected by `filter`. Packages and types that are not selected are
+  // skipped without looking at their entries, and the values of entries that are not selected are
+  // never decoded. This makes looking up a few resources in a large table cheap. References to
+  // resources that were skipped are still resolved to their names when possible.
+  void SetFilter(const BinaryResourceFilter& filter) {
+    filter_ = filter;
+  }
+
   // Parses the binary resource table and returns true if successful.
   bool Parse();
 
@@ -54,6 +71,9 @@ class BinaryResourceParser {
   bool ParseType(const ResourceTablePackage* package, const android::ResChunk_header* chunk);
   bool ParseLibrary(const android::ResChunk_header* chunk);
 
+  // Returns the type with ID `type_id` in the type string pool, or nullptr if it is invalid.
+  const ResourceType* GetResourceType(uint8_t type_id, std::string* out_type_str);
+
   std::unique_ptr<Item> ParseValue(const ResourceNameRef& name, const ConfigDescription& config,
                                    const android::Res_value& value);
 
@@ -91,6 +111,8 @@ class BinaryResourceParser {
   // Optional file collection from which to create io::IFile objects.
   io::IFileCollection* files_;
 
+  BinaryResourceFilter filter_;
+
   // The standard value string pool for resource values.
   android::ResStringPool value_pool_;
 
@@ -590,4 +590,50 @@ TEST_F(TableFlattenerTest, FlattenOverlayable) {
   EXPECT_TRUE(spec_flags & android::ResTable_typeSpec::SPEC_OVERLAYABLE);
 }
 
+TEST_F(TableFlattenerTest, ParseOnlyFilteredResources) {
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.app.test", 0x7f)
+          .AddString("com.app.test:string/foo", ResourceId(0x7f010000), "foo")
+          .AddString("com.app.test:string/bar", ResourceId(0x7f010001), "bar")
+          .AddValue("com.app.test:integer/one", ResourceId(0x7f020000),
+                    test::BuildReference("com.app.test:string/foo", ResourceId(0x7f010000)))
+          .AddValue("com.app.test:integer/two", ResourceId(0x7f020001),
+                    test::BuildReference("com.app.test:string/bar", ResourceId(0x7f010001)))
+          .Build();
+
+  std::string content;
+  ASSERT_TRUE(Flatten(context_.get(), {}, table.get(), &content));
+
+  BinaryResourceFilter filter;
+  filter.type = ResourceType::kInteger;
+  filter.entry = std::string("one");
+
+  ResourceTable filtered_table;
+  BinaryResourceParser parser(context_->GetDiagnostics(), &filtered_table, Source("test.arsc"),
+                              content.data(), content.size());
+  parser.SetFilter(filter);
+  ASSERT_TRUE(parser.Parse());
+
+  EXPECT_THAT(test::GetValue<String>(&filtered_table, "com.app.test:string/foo"), IsNull());
+  EXPECT_THAT(test::GetValue<String>(&filtered_table, "com.app.test:string/bar"), IsNull());
+  EXPECT_THAT(test::GetValue<Reference>(&filtered_table, "com.app.test:integer/two"), IsNull());
+
+  // The reference into the skipped type is still resolved to a name.
+  Reference* ref = test::GetValue<Reference>(&filtered_table, "com.app.test:integer/one");
+  ASSERT_THAT(ref, NotNull());
+  ASSERT_TRUE(ref->name);
+  EXPECT_EQ(test::ParseNameOrDie("com.app.test:string/foo"), ref->name.value());
+
+  filter = {};
+  filter.package = std::string("com.app.other");
+
+  ResourceTable empty_table;
+  BinaryResourceParser other_parser(context_->GetDiagnostics(), &empty_table, Source("test.arsc"),
+                                    content.data(), content.size());
+  other_parser.SetFilter(filter);
+  ASSERT_TRUE(other_parser.Parse());
+  EXPECT_TRUE(empty_table.packages.empty());
+}
+
 }  // namespace aapt
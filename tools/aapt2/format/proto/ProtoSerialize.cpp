@@ -16,6 +16,8 @@
 
 #include "format/proto/ProtoSerialize.h"
 
+#include "google/protobuf/io/coded_stream.h"
+
 #include "ValueVisitor.h"
 #include "util/BigBuffer.h"
 
@@ -270,61 +272,106 @@ void SerializeConfig(const ConfigDescription& config, pb::Configuration* out_pb_
   out_pb_config->set_sdk_version(config.sdkVersion);
 }
 
+static void SerializeTypeToPb(const ResourceTableType& type, StringPool* source_pool,
+                              pb::Type* pb_type) {
+  if (type.id) {
+    pb_type->mutable_type_id()->set_id(type.id.value());
+  }
+  pb_type->set_name(to_string(type.type).to_string());
+
+  for (const std::unique_ptr<ResourceEntry>& entry : type.entries) {
+    pb::Entry* pb_entry = pb_type->add_entry();
+    if (entry->id) {
+      pb_entry->mutable_entry_id()->set_id(entry->id.value());
+    }
+    pb_entry->set_name(entry->name);
+
+    // Write the Visibility struct.
+    pb::Visibility* pb_visibility = pb_entry->mutable_visibility();
+    pb_visibility->set_level(SerializeVisibilityToPb(entry->visibility.level));
+    SerializeSourceToPb(entry->visibility.source, source_pool, pb_visibility->mutable_source());
+    pb_visibility->set_comment(entry->visibility.comment);
+
+    if (entry->allow_new) {
+      pb::AllowNew* pb_allow_new = pb_entry->mutable_allow_new();
+      SerializeSourceToPb(entry->allow_new.value().source, source_pool,
+                          pb_allow_new->mutable_source());
+      pb_allow_new->set_comment(entry->allow_new.value().comment);
+    }
+
+    if (entry->overlayable) {
+      pb::Overlayable* pb_overlayable = pb_entry->mutable_overlayable();
+      SerializeSourceToPb(entry->overlayable.value().source, source_pool,
+                          pb_overlayable->mutable_source());
+      pb_overlayable->set_comment(entry->overlayable.value().comment);
+    }
+
+    for (const std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
+      pb::ConfigValue* pb_config_value = pb_entry->add_config_value();
+      SerializeConfig(config_value->config, pb_config_value->mutable_config());
+      pb_config_value->mutable_config()->set_product(config_value->product);
+      SerializeValueToPb(*config_value->value, pb_config_value->mutable_value(), source_pool);
+    }
+  }
+}
+
+static void SerializePackageHeaderToPb(const ResourceTablePackage& package,
+                                       pb::Package* pb_package) {
+  if (package.id) {
+    pb_package->mutable_package_id()->set_id(package.id.value());
+  }
+  pb_package->set_package_name(package.name);
+}
+
 void SerializeTableToPb(const ResourceTable& table, pb::ResourceTable* out_table,
                         IDiagnostics* diag) {
   StringPool source_pool;
   for (const std::unique_ptr<ResourceTablePackage>& package : table.packages) {
     pb::Package* pb_package = out_table->add_package();
-    if (package->id) {
-      pb_package->mutable_package_id()->set_id(package->id.value());
+    SerializePackageHeaderToPb(*package, pb_package);
+    for (const std::unique_ptr<ResourceTableType>& type : package->types) {
+      SerializeTypeToPb(*type, &source_pool, pb_package->add_type());
     }
-    pb_package->set_package_name(package->name);
+  }
+  SerializeStringPoolToPb(source_pool, out_table->mutable_source_pool(), diag);
+}
 
-    for (const std::unique_ptr<ResourceTableType>& type : package->types) {
-      pb::Type* pb_type = pb_package->add_type();
-      if (type->id) {
-        pb_type->mutable_type_id()->set_id(type->id.value());
-      }
-      pb_type->set_name(to_string(type->type).to_string());
+bool SerializeTableToPbStream(const ResourceTable& table,
+                              ::google::protobuf::io::ZeroCopyOutputStream* out,
+                              IDiagnostics* diag) {
+  // The tag of a length delimited field, as in the protobuf wire format.
+  constexpr uint32_t kWireTypeLengthDelimited = 2u;
+  constexpr uint32_t kPackageTag =
+      (pb::ResourceTable::kPackageFieldNumber << 3) | kWireTypeLengthDelimited;
 
-      for (const std::unique_ptr<ResourceEntry>& entry : type->entries) {
-        pb::Entry* pb_entry = pb_type->add_entry();
-        if (entry->id) {
-          pb_entry->mutable_entry_id()->set_id(entry->id.value());
-        }
-        pb_entry->set_name(entry->name);
-
-        // Write the Visibility struct.
-        pb::Visibility* pb_visibility = pb_entry->mutable_visibility();
-        pb_visibility->set_level(SerializeVisibilityToPb(entry->visibility.level));
-        SerializeSourceToPb(entry->visibility.source, &source_pool,
-                            pb_visibility->mutable_source());
-        pb_visibility->set_comment(entry->visibility.comment);
-
-        if (entry->allow_new) {
-          pb::AllowNew* pb_allow_new = pb_entry->mutable_allow_new();
-          SerializeSourceToPb(entry->allow_new.value().source, &source_pool,
-                              pb_allow_new->mutable_source());
-          pb_allow_new->set_comment(entry->allow_new.value().comment);
-        }
+  ::google::protobuf::io::CodedOutputStream coded_out(out);
+  StringPool source_pool;
+  for (const std::unique_ptr<ResourceTablePackage>& package : table.packages) {
+    // A package is length delimited, so its types are encoded before it is written. Only the
+    // encoded bytes of the previous types are kept, which are a fraction of the size of their
+    // protobuf messages. Encoding a Package that holds a single type produces exactly the bytes
+    // of that type's entry in the repeated `type` field.
+    pb::Package pb_package;
+    SerializePackageHeaderToPb(*package, &pb_package);
+    std::string encoded_package = pb_package.SerializeAsString();
+    for (const std::unique_ptr<ResourceTableType>& type : package->types) {
+      pb_package.Clear();
+      SerializeTypeToPb(*type, &source_pool, pb_package.add_type());
+      pb_package.AppendToString(&encoded_package);
+    }
 
-        if (entry->overlayable) {
-          pb::Overlayable* pb_overlayable = pb_entry->mutable_overlayable();
-          SerializeSourceToPb(entry->overlayable.value().source, &source_pool,
-                              pb_overlayable->mutable_source());
-          pb_overlayable->set_comment(entry->overlayable.value().comment);
-        }
+    coded_out.WriteVarint32(kPackageTag);
+    coded_out.WriteVarint32(static_cast<uint32_t>(encoded_package.size()));
+    coded_out.WriteString(encoded_package);
+  }
 
-        for (const std::unique_ptr<ResourceConfigValue>& config_value : entry->values) {
-          pb::ConfigValue* pb_config_value = pb_entry->add_config_value();
-          SerializeConfig(config_value->config, pb_config_value->mutable_config());
-          pb_config_value->mutable_config()->set_product(config_value->product);
-          SerializeValueToPb(*config_value->value, pb_config_value->mutable_value(), &source_pool);
-        }
-      }
-    }
+  // Fields may appear in any order, so the source pool goes last, once every source is known.
+  pb::ResourceTable pb_table_tail;
+  SerializeStringPoolToPb(source_pool, pb_table_tail.mutable_source_pool(), diag);
+  if (!pb_table_tail.SerializeToCodedStream(&coded_out)) {
+    return false;
   }
-  SerializeStringPoolToPb(source_pool, out_table->mutable_source_pool(), diag);
+  return !coded_out.HadError();
 }
 
 static pb::Reference_Type SerializeReferenceTypeToPb(Reference::Type type) {
@@ -18,6 +18,7 @@
 #define AAPT_FORMAT_PROTO_PROTOSERIALIZE_H
 
 #include "android-base/macros.h"
+#include "google/protobuf/io/zero_copy_stream.h"
 
 #include "ConfigDescription.h"
 #include "Configuration.pb.h"
@@ -54,6 +55,14 @@ void SerializeConfig(const ConfigDescription& config, pb::Configuration* out_pb_
 // Serializes a ResourceTable into its protobuf representation.
 void SerializeTableToPb(const ResourceTable& table, pb::ResourceTable* out_table, IDiagnostics* diag);
 
+// Writes a ResourceTable to `out`, encoded as a pb::ResourceTable, without building the whole
+// protobuf representation in memory. Only one type is held as protobuf messages at a time. The
+// encoding parses to the same message as SerializeTableToPb() produces, though its fields are in a
+// different order. Returns false if writing to `out` failed.
+bool SerializeTableToPbStream(const ResourceTable& table,
+                              ::google::protobuf::io::ZeroCopyOutputStream* out,
+                              IDiagnostics* diag);
+
 // Serializes a ResourceFile into its protobuf representation.
 void SerializeCompiledFileToPb(const ResourceFile& file, pb::internal::CompiledFile* out_file);
 
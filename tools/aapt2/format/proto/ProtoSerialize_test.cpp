@@ -16,6 +16,8 @@
 
 #include "format/proto/ProtoSerialize.h"
 
+#include "google/protobuf/io/zero_copy_stream_impl_lite.h"
+
 #include "ResourceUtils.h"
 #include "format/proto/ProtoDeserialize.h"
 #include "test/Test.h"
@@ -462,4 +464,33 @@ TEST(ProtoSerializeTest, SerializeDeserializeConfiguration) {
       "night-xhdpi-stylus-keysexposed-qwerty-navhidden-dpad-300x200-v23");
 }
 
+TEST(ProtoSerializeTest, StreamTableLikeSerializedTable) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  std::unique_ptr<ResourceTable> table =
+      test::ResourceTableBuilder()
+          .SetPackageId("com.app.a", 0x7f)
+          .AddFileReference("com.app.a:layout/main", ResourceId(0x7f020000), "res/layout/main.xml")
+          .AddReference("com.app.a:layout/other", ResourceId(0x7f020001), "com.app.a:layout/main")
+          .AddString("com.app.a:string/text", {}, "hi")
+          .AddString("com.app.a:string/text", test::ParseConfigOrDie("fr"), "salut")
+          .AddValue("com.app.a:id/foo", {}, util::make_unique<Id>())
+          .SetPackageId("com.app.b", 0x80)
+          .AddString("com.app.b:string/other", {}, "there")
+          .Build();
+
+  pb::ResourceTable expected_pb_table;
+  SerializeTableToPb(*table, &expected_pb_table, context->GetDiagnostics());
+
+  std::string encoded_table;
+  {
+    ::google::protobuf::io::StringOutputStream out(&encoded_table);
+    ASSERT_TRUE(SerializeTableToPbStream(*table, &out, context->GetDiagnostics()));
+  }
+
+  pb::ResourceTable pb_table;
+  ASSERT_TRUE(pb_table.ParseFromString(encoded_table));
+  EXPECT_THAT(pb_table.package_size(), Eq(2));
+  EXPECT_THAT(pb_table.SerializeAsString(), Eq(expected_pb_table.SerializeAsString()));
+}
+
 }  // namespace aapt
@@ -40,9 +40,11 @@ class IData : public KnownSizeInputStream {
   }
 };
 
+// Implementation of IData that exposes a subsection of another IData. The underlying data may be
+// shared by many segments, so that views into one mapping of a file don't each map it again.
 class DataSegment : public IData {
  public:
-  explicit DataSegment(std::unique_ptr<IData> data, size_t offset, size_t len)
+  explicit DataSegment(std::shared_ptr<const IData> data, size_t offset, size_t len)
       : data_(std::move(data)), offset_(offset), len_(len), next_read_(offset) {}
   virtual ~DataSegment() = default;
 
@@ -84,7 +86,7 @@ class DataSegment : public IData {
  private:
   DISALLOW_COPY_AND_ASSIGN(DataSegment);
 
-  std::unique_ptr<IData> data_;
+  std::shared_ptr<const IData> data_;
   size_t offset_;
   size_t len_;
   size_t next_read_;
@@ -27,13 +27,22 @@ IFile* IFile::CreateFileSegment(size_t offset, size_t len) {
   return file_segment;
 }
 
+IFile* IFile::CreateFileSegment(std::shared_ptr<const IData> data, size_t offset, size_t len) {
+  FileSegment* file_segment = new FileSegment(this, std::move(data), offset, len);
+  segments_.push_back(std::unique_ptr<IFile>(file_segment));
+  return file_segment;
+}
+
 std::unique_ptr<IData> FileSegment::OpenAsData() {
-  std::unique_ptr<IData> data = file_->OpenAsData();
+  std::shared_ptr<const IData> data = data_;
   if (!data) {
-    return {};
+    data = file_->OpenAsData();
+    if (!data) {
+      return {};
+    }
   }
 
-  if (offset_ <= data->size() - len_) {
+  if (len_ <= data->size() && offset_ <= data->size() - len_) {
     return util::make_unique<DataSegment>(std::move(data), offset_, len_);
   }
   return {};
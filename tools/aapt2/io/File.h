@@ -30,6 +30,14 @@
 namespace aapt {
 namespace io {
 
+// The raw contents of a file that is stored deflated, along with what is needed to copy them into
+// another ZIP archive without inflating and deflating them again.
+struct DeflatedData {
+  std::unique_ptr<IData> data;
+  uint32_t crc32 = 0;
+  size_t uncompressed_size = 0;
+};
+
 // Interface for a file, which could be a real file on the file system, or a
 // file inside a ZIP archive.
 class IFile {
@@ -52,11 +60,21 @@ class IFile {
 
   IFile* CreateFileSegment(size_t offset, size_t len);
 
+  // Creates a segment of this file that is backed by `data`, the already opened contents of this
+  // file. Opening the segment returns a view into `data` instead of opening the file again.
+  IFile* CreateFileSegment(std::shared_ptr<const IData> data, size_t offset, size_t len);
+
   // Returns whether the file was compressed before it was stored in memory.
   virtual bool WasCompressed() {
     return false;
   }
 
+  // Opens the still deflated contents of a compressed file without inflating them.
+  // Returns false if the file is not deflated, or if the implementation can't provide them.
+  virtual bool OpenDeflatedData(DeflatedData* out_data) {
+    return false;
+  }
+
  private:
   // Any segments created from this IFile need to be owned by this IFile, so
   // keep them
@@ -72,6 +90,9 @@ class FileSegment : public IFile {
   explicit FileSegment(IFile* file, size_t offset, size_t len)
       : file_(file), offset_(offset), len_(len) {}
 
+  FileSegment(IFile* file, std::shared_ptr<const IData> data, size_t offset, size_t len)
+      : file_(file), data_(std::move(data)), offset_(offset), len_(len) {}
+
   std::unique_ptr<IData> OpenAsData() override;
   std::unique_ptr<io::InputStream> OpenInputStream() override;
 
@@ -83,6 +104,9 @@ class FileSegment : public IFile {
   DISALLOW_COPY_AND_ASSIGN(FileSegment);
 
   IFile* file_;
+
+  // The contents of file_, if they were opened when this segment was created.
+  std::shared_ptr<const IData> data_;
   size_t offset_;
   size_t len_;
 };
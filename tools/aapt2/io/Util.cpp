@@ -50,6 +50,21 @@ bool CopyFileToArchive(IAaptContext* context, io::IFile* file, const std::string
 
 bool CopyFileToArchivePreserveCompression(IAaptContext* context, io::IFile* file,
                                           const std::string& out_path, IArchiveWriter* writer) {
+  // Copy deflated files as-is when possible, rather than inflating and deflating them again.
+  io::DeflatedData deflated;
+  if (writer->SupportsDeflatedFiles() && file->OpenDeflatedData(&deflated)) {
+    if (context->IsVerbose()) {
+      context->GetDiagnostics()->Note(DiagMessage() << "copying " << out_path << " to archive");
+    }
+
+    if (!writer->WriteDeflatedFile(out_path, ArchiveEntry::kCompress, std::move(deflated))) {
+      context->GetDiagnostics()->Error(DiagMessage() << "failed to write " << out_path
+                                                     << " to archive: " << writer->GetError());
+      return false;
+    }
+    return true;
+  }
+
   uint32_t compression_flags = file->WasCompressed() ? ArchiveEntry::kCompress : 0u;
   return CopyFileToArchive(context, file, out_path, compression_flags, writer);
 }
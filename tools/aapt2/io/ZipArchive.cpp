@@ -69,6 +69,22 @@ bool ZipFile::WasCompressed() {
   return zip_entry_.method != kCompressStored;
 }
 
+bool ZipFile::OpenDeflatedData(DeflatedData* out_data) {
+  if (zip_entry_.method != kCompressDeflated) {
+    return false;
+  }
+
+  android::FileMap file_map;
+  if (!file_map.create(nullptr, GetFileDescriptor(zip_handle_), zip_entry_.offset,
+                       zip_entry_.compressed_length, true)) {
+    return false;
+  }
+  out_data->data = util::make_unique<MmappedData>(std::move(file_map));
+  out_data->crc32 = zip_entry_.crc32;
+  out_data->uncompressed_size = zip_entry_.uncompressed_length;
+  return true;
+}
+
 ZipFileCollectionIterator::ZipFileCollectionIterator(
     ZipFileCollection* collection)
     : current_(collection->files_.begin()), end_(collection->files_.end()) {}
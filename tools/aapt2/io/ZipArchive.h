@@ -38,6 +38,7 @@ class ZipFile : public IFile {
   std::unique_ptr<io::InputStream> OpenInputStream() override;
   const Source& GetSource() const override;
   bool WasCompressed() override;
+  bool OpenDeflatedData(DeflatedData* out_data) override;
 
  private:
   ::ZipArchiveHandle zip_handle_;
@@ -17,6 +17,7 @@
 #include "MultiApkGenerator.h"
 
 #include <algorithm>
+#include <atomic>
 #include <regex>
 #include <string>
 
@@ -34,6 +35,7 @@
 #include "process/IResourceTableConsumer.h"
 #include "split/TableSplitter.h"
 #include "util/Files.h"
+#include "util/Parallel.h"
 #include "xml/XmlDom.h"
 #include "xml/XmlUtil.h"
 
@@ -46,12 +48,14 @@ using ::aapt::xml::XmlResource;
 using ::android::StringPiece;
 
 /**
- * Context wrapper that allows the min Android SDK value to be overridden.
+ * Context wrapper that allows the min Android SDK value and the diagnostics to be overridden.
  */
 class ContextWrapper : public IAaptContext {
  public:
-  explicit ContextWrapper(IAaptContext* context)
-      : context_(context), min_sdk_(context_->GetMinSdkVersion()) {
+  explicit ContextWrapper(IAaptContext* context, IDiagnostics* diag = nullptr)
+      : context_(context),
+        diag_(diag != nullptr ? diag : context->GetDiagnostics()),
+        min_sdk_(context_->GetMinSdkVersion()) {
   }
 
   PackageType GetPackageType() override {
@@ -66,7 +70,7 @@ class ContextWrapper : public IAaptContext {
     if (source_diag_) {
       return source_diag_.get();
     }
-    return context_->GetDiagnostics();
+    return diag_;
   }
 
   const std::string& GetCompilationPackage() override {
@@ -94,12 +98,12 @@ class ContextWrapper : public IAaptContext {
   }
 
   void SetSource(const std::string& source) {
-    source_diag_ =
-        util::make_unique<SourcePathDiagnostics>(Source{source}, context_->GetDiagnostics());
+    source_diag_ = util::make_unique<SourcePathDiagnostics>(Source{source}, diag_);
   }
 
  private:
   IAaptContext* context_;
+  IDiagnostics* diag_;
   std::unique_ptr<SourcePathDiagnostics> source_diag_;
 
   int min_sdk_ = -1;
@@ -123,14 +127,9 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
   std::unordered_set<std::string> artifacts_to_keep = options.kept_artifacts;
   std::unordered_set<std::string> filtered_artifacts;
   std::unordered_set<std::string> kept_artifacts;
+  std::vector<const OutputArtifact*> artifacts_to_generate;
 
-  // For now, just write out the stripped APK since ABI splitting doesn't modify anything else.
   for (const OutputArtifact& artifact : options.apk_artifacts) {
-    FilterChain filters;
-
-    ContextWrapper wrapped_context{context_};
-    wrapped_context.SetSource(artifact.name);
-
     if (!options.kept_artifacts.empty()) {
       const auto& it = artifacts_to_keep.find(artifact.name);
       if (it == artifacts_to_keep.end()) {
@@ -144,42 +143,7 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
         kept_artifacts.insert(artifact.name);
       }
     }
-
-    std::unique_ptr<ResourceTable> table =
-        FilterTable(context_, artifact, *apk_->GetResourceTable(), &filters);
-    if (!table) {
-      return false;
-    }
-
-    IDiagnostics* diag = wrapped_context.GetDiagnostics();
-
-    std::unique_ptr<XmlResource> manifest;
-    if (!UpdateManifest(artifact, &manifest, diag)) {
-      diag->Error(DiagMessage() << "could not update AndroidManifest.xml for output artifact");
-      return false;
-    }
-
-    std::string out = options.out_dir;
-    if (!file::mkdirs(out)) {
-      diag->Warn(DiagMessage() << "could not create out dir: " << out);
-    }
-    file::AppendPath(&out, artifact.name);
-
-    if (context_->IsVerbose()) {
-      diag->Note(DiagMessage() << "Generating split: " << out);
-    }
-
-    std::unique_ptr<IArchiveWriter> writer = CreateZipFileArchiveWriter(diag, out);
-
-    if (context_->IsVerbose()) {
-      diag->Note(DiagMessage() << "Writing output: " << out);
-    }
-
-    filters.AddFilter(util::make_unique<SignatureFilter>());
-    if (!apk_->WriteToArchive(&wrapped_context, table.get(), options.table_flattener_options,
-                              &filters, writer.get(), manifest.get())) {
-      return false;
-    }
+    artifacts_to_generate.push_back(&artifact);
   }
 
   // Make sure all of the requested artifacts were valid. If there are any kept artifacts left,
@@ -206,6 +170,80 @@ bool MultiApkGenerator::FromBaseApk(const MultiApkGeneratorOptions& options) {
     return false;
   }
 
+  if (!file::mkdirs(options.out_dir)) {
+    context_->GetDiagnostics()->Warn(DiagMessage() << "could not create out dir: "
+                                                   << options.out_dir);
+  }
+
+  // Each artifact logs into its own buffer, which is replayed in artifact order once all jobs have
+  // finished so that the output does not depend on scheduling.
+  std::vector<BufferedDiagnostics> artifact_diagnostics(artifacts_to_generate.size());
+  std::atomic<bool> error{false};
+  util::ParallelFor(artifacts_to_generate.size(), options.max_jobs, [&](size_t i) {
+    // Don't start any new artifacts once one of them has failed.
+    if (error.load(std::memory_order_relaxed)) {
+      return;
+    }
+    if (!GenerateArtifact(*artifacts_to_generate[i], options, &artifact_diagnostics[i])) {
+      error = true;
+    }
+  });
+
+  for (BufferedDiagnostics& diag : artifact_diagnostics) {
+    diag.FlushTo(context_->GetDiagnostics());
+  }
+  return !error;
+}
+
+bool MultiApkGenerator::GenerateArtifact(const OutputArtifact& artifact,
+                                         const MultiApkGeneratorOptions& options,
+                                         IDiagnostics* diag) {
+  FilterChain filters;
+
+  ContextWrapper wrapped_context{context_, diag};
+  wrapped_context.SetSource(artifact.name);
+
+  std::unique_ptr<ResourceTable> table =
+      FilterTable(&wrapped_context, artifact, *apk_->GetResourceTable(), &filters);
+  if (!table) {
+    return false;
+  }
+
+  diag = wrapped_context.GetDiagnostics();
+
+  std::unique_ptr<XmlResource> manifest;
+  if (!UpdateManifest(artifact, &manifest, diag)) {
+    diag->Error(DiagMessage() << "could not update AndroidManifest.xml for output artifact");
+    return false;
+  }
+
+  std::string out = options.out_dir;
+  file::AppendPath(&out, artifact.name);
+
+  if (context_->IsVerbose()) {
+    diag->Note(DiagMessage() << "Generating split: " << out);
+  }
+
+  // Artifacts are already generated concurrently, so compress each one on a single thread.
+  std::unique_ptr<IArchiveWriter> writer = CreateParallelZipFileArchiveWriter(diag, out, 1u);
+  if (!writer) {
+    return false;
+  }
+
+  if (context_->IsVerbose()) {
+    diag->Note(DiagMessage() << "Writing output: " << out);
+  }
+
+  filters.AddFilter(util::make_unique<SignatureFilter>());
+  if (!apk_->WriteToArchive(&wrapped_context, table.get(), options.table_flattener_options,
+                            &filters, writer.get(), manifest.get())) {
+    return false;
+  }
+
+  if (!writer->Finish()) {
+    diag->Error(DiagMessage(out) << "failed to write archive: " << writer->GetError());
+    return false;
+  }
   return true;
 }
 
@@ -241,7 +279,8 @@ std::unique_ptr<ResourceTable> MultiApkGenerator::FilterTable(IAaptContext* cont
 
   std::unique_ptr<ResourceTable> table = old_table.Clone();
 
-  VersionCollapser collapser;
+  // Artifacts are already generated in parallel.
+  VersionCollapser collapser(1u);
   if (!collapser.Consume(&wrapped_context, table.get())) {
     context->GetDiagnostics()->Error(DiagMessage() << "Failed to strip versioned resources");
     return {};
@@ -33,6 +33,9 @@ struct MultiApkGeneratorOptions {
   std::vector<configuration::OutputArtifact> apk_artifacts;
   TableFlattenerOptions table_flattener_options;
   std::unordered_set<std::string> kept_artifacts;
+  // Maximum number of artifacts generated concurrently. Each in-flight artifact holds its own copy
+  // of the resource table, so this bounds peak memory. 0 uses one job per available CPU core.
+  size_t max_jobs = 0;
 };
 
 /**
@@ -46,6 +49,10 @@ class MultiApkGenerator {
   /**
    * Writes a set of APKs to the provided output directory. Each APK is a subset fo the base APK and
    * represents an artifact in the post processing configuration.
+   *
+   * Artifacts are generated concurrently, up to `options.max_jobs` at a time. The base APK and its
+   * resource table are shared read-only between the jobs; every job filters its own clone of the
+   * table and writes its own archive. Diagnostics are reported in artifact order.
    */
   bool FromBaseApk(const MultiApkGeneratorOptions& options);
 
@@ -60,6 +67,13 @@ class MultiApkGenerator {
     return context_->GetDiagnostics();
   }
 
+  /**
+   * Filters the base table for a single artifact and writes the resulting APK. Diagnostics are
+   * reported to `diag` rather than the context so that this can run on any thread.
+   */
+  bool GenerateArtifact(const configuration::OutputArtifact& artifact,
+                        const MultiApkGeneratorOptions& options, IDiagnostics* diag);
+
   bool UpdateManifest(const configuration::OutputArtifact& artifact,
                       std::unique_ptr<xml::XmlResource>* updated_manifest, IDiagnostics* diag);
 
@@ -17,9 +17,13 @@
 #include "optimize/ResourceDeduper.h"
 
 #include <algorithm>
+#include <memory>
+#include <vector>
 
+#include "Diagnostics.h"
 #include "DominatorTree.h"
 #include "ResourceTable.h"
+#include "util/Parallel.h"
 
 namespace aapt {
 
@@ -40,8 +44,9 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
  public:
   using Node = DominatorTree::Node;
 
-  explicit DominatedKeyValueRemover(IAaptContext* context, ResourceEntry* entry)
-      : context_(context), entry_(entry) {}
+  DominatedKeyValueRemover(bool verbose, IDiagnostics* diag, ResourceEntry* entry,
+                           std::vector<std::unique_ptr<Value>>* removed_values)
+      : verbose_(verbose), diag_(diag), entry_(entry), removed_values_(removed_values) {}
 
   void VisitConfig(Node* node) {
     Node* parent = node->parent();
@@ -72,27 +77,36 @@ class DominatedKeyValueRemover : public DominatorTree::BottomUpVisitor {
         return;
       }
     }
-    if (context_->IsVerbose()) {
-      context_->GetDiagnostics()->Note(
+    if (verbose_) {
+      diag_->Note(
           DiagMessage(node_value->value->GetSource())
           << "removing dominated duplicate resource with name \""
           << entry_->name << "\"");
-      context_->GetDiagnostics()->Note(
+      diag_->Note(
           DiagMessage(parent_value->value->GetSource()) << "dominated here");
     }
-    node_value->value = {};
+    removed_values_->push_back(std::move(node_value->value));
   }
 
  private:
   DISALLOW_COPY_AND_ASSIGN(DominatedKeyValueRemover);
 
-  IAaptContext* context_;
+  bool verbose_;
+  IDiagnostics* diag_;
   ResourceEntry* entry_;
+  std::vector<std::unique_ptr<Value>>* removed_values_;
 };
 
-static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
+// The outcome of deduping one entry, kept until every entry is done.
+struct DedupedEntry {
+  BufferedDiagnostics diagnostics;
+  std::vector<std::unique_ptr<Value>> removed_values;
+};
+
+static void DedupeEntry(bool verbose, ResourceEntry* entry, DedupedEntry* out_result) {
   DominatorTree tree(entry->values);
-  DominatedKeyValueRemover remover(context, entry);
+  DominatedKeyValueRemover remover(verbose, &out_result->diagnostics, entry,
+                                   &out_result->removed_values);
   tree.Accept(&remover);
 
   // Erase the values that were removed.
@@ -108,13 +122,26 @@ static void DedupeEntry(IAaptContext* context, ResourceEntry* entry) {
 }  // namespace
 
 bool ResourceDeduper::Consume(IAaptContext* context, ResourceTable* table) {
+  std::vector<ResourceEntry*> entries;
   for (auto& package : table->packages) {
     for (auto& type : package->types) {
       for (auto& entry : type->entries) {
-        DedupeEntry(context, entry.get());
+        entries.push_back(entry.get());
       }
     }
   }
+
+  // Entries are independent of each other, so they are deduped in parallel. Notes are replayed in
+  // table order afterwards. Removed values are destroyed on this thread, because releasing their
+  // references into the table's StringPool is not thread-safe.
+  std::vector<DedupedEntry> results(entries.size());
+  const bool verbose = context->IsVerbose();
+  util::ParallelFor(entries.size(), max_jobs_,
+                    [&](size_t i) { DedupeEntry(verbose, entries[i], &results[i]); });
+
+  for (DedupedEntry& result : results) {
+    result.diagnostics.FlushTo(context->GetDiagnostics());
+  }
   return true;
 }
 
@@ -17,6 +17,8 @@
 #ifndef AAPT_OPTIMIZE_RESOURCEDEDUPER_H
 #define AAPT_OPTIMIZE_RESOURCEDEDUPER_H
 
+#include <cstddef>
+
 #include "android-base/macros.h"
 
 #include "process/IResourceTableConsumer.h"
@@ -25,15 +27,19 @@ namespace aapt {
 
 class ResourceTable;
 
-// Removes duplicated key-value entries from dominated resources.
+// Removes duplicated key-value entries from dominated resources. Entries are processed on up to
+// `max_jobs` threads (0 means one per CPU core).
 class ResourceDeduper : public IResourceTableConsumer {
  public:
-  ResourceDeduper() = default;
+  explicit ResourceDeduper(size_t max_jobs = 0) : max_jobs_(max_jobs) {
+  }
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ResourceDeduper);
+
+  size_t max_jobs_;
 };
 
 } // namespace aapt
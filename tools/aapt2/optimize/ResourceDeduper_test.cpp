@@ -103,4 +103,33 @@ TEST(ResourceDeduperTest, LocalesValuesAreKept) {
   EXPECT_THAT(table, HasValue("android:string/keep", fr_rCA_config));
 }
 
+TEST(ResourceDeduperTest, EntriesAreDedupedInParallel) {
+  std::unique_ptr<IAaptContext> context = test::ContextBuilder().Build();
+  const ConfigDescription default_config = {};
+  const ConfigDescription land_config = test::ParseConfigOrDie("land");
+  const ConfigDescription ldrtl_v21_config = test::ParseConfigOrDie("ldrtl-v21");
+
+  test::ResourceTableBuilder builder;
+  for (int i = 0; i < 100; i++) {
+    const std::string name = "android:string/entry" + std::to_string(i);
+    const std::string value = "value" + std::to_string(i);
+    builder.AddString(name, ResourceId{}, default_config, value)
+        .AddString(name, ResourceId{}, land_config, value)
+        .AddString(name, ResourceId{}, ldrtl_v21_config, i % 2 == 0 ? value : "keep");
+  }
+  std::unique_ptr<ResourceTable> table = builder.Build();
+
+  ASSERT_TRUE(ResourceDeduper(4u).Consume(context.get(), table.get()));
+  for (int i = 0; i < 100; i++) {
+    const std::string name = "android:string/entry" + std::to_string(i);
+    EXPECT_THAT(table, HasValue(name, default_config));
+    if (i % 2 == 0) {
+      EXPECT_THAT(table, Not(HasValue(name, land_config)));
+      EXPECT_THAT(table, Not(HasValue(name, ldrtl_v21_config)));
+    } else {
+      EXPECT_THAT(table, HasValue(name, ldrtl_v21_config));
+    }
+  }
+}
+
 }  // namespace aapt
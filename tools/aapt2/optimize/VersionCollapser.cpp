@@ -17,9 +17,11 @@
 #include "optimize/VersionCollapser.h"
 
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "ResourceTable.h"
+#include "util/Parallel.h"
 
 namespace aapt {
 
@@ -65,9 +67,11 @@ FilterIterator<Iterator, Pred> make_filter_iterator(Iterator begin,
 /**
  * Every Configuration with an SDK version specified that is less than minSdk will be removed. The
  * exception is when there is no exact matching resource for the minSdk. The next smallest one will
- * be kept.
+ * be kept. Removed values are moved to `out_removed_values`.
  */
-static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
+static void CollapseVersions(
+    int min_sdk, ResourceEntry* entry,
+    std::vector<std::unique_ptr<ResourceConfigValue>>* out_removed_values) {
   // First look for all sdks less than minSdk.
   for (auto iter = entry->values.rbegin(); iter != entry->values.rend();
        ++iter) {
@@ -99,7 +103,7 @@ static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
       auto filter_iter =
           make_filter_iterator(iter + 1, entry->values.rend(), pred);
       while (filter_iter.HasNext()) {
-        filter_iter.Next() = {};
+        out_removed_values->push_back(std::move(filter_iter.Next()));
       }
     }
   }
@@ -143,13 +147,22 @@ static void CollapseVersions(int min_sdk, ResourceEntry* entry) {
 
 bool VersionCollapser::Consume(IAaptContext* context, ResourceTable* table) {
   const int min_sdk = context->GetMinSdkVersion();
+  std::vector<ResourceEntry*> entries;
   for (auto& package : table->packages) {
     for (auto& type : package->types) {
       for (auto& entry : type->entries) {
-        CollapseVersions(min_sdk, entry.get());
+        entries.push_back(entry.get());
       }
     }
   }
+
+  // Entries are independent of each other, so they are collapsed in parallel. Removed values are
+  // destroyed on this thread, because releasing their references into the table's StringPool is
+  // not thread-safe.
+  std::vector<std::vector<std::unique_ptr<ResourceConfigValue>>> removed_values(entries.size());
+  util::ParallelFor(entries.size(), max_jobs_, [&](size_t i) {
+    CollapseVersions(min_sdk, entries[i], &removed_values[i]);
+  });
   return true;
 }
 
@@ -17,6 +17,8 @@
 #ifndef AAPT_OPTIMIZE_VERSIONCOLLAPSER_H
 #define AAPT_OPTIMIZE_VERSIONCOLLAPSER_H
 
+#include <cstddef>
+
 #include "android-base/macros.h"
 
 #include "process/IResourceTableConsumer.h"
@@ -25,14 +27,20 @@ namespace aapt {
 
 class ResourceTable;
 
+// Removes the values of each entry that are overridden for every SDK version from the minimum SDK
+// on, and strips the SDK version of those that are left. Entries are processed on up to `max_jobs`
+// threads (0 means one per CPU core).
 class VersionCollapser : public IResourceTableConsumer {
  public:
-  VersionCollapser() = default;
+  explicit VersionCollapser(size_t max_jobs = 0) : max_jobs_(max_jobs) {
+  }
 
   bool Consume(IAaptContext* context, ResourceTable* table) override;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(VersionCollapser);
+
+  size_t max_jobs_;
 };
 
 } // namespace aapt
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "process/SymbolIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "android-base/stringprintf.h"
+
+#include "NameMangler.h"
+#include "ResourceValues.h"
+#include "util/Files.h"
+#include "util/Util.h"
+
+using ::android::StringPiece;
+using ::android::base::StringPrintf;
+
+namespace aapt {
+
+namespace {
+
+constexpr uint32_t kSymbolIndexMagic = 0x58444953u;  // "SIDX"
+constexpr uint32_t kSymbolIndexVersion = 2u;
+
+// Marks a string reference or a hash bucket that is not set.
+constexpr uint32_t kNone = 0xffffffffu;
+
+enum : uint32_t {
+  kSymbolPublic = 0x01u,
+  kSymbolDynamic = 0x02u,
+  kSymbolHasAttribute = 0x04u,
+};
+
+// FNV-1a over the parts of a resource name. This must be stable across processes, so
+// std::hash can't be used.
+uint32_t HashName(const StringPiece& package, const StringPiece& type, const StringPiece& entry) {
+  uint32_t hash = 2166136261u;
+  auto mix = [&](const StringPiece& str) {
+    for (const char c : str) {
+      hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    hash = (hash ^ 0xffu) * 16777619u;
+  };
+  mix(package);
+  mix(type);
+  mix(entry);
+  return hash;
+}
+
+size_t Align(size_t offset) {
+  return (offset + 7u) & ~static_cast<size_t>(7u);
+}
+
+}  // namespace
+
+struct SymbolIndex::StringRef {
+  uint32_t offset;
+  uint32_t size;
+};
+
+struct SymbolIndex::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t source_size;
+  int64_t source_mtime;
+  StringRef source_path;
+  StringRef compile_sdk_version;
+  StringRef compile_sdk_version_codename;
+  uint32_t file_size;
+  uint32_t package_count;
+  uint32_t packages_offset;
+  uint32_t symbol_count;
+  uint32_t symbols_offset;
+  uint32_t bucket_count;
+  uint32_t buckets_offset;
+  uint32_t attribute_symbol_count;
+  uint32_t attribute_symbols_offset;
+  uint32_t strings_size;
+  uint32_t strings_offset;
+};
+
+struct SymbolIndex::PackageRecord {
+  uint32_t id;
+  StringRef name;
+};
+
+// Symbols are sorted by ID.
+struct SymbolIndex::SymbolRecord {
+  uint32_t id;
+  uint32_t package_index;
+  StringRef type;
+  StringRef entry;
+  uint32_t flags;
+  uint32_t type_mask;
+  int32_t min_int;
+  int32_t max_int;
+  uint32_t attribute_symbols_start;
+  uint32_t attribute_symbols_count;
+};
+
+// The enum and flag values of an attribute. The name is kNone and the ID is 0 if not set.
+struct SymbolIndex::AttributeSymbolRecord {
+  uint32_t id;
+  uint32_t value;
+  StringRef package;
+  StringRef type;
+  StringRef entry;
+};
+
+void SymbolIndexBuilder::AddPackage(uint8_t id, const std::string& name) {
+  packages_.push_back(std::make_pair(id, name));
+}
+
+void SymbolIndexBuilder::SetCompileSdkVersions(const Maybe<std::string>& version,
+                                               const Maybe<std::string>& version_codename) {
+  compile_sdk_version_ = version;
+  compile_sdk_version_codename_ = version_codename;
+}
+
+bool SymbolIndexBuilder::AddSymbol(const ResourceName& name, const SymbolTable::Symbol& symbol) {
+  if (!symbol.id) {
+    return false;
+  }
+
+  auto package_iter = std::find_if(packages_.begin(), packages_.end(),
+                                   [&](const std::pair<uint8_t, std::string>& package) -> bool {
+                                     return package.second == name.package;
+                                   });
+  if (package_iter == packages_.end()) {
+    return false;
+  }
+
+  entries_.push_back(Entry{static_cast<size_t>(std::distance(packages_.begin(), package_iter)),
+                           to_string(name.type).to_string(), name.entry, symbol});
+  return true;
+}
+
+void SymbolIndexBuilder::Flatten(std::string* out_data) const {
+  using StringRef = SymbolIndex::StringRef;
+
+  std::string strings;
+  std::unordered_map<std::string, StringRef> string_refs;
+  auto add_string = [&](const std::string& str) -> StringRef {
+    auto iter = string_refs.find(str);
+    if (iter != string_refs.end()) {
+      return iter->second;
+    }
+    StringRef ref{static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size())};
+    strings += str;
+    string_refs.insert(std::make_pair(str, ref));
+    return ref;
+  };
+  auto add_maybe_string = [&](const Maybe<std::string>& str) -> StringRef {
+    return str ? add_string(str.value()) : StringRef{kNone, 0u};
+  };
+
+  std::vector<const Entry*> sorted_entries;
+  sorted_entries.reserve(entries_.size());
+  for (const Entry& entry : entries_) {
+    sorted_entries.push_back(&entry);
+  }
+  std::stable_sort(sorted_entries.begin(), sorted_entries.end(),
+                   [](const Entry* a, const Entry* b) -> bool {
+                     return a->symbol.id.value() < b->symbol.id.value();
+                   });
+
+  std::vector<SymbolIndex::PackageRecord> packages;
+  for (const auto& package : packages_) {
+    packages.push_back(SymbolIndex::PackageRecord{package.first, add_string(package.second)});
+  }
+
+  std::vector<SymbolIndex::SymbolRecord> symbols;
+  std::vector<SymbolIndex::AttributeSymbolRecord> attribute_symbols;
+  for (const Entry* entry : sorted_entries) {
+    const SymbolTable::Symbol& symbol = entry->symbol;
+    SymbolIndex::SymbolRecord record = {};
+    record.id = symbol.id.value().id;
+    record.package_index = static_cast<uint32_t>(entry->package_index);
+    record.type = add_string(entry->type);
+    record.entry = add_string(entry->entry);
+    record.flags = (symbol.is_public ? kSymbolPublic : 0u) |
+                   (symbol.is_dynamic ? kSymbolDynamic : 0u);
+    if (symbol.attribute) {
+      record.flags |= kSymbolHasAttribute;
+      record.type_mask = symbol.attribute->type_mask;
+      record.min_int = symbol.attribute->min_int;
+      record.max_int = symbol.attribute->max_int;
+      record.attribute_symbols_start = static_cast<uint32_t>(attribute_symbols.size());
+      record.attribute_symbols_count = static_cast<uint32_t>(symbol.attribute->symbols.size());
+      for (const Attribute::Symbol& attr_symbol : symbol.attribute->symbols) {
+        SymbolIndex::AttributeSymbolRecord attr_record = {};
+        attr_record.id = attr_symbol.symbol.id ? attr_symbol.symbol.id.value().id : 0u;
+        attr_record.value = attr_symbol.value;
+        attr_record.package = attr_record.type = attr_record.entry = StringRef{kNone, 0u};
+        if (attr_symbol.symbol.name) {
+          const ResourceName& attr_name = attr_symbol.symbol.name.value();
+          attr_record.package = add_string(attr_name.package);
+          attr_record.type = add_string(to_string(attr_name.type).to_string());
+          attr_record.entry = add_string(attr_name.entry);
+        }
+        attribute_symbols.push_back(attr_record);
+      }
+    }
+    symbols.push_back(record);
+  }
+
+  // An open addressing hash table of symbol indices, at most half full.
+  uint32_t bucket_count = 1u;
+  while (bucket_count < symbols.size() * 2u) {
+    bucket_count <<= 1;
+  }
+  std::vector<uint32_t> buckets(bucket_count, kNone);
+  for (size_t i = 0; i < sorted_entries.size(); i++) {
+    const Entry* entry = sorted_entries[i];
+    uint32_t bucket =
+        HashName(packages_[entry->package_index].second, entry->type, entry->entry) &
+        (bucket_count - 1u);
+    while (buckets[bucket] != kNone) {
+      bucket = (bucket + 1u) & (bucket_count - 1u);
+    }
+    buckets[bucket] = static_cast<uint32_t>(i);
+  }
+
+  SymbolIndex::Header header = {};
+  header.magic = kSymbolIndexMagic;
+  header.version = kSymbolIndexVersion;
+  header.source_size = source_.size;
+  header.source_mtime = source_.mtime;
+  header.source_path = add_string(source_.path);
+  header.compile_sdk_version = add_maybe_string(compile_sdk_version_);
+  header.compile_sdk_version_codename = add_maybe_string(compile_sdk_version_codename_);
+
+  size_t offset = Align(sizeof(header));
+  header.package_count = static_cast<uint32_t>(packages.size());
+  header.packages_offset = static_cast<uint32_t>(offset);
+  offset = Align(offset + packages.size() * sizeof(SymbolIndex::PackageRecord));
+  header.symbol_count = static_cast<uint32_t>(symbols.size());
+  header.symbols_offset = static_cast<uint32_t>(offset);
+  offset = Align(offset + symbols.size() * sizeof(SymbolIndex::SymbolRecord));
+  header.bucket_count = bucket_count;
+  header.buckets_offset = static_cast<uint32_t>(offset);
+  offset = Align(offset + buckets.size() * sizeof(uint32_t));
+  header.attribute_symbol_count = static_cast<uint32_t>(attribute_symbols.size());
+  header.attribute_symbols_offset = static_cast<uint32_t>(offset);
+  offset = Align(offset + attribute_symbols.size() * sizeof(SymbolIndex::AttributeSymbolRecord));
+  header.strings_size = static_cast<uint32_t>(strings.size());
+  header.strings_offset = static_cast<uint32_t>(offset);
+  offset += strings.size();
+  header.file_size = static_cast<uint32_t>(offset);
+
+  out_data->assign(offset, '\0');
+  char* data = &(*out_data)[0];
+  memcpy(data, &header, sizeof(header));
+  memcpy(data + header.packages_offset, packages.data(),
+         packages.size() * sizeof(SymbolIndex::PackageRecord));
+  memcpy(data + header.symbols_offset, symbols.data(),
+         symbols.size() * sizeof(SymbolIndex::SymbolRecord));
+  memcpy(data + header.buckets_offset, buckets.data(), buckets.size() * sizeof(uint32_t));
+  memcpy(data + header.attribute_symbols_offset, attribute_symbols.data(),
+         attribute_symbols.size() * sizeof(SymbolIndex::AttributeSymbolRecord));
+  memcpy(data + header.strings_offset, strings.data(), strings.size());
+}
+
+// Returns true if `count` elements of `element_size` bytes at `offset` fit in `size` bytes.
+static bool IsInBounds(size_t size, uint32_t offset, uint32_t count, size_t element_size) {
+  return offset % 4u == 0u && offset <= size &&
+         static_cast<uint64_t>(count) * element_size <= size - offset;
+}
+
+std::unique_ptr<SymbolIndex> SymbolIndex::Load(const std::string& path, std::string* out_error) {
+  Maybe<android::FileMap> map = file::MmapPath(path, out_error);
+  if (!map) {
+    return {};
+  }
+
+  const size_t size = map.value().getDataLength();
+  const void* data = map.value().getDataPtr();
+  if (data == nullptr || size < sizeof(Header)) {
+    *out_error = "symbol index is truncated";
+    return {};
+  }
+
+  const Header* header = static_cast<const Header*>(data);
+  if (header->magic != kSymbolIndexMagic) {
+    *out_error = "not a symbol index";
+    return {};
+  }
+
+  if (header->version != kSymbolIndexVersion) {
+    *out_error = StringPrintf("symbol index version is %u but AAPT expects version %u",
+                              header->version, kSymbolIndexVersion);
+    return {};
+  }
+
+  if (header->file_size != size ||
+      !IsInBounds(size, header->packages_offset, header->package_count, sizeof(PackageRecord)) ||
+      !IsInBounds(size, header->symbols_offset, header->symbol_count, sizeof(SymbolRecord)) ||
+      !IsInBounds(size, header->buckets_offset, header->bucket_count, sizeof(uint32_t)) ||
+      !IsInBounds(size, header->attribute_symbols_offset, header->attribute_symbol_count,
+                  sizeof(AttributeSymbolRecord)) ||
+      !IsInBounds(size, header->strings_offset, header->strings_size, 1u)) {
+    *out_error = "symbol index is corrupt";
+    return {};
+  }
+
+  if (header->bucket_count == 0u || (header->bucket_count & (header->bucket_count - 1u)) != 0u ||
+      header->bucket_count <= header->symbol_count) {
+    *out_error = "symbol index is corrupt";
+    return {};
+  }
+  return std::unique_ptr<SymbolIndex>(new SymbolIndex(std::move(map.value()), header));
+}
+
+SymbolIndex::SymbolIndex(android::FileMap&& map, const Header* header)
+    : map_(std::move(map)), header_(header) {
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(header_);
+  packages_ = reinterpret_cast<const PackageRecord*>(data + header_->packages_offset);
+  symbols_ = reinterpret_cast<const SymbolRecord*>(data + header_->symbols_offset);
+  buckets_ = reinterpret_cast<const uint32_t*>(data + header_->buckets_offset);
+  attribute_symbols_ =
+      reinterpret_cast<const AttributeSymbolRecord*>(data + header_->attribute_symbols_offset);
+  strings_ = reinterpret_cast<const char*>(data + header_->strings_offset);
+}
+
+StringPiece SymbolIndex::GetString(const StringRef& ref) const {
+  if (ref.offset > header_->strings_size || ref.size > header_->strings_size - ref.offset) {
+    return {};
+  }
+  return StringPiece(strings_ + ref.offset, ref.size);
+}
+
+bool SymbolIndex::IsFrom(const SymbolIndexSource& source) const {
+  return header_->source_size == source.size && header_->source_mtime == source.mtime &&
+         GetString(header_->source_path) == StringPiece(source.path);
+}
+
+std::map<size_t, std::string> SymbolIndex::GetPackages() const {
+  std::map<size_t, std::string> packages;
+  for (uint32_t i = 0; i < header_->package_count; i++) {
+    packages[packages_[i].id] = GetString(packages_[i].name).to_string();
+  }
+  return packages;
+}
+
+Maybe<std::string> SymbolIndex::GetCompileSdkVersion() const {
+  if (header_->compile_sdk_version.offset == kNone) {
+    return {};
+  }
+  return GetString(header_->compile_sdk_version).to_string();
+}
+
+Maybe<std::string> SymbolIndex::GetCompileSdkVersionCodename() const {
+  if (header_->compile_sdk_version_codename.offset == kNone) {
+    return {};
+  }
+  return GetString(header_->compile_sdk_version_codename).to_string();
+}
+
+const SymbolIndex::SymbolRecord* SymbolIndex::FindRecord(const StringPiece& package,
+                                                         const StringPiece& type,
+                                                         const StringPiece& entry) const {
+  const uint32_t mask = header_->bucket_count - 1u;
+  uint32_t bucket = HashName(package, type, entry) & mask;
+  for (uint32_t probes = 0; probes < header_->bucket_count; probes++) {
+    const uint32_t index = buckets_[bucket];
+    if (index == kNone || index >= header_->symbol_count) {
+      return nullptr;
+    }
+
+    const SymbolRecord& record = symbols_[index];
+    if (record.package_index < header_->package_count &&
+        GetString(record.entry) == entry && GetString(record.type) == type &&
+        GetString(packages_[record.package_index].name) == package) {
+      return &record;
+    }
+    bucket = (bucket + 1u) & mask;
+  }
+  return nullptr;
+}
+
+std::unique_ptr<SymbolTable::Symbol> SymbolIndex::MakeSymbol(const SymbolRecord& record,
+                                                              bool with_attribute) const {
+  std::unique_ptr<SymbolTable::Symbol> symbol = util::make_unique<SymbolTable::Symbol>();
+  symbol->id = ResourceId(record.id);
+  symbol->is_public = (record.flags & kSymbolPublic) != 0u;
+  symbol->is_dynamic = (record.flags & kSymbolDynamic) != 0u;
+  if (!with_attribute || (record.flags & kSymbolHasAttribute) == 0u) {
+    return symbol;
+  }
+
+  symbol->attribute = std::make_shared<Attribute>(record.type_mask);
+  symbol->attribute->min_int = record.min_int;
+  symbol->attribute->max_int = record.max_int;
+  if (record.attribute_symbols_start > header_->attribute_symbol_count ||
+      record.attribute_symbols_count >
+          header_->attribute_symbol_count - record.attribute_symbols_start) {
+    return {};
+  }
+
+  for (uint32_t i = 0; i < record.attribute_symbols_count; i++) {
+    const AttributeSymbolRecord& attr_record =
+        attribute_symbols_[record.attribute_symbols_start + i];
+    Attribute::Symbol attr_symbol;
+    if (attr_record.package.offset != kNone) {
+      const ResourceType* type = ParseResourceType(GetString(attr_record.type));
+      if (type == nullptr) {
+        return {};
+      }
+      attr_symbol.symbol.name = ResourceName(GetString(attr_record.package), *type,
+                                             GetString(attr_record.entry));
+    }
+    if (attr_record.id != 0u) {
+      attr_symbol.symbol.id = ResourceId(attr_record.id);
+    }
+    attr_symbol.value = attr_record.value;
+    symbol->attribute->symbols.push_back(std::move(attr_symbol));
+  }
+  return symbol;
+}
+
+std::unique_ptr<SymbolTable::Symbol> SymbolIndex::FindByName(const ResourceName& name) {
+  const StringPiece type = to_string(name.type);
+  std::string mangled_entry;
+
+  // Like AssetManagerSymbolSource, look for resources mangled into other packages too, in the
+  // order the packages were loaded.
+  for (uint32_t i = 0; i < header_->package_count; i++) {
+    const StringPiece package = GetString(packages_[i].name);
+    StringPiece entry = name.entry;
+    if (package != StringPiece(name.package)) {
+      if (mangled_entry.empty()) {
+        mangled_entry = NameMangler::MangleEntry(name.package, name.entry);
+      }
+      entry = mangled_entry;
+    }
+
+    const SymbolRecord* record = FindRecord(package, type, entry);
+    if (record == nullptr && name.type == ResourceType::kAttr) {
+      // Like ResTable::identifierForName(), look for a private attribute of the same name.
+      record = FindRecord(package, to_string(ResourceType::kAttrPrivate), entry);
+    }
+
+    if (record != nullptr) {
+      // AssetManagerSymbolSource only looks up the attribute when looking up an attr by name.
+      return MakeSymbol(*record, name.type == ResourceType::kAttr);
+    }
+  }
+  return {};
+}
+
+std::unique_ptr<SymbolTable::Symbol> SymbolIndex::FindById(ResourceId id) {
+  const SymbolRecord* begin = symbols_;
+  const SymbolRecord* end = symbols_ + header_->symbol_count;
+  const SymbolRecord* iter =
+      std::lower_bound(begin, end, id.id, [](const SymbolRecord& record, uint32_t id) -> bool {
+        return record.id < id;
+      });
+  if (iter == end || iter->id != id.id) {
+    return {};
+  }
+  // AssetManagerSymbolSource only looks up the attribute of attrs found by ID, not that of
+  // private attrs.
+  return MakeSymbol(*iter, GetString(iter->type) == to_string(ResourceType::kAttr));
+}
+
+std::unique_ptr<SymbolTable::Symbol> SymbolIndex::FindByReference(const Reference& ref) {
+  if (ref.id) {
+    return FindById(ref.id.value());
+  } else if (ref.name) {
+    return FindByName(ref.name.value());
+  }
+  return {};
+}
+
+}  // namespace aapt
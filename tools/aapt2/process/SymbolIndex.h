@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_PROCESS_SYMBOLINDEX_H
+#define AAPT_PROCESS_SYMBOLINDEX_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "android-base/macros.h"
+#include "androidfw/StringPiece.h"
+#include "utils/FileMap.h"
+
+#include "Resource.h"
+#include "process/SymbolTable.h"
+#include "util/Maybe.h"
+
+namespace aapt {
+
+// Identifies the include APK that a symbol index was generated from. An index is only used if
+// the APK still has the same size and modification time.
+struct SymbolIndexSource {
+  std::string path;
+  uint64_t size = 0u;
+  int64_t mtime = 0;
+};
+
+// Collects the symbols of an include APK and flattens them into the format read by SymbolIndex.
+class SymbolIndexBuilder {
+ public:
+  explicit SymbolIndexBuilder(const SymbolIndexSource& source) : source_(source) {
+  }
+
+  void AddPackage(uint8_t id, const std::string& name);
+
+  // Records the version of the framework that this include APK represents, if it is one.
+  void SetCompileSdkVersions(const Maybe<std::string>& version,
+                             const Maybe<std::string>& version_codename);
+
+  // Adds a symbol with an ID. The package of `name` must have been added with AddPackage().
+  // Returns false if the symbol can't be represented in the index.
+  bool AddSymbol(const ResourceName& name, const SymbolTable::Symbol& symbol);
+
+  void Flatten(std::string* out_data) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SymbolIndexBuilder);
+
+  struct Entry {
+    size_t package_index;
+    std::string type;
+    std::string entry;
+    SymbolTable::Symbol symbol;
+  };
+
+  SymbolIndexSource source_;
+  std::vector<std::pair<uint8_t, std::string>> packages_;
+  Maybe<std::string> compile_sdk_version_;
+  Maybe<std::string> compile_sdk_version_codename_;
+  std::vector<Entry> entries_;
+};
+
+// A read-only index of all the symbols in an include APK, like android.jar. The index is a
+// memory mapped file with a hash table of names and a table of symbols sorted by ID, so loading it
+// costs nothing more than mapping it, and lookups don't parse the APK's resource table.
+// Lookups return exactly what AssetManagerSymbolSource would return for the APK the index was
+// generated from.
+//
+// The index is stored in host byte order. It is a cache meant to be generated and read on the
+// same machine.
+class SymbolIndex : public ISymbolSource {
+ public:
+  // Maps and validates the index at `path`. Returns nullptr and sets `out_error` if the file is
+  // missing or is not a valid index.
+  static std::unique_ptr<SymbolIndex> Load(const std::string& path, std::string* out_error);
+
+  // Returns true if this index was generated from `source`.
+  bool IsFrom(const SymbolIndexSource& source) const;
+
+  // Returns the packages in the index, keyed by package ID.
+  std::map<size_t, std::string> GetPackages() const;
+
+  Maybe<std::string> GetCompileSdkVersion() const;
+  Maybe<std::string> GetCompileSdkVersionCodename() const;
+
+  std::unique_ptr<SymbolTable::Symbol> FindByName(const ResourceName& name) override;
+  std::unique_ptr<SymbolTable::Symbol> FindById(ResourceId id) override;
+
+  // Like AssetManagerSymbolSource, prefers looking up by ID.
+  std::unique_ptr<SymbolTable::Symbol> FindByReference(const Reference& ref) override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SymbolIndex);
+
+  friend class SymbolIndexBuilder;
+
+  struct StringRef;
+  struct Header;
+  struct PackageRecord;
+  struct SymbolRecord;
+  struct AttributeSymbolRecord;
+
+  SymbolIndex(android::FileMap&& map, const Header* header);
+
+  android::StringPiece GetString(const StringRef& ref) const;
+  const SymbolRecord* FindRecord(const android::StringPiece& package,
+                                 const android::StringPiece& type,
+                                 const android::StringPiece& entry) const;
+  std::unique_ptr<SymbolTable::Symbol> MakeSymbol(const SymbolRecord& record,
+                                                  bool with_attribute) const;
+
+  android::FileMap map_;
+  const Header* header_;
+  const PackageRecord* packages_;
+  const SymbolRecord* symbols_;
+  const uint32_t* buckets_;
+  const AttributeSymbolRecord* attribute_symbols_;
+  const char* strings_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_PROCESS_SYMBOLINDEX_H */
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "process/SymbolIndex.h"
+
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
+
+#include "NameMangler.h"
+#include "test/Test.h"
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::IsNull;
+using ::testing::Not;
+using ::testing::NotNull;
+using ::testing::Pair;
+
+namespace aapt {
+
+static std::unique_ptr<SymbolIndex> WriteAndLoad(const SymbolIndexBuilder& builder,
+                                                 const std::string& path) {
+  std::string data;
+  builder.Flatten(&data);
+  if (!android::base::WriteStringToFile(data, path)) {
+    return {};
+  }
+
+  std::string error;
+  std::unique_ptr<SymbolIndex> index = SymbolIndex::Load(path, &error);
+  EXPECT_THAT(error, IsEmpty());
+  return index;
+}
+
+TEST(SymbolIndexTest, FindSymbols) {
+  SymbolIndexSource source;
+  source.path = "out/android.jar";
+  source.size = 1024u;
+  source.mtime = 42;
+
+  SymbolIndexBuilder builder(source);
+  builder.AddPackage(0x01u, "android");
+  builder.SetCompileSdkVersions(std::string("28"), std::string("P"));
+
+  SymbolTable::Symbol id_symbol(ResourceId(0x01020000), {}, true /*pub*/);
+  ASSERT_TRUE(builder.AddSymbol(test::ParseNameOrDie("android:id/foo"), id_symbol));
+
+  auto attr = std::make_shared<Attribute>(android::ResTable_map::TYPE_ENUM);
+  attr->min_int = 1;
+  Attribute::Symbol enum_symbol;
+  enum_symbol.symbol =
+      Reference(test::ParseNameOrDie("android:id/foo"), ResourceId(0x01020000));
+  enum_symbol.value = 3u;
+  attr->symbols.push_back(enum_symbol);
+  SymbolTable::Symbol attr_symbol(ResourceId(0x01010000), attr);
+  ASSERT_TRUE(builder.AddSymbol(test::ParseNameOrDie("android:attr/bar"), attr_symbol));
+
+  SymbolTable::Symbol mangled_symbol(ResourceId(0x01020001));
+  ASSERT_TRUE(builder.AddSymbol(
+      test::ParseNameOrDie("android:id/" + NameMangler::MangleEntry("com.lib", "baz")),
+      mangled_symbol));
+
+  // Symbols from packages that are not in the index can't be added.
+  EXPECT_FALSE(builder.AddSymbol(test::ParseNameOrDie("com.app:id/foo"), id_symbol));
+
+  TemporaryFile file;
+  std::unique_ptr<SymbolIndex> index = WriteAndLoad(builder, file.path);
+  ASSERT_THAT(index, NotNull());
+
+  EXPECT_TRUE(index->IsFrom(source));
+  EXPECT_THAT(index->GetPackages(), ElementsAre(Pair(0x01u, "android")));
+  EXPECT_THAT(index->GetCompileSdkVersion(), Eq(make_value<std::string>("28")));
+  EXPECT_THAT(index->GetCompileSdkVersionCodename(), Eq(make_value<std::string>("P")));
+
+  std::unique_ptr<SymbolTable::Symbol> s =
+      index->FindByName(test::ParseNameOrDie("android:id/foo"));
+  ASSERT_THAT(s, NotNull());
+  EXPECT_THAT(s->id, Eq(make_value(ResourceId(0x01020000))));
+  EXPECT_TRUE(s->is_public);
+  EXPECT_THAT(s->attribute, IsNull());
+
+  s = index->FindById(ResourceId(0x01010000));
+  ASSERT_THAT(s, NotNull());
+  EXPECT_FALSE(s->is_public);
+  ASSERT_THAT(s->attribute, NotNull());
+  EXPECT_THAT(s->attribute->type_mask, Eq(android::ResTable_map::TYPE_ENUM));
+  EXPECT_THAT(s->attribute->min_int, Eq(1));
+  ASSERT_THAT(s->attribute->symbols.size(), Eq(1u));
+  EXPECT_THAT(s->attribute->symbols[0].symbol.name,
+              Eq(make_value(test::ParseNameOrDie("android:id/foo"))));
+  EXPECT_THAT(s->attribute->symbols[0].symbol.id, Eq(make_value(ResourceId(0x01020000))));
+  EXPECT_THAT(s->attribute->symbols[0].value, Eq(3u));
+
+  // Resources of other packages are found under their mangled names, like in AssetManager.
+  s = index->FindByName(test::ParseNameOrDie("com.lib:id/baz"));
+  ASSERT_THAT(s, NotNull());
+  EXPECT_THAT(s->id, Eq(make_value(ResourceId(0x01020001))));
+
+  EXPECT_THAT(index->FindByName(test::ParseNameOrDie("android:id/bar")), IsNull());
+  EXPECT_THAT(index->FindById(ResourceId(0x01020002)), IsNull());
+}
+
+TEST(SymbolIndexTest, FindPrivateAttrByAttrName) {
+  SymbolIndexBuilder builder(SymbolIndexSource{});
+  builder.AddPackage(0x01u, "android");
+
+  auto attr = std::make_shared<Attribute>(android::ResTable_map::TYPE_INTEGER);
+  SymbolTable::Symbol attr_symbol(ResourceId(0x01020000), attr);
+  ASSERT_TRUE(builder.AddSymbol(test::ParseNameOrDie("android:^attr-private/foo"), attr_symbol));
+
+  TemporaryFile file;
+  std::unique_ptr<SymbolIndex> index = WriteAndLoad(builder, file.path);
+  ASSERT_THAT(index, NotNull());
+
+  // Like ResTable::identifierForName(), an attr that is not found is looked up as a private attr.
+  std::unique_ptr<SymbolTable::Symbol> s =
+      index->FindByName(test::ParseNameOrDie("android:attr/foo"));
+  ASSERT_THAT(s, NotNull());
+  EXPECT_THAT(s->id, Eq(make_value(ResourceId(0x01020000))));
+  ASSERT_THAT(s->attribute, NotNull());
+  EXPECT_THAT(s->attribute->type_mask, Eq(android::ResTable_map::TYPE_INTEGER));
+
+  // Like AssetManagerSymbolSource, private attrs found by ID have no attribute.
+  s = index->FindById(ResourceId(0x01020000));
+  ASSERT_THAT(s, NotNull());
+  EXPECT_THAT(s->attribute, IsNull());
+
+  EXPECT_THAT(index->FindByName(test::ParseNameOrDie("android:id/foo")), IsNull());
+}
+
+TEST(SymbolIndexTest, DetectsChangedSource) {
+  SymbolIndexSource source;
+  source.path = "out/android.jar";
+  source.size = 1024u;
+  source.mtime = 42;
+
+  SymbolIndexBuilder builder(source);
+  builder.AddPackage(0x01u, "android");
+
+  TemporaryFile file;
+  std::unique_ptr<SymbolIndex> index = WriteAndLoad(builder, file.path);
+  ASSERT_THAT(index, NotNull());
+  EXPECT_THAT(index->GetCompileSdkVersion(), Eq(Maybe<std::string>()));
+
+  SymbolIndexSource changed_source = source;
+  changed_source.mtime = 43;
+  EXPECT_FALSE(index->IsFrom(changed_source));
+
+  changed_source = source;
+  changed_source.path = "out/other.jar";
+  EXPECT_FALSE(index->IsFrom(changed_source));
+}
+
+TEST(SymbolIndexTest, RejectInvalidIndex) {
+  SymbolIndexBuilder builder(SymbolIndexSource{});
+  builder.AddPackage(0x01u, "android");
+  ASSERT_TRUE(builder.AddSymbol(test::ParseNameOrDie("android:id/foo"),
+                                SymbolTable::Symbol(ResourceId(0x01020000))));
+
+  std::string data;
+  builder.Flatten(&data);
+
+  TemporaryFile file;
+  ASSERT_TRUE(android::base::WriteStringToFile(data.substr(0, data.size() - 1u), file.path));
+  std::string error;
+  EXPECT_THAT(SymbolIndex::Load(file.path, &error), IsNull());
+  EXPECT_THAT(error, Not(IsEmpty()));
+
+  ASSERT_TRUE(android::base::WriteStringToFile("not an index", file.path));
+  error.clear();
+  EXPECT_THAT(SymbolIndex::Load(file.path, &error), IsNull());
+  EXPECT_THAT(error, Not(IsEmpty()));
+}
+
+}  // namespace aapt
@@ -16,8 +16,8 @@
 
 #include "text/Unicode.h"
 
-#include <algorithm>
 #include <array>
+#include <cstdint>
 
 #include "text/Utf8Iterator.h"
 
@@ -42,18 +42,156 @@ struct CharacterProperties {
 // Incude the generated data table.
 #include "text/Unicode_data.cpp"
 
-bool CompareCharacterProperties(const CharacterProperties& a, char32_t codepoint) {
-  return a.last_char < codepoint;
+// Properties are looked up in a two-level table that is built from sCharacterProperties at compile
+// time. Code points are split into blocks of 256. The first level maps each block to a bitmap in
+// the second level, which has one bit per code point and property. Blocks with the same bitmap,
+// like the many blocks with no properties at all, share it.
+constexpr size_t kBlockBits = 8u;
+constexpr size_t kBlockSize = 1u << kBlockBits;
+constexpr size_t kPropertyCount = 2u;
+constexpr size_t kWordsPerProperty = kBlockSize / 64u;
+constexpr size_t kWordsPerBlock = kWordsPerProperty * kPropertyCount;
+
+// Code points past the last block have no properties.
+constexpr size_t kBlockCount = (sCharacterProperties.back().last_char >> kBlockBits) + 1u;
+
+struct BlockBitmaps {
+  uint64_t words[kBlockCount][kWordsPerBlock];
+};
+
+constexpr BlockBitmaps MakeBlockBitmaps() {
+  BlockBitmaps bitmaps = {};
+  for (size_t i = 0; i < sCharacterProperties.size(); i++) {
+    const CharacterProperties& range = sCharacterProperties[i];
+    for (size_t property = 0; property < kPropertyCount; property++) {
+      if ((range.properties & (1u << property)) == 0u) {
+        continue;
+      }
+
+      // Set the bits of the range a word at a time.
+      size_t codepoint = range.first_char;
+      while (codepoint <= range.last_char) {
+        const size_t bit = codepoint % 64u;
+        const size_t remaining = range.last_char - codepoint + 1u;
+        const size_t count = remaining < 64u - bit ? remaining : 64u - bit;
+        const uint64_t mask = (count == 64u ? ~uint64_t{0} : (uint64_t{1} << count) - 1u) << bit;
+        const size_t word = property * kWordsPerProperty + (codepoint % kBlockSize) / 64u;
+        bitmaps.words[codepoint >> kBlockBits][word] |= mask;
+        codepoint += count;
+      }
+    }
+  }
+  return bitmaps;
+}
+
+constexpr BlockBitmaps kBlockBitmaps = MakeBlockBitmaps();
+
+constexpr bool IsSameBitmap(const uint64_t* a, const uint64_t* b) {
+  for (size_t i = 0; i < kWordsPerBlock; i++) {
+    if (a[i] != b[i]) {
+      return false;
+    }
+  }
+  return true;
 }
 
+constexpr size_t CountDistinctBitmaps() {
+  size_t distinct[kBlockCount] = {};
+  size_t distinct_count = 0u;
+  for (size_t block = 0; block < kBlockCount; block++) {
+    size_t i = 0u;
+    while (i < distinct_count &&
+           !IsSameBitmap(kBlockBitmaps.words[distinct[i]], kBlockBitmaps.words[block])) {
+      i++;
+    }
+    if (i == distinct_count) {
+      distinct[distinct_count++] = block;
+    }
+  }
+  return distinct_count;
+}
+
+template <size_t BitmapCount>
+struct CharacterPropertiesTable {
+  static_assert(BitmapCount <= 256u, "bitmap indices must fit in a uint8_t");
+
+  uint8_t block_bitmaps[kBlockCount];
+  uint64_t bitmaps[BitmapCount][kWordsPerBlock];
+};
+
+template <size_t BitmapCount>
+constexpr CharacterPropertiesTable<BitmapCount> MakeCharacterPropertiesTable() {
+  CharacterPropertiesTable<BitmapCount> table = {};
+  size_t bitmap_count = 0u;
+  for (size_t block = 0; block < kBlockCount; block++) {
+    const uint64_t* words = kBlockBitmaps.words[block];
+    size_t i = 0u;
+    while (i < bitmap_count && !IsSameBitmap(table.bitmaps[i], words)) {
+      i++;
+    }
+    if (i == bitmap_count) {
+      for (size_t w = 0; w < kWordsPerBlock; w++) {
+        table.bitmaps[i][w] = words[w];
+      }
+      bitmap_count++;
+    }
+    table.block_bitmaps[block] = static_cast<uint8_t>(i);
+  }
+  return table;
+}
+
+constexpr auto kCharacterPropertiesTable =
+    MakeCharacterPropertiesTable<CountDistinctBitmaps()>();
+
 uint32_t FindCharacterProperties(char32_t codepoint) {
-  const auto iter_end = sCharacterProperties.end();
-  const auto iter = std::lower_bound(sCharacterProperties.begin(), iter_end, codepoint,
-                                     CompareCharacterProperties);
-  if (iter != iter_end && codepoint >= iter->first_char) {
-    return iter->properties;
+  const size_t block = codepoint >> kBlockBits;
+  if (block >= kBlockCount) {
+    return 0u;
+  }
+
+  const uint64_t* words =
+      kCharacterPropertiesTable.bitmaps[kCharacterPropertiesTable.block_bitmaps[block]];
+  const size_t offset = codepoint % kBlockSize;
+  uint32_t properties = 0u;
+  for (size_t property = 0; property < kPropertyCount; property++) {
+    const uint64_t word = words[property * kWordsPerProperty + offset / 64u];
+    properties |= static_cast<uint32_t>((word >> (offset % 64u)) & 1u) << property;
   }
-  return 0u;
+  return properties;
+}
+
+// Returns true if `str` is not empty, its first character satisfies `is_start`, and every other
+// character satisfies `is_continue`. Names are almost always ASCII, so ASCII characters are checked
+// as they are, and only the rest of the string from the first non-ASCII byte is decoded.
+template <typename StartFunc, typename ContinueFunc>
+bool IsIdentifier(const StringPiece& str, const StartFunc& is_start,
+                  const ContinueFunc& is_continue) {
+  if (str.empty()) {
+    return false;
+  }
+
+  size_t i = 0u;
+  for (; i < str.size(); i++) {
+    const char32_t c = static_cast<unsigned char>(str.data()[i]);
+    if (c >= 0x80u) {
+      break;
+    }
+    if (!(i == 0u ? is_start(c) : is_continue(c))) {
+      return false;
+    }
+  }
+
+  Utf8Iterator iter(StringPiece(str.data() + i, str.size() - i));
+  if (i == 0u && !is_start(iter.Next())) {
+    return false;
+  }
+
+  while (iter.HasNext()) {
+    if (!is_continue(iter.Next())) {
+      return false;
+    }
+  }
+  return true;
 }
 
 }  // namespace
@@ -78,48 +216,21 @@ bool IsWhitespace(char32_t codepoint) {
 }
 
 bool IsJavaIdentifier(const StringPiece& str) {
-  Utf8Iterator iter(str);
-
-  // Check the first character.
-  if (!iter.HasNext()) {
-    return false;
-  }
-
-  const char32_t first_codepoint = iter.Next();
-  if (!IsXidStart(first_codepoint) && first_codepoint != U'_' && first_codepoint != U'$') {
-    return false;
-  }
-
-  while (iter.HasNext()) {
-    const char32_t codepoint = iter.Next();
-    if (!IsXidContinue(codepoint) && codepoint != U'$') {
-      return false;
-    }
-  }
-  return true;
+  return IsIdentifier(
+      str,
+      [](char32_t codepoint) {
+        return IsXidStart(codepoint) || codepoint == U'_' || codepoint == U'$';
+      },
+      [](char32_t codepoint) { return IsXidContinue(codepoint) || codepoint == U'$'; });
 }
 
 bool IsValidResourceEntryName(const StringPiece& str) {
-  Utf8Iterator iter(str);
-
-  // Check the first character.
-  if (!iter.HasNext()) {
-    return false;
-  }
-
   // Resources are allowed to start with '_'
-  const char32_t first_codepoint = iter.Next();
-  if (!IsXidStart(first_codepoint) && first_codepoint != U'_') {
-    return false;
-  }
-
-  while (iter.HasNext()) {
-    const char32_t codepoint = iter.Next();
-    if (!IsXidContinue(codepoint) && codepoint != U'.' && codepoint != U'-') {
-      return false;
-    }
-  }
-  return true;
+  return IsIdentifier(
+      str, [](char32_t codepoint) { return IsXidStart(codepoint) || codepoint == U'_'; },
+      [](char32_t codepoint) {
+        return IsXidContinue(codepoint) || codepoint == U'.' || codepoint == U'-';
+      });
 }
 
 }  // namespace text
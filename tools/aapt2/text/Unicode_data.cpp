@@ -14,7 +14,7 @@
  * limitations under the License.
  */
 
-const static std::array<CharacterProperties, 611> sCharacterProperties = {{
+static constexpr std::array<CharacterProperties, 611> sCharacterProperties = {{
     {0x0030, 0x0039, CharacterProperties::kXidContinue},
     {0x0041, 0x005a, CharacterProperties::kXidStart | CharacterProperties::kXidContinue},
     {0x005f, 0x005f, CharacterProperties::kXidContinue},
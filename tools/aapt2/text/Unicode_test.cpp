@@ -41,6 +41,23 @@ TEST(UnicodeTest, IsXidContinue) {
   EXPECT_THAT(invalid_input, Each(ResultOf(IsXidContinue, Eq(false))));
 }
 
+TEST(UnicodeTest, PropertiesAtBlockAndTableBoundaries) {
+  // U+00FF and U+0100 end and start blocks of the lookup table.
+  EXPECT_TRUE(IsXidStart(U'\u00ff'));
+  EXPECT_TRUE(IsXidStart(U'\u0100'));
+  EXPECT_FALSE(IsXidStart(U'\u00f7'));
+
+  // U+0300 is a combining mark, which can continue an identifier but not start one.
+  EXPECT_FALSE(IsXidStart(U'\u0300'));
+  EXPECT_TRUE(IsXidContinue(U'\u0300'));
+
+  // The last code points with properties, and the ones after them.
+  EXPECT_TRUE(IsXidStart(U'\uffdc'));
+  EXPECT_FALSE(IsXidContinue(U'\uffdd'));
+  EXPECT_FALSE(IsXidContinue(U'\U00010000'));
+  EXPECT_FALSE(IsXidContinue(U'\U0010ffff'));
+}
+
 TEST(UnicodeTest, IsJavaIdentifier) {
   EXPECT_TRUE(IsJavaIdentifier("FøøBar_12"));
   EXPECT_TRUE(IsJavaIdentifier("Føø$Bar"));
@@ -49,6 +66,14 @@ TEST(UnicodeTest, IsJavaIdentifier) {
 
   EXPECT_FALSE(IsJavaIdentifier("12FøøBar"));
   EXPECT_FALSE(IsJavaIdentifier(".Hello"));
+  EXPECT_FALSE(IsJavaIdentifier(""));
+
+  // Non-ASCII characters at the start, the end, and after an invalid ASCII character.
+  EXPECT_TRUE(IsJavaIdentifier("øBar"));
+  EXPECT_TRUE(IsJavaIdentifier("Barø"));
+  EXPECT_FALSE(IsJavaIdentifier("\u0300Bar"));
+  EXPECT_FALSE(IsJavaIdentifier("Bar.ø"));
+  EXPECT_FALSE(IsJavaIdentifier("Bar\u00f7"));
 }
 
 TEST(UnicodeTest, IsValidResourceEntryName) {
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <cerrno>
 #include <cstdio>
+#include <cstdlib>
 #include <string>
 
 #include "android-base/errors.h"
@@ -41,6 +42,7 @@ using ::android::FileMap;
 using ::android::StringPiece;
 using ::android::base::ReadFileToString;
 using ::android::base::SystemErrorCodeToString;
+using ::android::base::WriteStringToFile;
 using ::android::base::unique_fd;
 
 namespace aapt {
@@ -101,6 +103,75 @@ FileType GetFileType(const std::string& path) {
 }
 #endif
 
+#ifdef _WIN32
+Maybe<FileStamp> GetFileStamp(const std::string& path) {
+  std::wstring path_utf16;
+  if (!::android::base::UTF8PathToWindowsLongPath(path.c_str(), &path_utf16)) {
+    return {};
+  }
+
+  struct _stat64 sb;
+  if (_wstat64(path_utf16.c_str(), &sb) != 0 || (sb.st_mode & _S_IFREG) == 0) {
+    return {};
+  }
+
+  FileStamp stamp;
+  stamp.size = static_cast<uint64_t>(sb.st_size);
+  stamp.mtime_ns = static_cast<int64_t>(sb.st_mtime) * 1000000000;
+  return stamp;
+}
+#else
+Maybe<FileStamp> GetFileStamp(const std::string& path) {
+  struct stat sb;
+  if (stat(path.c_str(), &sb) != 0 || !S_ISREG(sb.st_mode)) {
+    return {};
+  }
+
+  FileStamp stamp;
+  stamp.size = static_cast<uint64_t>(sb.st_size);
+#if defined(__APPLE__)
+  stamp.mtime_ns = static_cast<int64_t>(sb.st_mtimespec.tv_sec) * 1000000000 +
+                   sb.st_mtimespec.tv_nsec;
+#else
+  stamp.mtime_ns = static_cast<int64_t>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+#endif
+  return stamp;
+}
+#endif
+
+#ifdef _WIN32
+Maybe<std::string> GetCanonicalPath(const std::string& path) {
+  std::wstring path_utf16;
+  if (!::android::base::UTF8PathToWindowsLongPath(path.c_str(), &path_utf16)) {
+    return {};
+  }
+
+  wchar_t* full_path_utf16 = _wfullpath(nullptr, path_utf16.c_str(), 0);
+  if (full_path_utf16 == nullptr) {
+    return {};
+  }
+
+  std::string full_path;
+  const bool converted = ::android::base::WideToUTF8(full_path_utf16, &full_path);
+  free(full_path_utf16);
+  if (!converted || GetFileType(full_path) == FileType::kNonexistant) {
+    return {};
+  }
+  return full_path;
+}
+#else
+Maybe<std::string> GetCanonicalPath(const std::string& path) {
+  char* full_path = realpath(path.c_str(), nullptr);
+  if (full_path == nullptr) {
+    return {};
+  }
+
+  std::string result = full_path;
+  free(full_path);
+  return result;
+}
+#endif
+
 bool mkdirs(const std::string& path) {
   constexpr const mode_t mode = S_IRUSR | S_IWUSR | S_IXUSR | S_IRGRP | S_IXGRP;
   // Start after the first character so that we don't consume the root '/'.
@@ -204,6 +275,35 @@ Maybe<FileMap> MmapPath(const std::string& path, std::string* out_error) {
   return std::move(filemap);
 }
 
+bool WriteFileIfChanged(const std::string& path, const StringPiece& contents, bool* out_changed,
+                        std::string* out_error) {
+  // Only read the existing file when it has the same size, which is the common case when nothing
+  // changed.
+  Maybe<FileStamp> stamp = GetFileStamp(path);
+  if (stamp && stamp.value().size == contents.size()) {
+    std::string existing_contents;
+    if (ReadFileToString(path, &existing_contents, true /*follow_symlinks*/) &&
+        StringPiece(existing_contents) == contents) {
+      if (out_changed) {
+        *out_changed = false;
+      }
+      return true;
+    }
+  }
+
+  if (!WriteStringToFile(contents.to_string(), path, true /*follow_symlinks*/)) {
+    if (out_error) {
+      *out_error = SystemErrorCodeToString(errno);
+    }
+    return false;
+  }
+
+  if (out_changed) {
+    *out_changed = true;
+  }
+  return true;
+}
+
 bool AppendArgsFromFile(const StringPiece& path, std::vector<std::string>* out_arglist,
                         std::string* out_error) {
   std::string contents;
@@ -54,6 +54,27 @@ enum class FileType {
 
 FileType GetFileType(const std::string& path);
 
+// The size and last modification time of a file, which change whenever the file is written.
+struct FileStamp {
+  uint64_t size = 0u;
+  int64_t mtime_ns = 0;
+};
+
+inline bool operator==(const FileStamp& a, const FileStamp& b) {
+  return a.size == b.size && a.mtime_ns == b.mtime_ns;
+}
+
+inline bool operator!=(const FileStamp& a, const FileStamp& b) {
+  return !(a == b);
+}
+
+// Returns the stamp of the regular file at `path`, or nothing if it is not a readable regular file.
+Maybe<FileStamp> GetFileStamp(const std::string& path);
+
+// Returns the absolute path of the existing file at `path`, with symbolic links and relative
+// parts resolved, or nothing if it can't be resolved.
+Maybe<std::string> GetCanonicalPath(const std::string& path);
+
 // Appends a path to `base`, separated by the directory separator.
 void AppendPath(std::string* base, android::StringPiece part);
 
@@ -76,6 +97,12 @@ std::string PackageToPath(const android::StringPiece& package);
 // Creates a FileMap for the file at path.
 Maybe<android::FileMap> MmapPath(const std::string& path, std::string* out_error);
 
+// Writes `contents` to the file at `path`, unless the file already holds exactly `contents`. An
+// unchanged file is left untouched, along with its modification time, so that build steps which
+// depend on it are not redone. Sets `out_changed` to whether the file was written, if not nullptr.
+bool WriteFileIfChanged(const std::string& path, const android::StringPiece& contents,
+                        bool* out_changed, std::string* out_error);
+
 // Reads the file at path and appends each line to the outArgList vector.
 bool AppendArgsFromFile(const android::StringPiece& path, std::vector<std::string>* out_arglist,
                         std::string* out_error);
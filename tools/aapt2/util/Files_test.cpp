@@ -18,6 +18,9 @@
 
 #include <sstream>
 
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
+
 #include "test/Test.h"
 
 namespace aapt {
@@ -55,5 +58,51 @@ TEST_F(FilesTest, AppendPathWithLeadingOrTrailingSeparators) {
   EXPECT_EQ(expected_path_, base);
 }
 
+TEST_F(FilesTest, WriteFileIfChanged) {
+  TemporaryDir dir;
+  std::string path = dir.path;
+  AppendPath(&path, "R.java");
+
+  bool changed = false;
+  ASSERT_TRUE(WriteFileIfChanged(path, "class R {}", &changed, nullptr));
+  EXPECT_TRUE(changed);
+
+  ASSERT_TRUE(WriteFileIfChanged(path, "class R {}", &changed, nullptr));
+  EXPECT_FALSE(changed);
+
+  // Same size, different contents.
+  ASSERT_TRUE(WriteFileIfChanged(path, "class S {}", &changed, nullptr));
+  EXPECT_TRUE(changed);
+
+  std::string contents;
+  ASSERT_TRUE(android::base::ReadFileToString(path, &contents));
+  EXPECT_EQ("class S {}", contents);
+
+  std::string error;
+  EXPECT_FALSE(WriteFileIfChanged(path + "/not/a/dir", "", nullptr, &error));
+  EXPECT_FALSE(error.empty());
+}
+
+TEST_F(FilesTest, GetCanonicalPath) {
+  TemporaryDir dir;
+  std::string path = dir.path;
+  AppendPath(&path, "android.jar");
+  ASSERT_TRUE(android::base::WriteStringToFile("", path));
+
+  Maybe<std::string> canonical_path = GetCanonicalPath(path);
+  ASSERT_TRUE(canonical_path);
+
+  std::string other_path = dir.path;
+  AppendPath(&other_path, ".");
+  AppendPath(&other_path, "android.jar");
+  Maybe<std::string> other_canonical_path = GetCanonicalPath(other_path);
+  ASSERT_TRUE(other_canonical_path);
+  EXPECT_EQ(canonical_path.value(), other_canonical_path.value());
+
+  std::string missing_path = dir.path;
+  AppendPath(&missing_path, "missing.jar");
+  EXPECT_FALSE(GetCanonicalPath(missing_path));
+}
+
 }  // namespace files
 }  // namespace aapt
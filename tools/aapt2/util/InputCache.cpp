@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/InputCache.h"
+
+#include <iterator>
+
+namespace aapt {
+
+InputCache* InputCache::Get() {
+  static InputCache* cache = new InputCache();
+  return cache;
+}
+
+void InputCache::SetMemoryLimit(size_t limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memory_limit_ = limit;
+  EvictToFit(limit);
+}
+
+bool InputCache::IsEnabled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memory_limit_ > 0u;
+}
+
+size_t InputCache::GetSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+bool InputCache::StampInputs(const std::vector<std::string>& paths, Inputs* out_inputs) {
+  out_inputs->clear();
+  for (const std::string& path : paths) {
+    Maybe<file::FileStamp> stamp = file::GetFileStamp(path);
+    if (!stamp) {
+      return false;
+    }
+    out_inputs->push_back(std::make_pair(path, stamp.value()));
+  }
+  return true;
+}
+
+std::shared_ptr<void> InputCache::FindValue(Kind kind, const std::string& key,
+                                            const Inputs& inputs) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto index_iter = index_.find(std::make_pair(kind, key));
+  if (index_iter == index_.end()) {
+    return {};
+  }
+
+  EntryList::iterator iter = index_iter->second;
+  if (iter->inputs != inputs) {
+    // The files changed, so the entry will never be found again.
+    Erase(iter);
+    return {};
+  }
+
+  entries_.splice(entries_.begin(), entries_, iter);
+  return iter->value;
+}
+
+void InputCache::InsertValue(Kind kind, const std::string& key, Inputs inputs,
+                             std::shared_ptr<void> value, size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto index_iter = index_.find(std::make_pair(kind, key));
+  if (index_iter != index_.end()) {
+    Erase(index_iter->second);
+  }
+
+  if (size > memory_limit_) {
+    return;
+  }
+
+  EvictToFit(memory_limit_ - size);
+  entries_.push_front(Entry{kind, key, std::move(inputs), std::move(value), size});
+  index_[std::make_pair(kind, key)] = entries_.begin();
+  size_ += size;
+}
+
+void InputCache::Erase(EntryList::iterator iter) {
+  size_ -= iter->size;
+  index_.erase(std::make_pair(iter->kind, iter->key));
+  entries_.erase(iter);
+}
+
+void InputCache::EvictToFit(size_t limit) {
+  while (size_ > limit && !entries_.empty()) {
+    Erase(std::prev(entries_.end()));
+  }
+
+  // Entries with no size are only evicted when the cache is disabled.
+  if (limit == 0u && memory_limit_ == 0u) {
+    index_.clear();
+    entries_.clear();
+  }
+}
+
+}  // namespace aapt
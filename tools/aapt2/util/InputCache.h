@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_INPUTCACHE_H
+#define AAPT_UTIL_INPUTCACHE_H
+
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "android-base/macros.h"
+
+#include "util/Files.h"
+
+namespace aapt {
+
+// Keeps data that was loaded or computed from input files, so that a long running aapt2 process
+// (like `aapt2 daemon`) can skip the work when a later command reads the same unchanged files.
+// Every entry remembers the stamps of the files it was derived from, and is only found while all
+// of them are unchanged. The least recently used entries are evicted to stay under a memory limit.
+//
+// The cache is disabled, and retains nothing, until a memory limit is set. It is safe to use from
+// multiple threads.
+class InputCache {
+ public:
+  // What an entry holds. Each kind of entry always holds the same type of value.
+  enum class Kind {
+    // An AssetManagerSymbolSource with a set of include APKs loaded.
+    kIncludeAssets,
+
+    // The LoadedApk of a static library include, whose table must be cloned before it is modified,
+    // and the diagnostics of loading it.
+    kStaticLibrary,
+
+    // The entries of a compiled resource container (.flat or .apc file).
+    kCompiledContainer,
+
+    // The output of crunching a PNG, as a std::string.
+    kCrunchedPng,
+  };
+
+  // The files an entry was derived from, and their stamps.
+  using Inputs = std::vector<std::pair<std::string, file::FileStamp>>;
+
+  // Returns the cache shared by the whole process.
+  static InputCache* Get();
+
+  InputCache() = default;
+
+  // Sets the approximate number of bytes that the values in the cache may take up, and evicts
+  // entries until they fit. A limit of 0 disables the cache and empties it.
+  void SetMemoryLimit(size_t limit);
+
+  bool IsEnabled() const;
+
+  // Returns the approximate number of bytes taken up by the values in the cache.
+  size_t GetSize() const;
+
+  // Reads the stamps of the files at `paths`. Returns false if any of the files isn't a readable
+  // regular file, in which case nothing derived from them can be cached.
+  static bool StampInputs(const std::vector<std::string>& paths, Inputs* out_inputs);
+
+  // Returns the value of kind `kind` that was cached for `key` from `inputs`, or nullptr if there
+  // is none or if it was derived from files with different stamps. `T` must be the type of value
+  // that `kind` holds.
+  template <typename T>
+  std::shared_ptr<T> Find(Kind kind, const std::string& key, const Inputs& inputs) {
+    return std::static_pointer_cast<T>(FindValue(kind, key, inputs));
+  }
+
+  // Caches `value` as the value of kind `kind` for `key`, derived from `inputs`. `size` is the
+  // approximate number of bytes taken up by `value`. Values larger than the memory limit are not
+  // cached.
+  template <typename T>
+  void Insert(Kind kind, const std::string& key, Inputs inputs, std::shared_ptr<T> value,
+              size_t size) {
+    InsertValue(kind, key, std::move(inputs), std::static_pointer_cast<void>(std::move(value)),
+                size);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(InputCache);
+
+  struct Entry {
+    Kind kind;
+    std::string key;
+    Inputs inputs;
+    std::shared_ptr<void> value;
+    size_t size;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  std::shared_ptr<void> FindValue(Kind kind, const std::string& key, const Inputs& inputs);
+  void InsertValue(Kind kind, const std::string& key, Inputs inputs, std::shared_ptr<void> value,
+                   size_t size);
+  void Erase(EntryList::iterator iter);
+  void EvictToFit(size_t limit);
+
+  mutable std::mutex mutex_;
+  size_t memory_limit_ = 0u;
+  size_t size_ = 0u;
+
+  // Ordered from the most to the least recently used.
+  EntryList entries_;
+  std::map<std::pair<Kind, std::string>, EntryList::iterator> index_;
+};
+
+}  // namespace aapt
+
+#endif /* AAPT_UTIL_INPUTCACHE_H */
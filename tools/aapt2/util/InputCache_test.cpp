@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/InputCache.h"
+
+#include "android-base/file.h"
+#include "android-base/test_utils.h"
+
+#include "test/Test.h"
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::NotNull;
+
+namespace aapt {
+
+using Kind = InputCache::Kind;
+
+TEST(InputCacheTest, FindValueWhileInputsAreUnchanged) {
+  TemporaryFile file;
+  ASSERT_TRUE(android::base::WriteStringToFile("contents", file.path));
+
+  InputCache cache;
+  cache.SetMemoryLimit(1024u);
+
+  InputCache::Inputs inputs;
+  ASSERT_TRUE(InputCache::StampInputs({file.path}, &inputs));
+  cache.Insert(Kind::kCrunchedPng, file.path, inputs, std::make_shared<std::string>("crunched"),
+               8u);
+
+  std::shared_ptr<std::string> value =
+      cache.Find<std::string>(Kind::kCrunchedPng, file.path, inputs);
+  ASSERT_THAT(value, NotNull());
+  EXPECT_THAT(*value, Eq("crunched"));
+  EXPECT_THAT(cache.Find<std::string>(Kind::kCompiledContainer, file.path, inputs), IsNull());
+
+  ASSERT_TRUE(android::base::WriteStringToFile("new contents", file.path));
+  ASSERT_TRUE(InputCache::StampInputs({file.path}, &inputs));
+  EXPECT_THAT(cache.Find<std::string>(Kind::kCrunchedPng, file.path, inputs), IsNull());
+  EXPECT_THAT(cache.GetSize(), Eq(0u));
+}
+
+TEST(InputCacheTest, StampMissingFileFails) {
+  InputCache::Inputs inputs;
+  EXPECT_FALSE(InputCache::StampInputs({"/does/not/exist.flat"}, &inputs));
+}
+
+TEST(InputCacheTest, EvictLeastRecentlyUsedValues) {
+  InputCache cache;
+  cache.SetMemoryLimit(10u);
+
+  const InputCache::Inputs inputs;
+  cache.Insert(Kind::kCrunchedPng, "a", inputs, std::make_shared<int>(1), 4u);
+  cache.Insert(Kind::kCrunchedPng, "b", inputs, std::make_shared<int>(2), 4u);
+
+  // Use "a" so that "b" is the least recently used.
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "a", inputs), NotNull());
+
+  cache.Insert(Kind::kCrunchedPng, "c", inputs, std::make_shared<int>(3), 4u);
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "a", inputs), NotNull());
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "b", inputs), IsNull());
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "c", inputs), NotNull());
+  EXPECT_THAT(cache.GetSize(), Eq(8u));
+
+  // Values that can never fit are not cached.
+  cache.Insert(Kind::kCrunchedPng, "d", inputs, std::make_shared<int>(4), 11u);
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "d", inputs), IsNull());
+
+  cache.SetMemoryLimit(0u);
+  EXPECT_FALSE(cache.IsEnabled());
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "a", inputs), IsNull());
+  EXPECT_THAT(cache.GetSize(), Eq(0u));
+}
+
+TEST(InputCacheTest, DisabledByDefault) {
+  InputCache cache;
+  EXPECT_FALSE(cache.IsEnabled());
+
+  const InputCache::Inputs inputs;
+  cache.Insert(Kind::kCrunchedPng, "a", inputs, std::make_shared<int>(1), 1u);
+  EXPECT_THAT(cache.Find<int>(Kind::kCrunchedPng, "a", inputs), IsNull());
+}
+
+}  // namespace aapt
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace aapt {
+namespace util {
+
+// Set on the threads that run the calls of a ParallelFor using more than one thread.
+static thread_local bool tls_in_parallel_for = false;
+
+size_t GetDefaultJobCount() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ParallelFor(size_t count, size_t max_jobs, const std::function<void(size_t)>& func) {
+  if (max_jobs == 0) {
+    max_jobs = tls_in_parallel_for ? 1u : GetDefaultJobCount();
+  }
+
+  const size_t job_count = std::min(count, max_jobs);
+  if (job_count <= 1) {
+    for (size_t i = 0; i < count; i++) {
+      func(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_index{0};
+  auto worker = [&]() {
+    const bool was_in_parallel_for = tls_in_parallel_for;
+    tls_in_parallel_for = true;
+    size_t i;
+    while ((i = next_index.fetch_add(1, std::memory_order_relaxed)) < count) {
+      func(i);
+    }
+    tls_in_parallel_for = was_in_parallel_for;
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(job_count - 1);
+  for (size_t i = 1; i < job_count; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace util
+}  // namespace aapt
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AAPT_UTIL_PARALLEL_H
+#define AAPT_UTIL_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace aapt {
+namespace util {
+
+// Returns the number of threads to use when the caller does not specify a limit. This is the number
+// of hardware threads available, and is always at least 1.
+size_t GetDefaultJobCount();
+
+// Invokes `func` once for every index in [0, count), spreading the calls over at most `max_jobs`
+// threads. The calling thread is one of those threads. Indices are handed out one at a time, so
+// work items of uneven cost balance across the threads. Returns once every call has completed.
+//
+// When `max_jobs` is 0, GetDefaultJobCount() threads are used, except within a call of another
+// ParallelFor that runs on several threads, where one thread is used so that nested loops don't
+// multiply the number of threads. When only one thread is needed, every call runs in index order
+// on the calling thread.
+//
+// `func` must be safe to call concurrently with itself.
+void ParallelFor(size_t count, size_t max_jobs, const std::function<void(size_t)>& func);
+
+}  // namespace util
+}  // namespace aapt
+
+#endif  // AAPT_UTIL_PARALLEL_H
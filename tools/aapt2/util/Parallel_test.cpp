@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2018 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "test/Test.h"
+
+using ::testing::ElementsAre;
+
+namespace aapt {
+namespace util {
+
+TEST(ParallelTest, DefaultJobCountIsPositive) {
+  EXPECT_GE(GetDefaultJobCount(), 1u);
+}
+
+TEST(ParallelTest, VisitsEveryIndexExactlyOnce) {
+  std::vector<std::atomic<int>> visits(1000);
+  ParallelFor(visits.size(), 8u, [&](size_t i) { visits[i]++; });
+
+  for (const std::atomic<int>& count : visits) {
+    EXPECT_EQ(1, count.load());
+  }
+}
+
+TEST(ParallelTest, SingleJobRunsInOrderOnCallingThread) {
+  const std::thread::id caller = std::this_thread::get_id();
+  std::vector<size_t> order;
+  bool same_thread = true;
+  ParallelFor(4u, 1u, [&](size_t i) {
+    same_thread &= std::this_thread::get_id() == caller;
+    order.push_back(i);
+  });
+
+  EXPECT_TRUE(same_thread);
+  EXPECT_THAT(order, ElementsAre(0u, 1u, 2u, 3u));
+}
+
+TEST(ParallelTest, NeverExceedsMaxJobs) {
+  std::mutex mutex;
+  size_t active = 0;
+  size_t max_active = 0;
+  ParallelFor(64u, 3u, [&](size_t) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      max_active = std::max(max_active, ++active);
+    }
+    std::this_thread::yield();
+    std::lock_guard<std::mutex> lock(mutex);
+    active--;
+  });
+
+  EXPECT_LE(max_active, 3u);
+}
+
+TEST(ParallelTest, NestedDefaultJobCountRunsOnCallingThread) {
+  std::atomic<bool> same_thread{true};
+  std::atomic<int> calls{0};
+  ParallelFor(4u, 2u, [&](size_t) {
+    const std::thread::id caller = std::this_thread::get_id();
+    ParallelFor(8u, 0u, [&](size_t) {
+      if (std::this_thread::get_id() != caller) {
+        same_thread = false;
+      }
+      calls++;
+    });
+  });
+
+  EXPECT_TRUE(same_thread.load());
+  EXPECT_EQ(32, calls.load());
+}
+
+TEST(ParallelTest, EmptyRangeDoesNothing) {
+  bool called = false;
+  ParallelFor(0u, 0u, [&](size_t) { called = true; });
+  EXPECT_FALSE(called);
+}
+
+}  // namespace util
+}  // namespace aapt